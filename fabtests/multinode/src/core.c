@@ -62,6 +62,9 @@ static int multinode_setup_fabric(int argc, char **argv)
 	size_t len;
 	int ret;
 
+	/* the patterns use a single transfer size */
+	opts.options |= FT_OPT_SIZE;
+
 	hints->ep_attr->type = FI_EP_RDM;
 	hints->caps = FI_MSG;
 	hints->mode = FI_CONTEXT;
@@ -0,0 +1,686 @@
+/*
+ * Copyright (c) 2017-2019 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <rdma/fi_errno.h>
+#include <rdma/fi_domain.h>
+#include <rdma/fabric.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_collective.h>
+
+#include <core.h>
+#include <shared.h>
+
+/*
+ * Collective benchmark.  Every test is first run once with a known data
+ * pattern and the result validated, then timed over opts.iterations.
+ * Each rank's elapsed time is exchanged over the out-of-band channel and
+ * rank 0 reports the maximum, which is the latency of the collective.
+ */
+
+struct coll_test {
+	char			*name;
+	enum fi_op		op;
+	uint64_t		flags;
+	int			has_data;
+	ssize_t			(*run)(void);
+	int			(*check)(void);
+};
+
+static struct fid_av_set *av_set;
+static fi_addr_t coll_addr;
+
+static enum fi_datatype coll_datatypes[] = {
+	FI_INT32, FI_INT64, FI_FLOAT, FI_DOUBLE,
+};
+
+/* state of the test in progress */
+static enum fi_datatype coll_dt;
+static size_t coll_count;
+static void *coll_src, *coll_dst;
+
+static int coll_is_root(void)
+{
+	return pm_job.my_rank == 0;
+}
+
+static double coll_val(size_t rank, size_t idx)
+{
+	return (double) ((rank + idx) % 7 + 1);
+}
+
+static void coll_set(void *buf, size_t idx, double val)
+{
+	switch (coll_dt) {
+	case FI_INT32:
+		((int32_t *) buf)[idx] = (int32_t) val;
+		break;
+	case FI_INT64:
+		((int64_t *) buf)[idx] = (int64_t) val;
+		break;
+	case FI_FLOAT:
+		((float *) buf)[idx] = (float) val;
+		break;
+	case FI_DOUBLE:
+		((double *) buf)[idx] = val;
+		break;
+	default:
+		break;
+	}
+}
+
+static double coll_get(void *buf, size_t idx)
+{
+	switch (coll_dt) {
+	case FI_INT32:
+		return ((int32_t *) buf)[idx];
+	case FI_INT64:
+		return ((int64_t *) buf)[idx];
+	case FI_FLOAT:
+		return ((float *) buf)[idx];
+	case FI_DOUBLE:
+		return ((double *) buf)[idx];
+	default:
+		return 0;
+	}
+}
+
+static double coll_sum(size_t idx)
+{
+	double sum = 0;
+	size_t i;
+
+	for (i = 0; i < pm_job.num_ranks; i++)
+		sum += coll_val(i, idx);
+	return sum;
+}
+
+static int coll_expect(void *buf, size_t idx, double val)
+{
+	if (coll_get(buf, idx) == val)
+		return 0;
+
+	FT_ERR("rank %zu: element %zu is %g, expected %g\n", pm_job.my_rank,
+	       idx, coll_get(buf, idx), val);
+	return -FI_EIO;
+}
+
+/* reduce-scatter splits the result into per rank slices as evenly as
+ * possible, with the leading slices one element larger */
+static void coll_get_block(size_t idx, size_t *offset, size_t *len)
+{
+	size_t base = coll_count / pm_job.num_ranks;
+	size_t rem = coll_count % pm_job.num_ranks;
+
+	*len = base + (idx < rem);
+	*offset = idx * base + MIN(idx, rem);
+}
+
+static void coll_fill_src(size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++)
+		coll_set(coll_src, i, coll_val(pm_job.my_rank, i));
+}
+
+static ssize_t coll_barrier(void)
+{
+	return fi_barrier(ep, coll_addr, &tx_ctx);
+}
+
+static int coll_barrier_check(void)
+{
+	return 0;
+}
+
+static ssize_t coll_broadcast(void)
+{
+	return fi_broadcast(ep, coll_src, coll_count, NULL, coll_addr,
+			    pm_job.fi_addrs[0], coll_dt, 0, &tx_ctx);
+}
+
+static int coll_broadcast_check(void)
+{
+	size_t i;
+	int ret;
+
+	for (i = 0; i < coll_count; i++) {
+		ret = coll_expect(coll_src, i, coll_val(0, i));
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static ssize_t coll_allreduce(void)
+{
+	return fi_allreduce(ep, coll_src, coll_count, NULL, coll_dst, NULL,
+			    coll_addr, coll_dt, FI_SUM, 0, &tx_ctx);
+}
+
+static int coll_allreduce_check(void)
+{
+	size_t i;
+	int ret;
+
+	for (i = 0; i < coll_count; i++) {
+		ret = coll_expect(coll_dst, i, coll_sum(i));
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static ssize_t coll_reduce_scatter(void)
+{
+	return fi_reduce_scatter(ep, coll_src, coll_count, NULL, coll_dst,
+				 NULL, coll_addr, coll_dt, FI_SUM, 0, &tx_ctx);
+}
+
+static int coll_reduce_scatter_check(void)
+{
+	size_t i, offset, len;
+	int ret;
+
+	coll_get_block(pm_job.my_rank, &offset, &len);
+	for (i = 0; i < len; i++) {
+		ret = coll_expect(coll_dst, i, coll_sum(offset + i));
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static ssize_t coll_allgather(void)
+{
+	return fi_allgather(ep, coll_src, coll_count, NULL, coll_dst, NULL,
+			    coll_addr, coll_dt, 0, &tx_ctx);
+}
+
+static int coll_allgather_check(void)
+{
+	size_t i, r;
+	int ret;
+
+	for (r = 0; r < pm_job.num_ranks; r++) {
+		for (i = 0; i < coll_count; i++) {
+			ret = coll_expect(coll_dst, r * coll_count + i,
+					  coll_val(r, i));
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+static ssize_t coll_alltoall(void)
+{
+	return fi_alltoall(ep, coll_src, coll_count, NULL, coll_dst, NULL,
+			   coll_addr, coll_dt, 0, &tx_ctx);
+}
+
+static int coll_alltoall_check(void)
+{
+	size_t i, r, blk;
+	int ret;
+
+	blk = coll_count / pm_job.num_ranks;
+	for (r = 0; r < pm_job.num_ranks; r++) {
+		for (i = 0; i < blk; i++) {
+			ret = coll_expect(coll_dst, r * blk + i,
+				coll_val(r, pm_job.my_rank * blk + i));
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+static ssize_t coll_scatter(void)
+{
+	return fi_scatter(ep, coll_src, coll_count, NULL, coll_dst, NULL,
+			  coll_addr, pm_job.fi_addrs[0], coll_dt, 0, &tx_ctx);
+}
+
+static int coll_scatter_check(void)
+{
+	size_t i;
+	int ret;
+
+	for (i = 0; i < coll_count; i++) {
+		ret = coll_expect(coll_dst, i,
+			coll_val(0, pm_job.my_rank * coll_count + i));
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+static ssize_t coll_gather(void)
+{
+	return fi_gather(ep, coll_src, coll_count, NULL, coll_dst, NULL,
+			 coll_addr, pm_job.fi_addrs[0], coll_dt, 0, &tx_ctx);
+}
+
+static int coll_gather_check(void)
+{
+	if (!coll_is_root())
+		return 0;
+
+	return coll_allgather_check();
+}
+
+/* op and flags are only used to query support.  Scatter is queried as
+ * broadcast with the FI_SCATTER flag, the same way reduce-scatter is
+ * queried as its reduction.
+ */
+static struct coll_test coll_tests[] = {
+	{ "barrier", FI_BARRIER, 0, 0, coll_barrier, coll_barrier_check },
+	{ "broadcast", FI_BROADCAST, 0, 1, coll_broadcast,
+	  coll_broadcast_check },
+	{ "allreduce", FI_SUM, 0, 1, coll_allreduce, coll_allreduce_check },
+	{ "reduce_scatter", FI_SUM, FI_SCATTER, 1, coll_reduce_scatter,
+	  coll_reduce_scatter_check },
+	{ "allgather", FI_ALLGATHER, 0, 1, coll_allgather,
+	  coll_allgather_check },
+	{ "alltoall", FI_ALLTOALL, 0, 1, coll_alltoall, coll_alltoall_check },
+	{ "scatter", FI_BROADCAST, FI_SCATTER, 1, coll_scatter,
+	  coll_scatter_check },
+	{ "gather", FI_GATHER, 0, 1, coll_gather, coll_gather_check },
+};
+
+/* Sets up the source buffer for the validation run.  Receive buffers are
+ * cleared so that stale data from a previous test cannot pass the check.
+ */
+static void coll_prepare(struct coll_test *test)
+{
+	memset(coll_dst, 0, coll_count * datatype_to_size(coll_dt) *
+	       pm_job.num_ranks);
+
+	if (test->run == coll_broadcast) {
+		if (coll_is_root())
+			coll_fill_src(coll_count);
+		else
+			memset(coll_src, 0,
+			       coll_count * datatype_to_size(coll_dt));
+	} else if (test->run == coll_scatter) {
+		coll_fill_src(coll_count * pm_job.num_ranks);
+	} else {
+		coll_fill_src(coll_count);
+	}
+}
+
+static int coll_wait(void)
+{
+	return ft_get_tx_comp(++tx_seq);
+}
+
+static int coll_post(struct coll_test *test)
+{
+	ssize_t ret;
+
+	do {
+		ret = test->run();
+		if (ret == -FI_EAGAIN)
+			(void) fi_cq_read(txcq, NULL, 0);
+	} while (ret == -FI_EAGAIN);
+
+	if (ret) {
+		FT_ERR("%s: %s (%zd)\n", test->name, fi_strerror((int) -ret),
+		       ret);
+		return (int) ret;
+	}
+	return coll_wait();
+}
+
+static void coll_show_perf(struct coll_test *test, size_t size,
+			   int64_t *elapsed)
+{
+	static int header = 1;
+	char str[FT_STR_LEN];
+	int64_t max = 0, sum = 0;
+	double usec_max, usec_avg;
+	size_t i;
+
+	for (i = 0; i < pm_job.num_ranks; i++) {
+		max = MAX(max, elapsed[i]);
+		sum += elapsed[i];
+	}
+	usec_max = (double) max / opts.iterations;
+	usec_avg = (double) sum / pm_job.num_ranks / opts.iterations;
+
+	if (opts.machr) {
+		/* yaml list, see scripts/toCSV.py */
+		if (header) {
+			printf("---\nfi_multinode_coll:\n");
+			header = 0;
+		}
+		printf("- { test: %s, datatype: %s, ranks: %zu, "
+		       "xfer_size: %zu, iterations: %d, usec/op: %f, "
+		       "usec/op_avg: %f, MB/sec: %f }\n", test->name,
+		       test->has_data ? fi_tostr(&coll_dt, FI_TYPE_ATOMIC_TYPE) :
+		       "none", pm_job.num_ranks, size, opts.iterations,
+		       usec_max, usec_avg, usec_max ? size / usec_max : 0.0);
+		return;
+	}
+
+	if (header) {
+		printf("%-16s%-12s%-8s%-8s%12s%12s%12s\n", "name", "datatype",
+		       "bytes", "iters", "usec/op", "usec/op avg", "MB/sec");
+		header = 0;
+	}
+	printf("%-16s%-12s", test->name, test->has_data ?
+	       fi_tostr(&coll_dt, FI_TYPE_ATOMIC_TYPE) : "-");
+	printf("%-8s", size_str(str, size));
+	printf("%-8s", cnt_str(str, opts.iterations));
+	printf("%12.2f%12.2f%12.2f\n", usec_max, usec_avg,
+	       usec_max ? size / usec_max : 0.0);
+}
+
+static int coll_run_size(struct coll_test *test, size_t size)
+{
+	struct timespec start, end;
+	int64_t my_elapsed, *elapsed;
+	int i, ret;
+
+	coll_count = test->has_data ? size / datatype_to_size(coll_dt) : 0;
+	if (test->run == coll_alltoall)
+		coll_count -= coll_count % pm_job.num_ranks;
+	if (test->has_data && !coll_count)
+		return 0;
+
+	coll_prepare(test);
+	ret = coll_post(test);
+	if (ret)
+		return ret;
+
+	ret = test->check();
+	if (ret) {
+		FT_ERR("%s validation failed for %zu bytes\n", test->name,
+		       size);
+		return ret;
+	}
+
+	for (i = 0; i < opts.warmup_iterations; i++) {
+		ret = coll_post(test);
+		if (ret)
+			return ret;
+	}
+
+	pm_barrier();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < opts.iterations; i++) {
+		ret = coll_post(test);
+		if (ret)
+			return ret;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	my_elapsed = get_elapsed(&start, &end, MICRO);
+
+	elapsed = calloc(pm_job.num_ranks, sizeof(*elapsed));
+	if (!elapsed)
+		return -FI_ENOMEM;
+
+	ret = pm_allgather(&my_elapsed, elapsed, sizeof(my_elapsed));
+	if (!ret && coll_is_root())
+		coll_show_perf(test, size, elapsed);
+
+	free(elapsed);
+	return ret;
+}
+
+static int coll_supported(struct coll_test *test)
+{
+	struct fi_collective_attr attr;
+	enum fi_datatype dt;
+	int ret;
+
+	/* a barrier carries no data */
+	dt = test->has_data ? coll_dt : FI_VOID;
+
+	memset(&attr, 0, sizeof(attr));
+	ret = fi_query_collective(domain, dt, test->op, &attr, test->flags);
+	if (ret)
+		FT_DEBUG("%s %s not supported: %s\n", test->name,
+			 fi_tostr(&dt, FI_TYPE_ATOMIC_TYPE),
+			 fi_strerror(-ret));
+	return ret != -FI_ENOSYS && ret != -FI_EOPNOTSUPP;
+}
+
+static int coll_run_test(struct coll_test *test)
+{
+	int i, d, ret;
+
+	for (d = 0; d < ARRAY_SIZE(coll_datatypes); d++) {
+		coll_dt = coll_datatypes[d];
+		if (!coll_supported(test))
+			continue;
+
+		if (!test->has_data) {
+			ret = coll_run_size(test, 0);
+			if (ret)
+				return ret;
+			break;
+		}
+
+		if (opts.options & FT_OPT_SIZE) {
+			ret = coll_run_size(test, opts.transfer_size);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		for (i = 0; i < TEST_CNT; i++) {
+			if (!ft_use_size(i, opts.sizes_enabled))
+				continue;
+			ret = coll_run_size(test, test_size[i].size);
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+static size_t coll_max_size(void)
+{
+	size_t max = opts.transfer_size;
+	int i;
+
+	if (opts.options & FT_OPT_SIZE)
+		return max;
+
+	for (i = 0; i < TEST_CNT; i++) {
+		if (ft_use_size(i, opts.sizes_enabled))
+			max = MAX(max, test_size[i].size);
+	}
+	return max;
+}
+
+static int coll_join(void)
+{
+	struct fi_av_set_attr attr;
+	struct fi_eq_entry entry;
+	uint32_t event;
+	ssize_t ret;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.count = pm_job.num_ranks;
+	attr.start_addr = pm_job.fi_addrs[0];
+	attr.end_addr = pm_job.fi_addrs[pm_job.num_ranks - 1];
+	attr.stride = 1;
+
+	ret = fi_av_set(av, &attr, &av_set, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_av_set", ret);
+		return (int) ret;
+	}
+
+	ret = fi_av_set_addr(av_set, &coll_addr);
+	if (ret) {
+		FT_PRINTERR("fi_av_set_addr", ret);
+		return (int) ret;
+	}
+
+	ret = fi_join_collective(ep, coll_addr, av_set, 0, &mc, NULL);
+	if (ret) {
+		FT_PRINTERR("fi_join_collective", ret);
+		return (int) ret;
+	}
+
+	/* the join is itself a collective, so drive progress while
+	 * waiting for it to complete */
+	do {
+		(void) fi_cq_read(txcq, NULL, 0);
+		(void) fi_cq_read(rxcq, NULL, 0);
+		ret = fi_eq_read(eq, &event, &entry, sizeof(entry), 0);
+	} while (ret == -FI_EAGAIN);
+
+	if (ret == -FI_EAVAIL) {
+		eq_readerr(eq, "join collective");
+		return (int) ret;
+	}
+	if (ret < 0 || event != FI_JOIN_COMPLETE) {
+		FT_ERR("unexpected join event %u (%zd)\n", event, ret);
+		return ret < 0 ? (int) ret : -FI_EOTHER;
+	}
+
+	coll_addr = fi_mc_addr(mc);
+	return 0;
+}
+
+static int coll_setup_fabric(void)
+{
+	char my_name[FT_MAX_CTRL_MSG];
+	size_t len;
+	int ret;
+
+	hints->ep_attr->type = FI_EP_RDM;
+	hints->caps = FI_MSG | FI_TAGGED | FI_COLLECTIVE;
+	hints->mode = FI_CONTEXT;
+	hints->domain_attr->mr_mode = opts.mr_mode;
+
+	tx_seq = 0;
+	rx_seq = 0;
+	tx_cq_cntr = 0;
+	rx_cq_cntr = 0;
+
+	/* reported as not run when no provider supports collectives */
+	ret = ft_getinfo(hints, &fi);
+	if (ret == -FI_ENODATA)
+		FT_ERR("no provider supports FI_COLLECTIVE with these hints\n");
+	if (ret)
+		return ret;
+
+	ret = ft_open_fabric_res();
+	if (ret)
+		return ret;
+
+	opts.av_size = pm_job.num_ranks;
+	ret = ft_alloc_active_res(fi);
+	if (ret)
+		return ret;
+
+	ret = ft_enable_ep(ep, eq, av, txcq, rxcq, txcntr, rxcntr);
+	if (ret)
+		return ret;
+
+	len = FT_MAX_CTRL_MSG;
+	ret = fi_getname(&ep->fid, (void *) my_name, &len);
+	if (ret) {
+		FT_PRINTERR("error determining local endpoint name\n", ret);
+		return ret;
+	}
+
+	pm_job.name_len = len;
+	pm_job.names = malloc(len * pm_job.num_ranks);
+	pm_job.fi_addrs = calloc(pm_job.num_ranks, sizeof(*pm_job.fi_addrs));
+	if (!pm_job.names || !pm_job.fi_addrs) {
+		FT_ERR("error allocating memory for address exchange\n");
+		return -FI_ENOMEM;
+	}
+
+	ret = pm_allgather(my_name, pm_job.names, pm_job.name_len);
+	if (ret) {
+		FT_PRINTERR("error exchanging addresses\n", ret);
+		return ret;
+	}
+
+	ret = fi_av_insert(av, pm_job.names, pm_job.num_ranks,
+			   pm_job.fi_addrs, 0, NULL);
+	if (ret != pm_job.num_ranks) {
+		FT_ERR("unable to insert all addresses into AV table\n");
+		return -1;
+	}
+
+	return coll_join();
+}
+
+int multinode_run_tests(int argc, char **argv)
+{
+	size_t max_size;
+	int i, ret;
+
+	ret = coll_setup_fabric();
+	if (ret)
+		goto out;
+
+	/* scatter, gather, allgather and alltoall results span all ranks */
+	max_size = coll_max_size() * pm_job.num_ranks;
+	coll_src = calloc(1, max_size);
+	coll_dst = calloc(1, max_size);
+	if (!coll_src || !coll_dst) {
+		ret = -FI_ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(coll_tests) && !ret; i++) {
+		ret = coll_run_test(&coll_tests[i]);
+		if (ret)
+			FT_ERR("%s failed\n", coll_tests[i].name);
+	}
+	pm_barrier();
+
+out:
+	free(coll_src);
+	free(coll_dst);
+	FT_CLOSE_FID(mc);
+	FT_CLOSE_FID(av_set);
+	free(pm_job.names);
+	free(pm_job.fi_addrs);
+	ft_free_res();
+	return ft_exit_code(ret);
+}
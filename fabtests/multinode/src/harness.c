@@ -272,7 +272,7 @@ int main(int argc, char **argv)
 	int c, ret;
 
 	opts = INIT_OPTS;
-	opts.options |= (FT_OPT_SIZE | FT_OPT_ALLOC_MULT_MR);
+	opts.options |= FT_OPT_ALLOC_MULT_MR;
 
 	pm_job.clients = NULL;
 
@@ -280,10 +280,10 @@ int main(int argc, char **argv)
 	if (!hints)
 		return EXIT_FAILURE;
 
-	while ((c = getopt(argc, argv, "n:h" ADDR_OPTS INFO_OPTS)) != -1) {
+	while ((c = getopt(argc, argv, "n:h" CS_OPTS INFO_OPTS)) != -1) {
 		switch (c) {
 		default:
-			ft_parse_addr_opts(c, optarg, &opts);
+			ft_parsecsopts(c, optarg, &opts);
 			ft_parseinfo(c, optarg, hints, &opts);
 			break;
 		case '?':
@@ -291,7 +291,8 @@ int main(int argc, char **argv)
 			pm_job.num_ranks = atoi(optarg);
 			break;
 		case 'h':
-			ft_usage(argv[0], "A simple multinode test");
+			ft_csusage(argv[0], "A simple multinode test");
+			FT_PRINT_OPTS_USAGE("-n <number>", "number of ranks");
 			return EXIT_FAILURE;
 		}
 	}
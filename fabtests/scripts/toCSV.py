@@ -11,8 +11,8 @@ except ImportError:
 	sys.exit(1)
 
 def main(argv=None):
-	"""Convert runfabtests.sh yaml output to CSV. If no argument is given
-	   stdin is read, otherwise read from file.
+	"""Convert runfabtests.sh or benchmark (-m) yaml output to CSV. If
+	   no argument is given stdin is read, otherwise read from file.
 	"""
 
 	parser = OptionParser(description=main.__doc__, usage="usage: %prog [file]")
@@ -23,9 +23,24 @@ def main(argv=None):
 	else:
 		fd = open(args[0], 'r')
 
-	yi = yaml.load(fd.read())
+	yi = yaml.safe_load(fd.read())
 
 	csv_fd = csv.writer(sys.stdout, delimiter=",", quotechar='"', quoting=csv.QUOTE_NONNUMERIC)
+
+	# Performance tests (-m) emit a list of result entries per test
+	# instead of a status, write those one row per entry.
+	if all(isinstance(v, list) for v in yi.values()):
+		fields = []
+		for v in yi.values():
+			for entry in v:
+				fields += [f for f in entry if f not in fields]
+
+		csv_fd.writerow(["Test name"] + fields)
+		for k,v in yi.items():
+			for entry in v:
+				csv_fd.writerow([k] + [entry.get(f, "") for f in fields])
+		return 0
+
 	csv_fd.writerow(["Test name", "Status"])
 	
 	for k,v in yi.items():
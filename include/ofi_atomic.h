@@ -56,6 +56,24 @@ extern void (*ofi_atomic_swap_handlers[OFI_SWAP_OP_LAST][FI_DATATYPE_LAST])
 			(void *dst, const void *src, const void *cmp,
 			 void *res, size_t cnt);
 
+/*
+ * Non-atomic variants of the write handlers.  Only use these when the
+ * target buffer cannot be accessed concurrently, e.g. bounce buffers.
+ */
+extern void (*ofi_atomic_reduce_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
+			(void *dst, const void *src, size_t cnt);
+
+/*
+ * Atomicity is only defined between operations of a single domain.  With
+ * FI_THREAD_DOMAIN the application serializes all access to the domain,
+ * so a provider that applies atomics from its progress path may use the
+ * non-atomic kernels.
+ */
+#define ofi_atomic_write_handler(threading, op, datatype)	\
+	((threading) == FI_THREAD_DOMAIN ?			\
+	 ofi_atomic_reduce_handlers[op][datatype] :		\
+	 ofi_atomic_write_handlers[op][datatype])
+
 int ofi_atomic_valid(const struct fi_provider *prov,
 		     enum fi_datatype datatype, enum fi_op op, uint64_t flags);
 
@@ -48,6 +48,11 @@ enum util_coll_op_type {
 	UTIL_COLL_BARRIER_OP,
 	UTIL_COLL_ALLREDUCE_OP,
 	UTIL_COLL_BROADCAST_OP,
+	UTIL_COLL_ALLGATHER_OP,
+	UTIL_COLL_REDUCE_SCATTER_OP,
+	UTIL_COLL_ALLTOALL_OP,
+	UTIL_COLL_SCATTER_OP,
+	UTIL_COLL_GATHER_OP,
 };
 
 struct util_av_set {
@@ -78,6 +83,7 @@ struct util_coll_hdr {
 
 struct util_coll_xfer_item {
 	struct util_coll_hdr	hdr;
+	struct util_coll_mc	*coll_mc;
 	void 			*buf;
 	int			count;
 	union {
@@ -118,6 +124,7 @@ struct util_coll_comp_item {
 	struct util_coll_hdr	hdr;
 	enum util_coll_op_type	op_type;
 	void			*data;
+	void			*context;
 	util_coll_comp_t	comp_fn;
 };
 
@@ -127,12 +134,32 @@ struct util_coll_mc {
 	struct util_av_set 	*av_set;
 	struct slist		barrier_list;
 	struct slist		deferred_list;
+	/* work of the operation being issued, moved to deferred_list once
+	 * all of it has been allocated */
+	struct slist		build_list;
+	struct dlist_entry	ready_entry;
+	/* set while deferred work waits for barrier_list to drain */
+	int			barrier_wait;
 	int 			my_rank;
 	uint16_t		cid;
 	uint16_t		tag_seq;
 	ofi_atomic32_t		ref;
 };
 
+void ofi_coll_init(void);
+
+int ofi_query_collective(struct fid_domain *domain, enum fi_datatype datatype,
+			 enum fi_op op, struct fi_atomic_attr *attr,
+			 uint64_t flags);
+
+/* Providers call this, with the EP's lock held, when a transfer posted with
+ * FI_COLLECTIVE completes, passing the transfer's context, and
+ * ofi_coll_ep_progress from EP progress without the lock held, to post the
+ * transfers that were waiting on it.
+ */
+void ofi_coll_handle_comp(void *ctx);
+void ofi_coll_ep_progress(struct fid_ep *ep);
+
 int ofi_join_collective(struct fid_ep *ep, fi_addr_t coll_addr,
 			const struct fid_av_set *set, uint64_t flags,
 			struct fid_mc **mc, void *context);
@@ -151,5 +178,22 @@ ssize_t ofi_ep_writereadmsg(struct fid_ep *ep, const struct fi_msg_collective *m
 			struct fi_ioc *resultv, void **result_desc,
 			size_t result_count, uint64_t flags);
 
+ssize_t ofi_ep_broadcast(struct fid_ep *ep, void *buf, size_t count, void *desc,
+			 fi_addr_t coll_addr, fi_addr_t root_addr,
+			 enum fi_datatype datatype, uint64_t flags,
+			 void *context);
+
+ssize_t ofi_ep_scatter(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, uint64_t flags,
+		       void *context);
+
+ssize_t ofi_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		      void *desc, void *result, void *result_desc,
+		      fi_addr_t coll_addr, fi_addr_t root_addr,
+		      enum fi_datatype datatype, uint64_t flags,
+		      void *context);
+
 
 #endif // _OFI_COLL_H_
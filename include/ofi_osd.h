@@ -72,9 +72,11 @@ typedef long double long_double;
 #ifdef __GNUC__
 #define OFI_LIKELY(x)	__builtin_expect((x), 1)
 #define OFI_UNLIKELY(x)	__builtin_expect((x), 0)
+#define OFI_PREFETCH(x)	__builtin_prefetch(x)
 #else
 #define OFI_LIKELY(x)	(x)
 #define OFI_UNLIKELY(x)	(x)
+#define OFI_PREFETCH(x)	((void) (x))
 #endif
 
 enum {
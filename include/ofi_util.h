@@ -294,6 +294,9 @@ struct util_ep {
 	fastlock_t		lock;
 	ofi_fastlock_acquire_t	lock_acquire;
 	ofi_fastlock_release_t	lock_release;
+
+	/* collective groups with work ready to be scheduled */
+	struct dlist_entry	coll_ready_queue;
 };
 
 int ofi_ep_bind_av(struct util_ep *util_ep, struct util_av *av);
@@ -468,6 +471,9 @@ struct util_cq {
 
 	struct util_comp_cirq	*cirq;
 	fi_addr_t		*src;
+	/* entries set aside for accepted operations that have not completed,
+	 * protected by cq_lock */
+	size_t			reserved;
 
 	struct slist		oflow_err_list;
 	fi_cq_read_func		read_entry;
@@ -476,6 +482,14 @@ struct util_cq {
 	ofi_cq_progress_func	progress;
 };
 
+/* Caller must hold cq_lock */
+static inline size_t ofi_cq_avail(struct util_cq *cq)
+{
+	size_t free = ofi_cirque_freecnt(cq->cirq);
+
+	return free > cq->reserved ? free - cq->reserved : 0;
+}
+
 int ofi_cq_init(const struct fi_provider *prov, struct fid_domain *domain,
 		 struct fi_cq_attr *attr, struct util_cq *cq,
 		 ofi_cq_progress_func progress, void *context);
@@ -802,7 +816,7 @@ const char *ofi_eq_strerror(struct fid_eq *eq_fid, int prov_errno,
  * Attributes and capabilities
  */
 #define FI_PRIMARY_CAPS	(FI_MSG | FI_RMA | FI_TAGGED | FI_ATOMICS | FI_MULTICAST | \
-			 FI_NAMED_RX_CTX | FI_DIRECTED_RECV | \
+			 FI_COLLECTIVE | FI_NAMED_RX_CTX | FI_DIRECTED_RECV | \
 			 FI_READ | FI_WRITE | FI_RECV | FI_SEND | \
 			 FI_REMOTE_READ | FI_REMOTE_WRITE)
 
@@ -601,6 +601,7 @@ enum {
 	FI_FLUSH_WORK,		/* NULL */
 	FI_REFRESH,		/* mr: fi_mr_modify */
 	FI_DUP,			/* struct fid ** */
+	FI_CONNECT_PEERS,	/* struct fi_connect_peers * */
 };
 
 static inline int fi_control(struct fid *fid, int command, void *arg)
@@ -95,6 +95,23 @@ struct fi_ops_collective {
 			const struct fi_msg_collective *msg,
 			struct fi_ioc *resultv, void **result_desc,
 			size_t result_count, uint64_t flags);
+	ssize_t	(*broadcast)(struct fid_ep *ep,
+			void *buf, size_t count, void *desc,
+			fi_addr_t coll_addr, fi_addr_t root_addr,
+			enum fi_datatype datatype, uint64_t flags,
+			void *context);
+	ssize_t	(*scatter)(struct fid_ep *ep,
+			const void *buf, size_t count, void *desc,
+			void *result, void *result_desc,
+			fi_addr_t coll_addr, fi_addr_t root_addr,
+			enum fi_datatype datatype, uint64_t flags,
+			void *context);
+	ssize_t	(*gather)(struct fid_ep *ep,
+			const void *buf, size_t count, void *desc,
+			void *result, void *result_desc,
+			fi_addr_t coll_addr, fi_addr_t root_addr,
+			enum fi_datatype datatype, uint64_t flags,
+			void *context);
 };
 
 
@@ -168,16 +185,12 @@ fi_barrier(struct fid_ep *ep, fi_addr_t coll_addr, void *context)
 
 static inline ssize_t
 fi_broadcast(struct fid_ep *ep, void *buf, size_t count, void *desc,
-	     fi_addr_t coll_addr, enum fi_datatype datatype,
-	     enum fi_op op, uint64_t flags, void *context)
+	     fi_addr_t coll_addr, fi_addr_t root_addr,
+	     enum fi_datatype datatype, uint64_t flags, void *context)
 {
-	if (flags & FI_SEND) {
-		return ep->collective->writeread(ep, buf, count, desc,
-			NULL, NULL, coll_addr, datatype, op, flags, context);
-	} else {
-		return ep->collective->writeread(ep, NULL, count, NULL,
-			buf, desc, coll_addr, datatype, op, flags, context);
-	}
+	return FI_CHECK_OP(ep->collective, struct fi_ops_collective, broadcast) ?
+		ep->collective->broadcast(ep, buf, count, desc, coll_addr,
+			root_addr, datatype, flags, context) : -FI_ENOSYS;
 }
 
 static inline ssize_t
@@ -223,6 +236,30 @@ fi_allgather(struct fid_ep *ep, const void *buf, size_t count, void *desc,
 		flags, context);
 }
 
+static inline ssize_t
+fi_scatter(struct fid_ep *ep, const void *buf, size_t count, void *desc,
+	   void *result, void *result_desc, fi_addr_t coll_addr,
+	   fi_addr_t root_addr, enum fi_datatype datatype,
+	   uint64_t flags, void *context)
+{
+	return FI_CHECK_OP(ep->collective, struct fi_ops_collective, scatter) ?
+		ep->collective->scatter(ep, buf, count, desc, result,
+			result_desc, coll_addr, root_addr, datatype,
+			flags, context) : -FI_ENOSYS;
+}
+
+static inline ssize_t
+fi_gather(struct fid_ep *ep, const void *buf, size_t count, void *desc,
+	  void *result, void *result_desc, fi_addr_t coll_addr,
+	  fi_addr_t root_addr, enum fi_datatype datatype,
+	  uint64_t flags, void *context)
+{
+	return FI_CHECK_OP(ep->collective, struct fi_ops_collective, gather) ?
+		ep->collective->gather(ep, buf, count, desc, result,
+			result_desc, coll_addr, root_addr, datatype,
+			flags, context) : -FI_ENOSYS;
+}
+
 static inline int
 fi_query_collective(struct fid_domain *domain,
 		    enum fi_datatype datatype, enum fi_op op,
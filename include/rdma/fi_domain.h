@@ -197,6 +197,7 @@ enum fi_op {
 	FI_BROADCAST,
 	FI_ALLTOALL,
 	FI_ALLGATHER,
+	FI_GATHER,
 };
 
 #endif
@@ -68,6 +68,14 @@ enum {
 	FI_OPT_RX_SIZE,
 };
 
+/* FI_CONNECT_PEERS control argument */
+struct fi_connect_peers {
+	const fi_addr_t		*addr;
+	size_t			count;
+	size_t			max_pending;	/* 0 for provider default */
+	void			*context;
+};
+
 struct fi_ops_ep {
 	size_t	size;
 	ssize_t	(*cancel)(fid_t fid, void *context);
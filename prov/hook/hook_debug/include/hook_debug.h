@@ -37,7 +37,7 @@
 #include "ofi.h"
 
 #define HOOK_DEBUG_EAGAIN_LOG 10000000
-#define HOOK_DEBUG_EQ_EVENT_MAX (FI_JOIN_COMPLETE + 1)
+#define HOOK_DEBUG_EQ_EVENT_MAX (FI_CONNECT_COMPLETE + 1)
 
 extern struct hook_prov_ctx hook_debug_ctx;
 
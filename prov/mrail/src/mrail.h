@@ -53,6 +53,7 @@
 #include <ofi_proto.h>
 #include <ofi_prov.h>
 #include <ofi_enosys.h>
+#include <ofi_recvwin.h>
 
 #define MRAIL_MAJOR_VERSION 1
 #define MRAIL_MINOR_VERSION 0
@@ -82,11 +83,18 @@ extern size_t mrail_num_info;
 enum {
 	MRAIL_POLICY_FIXED,
 	MRAIL_POLICY_ROUND_ROBIN,
-	MRAIL_POLICY_STRIPING
+	MRAIL_POLICY_STRIPING,
+	MRAIL_POLICY_ADAPTIVE
 };
 
 #define MRAIL_MAX_CONFIG		8
 
+#define MRAIL_ADAPT_PROBE_INTERVAL	32
+#define MRAIL_ADAPT_MIN_SAMPLE		16384
+#define MRAIL_ADAPT_MAX_WEIGHT		1024
+
+#define MRAIL_MAX_WEIGHTS		16
+
 struct mrail_config {
 	size_t		max_size;
 	int		policy;
@@ -94,6 +102,9 @@ struct mrail_config {
 
 extern struct mrail_config mrail_config[MRAIL_MAX_CONFIG];
 extern int mrail_num_config;
+extern size_t mrail_weights[MRAIL_MAX_WEIGHTS];
+extern int mrail_num_weights;
+extern size_t mrail_min_stripe;
 extern int mrail_local_rank;
 
 extern struct fi_ops_rma mrail_ops_rma;
@@ -169,6 +180,15 @@ struct mrail_rndv_req {
 	uint8_t			rawkey[]; /* rawkey + base_addr */
 };
 
+/* Bytes posted to a rail and when, used to weigh the rail's load. A zero
+ * length means the transfer isn't accounted for. */
+struct mrail_rail_sample {
+	uint64_t		start;
+	size_t			len;
+	size_t			ahead;	/* bytes pending on the rail at post */
+	uint32_t		rail;
+};
+
 struct mrail_tx_buf {
 	/* context should stay at top and would get overwritten on
 	 * util buf release */
@@ -181,6 +201,7 @@ struct mrail_tx_buf {
 	struct mrail_rndv_hdr	rndv_hdr;
 	struct mrail_rndv_req	*rndv_req;
 	fid_t			rndv_mr_fid;
+	struct mrail_rail_sample sample;
 };
 
 struct mrail_pkt {
@@ -245,17 +266,18 @@ struct mrail_av {
 	size_t num_avs;
 };
 
-struct mrail_peer_info {
-	struct slist	ooo_recv_queue;
-	fi_addr_t	addr;
-	uint32_t	seq_no;
-	uint32_t	expected_seq_no;
-};
+/* Completions received ahead of their sequence number are parked in a
+ * window indexed by it.  Unused slots have a NULL op_context. */
+OFI_DECL_RECVWIN_BUF(struct fi_cq_tagged_entry, mrail_recvwin);
 
-struct mrail_ooo_recv {
-	struct slist_entry 		entry;
-	struct fi_cq_tagged_entry 	comp;
-	uint32_t 			seq_no;
+#define MRAIL_RECVWIN_SIZE	64
+
+struct mrail_peer_info {
+	/* the window's buffer is allocated on the first out of order
+	 * message and grown as needed */
+	struct mrail_recvwin	recvwin;
+	fi_addr_t		addr;
+	uint32_t		seq_no;
 };
 
 typedef int (*mrail_cq_process_comp_func_t)(struct fi_cq_tagged_entry *comp,
@@ -273,18 +295,26 @@ struct mrail_ep {
 	struct {
 		struct fid_ep 		*ep;
 		struct fi_info		*info;
+		/* bytes posted but not completed yet */
+		size_t			pending;
+		/* average usec per MiB, 0 until sampled */
+		uint64_t		cost;
+		/* share of striped transfers */
+		size_t			weight;
 	}			*rails;
 	size_t			num_eps;
 	ofi_atomic32_t		tx_rail;
 	ofi_atomic32_t		rx_rail;
 	int			default_tx_rail;
+	/* track the rail load for MRAIL_POLICY_ADAPTIVE */
+	int			adaptive;
+	size_t			adapt_picks;
 
 	struct mrail_recv_fs	*recv_fs;
 	struct mrail_recv_queue recv_queue;
 	struct mrail_recv_queue trecv_queue;
 
 	struct ofi_bufpool	*req_pool;
-	struct ofi_bufpool 	*ooo_recv_pool;
 	struct ofi_bufpool 	*tx_buf_pool;
 	struct slist		deferred_reqs;
 };
@@ -380,12 +410,117 @@ static inline int mrail_get_policy(size_t size)
 	return mrail_config[i].policy;
 }
 
-static inline size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep, int policy)
+/*
+ * Pick the rail that would finish len more bytes first: the one with the
+ * lowest (pending + len) * cost.  Rails not sampled yet are assumed to be
+ * as fast as the fastest one, so they get tried.  The scan starts at the
+ * round-robin rail to spread ties.  Every MRAIL_ADAPT_PROBE_INTERVAL picks
+ * the round-robin rail is taken as is, so that a rail measured slow once
+ * is sampled again.
+ *
+ * Should only be called while holding the EP's lock
+ */
+static inline size_t mrail_get_tx_rail_adaptive(struct mrail_ep *mrail_ep,
+						size_t len)
 {
-	return policy == MRAIL_POLICY_FIXED ?
-				mrail_ep->default_tx_rail :
-				mrail_get_tx_rail_rr(mrail_ep);
+	uint64_t cost, min_cost = 0, load, best_load = UINT64_MAX;
+	size_t i, rail, start, best;
+
+	start = best = mrail_get_tx_rail_rr(mrail_ep);
+	if (!(++mrail_ep->adapt_picks % MRAIL_ADAPT_PROBE_INTERVAL))
+		return start;
 
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		cost = mrail_ep->rails[i].cost;
+		if (cost && (!min_cost || cost < min_cost))
+			min_cost = cost;
+	}
+	if (!min_cost)
+		min_cost = 1;
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		rail = (start + i) % mrail_ep->num_eps;
+		cost = mrail_ep->rails[rail].cost ?
+		       mrail_ep->rails[rail].cost : min_cost;
+		load = (mrail_ep->rails[rail].pending + len) * cost;
+		if (load < best_load) {
+			best_load = load;
+			best = rail;
+		}
+	}
+	return best;
+}
+
+/* Should only be called while holding the EP's lock */
+static inline size_t mrail_get_tx_rail(struct mrail_ep *mrail_ep, int policy,
+				       size_t len)
+{
+	switch (policy) {
+	case MRAIL_POLICY_FIXED:
+		return mrail_ep->default_tx_rail;
+	case MRAIL_POLICY_ADAPTIVE:
+		return mrail_get_tx_rail_adaptive(mrail_ep, len);
+	default:
+		return mrail_get_tx_rail_rr(mrail_ep);
+	}
+}
+
+/* Should only be called while holding the EP's lock */
+static inline void mrail_rail_load_add(struct mrail_ep *mrail_ep,
+				       struct mrail_rail_sample *sample,
+				       uint32_t rail, size_t len)
+{
+	if (!mrail_ep->adaptive || !len)
+		return;
+
+	sample->rail = rail;
+	sample->len = len;
+	sample->ahead = mrail_ep->rails[rail].pending;
+	sample->start = fi_gettime_us();
+	mrail_ep->rails[rail].pending += len;
+}
+
+/* Should only be called while holding the EP's lock */
+static inline void mrail_rail_load_cancel(struct mrail_ep *mrail_ep,
+					  struct mrail_rail_sample *sample)
+{
+	if (!sample->len)
+		return;
+
+	mrail_ep->rails[sample->rail].pending -= sample->len;
+	sample->len = 0;
+}
+
+/*
+ * The time a transfer took includes waiting for the bytes posted ahead of
+ * it on the rail, so it's charged for those too.  Transfers of fewer than
+ * MRAIL_ADAPT_MIN_SAMPLE bytes that way mostly measure the rail's latency
+ * and are not sampled.
+ *
+ * Should only be called while holding the EP's lock
+ */
+static inline void mrail_rail_load_done(struct mrail_ep *mrail_ep,
+					struct mrail_rail_sample *sample)
+{
+	uint64_t cost;
+
+	if (!sample->len)
+		return;
+
+	if (sample->ahead + sample->len < MRAIL_ADAPT_MIN_SAMPLE)
+		goto out;
+
+	cost = ((fi_gettime_us() - sample->start) << 20) /
+	       (sample->ahead + sample->len);
+	if (!cost)
+		cost = 1;
+	if (mrail_ep->rails[sample->rail].cost)
+		mrail_ep->rails[sample->rail].cost =
+			(7 * mrail_ep->rails[sample->rail].cost + cost) / 8;
+	else
+		mrail_ep->rails[sample->rail].cost = cost;
+out:
+	mrail_rail_load_cancel(mrail_ep, sample);
 }
 
 struct mrail_subreq {
@@ -396,6 +531,9 @@ struct mrail_subreq {
 	struct fi_rma_iov rma_iov[MRAIL_IOV_LIMIT];
 	size_t iov_count;
 	size_t rma_iov_count;
+	size_t len;
+	uint32_t rail;
+	struct mrail_rail_sample sample;
 };
 
 struct mrail_req {
@@ -407,6 +545,8 @@ struct mrail_req {
 	struct fi_cq_tagged_entry comp;
 	ofi_atomic32_t expected_subcomps;
 	int op_type;
+	int policy;
+	int subreq_count;
 	int pending_subreq;
 	struct mrail_subreq subreqs[];
 };
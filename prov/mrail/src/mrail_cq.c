@@ -59,6 +59,7 @@ static int mrail_cq_write_send_comp(struct util_cq *cq,
 	}
 
 	ofi_ep_lock_acquire(&tx_buf->ep->util_ep);
+	mrail_rail_load_done(tx_buf->ep, &tx_buf->sample);
 	ofi_buf_free(tx_buf);
 	ofi_ep_lock_release(&tx_buf->ep->util_ep);
 
@@ -314,88 +315,121 @@ static struct mrail_recv *mrail_match_recv(struct mrail_ep *mrail_ep,
 	return recv;
 }
 
-static
-struct mrail_ooo_recv *mrail_get_next_recv(struct mrail_peer_info *peer_info)
+/*
+ * Grows the window until it fits id, keeping the messages in it at their
+ * offsets from the expected one.
+ *
+ * Should only be called while holding the EP's lock
+ */
+static int mrail_recvwin_grow(struct mrail_recvwin *recvwin, uint64_t id)
 {
-	struct slist *queue = &peer_info->ooo_recv_queue;
-	struct mrail_ooo_recv *ooo_recv;
-
-	if (!slist_empty(queue)) {
-		ooo_recv = container_of(queue->head, struct mrail_ooo_recv,
-				entry);
-		if (ooo_recv->seq_no == peer_info->expected_seq_no) {
-			slist_remove_head(queue);
-			peer_info->expected_seq_no++;
-			return ooo_recv;
-		}
+	struct recvwin_cirq *pending;
+	unsigned int size, i;
+
+	size = recvwin->pending ? recvwin->win_size : MRAIL_RECVWIN_SIZE;
+	while (id - ofi_recvwin_next_exp_id(recvwin) >= size)
+		size <<= 1;
+
+	pending = recvwin_cirq_create(size);
+	if (!pending)
+		return -FI_ENOMEM;
+
+	if (recvwin->pending) {
+		for (i = 0; i < recvwin->win_size; i++)
+			pending->buf[i] = *ofi_recvwin_get_msg(recvwin,
+					ofi_recvwin_next_exp_id(recvwin) + i);
+		pending->wcnt = ofi_cirque_usedcnt(recvwin->pending);
+		recvwin_cirq_free(recvwin->pending);
 	}
-	return NULL;
+
+	recvwin->pending = pending;
+	recvwin->win_size = size;
+	return 0;
+}
+
+/* Maps the 32 bit sequence number of a message to its position in the
+ * stream, which can't be behind the expected one. */
+static inline uint64_t mrail_recvwin_msg_id(struct mrail_recvwin *recvwin,
+					    uint32_t seq_no)
+{
+	uint64_t exp_id = ofi_recvwin_next_exp_id(recvwin);
+
+	return exp_id + (uint32_t) (seq_no - (uint32_t) exp_id);
+}
+
+/* Should only be called while holding the EP's lock */
+static inline void mrail_recvwin_advance(struct mrail_recvwin *recvwin)
+{
+	if (recvwin->pending)
+		ofi_recvwin_slide(recvwin);
+	else
+		ofi_recvwin_exp_inc(recvwin);
+}
+
+/* Should only be called while holding the EP's lock */
+static int mrail_get_next_recv(struct mrail_peer_info *peer_info,
+			       struct fi_cq_tagged_entry *comp)
+{
+	struct mrail_recvwin *recvwin = &peer_info->recvwin;
+	struct fi_cq_tagged_entry *next;
+
+	if (!recvwin->pending || !ofi_recvwin_peek(recvwin)->op_context)
+		return 0;
+
+	next = ofi_recvwin_get_next_msg(recvwin);
+	*comp = *next;
+	next->op_context = NULL;
+	return 1;
 }
 
 static int mrail_process_ooo_recvs(struct mrail_ep *mrail_ep,
 				   struct mrail_peer_info *peer_info)
 {
-	struct mrail_ooo_recv *ooo_recv;
+	struct fi_cq_tagged_entry comp;
 	struct mrail_recv *recv;
 	int ret;
 
 	ofi_ep_lock_acquire(&mrail_ep->util_ep);
-	ooo_recv = mrail_get_next_recv(peer_info);
-	while (ooo_recv) {
-		FI_DBG(&mrail_prov, FI_LOG_CQ, "found ooo_recv seq=%d\n",
-				ooo_recv->seq_no);
+	while (mrail_get_next_recv(peer_info, &comp)) {
+		FI_DBG(&mrail_prov, FI_LOG_CQ, "found ooo_recv seq=%" PRIu64
+		       "\n", ofi_recvwin_next_exp_id(&peer_info->recvwin) - 1);
 		/* Requesting FI_AV_TABLE from the underlying provider allows
 		 * us to use peer_info->addr as an int here. */
-		recv = mrail_match_recv(mrail_ep, &ooo_recv->comp,
+		recv = mrail_match_recv(mrail_ep, &comp,
 				(int) peer_info->addr);
 		ofi_ep_lock_release(&mrail_ep->util_ep);
 
 		if (recv) {
-			ret = mrail_cq_process_buf_recv(&ooo_recv->comp, recv);
+			ret = mrail_cq_process_buf_recv(&comp, recv);
 			if (ret)
 				return ret;
 		}
 
 		ofi_ep_lock_acquire(&mrail_ep->util_ep);
-		ofi_buf_free(ooo_recv);
-		ooo_recv = mrail_get_next_recv(peer_info);
 	}
 	ofi_ep_lock_release(&mrail_ep->util_ep);
 	return 0;
 }
 
-static int mrail_ooo_recv_before(struct slist_entry *item, const void *arg)
-{
-	struct mrail_ooo_recv *ooo_recv;
-	struct mrail_ooo_recv *new_recv;
-
-	ooo_recv = container_of(item, struct mrail_ooo_recv, entry);
-	new_recv = container_of(arg, struct mrail_ooo_recv, entry);
-	return (new_recv->seq_no < ooo_recv->seq_no);
-}
-
 /* Should only be called while holding the EP's lock */
 static void mrail_save_ooo_recv(struct mrail_ep *mrail_ep,
 				struct mrail_peer_info *peer_info,
-				uint32_t seq_no,
+				uint64_t msg_id,
 				struct fi_cq_tagged_entry *comp)
 {
-	struct slist *queue = &peer_info->ooo_recv_queue;
-	struct mrail_ooo_recv *ooo_recv;
+	struct mrail_recvwin *recvwin = &peer_info->recvwin;
 
-	ooo_recv = ofi_buf_alloc(mrail_ep->ooo_recv_pool);
-	if (!ooo_recv) {
-		FI_WARN(&mrail_prov, FI_LOG_CQ, "Cannot allocate ooo_recv\n");
+	if (!ofi_recvwin_is_allowed(recvwin, msg_id) &&
+	    mrail_recvwin_grow(recvwin, msg_id)) {
+		FI_WARN(&mrail_prov, FI_LOG_CQ, "Cannot grow reorder window\n");
 		assert(0);
+		return;
 	}
-	ooo_recv->entry.next = NULL;
-	ooo_recv->seq_no = seq_no;
-	memcpy(&ooo_recv->comp, comp, sizeof(*comp));
 
-	slist_insert_before_first_match(queue, mrail_ooo_recv_before,
-					&ooo_recv->entry);
+	ofi_recvwin_queue_msg(recvwin, comp, msg_id);
 
-	FI_DBG(&mrail_prov, FI_LOG_CQ, "saved ooo_recv seq=%d\n", seq_no);
+	FI_DBG(&mrail_prov, FI_LOG_CQ, "saved ooo_recv seq=%" PRIu64 "\n",
+	       msg_id);
 }
 
 static int mrail_handle_recv_completion(struct fi_cq_tagged_entry *comp,
@@ -406,7 +440,7 @@ static int mrail_handle_recv_completion(struct fi_cq_tagged_entry *comp,
 	struct mrail_ep *mrail_ep;
 	struct mrail_recv *recv;
 	struct mrail_hdr *hdr;
-	uint32_t seq_no;
+	uint64_t msg_id;
 	int ret;
 
 	if (comp->flags & FI_CLAIM) {
@@ -432,16 +466,16 @@ static int mrail_handle_recv_completion(struct fi_cq_tagged_entry *comp,
 	    hdr->protocol_cmd == MRAIL_RNDV_ACK)
 		return mrail_cq_process_rndv_ack(comp);
 
-	seq_no = ntohl(hdr->seq);
 	peer_info = ofi_av_get_addr(mrail_ep->util_ep.av, (int) src_addr);
-	FI_DBG(&mrail_prov, FI_LOG_CQ,
-			"ep=%p peer=%d received seq=%d, expected=%d\n",
-			mrail_ep, (int)peer_info->addr, seq_no,
-			peer_info->expected_seq_no);
 	ofi_ep_lock_acquire(&mrail_ep->util_ep);
-	if (seq_no == peer_info->expected_seq_no) {
+	msg_id = mrail_recvwin_msg_id(&peer_info->recvwin, ntohl(hdr->seq));
+	FI_DBG(&mrail_prov, FI_LOG_CQ,
+			"ep=%p peer=%d received seq=%" PRIu64 ", expected=%"
+			PRIu64 "\n", mrail_ep, (int)peer_info->addr, msg_id,
+			ofi_recvwin_next_exp_id(&peer_info->recvwin));
+	if (ofi_recvwin_is_exp(&peer_info->recvwin, msg_id)) {
 		/* This message was received in order */
-		peer_info->expected_seq_no++;
+		mrail_recvwin_advance(&peer_info->recvwin);
 		/* Requesting FI_AV_TABLE from the underlying provider allows
 		 * us to use src_addr as an int here. */
 		recv = mrail_match_recv(mrail_ep, comp, (int) src_addr);
@@ -459,7 +493,7 @@ static int mrail_handle_recv_completion(struct fi_cq_tagged_entry *comp,
 		/* This message was received early.
 		 * Save it into the out-of-order recv queue.
 		 */
-		mrail_save_ooo_recv(mrail_ep, peer_info, seq_no, comp);
+		mrail_save_ooo_recv(mrail_ep, peer_info, msg_id, comp);
 		ofi_ep_lock_release(&mrail_ep->util_ep);
 		ret = 0;
 	}
@@ -517,6 +551,12 @@ static void mrail_handle_rma_completion(struct util_cq *cq,
 	subreq = comp->op_context;
 	req = subreq->parent;
 
+	if (subreq->sample.len) {
+		ofi_ep_lock_acquire(&req->mrail_ep->util_ep);
+		mrail_rail_load_done(req->mrail_ep, &subreq->sample);
+		ofi_ep_lock_release(&req->mrail_ep->util_ep);
+	}
+
 	if (ofi_atomic_dec32(&req->expected_subcomps) == 0) {
 		if (req->comp.flags & MRAIL_RNDV_FLAG) {
 			mrail_finish_rndv_recv(cq, req, comp);
@@ -580,6 +620,10 @@ void mrail_poll_cq(struct util_cq *cq)
 			if (tx_buf->hdr.protocol == MRAIL_PROTO_RNDV) {
 				if (tx_buf->hdr.protocol_cmd == MRAIL_RNDV_REQ) {
 					/* buf will be freed when ACK comes */
+					ofi_ep_lock_acquire(&tx_buf->ep->util_ep);
+					mrail_rail_load_done(tx_buf->ep,
+							     &tx_buf->sample);
+					ofi_ep_lock_release(&tx_buf->ep->util_ep);
 				} else if (tx_buf->hdr.protocol_cmd == MRAIL_RNDV_ACK) {
 					ofi_ep_lock_acquire(&tx_buf->ep->util_ep);
 					ofi_buf_free(tx_buf);
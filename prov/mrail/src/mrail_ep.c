@@ -334,6 +334,7 @@ static struct mrail_tx_buf *mrail_get_tx_buf(struct mrail_ep *mrail_ep,
 	tx_buf->flags		= flags;
 	tx_buf->hdr.op		= op;
 	tx_buf->hdr.seq		= htonl(seq);
+	tx_buf->sample.len	= 0;
 	return tx_buf;
 }
 
@@ -349,13 +350,15 @@ int mrail_send_rndv_ack_blocking(struct mrail_ep *mrail_ep,
 	struct mrail_tx_buf *tx_buf;
 	size_t rndv_pkt_size = sizeof(tx_buf->hdr) + sizeof(tx_buf->rndv_hdr);
 	int policy = mrail_get_policy(rndv_pkt_size);
-	uint32_t i = mrail_get_tx_rail(mrail_ep, policy);
+	uint32_t i;
 	struct fi_msg msg;
 	ssize_t ret;
 	uint64_t flags = FI_COMPLETION;
 
 	ofi_ep_lock_acquire(&mrail_ep->util_ep);
 
+	i = mrail_get_tx_rail(mrail_ep, policy, rndv_pkt_size);
+
 	tx_buf = mrail_get_tx_buf(mrail_ep, context, 0, ofi_op_tagged, 0);
 	if (OFI_UNLIKELY(!tx_buf))
 		return -FI_ENOMEM;
@@ -487,7 +490,7 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	struct iovec *iov_dest = alloca(sizeof(*iov_dest) * (count + 1));
 	struct mrail_tx_buf *tx_buf;
 	int policy = mrail_get_policy(len);
-	uint32_t rail = mrail_get_tx_rail(mrail_ep, policy);
+	uint32_t rail;
 	struct fi_msg msg;
 	ssize_t ret;
 	size_t total_len;
@@ -496,6 +499,8 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 
 	ofi_ep_lock_acquire(&mrail_ep->util_ep);
 
+	rail = mrail_get_tx_rail(mrail_ep, policy, len);
+
 	tx_buf = mrail_get_tx_buf(mrail_ep, context, peer_info->seq_no++,
 				  ofi_op_tagged, flags | op);
 	if (OFI_UNLIKELY(!tx_buf)) {
@@ -537,10 +542,13 @@ mrail_send_common(struct fid_ep *ep_fid, const struct iovec *iov, void **desc,
 	       " dest_addr: 0x%" PRIx64 " tag: 0x%" PRIx64 " seq: %d"
 	       " on rail: %d\n", len, dest_addr, tag, peer_info->seq_no - 1, rail);
 
+	mrail_rail_load_add(mrail_ep, &tx_buf->sample, rail, total_len);
+
 	ret = fi_sendmsg(mrail_ep->rails[rail].ep, &msg, flags | FI_COMPLETION);
 	if (ret) {
 		FI_WARN(&mrail_prov, FI_LOG_EP_DATA,
 			"Unable to fi_sendmsg on rail: %" PRIu32 "\n", rail);
+		mrail_rail_load_cancel(mrail_ep, &tx_buf->sample);
 		goto err2;
 	} else if (!(flags & FI_COMPLETION)) {
 		ofi_ep_tx_cntr_inc(&mrail_ep->util_ep);
@@ -717,9 +725,6 @@ static void mrail_ep_free_bufs(struct mrail_ep *mrail_ep)
 	if (mrail_ep->req_pool)
 		ofi_bufpool_destroy(mrail_ep->req_pool);
 
-	if (mrail_ep->ooo_recv_pool)
-		ofi_bufpool_destroy(mrail_ep->ooo_recv_pool);
-
 	if (mrail_ep->tx_buf_pool)
 		ofi_bufpool_destroy(mrail_ep->tx_buf_pool);
 
@@ -748,12 +753,6 @@ static int mrail_ep_alloc_bufs(struct mrail_ep *mrail_ep)
 	if (!mrail_ep->recv_fs)
 		return -FI_ENOMEM;
 
-	ret = ofi_bufpool_create(&mrail_ep->ooo_recv_pool,
-				 sizeof(struct mrail_ooo_recv),
-				 sizeof(void *), 0, 64, 0);
-	if (!mrail_ep->ooo_recv_pool)
-		goto err;
-
 	ret = ofi_bufpool_create_attr(&attr, &mrail_ep->tx_buf_pool);
 	if (!mrail_ep->tx_buf_pool)
 		goto err;
@@ -1050,6 +1049,16 @@ int mrail_ep_open(struct fid_domain *domain_fid, struct fi_info *info,
 	ofi_atomic_initialize32(&mrail_ep->rx_rail, 0);
 	mrail_ep->default_tx_rail = mrail_local_rank % mrail_ep->num_eps;
 
+	for (i = 0; i < (size_t) mrail_num_config; i++) {
+		if (mrail_config[i].policy == MRAIL_POLICY_ADAPTIVE)
+			mrail_ep->adaptive = 1;
+	}
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		mrail_ep->rails[i].weight = i < (size_t) mrail_num_weights ?
+					    mrail_weights[i] : 1;
+	}
+
 	*ep_fid = &mrail_ep->util_ep.ep_fid;
 	(*ep_fid)->fid.ops = &mrail_ep_fi_ops;
 	(*ep_fid)->ops = &mrail_ops_ep;
@@ -44,6 +44,9 @@ struct mrail_config mrail_config[MRAIL_MAX_CONFIG] = {
 	{ .max_size = ULONG_MAX, .policy = MRAIL_POLICY_STRIPING },
 };
 int mrail_num_config = 2;
+size_t mrail_weights[MRAIL_MAX_WEIGHTS];
+int mrail_num_weights = 0;
+size_t mrail_min_stripe = 16384;
 int mrail_local_rank = 0;
 
 static inline char **mrail_split_addr_strc(const char *addr_strc)
@@ -68,7 +71,7 @@ static int mrail_parse_env_vars(void)
 	fi_param_define(&mrail_prov, "config", FI_PARAM_STRING,
 			"Comma separated list of '<max_size>:<policy>' pairs, "
 			"with <max_size> in ascending order and <policy> being "
-			"fixed, round-robin, or striping");
+			"fixed, round-robin, striping, or adaptive");
 	ret = fi_param_get_str(&mrail_prov, "config", &str);
 	if (!ret) {
 		for (i = 0; i < MRAIL_MAX_CONFIG; i++) {
@@ -92,6 +95,8 @@ static int mrail_parse_env_vars(void)
 				mrail_config[i].policy = MRAIL_POLICY_ROUND_ROBIN;
 			} else if (!strcasecmp(alg, "striping")) {
 				mrail_config[i].policy = MRAIL_POLICY_STRIPING;
+			} else if (!strcasecmp(alg, "adaptive")) {
+				mrail_config[i].policy = MRAIL_POLICY_ADAPTIVE;
 			} else {
 				FI_WARN(&mrail_prov, FI_LOG_CORE, "Invalid policy "
 					"specification %s\n", alg);
@@ -101,6 +106,34 @@ static int mrail_parse_env_vars(void)
 		mrail_num_config = i;
 	}
 
+	fi_param_define(&mrail_prov, "weights", FI_PARAM_STRING,
+			"Comma separated list of relative rail weights, in the "
+			"order of FI_OFI_MRAIL_ADDR. Striped transfers are split "
+			"between the rails in proportion to them (default: 1 "
+			"for each rail)");
+	ret = fi_param_get_str(&mrail_prov, "weights", &str);
+	if (!ret) {
+		for (i = 0; i < MRAIL_MAX_WEIGHTS; i++) {
+			token = strsep(&str, ",");
+			if (!token)
+				break;
+
+			mrail_weights[i] = strtoul(token, &p, 0);
+			if (p == token || *p || !mrail_weights[i]) {
+				FI_WARN(&mrail_prov, FI_LOG_CORE, "Invalid rail "
+					"weight %s\n", token);
+				break;
+			}
+		}
+		mrail_num_weights = i;
+	}
+
+	fi_param_define(&mrail_prov, "min_stripe", FI_PARAM_SIZE_T,
+			"Minimum number of bytes sent on a rail as part of a "
+			"striped transfer. Smaller transfers use fewer rails "
+			"(default: 16384)");
+	fi_param_get_size_t(&mrail_prov, "min_stripe", &mrail_min_stripe);
+
 	fi_param_define(&mrail_prov, "addr_strc", FI_PARAM_STRING, "Deprecated. "
 			"Replaced by FI_OFI_MRAIL_ADDR.");
 
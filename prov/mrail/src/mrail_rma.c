@@ -84,6 +84,13 @@ static ssize_t mrail_post_subreq(uint32_t rail,
 	msg.rma_iov_count	= subreq->rma_iov_count;
 	msg.context		= &subreq->context;
 
+	if (mrail_ep->adaptive) {
+		ofi_ep_lock_acquire(&mrail_ep->util_ep);
+		mrail_rail_load_add(mrail_ep, &subreq->sample, rail,
+				    subreq->len);
+		ofi_ep_lock_release(&mrail_ep->util_ep);
+	}
+
 	if (req->op_type == FI_READ) {
 		ret = fi_readmsg(mrail_ep->rails[rail].ep, &msg, flags);
 	} else {
@@ -98,22 +105,45 @@ static ssize_t mrail_post_subreq(uint32_t rail,
 		ret = fi_writemsg(mrail_ep->rails[rail].ep, &msg, flags);
 	}
 
+	if (ret && subreq->sample.len) {
+		ofi_ep_lock_acquire(&mrail_ep->util_ep);
+		mrail_rail_load_cancel(mrail_ep, &subreq->sample);
+		ofi_ep_lock_release(&mrail_ep->util_ep);
+	}
+
 	return ret;
 }
 
+/* A transfer sent whole moves on to the next rail in turn if its rail is
+ * busy.  Stripes are sized for their rail and stay on it. */
+static uint32_t mrail_get_subreq_rail(struct mrail_req *req,
+		struct mrail_subreq *subreq, size_t attempt)
+{
+	if (attempt && req->subreq_count == 1)
+		return mrail_get_tx_rail_rr(req->mrail_ep);
+
+	return subreq->rail;
+}
+
 static ssize_t mrail_post_req(struct mrail_req *req)
 {
-	size_t i;
+	struct mrail_subreq *subreq;
+	size_t i, attempts;
 	uint32_t rail;
 	ssize_t ret = 0;
 
+	/* A transfer sent whole tries each rail before giving up.  A stripe
+	 * has only its own rail to go to, so it's deferred as soon as that
+	 * rail is busy. */
+	attempts = (req->subreq_count == 1) ? req->mrail_ep->num_eps : 1;
+
 	while (req->pending_subreq >= 0) {
-		/* Try all rails before giving up */
-		for (i = 0; i < req->mrail_ep->num_eps; ++i) {
-			rail = mrail_get_tx_rail_rr(req->mrail_ep);
+		subreq = &req->subreqs[req->pending_subreq];
+
+		for (i = 0; i < attempts; ++i) {
+			rail = mrail_get_subreq_rail(req, subreq, i);
 
-			ret = mrail_post_subreq(rail,
-					&req->subreqs[req->pending_subreq]);
+			ret = mrail_post_subreq(rail, subreq);
 			if (ret != -FI_EAGAIN) {
 				break;
 			} else {
@@ -180,31 +210,127 @@ void mrail_progress_deferred_reqs(struct mrail_ep *mrail_ep)
 	}
 }
 
+/*
+ * The weights are the measured speeds of the rails for the adaptive policy
+ * once every rail has been sampled, and the configured ones otherwise.
+ *
+ * Should only be called while holding the EP's lock
+ */
+static uint64_t mrail_get_stripe_weights(struct mrail_ep *mrail_ep,
+		int policy, uint64_t *weights)
+{
+	uint64_t min_cost = UINT64_MAX, sum = 0;
+	size_t i;
+
+	if (policy == MRAIL_POLICY_ADAPTIVE) {
+		for (i = 0; i < mrail_ep->num_eps; i++) {
+			if (!mrail_ep->rails[i].cost)
+				break;
+			min_cost = MIN(min_cost, mrail_ep->rails[i].cost);
+		}
+		if (i == mrail_ep->num_eps) {
+			for (i = 0; i < mrail_ep->num_eps; i++) {
+				weights[i] = MRAIL_ADAPT_MAX_WEIGHT * min_cost /
+					     mrail_ep->rails[i].cost;
+				weights[i] = MAX(weights[i], 1);
+				sum += weights[i];
+			}
+			return sum;
+		}
+	}
+
+	for (i = 0; i < mrail_ep->num_eps; i++) {
+		weights[i] = mrail_ep->rails[i].weight;
+		sum += weights[i];
+	}
+	return sum;
+}
+
+static inline size_t mrail_stripe_len(size_t total_len, uint64_t weight,
+		uint64_t sum)
+{
+	return (total_len / sum) * weight + (total_len % sum) * weight / sum;
+}
+
+/*
+ * Splits the transfer into one stripe per rail, sized in proportion to the
+ * rail weights.  Rails whose stripe would be shorter than mrail_min_stripe
+ * are left out, slowest first.  If a single rail is left, the rail is
+ * picked by the policy for the size of the transfer instead.
+ */
+static size_t mrail_get_stripes(struct mrail_ep *mrail_ep, int policy,
+		size_t total_len, size_t *stripe_len, uint32_t *stripe_rail)
+{
+	uint64_t *weights = alloca(sizeof(*weights) * mrail_ep->num_eps);
+	uint64_t sum;
+	size_t i, min, count, len, first = 0;
+
+	ofi_ep_lock_acquire(&mrail_ep->util_ep);
+	sum = mrail_get_stripe_weights(mrail_ep, policy, weights);
+
+	for (count = mrail_ep->num_eps; count > 1; count--) {
+		for (min = 0, i = 1; i < mrail_ep->num_eps; i++) {
+			if (weights[i] && (!weights[min] ||
+					   weights[i] < weights[min]))
+				min = i;
+		}
+		if (mrail_stripe_len(total_len, weights[min], sum) >=
+		    mrail_min_stripe)
+			break;
+		sum -= weights[min];
+		weights[min] = 0;
+	}
+
+	if (count == 1) {
+		stripe_len[0] = total_len;
+		stripe_rail[0] = mrail_get_tx_rail(mrail_ep, policy, total_len);
+		ofi_ep_lock_release(&mrail_ep->util_ep);
+		return 1;
+	}
+	ofi_ep_lock_release(&mrail_ep->util_ep);
+
+	for (len = 0, count = 0, i = 0; i < mrail_ep->num_eps; i++) {
+		if (!weights[i])
+			continue;
+		stripe_len[count] = mrail_stripe_len(total_len, weights[i], sum);
+		stripe_rail[count] = i;
+		if (stripe_len[count] > stripe_len[first])
+			first = count;
+		len += stripe_len[count++];
+	}
+
+	/* The longest stripe also takes the rounding remainder */
+	stripe_len[first] += total_len - len;
+	return count;
+}
+
 static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		const struct fi_msg_rma *msg, struct mrail_req *req)
 {
 	ssize_t ret;
 	struct mrail_subreq *subreq;
+	size_t *stripe_len = alloca(sizeof(*stripe_len) * mrail_ep->num_eps);
+	uint32_t *stripe_rail = alloca(sizeof(*stripe_rail) * mrail_ep->num_eps);
 	size_t subreq_count;
 	size_t total_len;
-	size_t chunk_len;
-	size_t subreq_len;
+	size_t rma_len;
 	size_t iov_index;
 	size_t iov_offset;
 	size_t rma_iov_index;
 	size_t rma_iov_offset;
 	int i;
 
-	/* For now, stripe across all rails.
-	 * This could be determined by a dynamic scheduler instead.
-	 */
-	subreq_count = mrail_ep->num_eps;
+	/* The local buffer of a rendezvous read may be larger than the
+	 * data to read. */
+	total_len = ofi_total_iov_len(msg->msg_iov, msg->iov_count);
+	for (rma_len = 0, i = 0; i < msg->rma_iov_count; i++)
+		rma_len += msg->rma_iov[i].len;
+	total_len = MIN(total_len, rma_len);
+	req->policy = mrail_get_policy(total_len);
 
-	total_len = ofi_total_iov_len(msg->msg_iov, msg->iov_count); 
-	chunk_len = total_len / subreq_count;
+	subreq_count = mrail_get_stripes(mrail_ep, req->policy, total_len,
+					 stripe_len, stripe_rail);
 
-	/* The first chunk is the longest */
-	subreq_len =  chunk_len + (total_len % subreq_count);
 	iov_index = 0;
 	iov_offset = 0;
 	rma_iov_index = 0;
@@ -222,12 +348,15 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		subreq = &req->subreqs[i];
 
 		subreq->parent = req;
+		subreq->len = stripe_len[subreq_count - 1 - i];
+		subreq->rail = stripe_rail[subreq_count - 1 - i];
+		subreq->sample.len = 0;
 
 		ret = ofi_copy_iov_desc(subreq->iov, subreq->descs,
 				&subreq->iov_count,
 				(struct iovec *)msg->msg_iov, msg->desc,
 				msg->iov_count, &iov_index, &iov_offset,
-				subreq_len);
+				subreq->len);
 		if (ret) {
 			goto out;
 		}
@@ -235,16 +364,14 @@ static ssize_t mrail_prepare_rma_subreqs(struct mrail_ep *mrail_ep,
 		ret = ofi_copy_rma_iov(subreq->rma_iov, &subreq->rma_iov_count,
 				(struct fi_rma_iov *)msg->rma_iov,
 				msg->rma_iov_count, &rma_iov_index,
-				&rma_iov_offset, subreq_len);
+				&rma_iov_offset, subreq->len);
 		if (ret) {
 			goto out;
 		}
-
-		/* All the other chunks have the same length */
-		subreq_len = chunk_len;
 	}
 
 	ofi_atomic_initialize32(&req->expected_subcomps, subreq_count);
+	req->subreq_count = subreq_count;
 
 	/* pending_subreq is the index of the next subreq to post.
 	 * The array was filled in reverse order in mrail_prepare_rma_subreqs()
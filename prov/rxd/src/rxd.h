@@ -61,7 +61,7 @@
 
 #define RXD_MAJOR_VERSION 	(1)
 #define RXD_MINOR_VERSION 	(0)
-#define RXD_PROTOCOL_VERSION 	(2)
+#define RXD_PROTOCOL_VERSION 	(3)
 
 #define RXD_MAX_MTU_SIZE	4096
 
@@ -76,6 +76,14 @@
 
 #define RXD_PKT_IN_USE		(1 << 0)
 #define RXD_PKT_ACKED		(1 << 1)
+#define RXD_PKT_SACKED		(1 << 2)
+#define RXD_PKT_RETRANS		(1 << 3)
+#define RXD_PKT_ZCOPY		(1 << 4)
+
+#define RXD_DUP_ACK_THRESH	3
+#define RXD_DG_CQ_BATCH		16
+#define RXD_MIN_RTO		1000		/* usec */
+#define RXD_MAX_RTO		4000000		/* usec */
 
 #define RXD_REMOTE_CQ_DATA	(1 << 0)
 #define RXD_NO_TX_COMP		(1 << 1)
@@ -84,12 +92,15 @@
 #define RXD_TAG_HDR		(1 << 4)
 #define RXD_INLINE		(1 << 5)
 #define RXD_MULTI_RECV		(1 << 6)
+#define RXD_ACK_REQ		(1 << 7)
 
 struct rxd_env {
 	int spin_count;
 	int retry;
 	int max_peers;
 	int max_unacked;
+	char *cc;
+	int zcopy;
 };
 
 extern struct rxd_env rxd_env;
@@ -119,16 +130,55 @@ struct rxd_domain {
 	struct ofi_mr_map mr_map;//TODO use util_domain mr_map instead
 };
 
+/*
+ * Hierarchical timer wheel of per peer retransmit deadlines, in ticks.
+ * Level 0 slots are one tick wide; each slot of a higher level spans a
+ * full turn of the level below it and is cascaded down as time reaches it.
+ * Deadlines past the top level are clamped and re-checked when they fire.
+ */
+#define RXD_TIMER_TICK		1000		/* usec */
+#define RXD_TIMER_BITS		6
+#define RXD_TIMER_SLOTS		(1 << RXD_TIMER_BITS)
+#define RXD_TIMER_MASK		(RXD_TIMER_SLOTS - 1)
+#define RXD_TIMER_LEVELS	3
+
+struct rxd_timer_wheel {
+	uint64_t now;
+	size_t armed;
+	struct dlist_entry slots[RXD_TIMER_LEVELS][RXD_TIMER_SLOTS];
+};
+
 struct rxd_peer {
 	struct dlist_entry entry;
+	struct dlist_entry timer_entry;
+	uint64_t timer_expire;
+	fi_addr_t rxd_addr;
 	fi_addr_t peer_addr;
 	uint64_t tx_seq_no;
 	uint64_t rx_seq_no;
 	uint64_t last_rx_ack;
 	uint64_t last_tx_ack;
+	uint64_t last_rx_seq;
 	uint16_t rx_window;
 	uint16_t tx_window;
 	int retry_cnt;
+	uint8_t dup_ack_cnt;
+
+	/* RTT estimate and retransmit timeout, in usec */
+	uint64_t srtt;
+	uint64_t rttvar;
+	uint64_t rto;
+
+	/* Congestion control state, see rxd_cc.c */
+	uint32_t cwnd;
+	uint32_t ssthresh;
+	uint32_t cwnd_cnt;
+	uint64_t min_rtt;
+	uint64_t pace_time;
+	uint64_t recover_seq;
+	uint64_t undo_time;
+	uint32_t undo_cwnd;
+	uint32_t undo_ssthresh;
 
 	uint16_t unacked_cnt;
 	uint8_t active;
@@ -144,6 +194,33 @@ struct rxd_peer {
 	struct dlist_entry buf_pkts;
 };
 
+/*
+ * Sender side congestion control.  A module adjusts each peer's congestion
+ * window from acks and losses; the number of packets in flight to a peer is
+ * bounded by both its congestion window and the receiver's window.
+ */
+struct rxd_cc_ops {
+	const char *name;
+	int pace;
+	void (*init)(struct rxd_peer *peer);
+	void (*ack)(struct rxd_peer *peer, uint32_t acked, uint64_t rtt);
+	void (*loss)(struct rxd_peer *peer, int timeout);
+};
+
+/*
+ * Peers are allocated on first contact and found through a two level table
+ * indexed by rxd address, whose chunks are only allocated once a peer in
+ * their range has been.
+ */
+#define RXD_PEER_CHUNK_BITS	8
+#define RXD_PEER_CHUNK_SIZE	(1 << RXD_PEER_CHUNK_BITS)
+#define RXD_PEER_CHUNK_MASK	(RXD_PEER_CHUNK_SIZE - 1)
+
+struct rxd_peer_chunk {
+	size_t used;
+	struct rxd_peer *peers[RXD_PEER_CHUNK_SIZE];
+};
+
 struct rxd_addr {
 	fi_addr_t fi_addr;
 	fi_addr_t dg_addr;
@@ -193,7 +270,8 @@ struct rxd_ep {
 	size_t rx_prefix_size;
 	size_t min_multi_recv_size;
 	int do_local_mr;
-	int next_retry;
+	size_t zcopy_iov_limit;	/* 0 if data is always copied */
+	int next_retry;		/* msec until next retransmit, -1 if none */
 	int dg_cq_fd;
 	uint32_t tx_flags;
 	uint32_t rx_flags;
@@ -217,10 +295,24 @@ struct rxd_ep {
 	struct dlist_entry active_peers;
 	struct dlist_entry rts_sent_list;
 	struct dlist_entry ctrl_pkts;
+	struct rxd_timer_wheel timers;
+	const struct rxd_cc_ops *cc;
 
-	struct rxd_peer peers[];
+	struct ofi_bufpool *peer_pool;
+	struct rxd_peer_chunk **peer_table;
 };
 
+static inline struct rxd_peer *rxd_peer(struct rxd_ep *ep, fi_addr_t addr)
+{
+	struct rxd_peer_chunk *chunk;
+
+	if (addr >= (fi_addr_t) rxd_env.max_peers)
+		return NULL;
+
+	chunk = ep->peer_table[addr >> RXD_PEER_CHUNK_BITS];
+	return chunk ? chunk->peers[addr & RXD_PEER_CHUNK_MASK] : NULL;
+}
+
 static inline struct rxd_domain *rxd_ep_domain(struct rxd_ep *ep)
 {
 	return container_of(ep->util_ep.domain, struct rxd_domain, util_domain);
@@ -303,6 +395,9 @@ struct rxd_pkt_entry {
 	void *desc;
 	fi_addr_t peer;
 	void *pkt;
+	/* header followed by the user buffer, if RXD_PKT_ZCOPY */
+	uint8_t iov_count;
+	struct iovec iov[RXD_IOV_LIMIT + 1];
 };
 
 struct rxd_unexp_msg {
@@ -434,6 +529,7 @@ ssize_t rxd_ep_post_data_pkts(struct rxd_ep *ep, struct rxd_x_entry *tx_entry);
 void rxd_insert_unacked(struct rxd_ep *ep, fi_addr_t peer,
 			struct rxd_pkt_entry *pkt_entry);
 ssize_t rxd_send_rts_if_needed(struct rxd_ep *rxd_ep, fi_addr_t rxd_addr);
+struct rxd_peer *rxd_get_peer(struct rxd_ep *ep, fi_addr_t rxd_addr);
 int rxd_start_xfer(struct rxd_ep *ep, struct rxd_x_entry *tx_entry);
 void rxd_init_data_pkt(struct rxd_ep *ep, struct rxd_x_entry *tx_entry,
 		       struct rxd_pkt_entry *pkt_entry);
@@ -469,8 +565,27 @@ struct rxd_x_entry *rxd_rx_entry_init(struct rxd_ep *ep,
 			uint32_t op, uint32_t flags);
 void rxd_tx_entry_free(struct rxd_ep *ep, struct rxd_x_entry *tx_entry);
 void rxd_rx_entry_free(struct rxd_ep *ep, struct rxd_x_entry *rx_entry);
-int rxd_get_timeout(uint8_t retry_cnt);
-uint64_t rxd_get_retry_time(uint64_t start, uint8_t retry_cnt);
+uint64_t rxd_get_rto(struct rxd_peer *peer);
+void rxd_update_rtt(struct rxd_peer *peer, uint64_t rtt);
+void rxd_ep_fast_retransmit(struct rxd_ep *ep, struct rxd_peer *peer);
+
+/* Congestion control functions */
+const struct rxd_cc_ops *rxd_cc_get_ops(const char *name);
+void rxd_cc_ack(struct rxd_ep *ep, struct rxd_peer *peer, uint32_t acked,
+		uint64_t rtt);
+void rxd_cc_loss(struct rxd_ep *ep, struct rxd_peer *peer, int timeout);
+int rxd_cc_paced(struct rxd_ep *ep, struct rxd_peer *peer);
+void rxd_cc_sent(struct rxd_ep *ep, struct rxd_peer *peer);
+
+static inline int rxd_peer_window_full(struct rxd_peer *peer)
+{
+	return peer->unacked_cnt >= MIN(peer->tx_window, peer->cwnd);
+}
+
+static inline int rxd_peer_tx_blocked(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	return rxd_peer_window_full(peer) || rxd_cc_paced(ep, peer);
+}
 
 /* Generic message functions */
 ssize_t rxd_ep_generic_recvmsg(struct rxd_ep *rxd_ep, const struct iovec *iov,
@@ -503,6 +618,8 @@ void rxd_progress_op(struct rxd_ep *ep, struct rxd_x_entry *rx_entry,
 void rxd_ep_recv_data(struct rxd_ep *ep, struct rxd_x_entry *x_entry,
 		      struct rxd_data_pkt *pkt, size_t size);
 void rxd_progress_tx_list(struct rxd_ep *ep, struct rxd_peer *peer);
+void rxd_peer_arm_timer(struct rxd_ep *ep, struct rxd_peer *peer,
+			uint64_t expire);
 struct rxd_x_entry *rxd_progress_multi_recv(struct rxd_ep *ep,
 					    struct rxd_x_entry *rx_entry,
 					    size_t total_size);
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2013-2019 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ofi.h>
+
+#include "rxd.h"
+
+#define RXD_CC_INIT_CWND	10
+#define RXD_CC_MIN_CWND		2
+#define RXD_CC_DELAY_SLACK	200	/* usec */
+
+/*
+ * Sequence number past the last packet sent.  tx_seq_no can't be used as
+ * it is advanced over the whole of a transfer when the transfer starts.
+ */
+static uint64_t rxd_cc_sent_seq(struct rxd_peer *peer)
+{
+	if (dlist_empty(&peer->unacked))
+		return peer->last_rx_ack;
+
+	return rxd_get_base_hdr(container_of(peer->unacked.prev,
+			struct rxd_pkt_entry, d_entry))->seq_no + 1;
+}
+
+/*
+ * Open the congestion window by one packet per packet acked while below
+ * the slow start threshold, and by one packet per window above it.
+ */
+static void rxd_cc_grow(struct rxd_peer *peer, uint32_t acked)
+{
+	while (acked--) {
+		if (peer->cwnd < peer->ssthresh) {
+			peer->cwnd++;
+		} else if (++peer->cwnd_cnt >= peer->cwnd) {
+			peer->cwnd_cnt = 0;
+			peer->cwnd++;
+		}
+	}
+	peer->cwnd = MIN(peer->cwnd, (uint32_t) rxd_env.max_unacked);
+}
+
+static void rxd_cc_none_init(struct rxd_peer *peer)
+{
+	peer->cwnd = UINT16_MAX;
+	peer->ssthresh = UINT16_MAX;
+}
+
+static void rxd_cc_none_ack(struct rxd_peer *peer, uint32_t acked,
+			    uint64_t rtt)
+{
+}
+
+static void rxd_cc_none_loss(struct rxd_peer *peer, int timeout)
+{
+}
+
+static void rxd_cc_aimd_init(struct rxd_peer *peer)
+{
+	peer->cwnd = MIN(RXD_CC_INIT_CWND, rxd_env.max_unacked);
+	peer->ssthresh = rxd_env.max_unacked;
+}
+
+static void rxd_cc_aimd_ack(struct rxd_peer *peer, uint32_t acked,
+			    uint64_t rtt)
+{
+	rxd_cc_grow(peer, acked);
+}
+
+static void rxd_cc_aimd_loss(struct rxd_peer *peer, int timeout)
+{
+	peer->ssthresh = MAX(peer->cwnd / 2, RXD_CC_MIN_CWND);
+	peer->cwnd = peer->ssthresh;
+	peer->cwnd_cnt = 0;
+}
+
+/*
+ * Delay based: back off in proportion to how far the RTT has grown past
+ * the lowest RTT seen to the peer, before queues overflow into loss.
+ */
+static void rxd_cc_delay_ack(struct rxd_peer *peer, uint32_t acked,
+			     uint64_t rtt)
+{
+	uint64_t target;
+	uint32_t dec;
+
+	if (rtt) {
+		if (!peer->min_rtt || rtt < peer->min_rtt)
+			peer->min_rtt = rtt;
+
+		target = peer->min_rtt + peer->min_rtt / 4 + RXD_CC_DELAY_SLACK;
+		if (rtt > target) {
+			dec = (uint32_t) (peer->cwnd * (rtt - target) / (2 * rtt));
+			peer->cwnd = MAX(peer->cwnd - dec, RXD_CC_MIN_CWND);
+			peer->ssthresh = peer->cwnd;
+			peer->cwnd_cnt = 0;
+			peer->recover_seq = rxd_cc_sent_seq(peer);
+			return;
+		}
+	}
+
+	rxd_cc_grow(peer, acked);
+}
+
+static struct rxd_cc_ops rxd_cc_none = {
+	.name = "none",
+	.pace = 0,
+	.init = rxd_cc_none_init,
+	.ack = rxd_cc_none_ack,
+	.loss = rxd_cc_none_loss,
+};
+
+static struct rxd_cc_ops rxd_cc_aimd = {
+	.name = "aimd",
+	.pace = 1,
+	.init = rxd_cc_aimd_init,
+	.ack = rxd_cc_aimd_ack,
+	.loss = rxd_cc_aimd_loss,
+};
+
+static struct rxd_cc_ops rxd_cc_delay = {
+	.name = "delay",
+	.pace = 1,
+	.init = rxd_cc_aimd_init,
+	.ack = rxd_cc_delay_ack,
+	.loss = rxd_cc_aimd_loss,
+};
+
+static struct rxd_cc_ops *rxd_cc_list[] = {
+	&rxd_cc_none,
+	&rxd_cc_aimd,
+	&rxd_cc_delay,
+};
+
+const struct rxd_cc_ops *rxd_cc_get_ops(const char *name)
+{
+	size_t i;
+
+	if (!name)
+		return &rxd_cc_none;
+
+	for (i = 0; i < ARRAY_SIZE(rxd_cc_list); i++) {
+		if (!strcasecmp(name, rxd_cc_list[i]->name))
+			return rxd_cc_list[i];
+	}
+
+	FI_WARN(&rxd_prov, FI_LOG_CORE,
+		"unknown congestion control '%s', using '%s'\n",
+		name, rxd_cc_none.name);
+	return &rxd_cc_none;
+}
+
+/*
+ * An ack arriving within half an RTT of a retransmit timeout can only be
+ * for the original packets, so the timeout was spurious and the window it
+ * cut is given back.  Otherwise the window is held while recovering.
+ */
+void rxd_cc_ack(struct rxd_ep *ep, struct rxd_peer *peer, uint32_t acked,
+		uint64_t rtt)
+{
+	if (!acked)
+		return;
+
+	if (peer->undo_time) {
+		if (fi_gettime_us() - peer->undo_time < peer->srtt / 2) {
+			peer->cwnd = MAX(peer->cwnd, peer->undo_cwnd);
+			peer->ssthresh = MAX(peer->ssthresh, peer->undo_ssthresh);
+			peer->recover_seq = peer->last_rx_ack;
+		}
+		peer->undo_time = 0;
+	}
+
+	if (ofi_before(peer->last_rx_ack, peer->recover_seq))
+		return;
+
+	ep->cc->ack(peer, acked, rtt);
+}
+
+/*
+ * The window is only cut once for everything that was in flight when a
+ * loss was detected.  Timeouts before the first RTT sample say nothing
+ * about the path and are ignored.
+ */
+void rxd_cc_loss(struct rxd_ep *ep, struct rxd_peer *peer, int timeout)
+{
+	if (!peer->srtt || ofi_before(peer->last_rx_ack, peer->recover_seq))
+		return;
+
+	if (timeout) {
+		peer->undo_cwnd = peer->cwnd;
+		peer->undo_ssthresh = peer->ssthresh;
+		peer->undo_time = fi_gettime_us();
+	}
+
+	peer->recover_seq = rxd_cc_sent_seq(peer);
+	ep->cc->loss(peer, timeout);
+}
+
+/*
+ * Spread a window's worth of packets over an RTT rather than sending them
+ * back to back.  Packets may run up to a timer tick ahead of schedule, so
+ * the retransmit timer wheel can be used to resume a paced peer.  The
+ * wheel only runs with retries enabled, and so does pacing.
+ */
+int rxd_cc_paced(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	if (!ep->cc->pace || !rxd_env.retry || !peer->srtt)
+		return 0;
+
+	if (fi_gettime_us() + RXD_TIMER_TICK >= peer->pace_time)
+		return 0;
+
+	rxd_peer_arm_timer(ep, peer, peer->pace_time);
+	return 1;
+}
+
+void rxd_cc_sent(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	uint64_t now, gap;
+
+	if (!ep->cc->pace || !rxd_env.retry || !peer->srtt)
+		return;
+
+	/* pace at twice the window rate in slow start, 1.25x after */
+	gap = peer->cwnd < peer->ssthresh ? peer->srtt / (2 * peer->cwnd) :
+	      peer->srtt * 4 / (5 * peer->cwnd);
+
+	now = fi_gettime_us();
+	peer->pace_time = MAX(peer->pace_time, now) + gap;
+}
@@ -162,13 +162,14 @@ static int rxd_comp_pkt_seq_no(struct dlist_entry *item, const void *arg)
 	new_hdr = rxd_get_base_hdr(container_of((struct dlist_entry *) arg,
 				  struct rxd_pkt_entry, d_entry));
 
-	return new_hdr->seq_no > list_hdr->seq_no;
+	return ofi_before(new_hdr->seq_no, list_hdr->seq_no);
 }
 
 void rxd_ep_recv_data(struct rxd_ep *ep, struct rxd_x_entry *x_entry,
 		      struct rxd_data_pkt *pkt, size_t size)
 {
 	struct rxd_domain *rxd_domain = rxd_ep_domain(ep);
+	struct rxd_peer *peer = rxd_peer(ep, pkt->base_hdr.peer);
 	uint64_t done;
 	struct iovec *iov;
 	size_t iov_count;
@@ -190,8 +191,8 @@ void rxd_ep_recv_data(struct rxd_ep *ep, struct rxd_x_entry *x_entry,
 	x_entry->next_seg_no++;
 
 	if (x_entry->next_seg_no < x_entry->num_segs) {
-		if (!(ep->peers[pkt->base_hdr.peer].rx_seq_no %
-		    ep->peers[pkt->base_hdr.peer].rx_window))
+		if (!(peer->rx_seq_no % peer->rx_window) ||
+		    pkt->base_hdr.flags & RXD_ACK_REQ)
 			rxd_ep_send_ack(ep, pkt->base_hdr.peer);
 		return;
 	}
@@ -203,67 +204,82 @@ void rxd_ep_recv_data(struct rxd_ep *ep, struct rxd_x_entry *x_entry,
 		rxd_complete_rx(ep, x_entry);
 }
 
-static void rxd_verify_active(struct rxd_ep *ep, fi_addr_t addr, fi_addr_t peer_addr)
+static void rxd_verify_active(struct rxd_ep *ep, struct rxd_peer *peer,
+			      fi_addr_t peer_addr)
 {
 	struct rxd_pkt_entry *pkt_entry;
 
-	if (ep->peers[addr].peer_addr != FI_ADDR_UNSPEC &&
-	    ep->peers[addr].peer_addr != peer_addr)
+	if (peer->peer_addr != FI_ADDR_UNSPEC &&
+	    peer->peer_addr != peer_addr)
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL,
 			"overwriting active peer - unexpected behavior\n");
 
-	ep->peers[addr].peer_addr = peer_addr;
+	peer->peer_addr = peer_addr;
 
-	if (!dlist_empty(&ep->peers[addr].unacked) && 
-	    rxd_get_base_hdr(container_of((&ep->peers[addr].unacked)->next,
+	if (!dlist_empty(&peer->unacked) && 
+	    rxd_get_base_hdr(container_of((&peer->unacked)->next,
 			     struct rxd_pkt_entry, d_entry))->type == RXD_RTS) {
-		dlist_pop_front(&ep->peers[addr].unacked,
+		dlist_pop_front(&peer->unacked,
 				struct rxd_pkt_entry, pkt_entry, d_entry);
 		if (pkt_entry->flags & RXD_PKT_IN_USE) {
 			dlist_insert_tail(&pkt_entry->d_entry, &ep->ctrl_pkts);
 			pkt_entry->flags |= RXD_PKT_ACKED;
 		} else {
 			ofi_buf_free(pkt_entry);
-			ep->peers[addr].unacked_cnt--;
+			peer->unacked_cnt--;
 		}
-		dlist_remove(&ep->peers[addr].entry);
+		dlist_remove(&peer->entry);
 	}
 
-	if (!ep->peers[addr].active) {
-		dlist_insert_tail(&ep->peers[addr].entry, &ep->active_peers);
-		ep->peers[addr].retry_cnt = 0;
-		ep->peers[addr].active = 1;
+	if (!peer->active) {
+		dlist_insert_tail(&peer->entry, &ep->active_peers);
+		peer->retry_cnt = 0;
+		peer->active = 1;
 	}
 }
 
+/*
+ * Sequence numbers are handed out in tx_list order.  A transfer may not
+ * start ahead of one whose packets haven't all been posted, or its packets
+ * could fill the window while the receiver waits on the earlier ones.
+ */
+static int rxd_tx_entry_queued(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
+{
+	struct rxd_x_entry *prev;
+
+	if (tx_entry->entry.prev == &rxd_peer(ep, tx_entry->peer)->tx_list)
+		return 0;
+
+	prev = container_of(tx_entry->entry.prev, struct rxd_x_entry, entry);
+	return prev->pkt || prev->bytes_done != prev->cq_entry.len;
+}
+
 int rxd_start_xfer(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 {
 	struct rxd_base_hdr *hdr = rxd_get_base_hdr(tx_entry->pkt);
+	struct rxd_peer *peer = rxd_peer(ep, tx_entry->peer);
 
-	if (ep->peers[tx_entry->peer].unacked_cnt >=
-	    ep->peers[tx_entry->peer].tx_window)
+	if (rxd_tx_entry_queued(ep, tx_entry) ||
+	    rxd_peer_tx_blocked(ep, peer))
 		return 0;
 
-	tx_entry->start_seq = rxd_set_pkt_seq(&ep->peers[tx_entry->peer],
-					      tx_entry->pkt);
+	tx_entry->start_seq = rxd_set_pkt_seq(peer, tx_entry->pkt);
 	if (tx_entry->op != RXD_READ_REQ && tx_entry->num_segs > 1) {
-		ep->peers[tx_entry->peer].tx_seq_no = tx_entry->start_seq +
-						      tx_entry->num_segs;
+		peer->tx_seq_no = tx_entry->start_seq + tx_entry->num_segs;
 	}
-	hdr->peer = ep->peers[tx_entry->peer].peer_addr;
+	hdr->peer = peer->peer_addr;
 	rxd_ep_send_pkt(ep, tx_entry->pkt);
 	rxd_insert_unacked(ep, tx_entry->peer, tx_entry->pkt);
+	rxd_cc_sent(ep, peer);
 	tx_entry->pkt = NULL;
 
 	if (tx_entry->op == RXD_READ_REQ || tx_entry->op == RXD_ATOMIC_FETCH ||
 	    tx_entry->op == RXD_ATOMIC_COMPARE) {
 		dlist_remove(&tx_entry->entry);
-		dlist_insert_tail(&tx_entry->entry,
-				  &ep->peers[tx_entry->peer].rma_rx_list);
+		dlist_insert_tail(&tx_entry->entry, &peer->rma_rx_list);
 	}
 
-	return ep->peers[tx_entry->peer].unacked_cnt <
-	       ep->peers[tx_entry->peer].tx_window;
+	return !rxd_peer_window_full(peer);
 }
 
 void rxd_progress_tx_list(struct rxd_ep *ep, struct rxd_peer *peer)
@@ -304,33 +320,33 @@ void rxd_progress_tx_list(struct rxd_ep *ep, struct rxd_peer *peer)
 		}
 				
 		if (tx_entry->op == RXD_DATA_READ && !tx_entry->bytes_done) {
-			if (ep->peers[tx_entry->peer].unacked_cnt >=
-		    	    ep->peers[tx_entry->peer].tx_window) {
+			if (rxd_peer_tx_blocked(ep, peer))
 				break;
-			} 
-			tx_entry->start_seq = ep->peers[tx_entry->peer].tx_seq_no;
-			ep->peers[tx_entry->peer].tx_seq_no = tx_entry->start_seq +
-							      tx_entry->num_segs;
+			tx_entry->start_seq = peer->tx_seq_no;
+			peer->tx_seq_no = tx_entry->start_seq +
+					  tx_entry->num_segs;
 			inc = 1;
 		}
 
 		ret = rxd_ep_post_data_pkts(ep, tx_entry);
 		if (ret) {
 			if (ret == -FI_ENOMEM && inc)
-				ep->peers[tx_entry->peer].tx_seq_no -=
-							  tx_entry->num_segs;
+				peer->tx_seq_no -= tx_entry->num_segs;
 			break;
 		}
 	}
 
 	if (dlist_empty(&peer->tx_list))
 		peer->retry_cnt = 0;
+	else if (rxd_env.retry && dlist_empty(&peer->unacked))
+		rxd_peer_arm_timer(ep, peer, fi_gettime_us() + RXD_TIMER_TICK);
 }
 
-static void rxd_update_peer(struct rxd_ep *ep, fi_addr_t peer, fi_addr_t peer_addr)
+static void rxd_update_peer(struct rxd_ep *ep, struct rxd_peer *peer,
+			    fi_addr_t peer_addr)
 {
 	rxd_verify_active(ep, peer, peer_addr);
-	rxd_progress_tx_list(ep, &ep->peers[peer]);
+	rxd_progress_tx_list(ep, peer);
 }
 
 static int rxd_send_cts(struct rxd_ep *rxd_ep, struct rxd_rts_pkt *rts_pkt,
@@ -340,7 +356,7 @@ static int rxd_send_cts(struct rxd_ep *rxd_ep, struct rxd_rts_pkt *rts_pkt,
 	struct rxd_cts_pkt *cts;
 	int ret = 0;
 
-	rxd_update_peer(rxd_ep, peer, rts_pkt->rts_addr);
+	rxd_update_peer(rxd_ep, rxd_peer(rxd_ep, peer), rts_pkt->rts_addr);
 
 	pkt_entry = rxd_get_tx_pkt(rxd_ep);
 	if (!pkt_entry)
@@ -438,6 +454,12 @@ static void rxd_handle_rts(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 			return;
 	}
 
+	if (!rxd_get_peer(ep, rxd_addr)) {
+		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL,
+			"unable to allocate peer\n");
+		return;
+	}
+
 	if (rxd_send_cts(ep, pkt, rxd_addr)) {
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL,
 			"error posting CTS\n");
@@ -512,12 +534,12 @@ static struct rxd_x_entry *rxd_match_rx(struct rxd_ep *ep,
 	}
 
 	if (!match) {
-		assert(!ep->peers[base->peer].curr_unexp);
+		assert(!rxd_peer(ep, base->peer)->curr_unexp);
 		unexp_msg = rxd_init_unexp(ep, pkt_entry, base, op,
 					   tag, data, msg, msg_size);
 		if (unexp_msg) {
 			dlist_insert_tail(&unexp_msg->entry, unexp_list);
-			ep->peers[base->peer].curr_unexp = unexp_msg;
+			rxd_peer(ep, base->peer)->curr_unexp = unexp_msg;
 		}
 		return NULL;
 	}
@@ -594,9 +616,10 @@ static struct rxd_x_entry *rxd_rma_read_entry_init(struct rxd_ep *ep,
 	rx_entry->cq_entry.flags = ofi_rx_cq_flags(RXD_READ_REQ);
 	rx_entry->cq_entry.len = sar_hdr->size;
 
-	dlist_insert_tail(&rx_entry->entry, &ep->peers[rx_entry->peer].tx_list);
+	dlist_insert_tail(&rx_entry->entry,
+			  &rxd_peer(ep, rx_entry->peer)->tx_list);
 
-	rxd_progress_tx_list(ep, &ep->peers[rx_entry->peer]);
+	rxd_progress_tx_list(ep, rxd_peer(ep, rx_entry->peer));
 
 	return rx_entry;
 }
@@ -669,11 +692,12 @@ static struct rxd_x_entry *rxd_rx_atomic_fetch(struct rxd_ep *ep,
 	if (rx_entry->bytes_done != rx_entry->cq_entry.len)
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "fetch data length mismatch\n");
 
-	dlist_insert_tail(&rx_entry->entry, &ep->peers[rx_entry->peer].tx_list);
+	dlist_insert_tail(&rx_entry->entry,
+			  &rxd_peer(ep, rx_entry->peer)->tx_list);
 
 	rxd_ep_send_ack(ep, base_hdr->peer);
 
-	rxd_progress_tx_list(ep, &ep->peers[rx_entry->peer]);
+	rxd_progress_tx_list(ep, rxd_peer(ep, rx_entry->peer));
 
 	return rx_entry;
 }
@@ -776,8 +800,8 @@ static int rxd_unpack_init_rx(struct rxd_ep *ep, struct rxd_x_entry **rx_entry,
 	return 0;
 }
 
-void rxd_do_atomic(void *src, void *dst, void *cmp, enum fi_datatype datatype,
-		   enum fi_op atomic_op, size_t cnt)
+void rxd_do_atomic(struct rxd_ep *ep, void *src, void *dst, void *cmp,
+		   enum fi_datatype datatype, enum fi_op atomic_op, size_t cnt)
 {
 	char tmp_result[RXD_MAX_MTU_SIZE];
 
@@ -785,7 +809,8 @@ void rxd_do_atomic(void *src, void *dst, void *cmp, enum fi_datatype datatype,
 		ofi_atomic_swap_handlers[atomic_op - OFI_SWAP_OP_START][datatype](dst,
 			src, cmp, tmp_result, cnt);
 	} else if (atomic_op != FI_ATOMIC_READ) {
-		ofi_atomic_write_handlers[atomic_op][datatype](dst, src, cnt);
+		ofi_atomic_write_handler(rxd_ep_domain(ep)->util_domain.threading,
+					 atomic_op, datatype)(dst, src, cnt);
 	}
 }
 
@@ -811,7 +836,7 @@ void rxd_progress_atom_op(struct rxd_ep *ep, struct rxd_x_entry *rx_entry,
 
 	iov_count = sar_hdr ? sar_hdr->iov_count : 1;
 	for (i = len = 0; i < iov_count; i++) {
-		rxd_do_atomic(&src[len], rx_entry->iov[i].iov_base,
+		rxd_do_atomic(ep, &src[len], rx_entry->iov[i].iov_base,
 			      cmp ? &cmp[len] : NULL, atom_hdr->datatype,
 			      atom_hdr->atomic_op, rx_entry->iov[i].iov_len /
 			      ofi_datatype_size(atom_hdr->datatype));
@@ -832,10 +857,12 @@ void rxd_progress_op(struct rxd_ep *ep, struct rxd_x_entry *rx_entry,
 		     struct rxd_atom_hdr *atom_hdr,
 		     void **msg, size_t size)
 {
+	struct rxd_peer *peer = rxd_peer(ep, base_hdr->peer);
+
 	if (sar_hdr)
-		ep->peers[base_hdr->peer].curr_tx_id = sar_hdr->tx_id;
+		peer->curr_tx_id = sar_hdr->tx_id;
 
-	ep->peers[base_hdr->peer].curr_rx_id = rx_entry->rx_id;
+	peer->curr_rx_id = rx_entry->rx_id;
 
 	if (base_hdr->type == RXD_READ_REQ)
 		return;
@@ -869,7 +896,7 @@ void rxd_progress_op(struct rxd_ep *ep, struct rxd_x_entry *rx_entry,
 	rx_entry->next_seg_no++;
 	rx_entry->start_seq = base_hdr->seq_no;
 
-	dlist_insert_tail(&rx_entry->entry, &ep->peers[base_hdr->peer].rx_list);
+	dlist_insert_tail(&rx_entry->entry, &peer->rx_list);
 }
 
 static struct rxd_x_entry *rxd_get_data_x_entry(struct rxd_ep *ep,
@@ -877,12 +904,67 @@ static struct rxd_x_entry *rxd_get_data_x_entry(struct rxd_ep *ep,
 {
 	if (data_pkt->base_hdr.type == RXD_DATA)
 		return ofi_bufpool_get_ibuf(ep->rx_entry_pool.pool,
-			     ep->peers[data_pkt->base_hdr.peer].curr_rx_id);
+			     rxd_peer(ep, data_pkt->base_hdr.peer)->curr_rx_id);
 
 	return ofi_bufpool_get_ibuf(ep->tx_entry_pool.pool, data_pkt->ext_hdr.tx_id);
 }
 
-static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
+/*
+ * Deliver an in order data packet.  Returns 1 if the packet was queued to
+ * an unexpected message and must not be released by the caller.
+ */
+static int rxd_recv_data_pkt(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
+{
+	struct rxd_data_pkt *pkt = (struct rxd_data_pkt *) (pkt_entry->pkt);
+	struct rxd_peer *peer = rxd_peer(ep, pkt->base_hdr.peer);
+	struct rxd_unexp_msg *unexp_msg;
+	struct rxd_x_entry *x_entry;
+
+	peer->rx_seq_no++;
+	if (pkt->base_hdr.type == RXD_DATA && peer->curr_unexp) {
+		unexp_msg = peer->curr_unexp;
+		dlist_insert_tail(&pkt_entry->d_entry, &unexp_msg->pkt_list);
+		if (pkt->ext_hdr.seg_no + 1 == unexp_msg->sar_hdr->num_segs - 1) {
+			peer->curr_unexp = NULL;
+			rxd_ep_send_ack(ep, pkt->base_hdr.peer);
+		} else if (pkt->base_hdr.flags & RXD_ACK_REQ) {
+			rxd_ep_send_ack(ep, pkt->base_hdr.peer);
+		}
+		return 1;
+	}
+
+	x_entry = rxd_get_data_x_entry(ep, pkt);
+	rxd_ep_recv_data(ep, x_entry, pkt, pkt_entry->pkt_size);
+	return 0;
+}
+
+/*
+ * With retries enabled, data packets that arrive past a gap are held
+ * (up to one window ahead) instead of dropped, and reported back to the
+ * sender as SACK ranges so that only the gap needs to be resent.
+ */
+static int rxd_hold_ooo_pkt(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
+{
+	struct rxd_base_hdr *base_hdr = rxd_get_base_hdr(pkt_entry);
+	struct rxd_peer *peer = rxd_peer(ep, base_hdr->peer);
+	struct rxd_pkt_entry *buf_entry;
+
+	if (ofi_before(base_hdr->seq_no, peer->rx_seq_no) ||
+	    ofi_after_eq(base_hdr->seq_no, peer->rx_seq_no + rxd_env.max_unacked))
+		return 0;
+
+	dlist_foreach_container(&peer->buf_pkts, struct rxd_pkt_entry,
+				buf_entry, d_entry) {
+		if (rxd_get_base_hdr(buf_entry)->seq_no == base_hdr->seq_no)
+			return 0;
+	}
+
+	dlist_insert_order(&peer->buf_pkts, &rxd_comp_pkt_seq_no,
+			   &pkt_entry->d_entry);
+	return 1;
+}
+
+static void rxd_progress_buf_pkts(struct rxd_ep *ep, struct rxd_peer *peer)
 {
 	struct fi_cq_err_entry err_entry;
 	struct rxd_pkt_entry *pkt_entry;
@@ -896,19 +978,19 @@ static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
 	int ret;
 	size_t msg_size;
 	struct rxd_x_entry *rx_entry = NULL;
-	struct rxd_data_pkt *data_pkt;
 
-	while (!dlist_empty(&ep->peers[peer].buf_pkts)) {
-		pkt_entry = container_of((&ep->peers[peer].buf_pkts)->next,
+	while (!dlist_empty(&peer->buf_pkts)) {
+		pkt_entry = container_of(peer->buf_pkts.next,
 					struct rxd_pkt_entry, d_entry);
 		base_hdr = rxd_get_base_hdr(pkt_entry);
-		if (base_hdr->seq_no != ep->peers[peer].rx_seq_no)
+		if (base_hdr->seq_no != peer->rx_seq_no)
 			return;
 
 		if (base_hdr->type == RXD_DATA || base_hdr->type == RXD_DATA_READ) {
-			data_pkt = (struct rxd_data_pkt *) pkt_entry->pkt;
-			rx_entry = rxd_get_data_x_entry(ep, data_pkt);
-			rxd_ep_recv_data(ep, rx_entry, data_pkt, pkt_entry->pkt_size);
+			dlist_remove(&pkt_entry->d_entry);
+			if (!rxd_recv_data_pkt(ep, pkt_entry))
+				ofi_buf_free(pkt_entry);
+			continue;
 		} else {
 			ret = rxd_unpack_init_rx(ep, &rx_entry, pkt_entry, base_hdr, &sar_hdr,
 					      &tag_hdr, &data_hdr, &rma_hdr, &atom_hdr,
@@ -922,14 +1004,14 @@ static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
 				if (ret)
 					FI_WARN(&rxd_prov, FI_LOG_EP_CTRL,
 						"could not write error entry\n");
-				ep->peers[base_hdr->peer].rx_seq_no++;
+				peer->rx_seq_no++;
 				rxd_remove_free_pkt_entry(pkt_entry);
 				continue;
 			}
 			if (!rx_entry) {
 				if (base_hdr->type == RXD_MSG ||
 				    base_hdr->type == RXD_TAGGED) {
-					ep->peers[base_hdr->peer].rx_seq_no++;
+					peer->rx_seq_no++;
 					continue;
 				}
 				break;
@@ -940,7 +1022,7 @@ static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
 					atom_hdr, &msg, msg_size);
 		}
 
-		ep->peers[base_hdr->peer].rx_seq_no++;
+		peer->rx_seq_no++;
 		rxd_remove_free_pkt_entry(pkt_entry);
 	}
 }
@@ -948,8 +1030,8 @@ static void rxd_progress_buf_pkts(struct rxd_ep *ep, fi_addr_t peer)
 static void rxd_handle_data(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 {
 	struct rxd_data_pkt *pkt = (struct rxd_data_pkt *) (pkt_entry->pkt);
-	struct rxd_x_entry *x_entry;
-	struct rxd_unexp_msg *unexp_msg;
+	struct rxd_peer *peer;
+	int held;
 
 	if (pkt_entry->pkt_size < sizeof(*pkt) + ep->rx_prefix_size) {
 		FI_WARN(&rxd_prov, FI_LOG_CQ,
@@ -957,28 +1039,26 @@ static void rxd_handle_data(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 		goto free;
 	}
 
-	if (pkt->base_hdr.seq_no == ep->peers[pkt->base_hdr.peer].rx_seq_no) {
-		ep->peers[pkt->base_hdr.peer].rx_seq_no++;
-		if (pkt->base_hdr.type == RXD_DATA &&
-		    ep->peers[pkt->base_hdr.peer].curr_unexp) {
-			unexp_msg = ep->peers[pkt->base_hdr.peer].curr_unexp;
-			dlist_insert_tail(&pkt_entry->d_entry, &unexp_msg->pkt_list);
-			if (pkt->ext_hdr.seg_no + 1 == unexp_msg->sar_hdr->num_segs - 1) {
-				ep->peers[pkt->base_hdr.peer].curr_unexp = NULL;
+	peer = rxd_peer(ep, pkt->base_hdr.peer);
+	peer->last_rx_seq = pkt->base_hdr.seq_no;
+	if (pkt->base_hdr.seq_no == peer->rx_seq_no) {
+		if (!rxd_recv_data_pkt(ep, pkt_entry))
+			ofi_buf_free(pkt_entry);
+		if (!dlist_empty(&peer->buf_pkts)) {
+			rxd_progress_buf_pkts(ep, peer);
+			if (rxd_env.retry)
 				rxd_ep_send_ack(ep, pkt->base_hdr.peer);
-			}
-			return;
 		}
-		x_entry = rxd_get_data_x_entry(ep, pkt);
-		rxd_ep_recv_data(ep, x_entry, pkt, pkt_entry->pkt_size);
-		if (!dlist_empty(&ep->peers[pkt->base_hdr.peer].buf_pkts))
-			rxd_progress_buf_pkts(ep, pkt->base_hdr.peer);
+		return;
 	} else if (!rxd_env.retry) {
-		dlist_insert_order(&ep->peers[pkt->base_hdr.peer].buf_pkts,
+		dlist_insert_order(&peer->buf_pkts,
 				   &rxd_comp_pkt_seq_no, &pkt_entry->d_entry);
 		return;
-	} else if (ep->peers[pkt->base_hdr.peer].peer_addr != FI_ADDR_UNSPEC) {
+	} else if (peer->peer_addr != FI_ADDR_UNSPEC) {
+		held = rxd_hold_ooo_pkt(ep, pkt_entry);
 		rxd_ep_send_ack(ep, pkt->base_hdr.peer);
+		if (held)
+			return;
 	}
 free:
 	ofi_buf_free(pkt_entry);
@@ -988,6 +1068,7 @@ static void rxd_handle_op(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 {
 	struct rxd_x_entry *rx_entry;
 	struct rxd_base_hdr *base_hdr = rxd_get_base_hdr(pkt_entry);
+	struct rxd_peer *peer = rxd_peer(ep, base_hdr->peer);
 	struct rxd_sar_hdr *sar_hdr;
 	struct rxd_tag_hdr *tag_hdr;
 	struct rxd_data_hdr *data_hdr;
@@ -997,19 +1078,20 @@ static void rxd_handle_op(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 	size_t msg_size;
 	int ret;
 
-	if (base_hdr->seq_no != ep->peers[base_hdr->peer].rx_seq_no) {
+	peer->last_rx_seq = base_hdr->seq_no;
+	if (base_hdr->seq_no != peer->rx_seq_no) {
 		if (!rxd_env.retry) {
-			dlist_insert_order(&ep->peers[base_hdr->peer].buf_pkts,
-					   &rxd_comp_pkt_seq_no, &pkt_entry->d_entry);
+			dlist_insert_order(&peer->buf_pkts, &rxd_comp_pkt_seq_no,
+					   &pkt_entry->d_entry);
 			return;
 		}
 
-		if (ep->peers[base_hdr->peer].peer_addr != FI_ADDR_UNSPEC)
+		if (peer->peer_addr != FI_ADDR_UNSPEC)
 			goto ack;
 		goto release;
 	}
 
-	if (ep->peers[base_hdr->peer].peer_addr == FI_ADDR_UNSPEC)
+	if (peer->peer_addr == FI_ADDR_UNSPEC)
 		goto release;
 
 	ret = rxd_unpack_init_rx(ep, &rx_entry, pkt_entry, base_hdr, &sar_hdr,
@@ -1020,28 +1102,28 @@ static void rxd_handle_op(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 
 	if (!rx_entry) {
 		if (base_hdr->type == RXD_MSG || base_hdr->type == RXD_TAGGED) {
-			if (!ep->peers[base_hdr->peer].curr_unexp)
+			if (!peer->curr_unexp)
 				goto ack;
 
-			ep->peers[base_hdr->peer].rx_seq_no++;
+			peer->rx_seq_no++;
 
 			if (!sar_hdr)
-				ep->peers[base_hdr->peer].curr_unexp = NULL;
+				peer->curr_unexp = NULL;
 
 			rxd_ep_send_ack(ep, base_hdr->peer);
 			return;
 		}
-		ep->peers[base_hdr->peer].rx_window = 0;
+		peer->rx_window = 0;
 		goto ack;
 	}
 
-	ep->peers[base_hdr->peer].rx_seq_no++;
-	ep->peers[base_hdr->peer].rx_window = rxd_env.max_unacked;
+	peer->rx_seq_no++;
+	peer->rx_window = rxd_env.max_unacked;
 	rxd_progress_op(ep, rx_entry, pkt_entry, base_hdr, sar_hdr, tag_hdr,
 			data_hdr, rma_hdr, atom_hdr, &msg, msg_size);
 
-	if (!dlist_empty(&ep->peers[base_hdr->peer].buf_pkts))
-		rxd_progress_buf_pkts(ep, base_hdr->peer);
+	if (!dlist_empty(&peer->buf_pkts))
+		rxd_progress_buf_pkts(ep, peer);
 
 ack:
 	rxd_ep_send_ack(ep, base_hdr->peer);
@@ -1052,6 +1134,7 @@ release:
 static void rxd_handle_cts(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 {
 	struct rxd_cts_pkt *cts = (struct rxd_cts_pkt *) (pkt_entry->pkt);
+	struct rxd_peer *peer;
 
 	if (cts->base_hdr.version != RXD_PROTOCOL_VERSION) {
 		FI_WARN(&rxd_prov, FI_LOG_CQ,
@@ -1059,34 +1142,99 @@ static void rxd_handle_cts(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 		return;
 	}
 
-	rxd_update_peer(ep, cts->rts_addr, cts->cts_addr);
+	peer = rxd_peer(ep, cts->rts_addr);
+	if (!peer) {
+		FI_DBG(&rxd_prov, FI_LOG_EP_CTRL,
+		       "dropping CTS for released peer\n");
+		return;
+	}
+
+	rxd_update_peer(ep, peer, cts->cts_addr);
+}
+
+/*
+ * Sample the RTT only from the packet which triggered the ack, so delayed
+ * acks don't inflate the estimate, and never from a retransmitted packet
+ * (Karn's rule).
+ */
+static void rxd_ack_sample(struct rxd_ack_pkt *ack,
+			   struct rxd_pkt_entry *pkt_entry, uint64_t *sample)
+{
+	if (rxd_get_base_hdr(pkt_entry)->seq_no == ack->echo_seq_no &&
+	    !(pkt_entry->flags & RXD_PKT_RETRANS))
+		*sample = pkt_entry->timestamp;
+}
+
+static uint32_t rxd_handle_sack(struct rxd_ack_pkt *ack, struct rxd_peer *peer,
+				uint64_t *sample)
+{
+	struct rxd_pkt_entry *pkt_entry;
+	uint64_t seq_no;
+	uint32_t i, acked = 0;
+
+	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		if (pkt_entry->flags & (RXD_PKT_ACKED | RXD_PKT_SACKED))
+			continue;
+
+		seq_no = rxd_get_base_hdr(pkt_entry)->seq_no;
+		for (i = 0; i < ack->sack_cnt; i++) {
+			if (ofi_after_eq(seq_no, ack->sack[i].start) &&
+			    ofi_before(seq_no, ack->sack[i].end)) {
+				pkt_entry->flags |= RXD_PKT_SACKED;
+				rxd_ack_sample(ack, pkt_entry, sample);
+				acked++;
+				break;
+			}
+		}
+	}
+
+	return acked;
 }
 
 static void rxd_handle_ack(struct rxd_ep *ep, struct rxd_pkt_entry *ack_entry)
 {
 	struct rxd_ack_pkt *ack = (struct rxd_ack_pkt *) (ack_entry->pkt);
 	struct rxd_pkt_entry *pkt_entry;
-	fi_addr_t peer = ack->base_hdr.peer;
+	struct rxd_peer *peer = rxd_peer(ep, ack->base_hdr.peer);
 	struct rxd_base_hdr *hdr;
+	uint64_t sample = 0, rtt = 0;
+	uint32_t acked = 0;
 
-	ep->peers[peer].tx_window = ack->ext_hdr.rx_id;
-
-	if (ep->peers[peer].last_rx_ack == ack->base_hdr.seq_no)
+	if (ack_entry->pkt_size < sizeof(*ack) + ep->rx_prefix_size ||
+	    ack->sack_cnt > RXD_MAX_SACK) {
+		FI_WARN(&rxd_prov, FI_LOG_CQ, "Dropping malformed ack\n");
 		return;
+	}
 
-	ep->peers[peer].last_rx_ack = ack->base_hdr.seq_no;
+	peer->tx_window = ack->ext_hdr.rx_id;
 
-	if (dlist_empty(&ep->peers[peer].unacked))
+	if (peer->last_rx_ack == ack->base_hdr.seq_no) {
+		if (!ack->sack_cnt || dlist_empty(&peer->unacked))
+			return;
+		peer->dup_ack_cnt++;
+		goto sack;
+	}
+
+	peer->last_rx_ack = ack->base_hdr.seq_no;
+	peer->dup_ack_cnt = 0;
+
+	if (dlist_empty(&peer->unacked))
 		return;
 
-	pkt_entry = container_of((&ep->peers[peer].unacked)->next,
+	pkt_entry = container_of((&peer->unacked)->next,
 				struct rxd_pkt_entry, d_entry);
 
-	while (&pkt_entry->d_entry != &ep->peers[peer].unacked) {
+	while (&pkt_entry->d_entry != &peer->unacked) {
 		hdr = rxd_get_base_hdr(pkt_entry);
 		if (ofi_after_eq(hdr->seq_no, ack->base_hdr.seq_no))
 			break;
 
+		if (!(pkt_entry->flags & (RXD_PKT_ACKED | RXD_PKT_SACKED))) {
+			rxd_ack_sample(ack, pkt_entry, &sample);
+			acked++;
+		}
+
 		if (pkt_entry->flags & RXD_PKT_IN_USE) {
 			pkt_entry->flags |= RXD_PKT_ACKED;
 			pkt_entry = container_of((&pkt_entry->d_entry)->next,
@@ -1094,21 +1242,34 @@ static void rxd_handle_ack(struct rxd_ep *ep, struct rxd_pkt_entry *ack_entry)
 			continue;
 		}
 		rxd_remove_free_pkt_entry(pkt_entry);
-		ep->peers[peer].unacked_cnt--;
-		ep->peers[peer].retry_cnt = 0;
+		peer->unacked_cnt--;
+		peer->retry_cnt = 0;
 
-		pkt_entry = container_of((&ep->peers[peer].unacked)->next,
+		pkt_entry = container_of((&peer->unacked)->next,
 					struct rxd_pkt_entry, d_entry);
 	}
 
-	rxd_progress_tx_list(ep, &ep->peers[ack->base_hdr.peer]);
+sack:
+	acked += rxd_handle_sack(ack, peer, &sample);
+	if (sample) {
+		rtt = fi_gettime_us() - sample;
+		rxd_update_rtt(peer, rtt);
+	}
+	rxd_cc_ack(ep, peer, acked, rtt);
+
+	if (peer->dup_ack_cnt >= RXD_DUP_ACK_THRESH) {
+		rxd_cc_loss(ep, peer, 0);
+		rxd_ep_fast_retransmit(ep, peer);
+	}
+
+	rxd_progress_tx_list(ep, peer);
 } 
 
 void rxd_handle_send_comp(struct rxd_ep *ep, struct fi_cq_msg_entry *comp)
 {
 	struct rxd_pkt_entry *pkt_entry =
 		container_of(comp->op_context, struct rxd_pkt_entry, context);
-	fi_addr_t peer;
+	struct rxd_peer *peer;
 
 	FI_DBG(&rxd_prov, FI_LOG_EP_DATA,
 	       "got send completion (type: %s)\n",
@@ -1121,10 +1282,12 @@ void rxd_handle_send_comp(struct rxd_ep *ep, struct fi_cq_msg_entry *comp)
 		break;
 	default:
 		if (pkt_entry->flags & RXD_PKT_ACKED) {
-			peer = pkt_entry->peer;
+			peer = rxd_peer(ep, pkt_entry->peer);
 			rxd_remove_free_pkt_entry(pkt_entry);
-			ep->peers[peer].unacked_cnt--;
-			rxd_progress_tx_list(ep, &ep->peers[peer]);
+			if (peer) {
+				peer->unacked_cnt--;
+				rxd_progress_tx_list(ep, peer);
+			}
 		} else {
 			pkt_entry->flags &= ~RXD_PKT_IN_USE;
 		}
@@ -1144,6 +1307,17 @@ void rxd_handle_recv_comp(struct rxd_ep *ep, struct fi_cq_msg_entry *comp)
 	rxd_remove_rx_pkt(ep, pkt_entry);
 
 	pkt_entry->pkt_size = comp->len;
+
+	/* Anything past the handshake needs state for the sending peer */
+	if (rxd_pkt_type(pkt_entry) != RXD_RTS &&
+	    rxd_pkt_type(pkt_entry) != RXD_CTS &&
+	    !rxd_peer(ep, rxd_get_base_hdr(pkt_entry)->peer)) {
+		FI_DBG(&rxd_prov, FI_LOG_EP_DATA,
+		       "dropping packet from unknown peer\n");
+		ofi_buf_free(pkt_entry);
+		return;
+	}
+
 	switch (rxd_pkt_type(pkt_entry)) {
 	case RXD_RTS:
 		rxd_handle_rts(ep, pkt_entry);
@@ -1247,7 +1421,7 @@ ssize_t rxd_cq_sreadfrom(struct fid_cq *cq_fid, void *buf, size_t count,
 		cq->cq_fastlock_release(&cq->ep_list_lock);
 
 		ret = fi_wait(&cq->wait->wait_fid, ep_retry == -1 ?
-			      timeout : rxd_get_timeout(ep_retry));
+			      timeout : ep_retry);
 
 		if (ep_retry != -1 && ret == -FI_ETIMEDOUT)
 			ret = 0;
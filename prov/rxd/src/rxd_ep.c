@@ -275,16 +275,189 @@ static int rxd_ep_enable(struct rxd_ep *ep)
 }
 
 /*
- * Exponential back-off starting at 1ms, max 4s.
+ * Retransmit timeout estimated from the peer's RTT (RFC 6298), doubled
+ * for every retransmit that has gone unanswered, max 4s.
  */
-int rxd_get_timeout(uint8_t retry_cnt)
+uint64_t rxd_get_rto(struct rxd_peer *peer)
 {
-	return MIN(1 << retry_cnt, 4000);
+	return MIN(peer->rto << MIN(peer->retry_cnt, 12), RXD_MAX_RTO);
 }
 
-uint64_t rxd_get_retry_time(uint64_t start, uint8_t retry_cnt)
+void rxd_update_rtt(struct rxd_peer *peer, uint64_t rtt)
 {
-	return start + rxd_get_timeout(retry_cnt);
+	uint64_t delta;
+
+	if (!peer->srtt) {
+		peer->srtt = MAX(rtt, 1);
+		peer->rttvar = rtt / 2;
+	} else {
+		delta = peer->srtt > rtt ? peer->srtt - rtt : rtt - peer->srtt;
+		peer->rttvar = (3 * peer->rttvar + delta) / 4;
+		peer->srtt = (7 * peer->srtt + rtt) / 8;
+	}
+
+	peer->rto = MIN(MAX(peer->srtt + 4 * peer->rttvar, RXD_MIN_RTO),
+			RXD_MAX_RTO);
+}
+
+static void rxd_timer_init(struct rxd_timer_wheel *wheel)
+{
+	int level, slot;
+
+	wheel->now = fi_gettime_us() / RXD_TIMER_TICK;
+	wheel->armed = 0;
+	for (level = 0; level < RXD_TIMER_LEVELS; level++) {
+		for (slot = 0; slot < RXD_TIMER_SLOTS; slot++)
+			dlist_init(&wheel->slots[level][slot]);
+	}
+}
+
+static void rxd_timer_insert(struct rxd_timer_wheel *wheel,
+			     struct rxd_peer *peer)
+{
+	uint64_t expire, delta;
+	int level;
+
+	expire = MAX(peer->timer_expire, wheel->now + 1);
+	delta = MIN(expire - wheel->now,
+		    (1ULL << (RXD_TIMER_BITS * RXD_TIMER_LEVELS)) - 1);
+	expire = wheel->now + delta;
+
+	for (level = 0; level < RXD_TIMER_LEVELS - 1; level++) {
+		if (delta < (1ULL << (RXD_TIMER_BITS * (level + 1))))
+			break;
+	}
+
+	dlist_insert_tail(&peer->timer_entry, &wheel->slots[level]
+			  [(expire >> (RXD_TIMER_BITS * level)) & RXD_TIMER_MASK]);
+}
+
+/*
+ * Arm the peer's timer for the given time (usec), unless it is already
+ * set to go off earlier.  Timers are never cancelled: the handler checks
+ * the peer's actual state when one fires.
+ */
+void rxd_peer_arm_timer(struct rxd_ep *ep, struct rxd_peer *peer,
+			uint64_t expire)
+{
+	expire = (expire + RXD_TIMER_TICK - 1) / RXD_TIMER_TICK;
+
+	if (!dlist_empty(&peer->timer_entry)) {
+		if (peer->timer_expire <= expire)
+			return;
+		dlist_remove(&peer->timer_entry);
+	} else {
+		ep->timers.armed++;
+	}
+
+	peer->timer_expire = expire;
+	rxd_timer_insert(&ep->timers, peer);
+}
+
+static void rxd_peer_disarm_timer(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	if (dlist_empty(&peer->timer_entry))
+		return;
+
+	dlist_remove_init(&peer->timer_entry);
+	ep->timers.armed--;
+}
+
+static void rxd_timer_cascade(struct rxd_timer_wheel *wheel, int level)
+{
+	struct dlist_entry *slot;
+	struct rxd_peer *peer;
+
+	slot = &wheel->slots[level][(wheel->now >> (RXD_TIMER_BITS * level)) &
+				    RXD_TIMER_MASK];
+	while (!dlist_empty(slot)) {
+		dlist_pop_front(slot, struct rxd_peer, peer, timer_entry);
+		rxd_timer_insert(wheel, peer);
+	}
+}
+
+/*
+ * Move the wheel forward to 'now', collecting the peers whose timers
+ * expired on the way.
+ */
+static void rxd_timer_advance(struct rxd_timer_wheel *wheel, uint64_t now,
+			      struct dlist_entry *expired)
+{
+	int level;
+
+	if (!wheel->armed) {
+		wheel->now = MAX(wheel->now, now);
+		return;
+	}
+
+	while (wheel->now < now) {
+		wheel->now++;
+		for (level = RXD_TIMER_LEVELS - 1; level > 0; level--) {
+			if (!(wheel->now &
+			      ((1ULL << (RXD_TIMER_BITS * level)) - 1)))
+				rxd_timer_cascade(wheel, level);
+		}
+		dlist_splice_tail(expired,
+				  &wheel->slots[0][wheel->now & RXD_TIMER_MASK]);
+	}
+}
+
+/*
+ * Msec until the wheel next needs to be looked at: the next armed level 0
+ * slot, or else the next cascade of level 1.  -1 if nothing is armed.
+ */
+static int rxd_timer_next(struct rxd_timer_wheel *wheel)
+{
+	int i;
+
+	if (!wheel->armed)
+		return -1;
+
+	for (i = 1; i < RXD_TIMER_SLOTS; i++) {
+		if (!dlist_empty(&wheel->slots[0][(wheel->now + i) &
+						  RXD_TIMER_MASK]))
+			break;
+	}
+
+	i = MIN(i, RXD_TIMER_SLOTS - (int) (wheel->now & RXD_TIMER_MASK));
+	return i * RXD_TIMER_TICK / 1000;
+}
+
+/*
+ * Point the packet at the segment in the user's buffer rather than copying
+ * it in.  The buffer stays valid until the transfer completes, which waits
+ * for all of its packets to be acked and for their sends to complete.
+ * Returns 0 if the segment spans more buffers than can be gathered.
+ */
+static size_t rxd_init_zcopy_pkt(struct rxd_ep *ep,
+				 struct rxd_x_entry *tx_entry,
+				 struct rxd_pkt_entry *pkt_entry,
+				 size_t seg_size)
+{
+	uint64_t offset = tx_entry->bytes_done;
+	size_t i, len = 0, count = 1;
+
+	for (i = 0; offset >= tx_entry->iov[i].iov_len; i++)
+		offset -= tx_entry->iov[i].iov_len;
+
+	for (; len < seg_size && i < tx_entry->iov_count; i++, count++) {
+		if (count == ep->zcopy_iov_limit)
+			return 0;
+
+		pkt_entry->iov[count].iov_base =
+			(char *) tx_entry->iov[i].iov_base + offset;
+		pkt_entry->iov[count].iov_len =
+			MIN(tx_entry->iov[i].iov_len - offset, seg_size - len);
+		len += pkt_entry->iov[count].iov_len;
+		offset = 0;
+	}
+
+	pkt_entry->iov[0].iov_base = rxd_pkt_start(pkt_entry);
+	pkt_entry->iov[0].iov_len = sizeof(struct rxd_data_pkt) +
+				    ep->tx_prefix_size;
+	pkt_entry->iov_count = (uint8_t) count;
+	pkt_entry->flags |= RXD_PKT_ZCOPY;
+	return len;
 }
 
 void rxd_init_data_pkt(struct rxd_ep *ep, struct rxd_x_entry *tx_entry,
@@ -305,12 +478,22 @@ void rxd_init_data_pkt(struct rxd_ep *ep, struct rxd_x_entry *tx_entry,
 	data_pkt->ext_hdr.rx_id = tx_entry->rx_id;
 	data_pkt->ext_hdr.tx_id = tx_entry->tx_id;
 	data_pkt->ext_hdr.seg_no = tx_entry->next_seg_no++;
-	data_pkt->base_hdr.peer = ep->peers[tx_entry->peer].peer_addr;
-
-	pkt_entry->pkt_size = ofi_copy_from_iov(data_pkt->msg, seg_size,
-						tx_entry->iov,
-						tx_entry->iov_count,
-						tx_entry->bytes_done);
+	data_pkt->base_hdr.peer = rxd_peer(ep, tx_entry->peer)->peer_addr;
+
+	/*
+	 * Atomic fetch responses must carry the data from before the op is
+	 * applied, and inject buffers aren't held, so those are always copied.
+	 */
+	pkt_entry->pkt_size = 0;
+	if (ep->zcopy_iov_limit && !(tx_entry->flags & RXD_INJECT) &&
+	    !(tx_entry->cq_entry.flags & FI_ATOMIC))
+		pkt_entry->pkt_size = rxd_init_zcopy_pkt(ep, tx_entry,
+							 pkt_entry, seg_size);
+	if (!pkt_entry->pkt_size)
+		pkt_entry->pkt_size = ofi_copy_from_iov(data_pkt->msg, seg_size,
+							tx_entry->iov,
+							tx_entry->iov_count,
+							tx_entry->bytes_done);
 	pkt_entry->peer = tx_entry->peer;
 
 	tx_entry->bytes_done += pkt_entry->pkt_size;
@@ -360,7 +543,7 @@ struct rxd_x_entry *rxd_tx_entry_init_common(struct rxd_ep *ep, fi_addr_t addr,
 	rxd_init_base_hdr(ep, &(*ptr), tx_entry);
 
 	dlist_insert_tail(&tx_entry->entry,
-			  &ep->peers[tx_entry->peer].tx_list);
+			  &rxd_peer(ep, tx_entry->peer)->tx_list);
 
 	return tx_entry;
 }
@@ -373,23 +556,42 @@ void rxd_tx_entry_free(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 	ofi_ibuf_free(tx_entry);
 }
 
-void rxd_insert_unacked(struct rxd_ep *ep, fi_addr_t peer,
+void rxd_insert_unacked(struct rxd_ep *ep, fi_addr_t addr,
 			struct rxd_pkt_entry *pkt_entry)
 {
-	dlist_insert_tail(&pkt_entry->d_entry,
-			  &ep->peers[peer].unacked);
-	ep->peers[peer].unacked_cnt++;
+	struct rxd_peer *peer = rxd_peer(ep, addr);
+
+	dlist_insert_tail(&pkt_entry->d_entry, &peer->unacked);
+	peer->unacked_cnt++;
+
+	if (rxd_env.retry)
+		rxd_peer_arm_timer(ep, peer, pkt_entry->timestamp +
+				   rxd_get_rto(peer));
+}
+
+/*
+ * Ask for an ack twice per congestion window, and for the packet that
+ * fills it, so acks keep clocking out packets while the window is smaller
+ * than the receiver's.
+ */
+static int rxd_peer_ack_req(struct rxd_peer *peer, uint64_t seq_no)
+{
+	if (peer->cwnd >= peer->tx_window)
+		return 0;
+
+	return peer->unacked_cnt + 1 >= peer->cwnd ||
+	       !(seq_no % MAX(peer->cwnd / 2, 1));
 }
 
 ssize_t rxd_ep_post_data_pkts(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 {
+	struct rxd_peer *peer = rxd_peer(ep, tx_entry->peer);
 	struct rxd_pkt_entry *pkt_entry;
 	struct rxd_data_pkt *data;
 
 	while (tx_entry->bytes_done != tx_entry->cq_entry.len) {
-		if (ep->peers[tx_entry->peer].unacked_cnt >=
-		    ep->peers[tx_entry->peer].tx_window)
-			return 0;
+		if (rxd_peer_tx_blocked(ep, peer))
+			return 1;
 
 		pkt_entry = rxd_get_tx_pkt(ep);
 		if (!pkt_entry)
@@ -402,25 +604,33 @@ ssize_t rxd_ep_post_data_pkts(struct rxd_ep *ep, struct rxd_x_entry *tx_entry)
 				        data->ext_hdr.seg_no;
 		if (data->base_hdr.type != RXD_DATA_READ)
 			data->base_hdr.seq_no++;
+		if (rxd_peer_ack_req(peer, data->base_hdr.seq_no))
+			data->base_hdr.flags |= RXD_ACK_REQ;
 
 		rxd_ep_send_pkt(ep, pkt_entry);
 		rxd_insert_unacked(ep, tx_entry->peer, pkt_entry);
+		rxd_cc_sent(ep, peer);
 	}
 
-	return ep->peers[tx_entry->peer].unacked_cnt >=
-	       ep->peers[tx_entry->peer].tx_window;
+	return rxd_peer_window_full(peer);
 }
 
 int rxd_ep_send_pkt(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
 {
 	int ret;
 
-	pkt_entry->timestamp = fi_gettime_ms();
+	pkt_entry->timestamp = fi_gettime_us();
 
-	ret = fi_send(ep->dg_ep, (const void *) rxd_pkt_start(pkt_entry),
-		      pkt_entry->pkt_size, pkt_entry->desc,
-		      rxd_ep_av(ep)->rxd_addr_table[pkt_entry->peer].dg_addr,
-		      &pkt_entry->context);
+	if (pkt_entry->flags & RXD_PKT_ZCOPY)
+		ret = fi_sendv(ep->dg_ep, pkt_entry->iov, NULL,
+			       pkt_entry->iov_count,
+			       rxd_ep_av(ep)->rxd_addr_table[pkt_entry->peer].dg_addr,
+			       &pkt_entry->context);
+	else
+		ret = fi_send(ep->dg_ep, (const void *) rxd_pkt_start(pkt_entry),
+			      pkt_entry->pkt_size, pkt_entry->desc,
+			      rxd_ep_av(ep)->rxd_addr_table[pkt_entry->peer].dg_addr,
+			      &pkt_entry->context);
 	if (ret) {
 		FI_WARN(&rxd_prov, FI_LOG_EP_CTRL, "error sending packet: %d (%s)\n",
 			ret, fi_strerror(-ret));
@@ -461,15 +671,22 @@ static ssize_t rxd_ep_send_rts(struct rxd_ep *rxd_ep, fi_addr_t rxd_addr)
 
 	rxd_ep_send_pkt(rxd_ep, pkt_entry);
 	rxd_insert_unacked(rxd_ep, rxd_addr, pkt_entry);
-	dlist_insert_tail(&rxd_ep->peers[rxd_addr].entry, &rxd_ep->rts_sent_list);
+	dlist_insert_tail(&rxd_peer(rxd_ep, rxd_addr)->entry,
+			  &rxd_ep->rts_sent_list);
 
 	return 0;
 }
 
 ssize_t rxd_send_rts_if_needed(struct rxd_ep *ep, fi_addr_t addr)
 {
-	if (ep->peers[addr].peer_addr == FI_ADDR_UNSPEC &&
-	    dlist_empty(&ep->peers[addr].unacked))
+	struct rxd_peer *peer;
+
+	peer = rxd_get_peer(ep, addr);
+	if (!peer)
+		return -FI_ENOMEM;
+
+	if (peer->peer_addr == FI_ADDR_UNSPEC &&
+	    dlist_empty(&peer->unacked))
 		return rxd_ep_send_rts(ep, addr);
 	return 0;
 }
@@ -482,7 +699,7 @@ void rxd_init_base_hdr(struct rxd_ep *rxd_ep, void **ptr,
 	hdr->version = RXD_PROTOCOL_VERSION;
 	hdr->type = tx_entry->op;
 	hdr->seq_no = 0;
-	hdr->peer = rxd_ep->peers[tx_entry->peer].peer_addr;
+	hdr->peer = rxd_peer(rxd_ep, tx_entry->peer)->peer_addr;
 	hdr->flags = tx_entry->flags;
 
 	*ptr = (char *) (*ptr) + sizeof(*hdr);
@@ -552,8 +769,58 @@ size_t rxd_init_msg(void **ptr, const struct iovec *iov, size_t iov_count,
 	return done;
 }
 
-void rxd_ep_send_ack(struct rxd_ep *rxd_ep, fi_addr_t peer)
+static void rxd_ep_add_sack(struct rxd_ack_pkt *ack, struct rxd_sack_blk *blk,
+			    uint64_t last_rx_seq, int *recent)
+{
+	if (ofi_after_eq(last_rx_seq, blk->start) &&
+	    ofi_before(last_rx_seq, blk->end)) {
+		ack->sack[0] = *blk;
+		*recent = 1;
+	} else if (ack->sack_cnt < RXD_MAX_SACK) {
+		ack->sack[ack->sack_cnt++] = *blk;
+	}
+}
+
+/*
+ * Report the held out of order packets as ranges.  As in TCP, the first
+ * block is the one holding the most recently received packet so that the
+ * sender learns about every new range even when there are more ranges than
+ * fit in the ack; the rest are filled in from the lowest sequence number.
+ */
+static void rxd_ep_set_sack(struct rxd_ack_pkt *ack, struct rxd_peer *peer)
 {
+	struct rxd_pkt_entry *pkt_entry;
+	struct rxd_sack_blk blk;
+	uint64_t seq_no;
+	int recent = 0;
+
+	ack->sack_cnt = 1;
+	blk.start = blk.end = 0;
+	dlist_foreach_container(&peer->buf_pkts, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		seq_no = rxd_get_base_hdr(pkt_entry)->seq_no;
+		if (blk.end == seq_no && blk.start != blk.end) {
+			blk.end++;
+			continue;
+		}
+		if (blk.start != blk.end)
+			rxd_ep_add_sack(ack, &blk, peer->last_rx_seq, &recent);
+		blk.start = seq_no;
+		blk.end = seq_no + 1;
+	}
+	if (blk.start != blk.end)
+		rxd_ep_add_sack(ack, &blk, peer->last_rx_seq, &recent);
+
+	if (!recent) {
+		memmove(&ack->sack[0], &ack->sack[1],
+			sizeof(ack->sack[0]) * (ack->sack_cnt - 1));
+		ack->sack_cnt--;
+	}
+}
+
+void rxd_ep_send_ack(struct rxd_ep *rxd_ep, fi_addr_t addr)
+{
+	struct rxd_peer *peer = rxd_peer(rxd_ep, addr);
 	struct rxd_pkt_entry *pkt_entry;
 	struct rxd_ack_pkt *ack;
 
@@ -565,14 +832,16 @@ void rxd_ep_send_ack(struct rxd_ep *rxd_ep, fi_addr_t peer)
 
 	ack = (struct rxd_ack_pkt *) (pkt_entry->pkt);
 	pkt_entry->pkt_size = sizeof(*ack) + rxd_ep->tx_prefix_size;
-	pkt_entry->peer = peer;
+	pkt_entry->peer = addr;
 
 	ack->base_hdr.version = RXD_PROTOCOL_VERSION;
 	ack->base_hdr.type = RXD_ACK;
-	ack->base_hdr.peer = rxd_ep->peers[peer].peer_addr;
-	ack->base_hdr.seq_no = rxd_ep->peers[peer].rx_seq_no;
-	ack->ext_hdr.rx_id = rxd_ep->peers[peer].rx_window;
-	rxd_ep->peers[peer].last_tx_ack = ack->base_hdr.seq_no;
+	ack->base_hdr.peer = peer->peer_addr;
+	ack->base_hdr.seq_no = peer->rx_seq_no;
+	ack->ext_hdr.rx_id = peer->rx_window;
+	ack->echo_seq_no = peer->last_rx_seq;
+	rxd_ep_set_sack(ack, peer);
+	peer->last_tx_ack = ack->base_hdr.seq_no;
 
 	dlist_insert_tail(&pkt_entry->d_entry, &rxd_ep->ctrl_pkts);
 	if (rxd_ep_send_pkt(rxd_ep, pkt_entry))
@@ -592,6 +861,11 @@ static void rxd_ep_free_res(struct rxd_ep *ep)
 
 	if (ep->rx_entry_pool.pool)
 		ofi_bufpool_destroy(ep->rx_entry_pool.pool);
+
+	if (ep->peer_pool)
+		ofi_bufpool_destroy(ep->peer_pool);
+
+	free(ep->peer_table);
 }
 
 static void rxd_close_peer(struct rxd_ep *ep, struct rxd_peer *peer)
@@ -624,10 +898,107 @@ static void rxd_close_peer(struct rxd_ep *ep, struct rxd_peer *peer)
 		rxd_tx_entry_free(ep, x_entry);
 	}
 
-	dlist_remove(&peer->entry);
+	while (!dlist_empty(&peer->buf_pkts)) {
+		dlist_pop_front(&peer->buf_pkts, struct rxd_pkt_entry,
+				pkt_entry, d_entry);
+		ofi_buf_free(pkt_entry);
+	}
+
+	rxd_peer_disarm_timer(ep, peer);
+	dlist_remove_init(&peer->entry);
 	peer->active = 0;
 }
 
+static void rxd_init_peer(struct rxd_ep *ep, struct rxd_peer *peer,
+			  fi_addr_t rxd_addr)
+{
+	memset(peer, 0, sizeof(*peer));
+	peer->rxd_addr = rxd_addr;
+	peer->peer_addr = FI_ADDR_UNSPEC;
+	peer->rx_window = rxd_env.max_unacked;
+	peer->tx_window = rxd_env.max_unacked;
+	peer->rto = RXD_MIN_RTO;
+	ep->cc->init(peer);
+	dlist_init(&peer->entry);
+	dlist_init(&peer->timer_entry);
+	dlist_init(&peer->unacked);
+	dlist_init(&peer->tx_list);
+	dlist_init(&peer->rx_list);
+	dlist_init(&peer->rma_rx_list);
+	dlist_init(&peer->buf_pkts);
+}
+
+struct rxd_peer *rxd_get_peer(struct rxd_ep *ep, fi_addr_t rxd_addr)
+{
+	struct rxd_peer_chunk **chunk;
+	struct rxd_peer *peer;
+
+	peer = rxd_peer(ep, rxd_addr);
+	if (peer || rxd_addr >= (fi_addr_t) rxd_env.max_peers)
+		return peer;
+
+	chunk = &ep->peer_table[rxd_addr >> RXD_PEER_CHUNK_BITS];
+	if (!*chunk) {
+		*chunk = calloc(1, sizeof(**chunk));
+		if (!*chunk)
+			return NULL;
+	}
+
+	peer = ofi_buf_alloc(ep->peer_pool);
+	if (!peer) {
+		if (!(*chunk)->used) {
+			free(*chunk);
+			*chunk = NULL;
+		}
+		return NULL;
+	}
+
+	rxd_init_peer(ep, peer, rxd_addr);
+	(*chunk)->peers[rxd_addr & RXD_PEER_CHUNK_MASK] = peer;
+	(*chunk)->used++;
+	return peer;
+}
+
+static void rxd_release_peer(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	struct rxd_peer_chunk **chunk;
+
+	chunk = &ep->peer_table[peer->rxd_addr >> RXD_PEER_CHUNK_BITS];
+	(*chunk)->peers[peer->rxd_addr & RXD_PEER_CHUNK_MASK] = NULL;
+	if (!--(*chunk)->used) {
+		free(*chunk);
+		*chunk = NULL;
+	}
+	ofi_buf_free(peer);
+}
+
+static int rxd_match_unexp_peer(struct dlist_entry *item, const void *arg)
+{
+	struct rxd_unexp_msg *unexp_msg;
+
+	unexp_msg = container_of(item, struct rxd_unexp_msg, entry);
+	return unexp_msg->base_hdr->peer == *(fi_addr_t *) arg;
+}
+
+/*
+ * A peer can only be given back once nothing refers to it, including
+ * unexpected messages it sent that are still waiting for a receive.
+ * It must also never have completed the RTS/CTS handshake: once it has,
+ * the remote side may hold a session with sequence numbers that a fresh
+ * peer would not match, and there is no way to tell it to reset them.
+ */
+static int rxd_peer_reclaimable(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	return peer->peer_addr == FI_ADDR_UNSPEC &&
+	       dlist_empty(&peer->unacked) && dlist_empty(&peer->tx_list) &&
+	       dlist_empty(&peer->rx_list) && dlist_empty(&peer->rma_rx_list) &&
+	       dlist_empty(&peer->buf_pkts) && !peer->curr_unexp &&
+	       !dlist_find_first_match(&ep->unexp_list, rxd_match_unexp_peer,
+				       &peer->rxd_addr) &&
+	       !dlist_find_first_match(&ep->unexp_tag_list,
+				       rxd_match_unexp_peer, &peer->rxd_addr);
+}
+
 void rxd_cleanup_unexp_msg(struct rxd_unexp_msg *unexp_msg)
 {
 	struct rxd_pkt_entry *pkt_entry;
@@ -658,11 +1029,17 @@ static int rxd_ep_close(struct fid *fid)
 	struct rxd_pkt_entry *pkt_entry;
 	struct slist_entry *entry;
 	struct rxd_peer *peer;
+	fi_addr_t i;
 
 	ep = container_of(fid, struct rxd_ep, util_ep.ep_fid.fid);
 
-	dlist_foreach_container(&ep->active_peers, struct rxd_peer, peer, entry)
-		rxd_close_peer(ep, peer);
+	for (i = 0; i < (fi_addr_t) rxd_env.max_peers; i++) {
+		peer = rxd_peer(ep, i);
+		if (peer) {
+			rxd_close_peer(ep, peer);
+			rxd_release_peer(ep, peer);
+		}
+	}
 
 	ret = fi_close(&ep->dg_ep->fid);
 	if (ret)
@@ -906,55 +1283,174 @@ static void rxd_peer_timeout(struct rxd_ep *rxd_ep, struct rxd_peer *peer)
 	     	peer->unacked_cnt--;
 	}
 
-	dlist_remove(&peer->entry);
+	rxd_peer_disarm_timer(rxd_ep, peer);
+	dlist_remove_init(&peer->entry);
+	peer->active = 0;
 }
 
-static void rxd_progress_pkt_list(struct rxd_ep *ep, struct rxd_peer *peer)
+static int rxd_ep_retransmit(struct rxd_ep *ep, struct rxd_pkt_entry *pkt_entry)
+{
+	pkt_entry->flags |= RXD_PKT_RETRANS;
+	return rxd_ep_send_pkt(ep, pkt_entry);
+}
+
+/*
+ * Resend the holes below the highest selectively acked packet.  Each packet
+ * is resent this way at most once; anything lost again is left to the
+ * retransmit timer.
+ */
+void rxd_ep_fast_retransmit(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	struct rxd_pkt_entry *pkt_entry, *last_sacked = NULL;
+
+	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		if (pkt_entry->flags & RXD_PKT_SACKED)
+			last_sacked = pkt_entry;
+	}
+	if (!last_sacked)
+		return;
+
+	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		if (pkt_entry == last_sacked)
+			break;
+		if (pkt_entry->flags & (RXD_PKT_IN_USE | RXD_PKT_ACKED |
+					RXD_PKT_SACKED | RXD_PKT_RETRANS))
+			continue;
+		if (rxd_ep_retransmit(ep, pkt_entry))
+			break;
+	}
+}
+
+/*
+ * The retransmit timer runs off the oldest packet the peer hasn't acked in
+ * any form.  If everything outstanding has been selectively acked, the
+ * oldest packet is used as a probe to get the cumulative ack resent.
+ */
+static struct rxd_pkt_entry *rxd_peer_timer_pkt(struct rxd_peer *peer,
+						int *probe)
+{
+	struct rxd_pkt_entry *pkt_entry, *sacked = NULL;
+
+	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
+				pkt_entry, d_entry) {
+		if (pkt_entry->flags & RXD_PKT_ACKED)
+			continue;
+		if (!(pkt_entry->flags & RXD_PKT_SACKED)) {
+			*probe = 0;
+			return pkt_entry;
+		}
+		if (!sacked)
+			sacked = pkt_entry;
+	}
+
+	*probe = 1;
+	return sacked;
+}
+
+/*
+ * Returns 1 if the peer timed out, in which case its outstanding sends
+ * have been failed.
+ */
+static int rxd_progress_pkt_list(struct rxd_ep *ep, struct rxd_peer *peer)
 {
 	struct rxd_pkt_entry *pkt_entry;
-	uint64_t current;
-	int ret, retry = 0;
+	uint64_t current, rto;
+	int ret, probe;
 
-	current = fi_gettime_ms();
 	if (peer->retry_cnt > RXD_MAX_PKT_RETRY) {
 		rxd_peer_timeout(ep, peer);
-		return;
+		return 1;
+	}
+
+	pkt_entry = rxd_peer_timer_pkt(peer, &probe);
+	current = fi_gettime_us();
+	rto = rxd_get_rto(peer);
+	if (!pkt_entry || pkt_entry->flags & RXD_PKT_IN_USE ||
+	    current < pkt_entry->timestamp + rto)
+		return 0;
+
+	peer->retry_cnt++;
+	if (probe) {
+		rxd_ep_retransmit(ep, pkt_entry);
+		return 0;
 	}
 
+	/* a single timeout is as likely to be a late ack as a loss */
+	if (peer->retry_cnt > 1)
+		rxd_cc_loss(ep, peer, 1);
+
+	/* Resend everything else outstanding for as long */
 	dlist_foreach_container(&peer->unacked, struct rxd_pkt_entry,
 				pkt_entry, d_entry) {
-		if (pkt_entry->flags & (RXD_PKT_IN_USE | RXD_PKT_ACKED) ||
-		    current < rxd_get_retry_time(pkt_entry->timestamp, peer->retry_cnt))
-			break;
-		retry = 1;
-		ret = rxd_ep_send_pkt(ep, pkt_entry);
+		if (pkt_entry->flags & (RXD_PKT_IN_USE | RXD_PKT_ACKED |
+					RXD_PKT_SACKED) ||
+		    current < pkt_entry->timestamp + rto)
+			continue;
+		ret = rxd_ep_retransmit(ep, pkt_entry);
 		if (ret)
 			break;
 	}
-	if (retry)
-		peer->retry_cnt++;
+	return 0;
+}
 
-	if (!dlist_empty(&peer->unacked))
-		ep->next_retry = ep->next_retry == -1 ? peer->retry_cnt :
-				 MIN(ep->next_retry, peer->retry_cnt);
+static void rxd_peer_set_timer(struct rxd_ep *ep, struct rxd_peer *peer)
+{
+	struct rxd_pkt_entry *pkt_entry;
+	int probe;
+
+	pkt_entry = rxd_peer_timer_pkt(peer, &probe);
+	if (pkt_entry)
+		rxd_peer_arm_timer(ep, peer, pkt_entry->timestamp +
+				   rxd_get_rto(peer));
+	else if (!dlist_empty(&peer->tx_list) && dlist_empty(&peer->unacked))
+		rxd_peer_arm_timer(ep, peer, fi_gettime_us());
 }
 
-void rxd_ep_progress(struct util_ep *util_ep)
+static void rxd_progress_timers(struct rxd_ep *ep)
 {
+	struct dlist_entry expired;
 	struct rxd_peer *peer;
-	struct fi_cq_msg_entry cq_entry;
-	struct dlist_entry *tmp;
+
+	dlist_init(&expired);
+	rxd_timer_advance(&ep->timers, fi_gettime_us() / RXD_TIMER_TICK,
+			  &expired);
+
+	while (!dlist_empty(&expired)) {
+		dlist_pop_front(&expired, struct rxd_peer, peer, timer_entry);
+		dlist_init(&peer->timer_entry);
+		ep->timers.armed--;
+
+		/* a peer that never answered is freed for reuse */
+		if (rxd_progress_pkt_list(ep, peer) &&
+		    rxd_peer_reclaimable(ep, peer)) {
+			rxd_release_peer(ep, peer);
+			continue;
+		}
+
+		if (!dlist_empty(&peer->tx_list))
+			rxd_progress_tx_list(ep, peer);
+		rxd_peer_set_timer(ep, peer);
+	}
+
+	ep->next_retry = rxd_timer_next(&ep->timers);
+}
+
+void rxd_ep_progress(struct util_ep *util_ep)
+{
+	struct fi_cq_msg_entry cq_entry[RXD_DG_CQ_BATCH];
 	struct rxd_ep *ep;
 	ssize_t ret;
-	int i;
+	int i, j;
 
 	ep = container_of(util_ep, struct rxd_ep, util_ep);
 
 	fastlock_acquire(&ep->util_ep.lock);
 	for(ret = 1, i = 0;
 	    ret > 0 && (!rxd_env.spin_count || i < rxd_env.spin_count);
-	    i++) {
-		ret = fi_cq_read(ep->dg_cq, &cq_entry, 1);
+	    i += ret) {
+		ret = fi_cq_read(ep->dg_cq, cq_entry, RXD_DG_CQ_BATCH);
 		if (ret == -FI_EAGAIN)
 			break;
 
@@ -963,28 +1459,17 @@ void rxd_ep_progress(struct util_ep *util_ep)
 			continue;
 		}
 
-		if (cq_entry.flags & FI_RECV)
-			rxd_handle_recv_comp(ep, &cq_entry);
-		else
-			rxd_handle_send_comp(ep, &cq_entry);
+		for (j = 0; j < ret; j++) {
+			if (cq_entry[j].flags & FI_RECV)
+				rxd_handle_recv_comp(ep, &cq_entry[j]);
+			else
+				rxd_handle_send_comp(ep, &cq_entry[j]);
+		}
 	}
 
-	if (!rxd_env.retry)
-		goto out;
+	if (rxd_env.retry)
+		rxd_progress_timers(ep);
 
-	ep->next_retry = -1;
-	dlist_foreach_container_safe(&ep->rts_sent_list, struct rxd_peer,
-				     peer, entry, tmp)
-		rxd_progress_pkt_list(ep, peer);
-
-	dlist_foreach_container_safe(&ep->active_peers, struct rxd_peer,
-				     peer, entry, tmp) {
-		rxd_progress_pkt_list(ep, peer);
-		if (dlist_empty(&peer->unacked))
-			rxd_progress_tx_list(ep, peer);
-	}
-
-out:
 	fastlock_release(&ep->util_ep.lock);
 }
 
@@ -1123,6 +1608,19 @@ int rxd_ep_init_res(struct rxd_ep *ep, struct fi_info *fi_info)
 	if (ret)
 		goto err;
 
+	ret = ofi_bufpool_create(&ep->peer_pool, sizeof(struct rxd_peer),
+				 16, 0, RXD_PEER_CHUNK_SIZE, 0);
+	if (ret)
+		goto err;
+
+	ep->peer_table = calloc(ofi_div_ceil(rxd_env.max_peers,
+					     RXD_PEER_CHUNK_SIZE),
+				sizeof(*ep->peer_table));
+	if (!ep->peer_table) {
+		ret = -FI_ENOMEM;
+		goto err;
+	}
+
 	dlist_init(&ep->rx_list);
 	dlist_init(&ep->rx_tag_list);
 	dlist_init(&ep->active_peers);
@@ -1131,6 +1629,7 @@ int rxd_ep_init_res(struct rxd_ep *ep, struct fi_info *fi_info)
 	dlist_init(&ep->unexp_tag_list);
 	dlist_init(&ep->ctrl_pkts);
 	slist_init(&ep->rx_pkt_list);
+	rxd_timer_init(&ep->timers);
 
 	return 0;
 err:
@@ -1139,35 +1638,15 @@ err:
 	return ret;
 }
 
-static void rxd_init_peer(struct rxd_ep *ep, uint64_t rxd_addr)
-{
-	ep->peers[rxd_addr].peer_addr = FI_ADDR_UNSPEC;
-	ep->peers[rxd_addr].tx_seq_no = 0;
-	ep->peers[rxd_addr].rx_seq_no = 0;
-	ep->peers[rxd_addr].last_rx_ack = 0;
-	ep->peers[rxd_addr].last_tx_ack = 0;
-	ep->peers[rxd_addr].rx_window = rxd_env.max_unacked;
-	ep->peers[rxd_addr].tx_window = rxd_env.max_unacked;
-	ep->peers[rxd_addr].unacked_cnt = 0;
-	ep->peers[rxd_addr].retry_cnt = 0;
-	ep->peers[rxd_addr].active = 0;
-	dlist_init(&ep->peers[rxd_addr].unacked);
-	dlist_init(&ep->peers[rxd_addr].tx_list);
-	dlist_init(&ep->peers[rxd_addr].rx_list);
-	dlist_init(&ep->peers[rxd_addr].rma_rx_list);
-	dlist_init(&ep->peers[rxd_addr].buf_pkts);
-}
-
 int rxd_endpoint(struct fid_domain *domain, struct fi_info *info,
 		 struct fid_ep **ep, void *context)
 {
 	struct fi_info *dg_info;
 	struct rxd_domain *rxd_domain;
 	struct rxd_ep *rxd_ep;
-	int ret, i;
+	int ret;
 
-	rxd_ep = calloc(1, sizeof(*rxd_ep) + sizeof(struct rxd_peer) *
-			rxd_env.max_peers);
+	rxd_ep = calloc(1, sizeof(*rxd_ep));
 	if (!rxd_ep)
 		return -FI_ENOMEM;
 
@@ -1202,16 +1681,20 @@ int rxd_endpoint(struct fid_domain *domain, struct fi_info *info,
 	rxd_ep->rx_msg_avail = rxd_ep->rx_size;
 	rxd_ep->tx_rma_avail = rxd_ep->tx_size;
 	rxd_ep->rx_rma_avail = rxd_ep->rx_size;
+	/* user buffers can't be gathered if the core needs them registered */
+	if (rxd_env.zcopy && !rxd_ep->do_local_mr)
+		rxd_ep->zcopy_iov_limit = MIN(dg_info->tx_attr->iov_limit,
+					      RXD_IOV_LIMIT + 1);
+	if (rxd_ep->zcopy_iov_limit < 2)
+		rxd_ep->zcopy_iov_limit = 0;
 	fi_freeinfo(dg_info);
 
 	rxd_ep->next_retry = -1;
+	rxd_ep->cc = rxd_cc_get_ops(rxd_env.cc);
 	ret = rxd_ep_init_res(rxd_ep, info);
 	if (ret)
 		goto err3;
 
-	for (i = 0; i < rxd_env.max_peers; rxd_init_peer(rxd_ep, i++))
-		;
-
 	rxd_ep->util_ep.ep_fid.fid.ops = &rxd_ep_fi_ops;
 	rxd_ep->util_ep.ep_fid.cm = &rxd_ep_cm;
 	rxd_ep->util_ep.ep_fid.ops = &rxd_ops_ep;
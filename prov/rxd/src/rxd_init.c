@@ -43,6 +43,7 @@ struct rxd_env rxd_env = {
 	.retry		= 1,
 	.max_peers	= 1024,
 	.max_unacked	= 128,
+	.zcopy		= 1,
 };
 
 char *rxd_pkt_type_str[] = {
@@ -55,6 +56,8 @@ static void rxd_init_env(void)
 	fi_param_get_bool(&rxd_prov, "retry", &rxd_env.retry);
 	fi_param_get_int(&rxd_prov, "max_peers", &rxd_env.max_peers);
 	fi_param_get_int(&rxd_prov, "max_unacked", &rxd_env.max_unacked);
+	fi_param_get_str(&rxd_prov, "cc", &rxd_env.cc);
+	fi_param_get_bool(&rxd_prov, "zcopy", &rxd_env.zcopy);
 }
 
 void rxd_info_to_core_mr_modes(uint32_t version, const struct fi_info *hints,
@@ -143,6 +146,12 @@ RXD_INI
 			"Maximum number of peers to track (default: 1024)");
 	fi_param_define(&rxd_prov, "max_unacked", FI_PARAM_INT,
 			"Maximum number of packets to send at once (default: 128)");
+	fi_param_define(&rxd_prov, "cc", FI_PARAM_STRING,
+			"Congestion control algorithm: none, aimd or delay "
+			"(default: none)");
+	fi_param_define(&rxd_prov, "zcopy", FI_PARAM_BOOL,
+			"Send data packets straight from the user buffer "
+			"(default: yes)");
 
 	rxd_init_env();
 
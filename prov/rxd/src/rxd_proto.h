@@ -84,6 +84,12 @@ struct rxd_base_hdr {
 	uint64_t	seq_no;
 };
 
+/*
+ * Data packets flagged with RXD_ACK_REQ are acked right away instead of
+ * once per receive window, so a sender limited by its congestion window
+ * keeps getting acks.
+ */
+
 /*
  * Extended header: used for large transfers and ACKs
  * 	- tx_id/rx_id:
@@ -118,13 +124,33 @@ struct rxd_cts_pkt {
 	uint64_t		cts_addr;
 };
 
+/*
+ * Selective ack block: range [start, end) of sequence numbers received
+ * beyond the cumulative ack
+ */
+#define RXD_MAX_SACK	8
+
+struct rxd_sack_blk {
+	uint64_t	start;
+	uint64_t	end;
+};
+
 /*
  * ACK: to signal received packets and send tx/rx id info
+ * 	- echo_seq_no: sequence number of the packet which triggered the ACK,
+ * 		       used by the sender to sample the RTT
+ * 	- sack_cnt: number of valid sack blocks
+ * 	- sack: out of order packets held by the receiver.  The block holding
+ * 		the most recently received packet comes first, the rest follow
+ * 		in ascending order.  ACK processing does not depend on the order.
  */
 struct rxd_ack_pkt {
 	struct rxd_base_hdr	base_hdr;
 	struct rxd_ext_hdr	ext_hdr;
-	//TODO fill in more fields? Selective ack?
+	uint64_t		echo_seq_no;
+	uint32_t		sack_cnt;
+	uint32_t		resv;
+	struct rxd_sack_blk	sack[RXD_MAX_SACK];
 };
 
 /*
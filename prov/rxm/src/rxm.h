@@ -50,6 +50,7 @@
 #include <ofi.h>
 #include <ofi_enosys.h>
 #include <ofi_util.h>
+#include <ofi_coll.h>
 #include <ofi_list.h>
 #include <ofi_proto.h>
 #include <ofi_iov.h>
@@ -75,6 +76,16 @@ extern size_t rxm_eager_limit;
 
 #define RXM_IOV_LIMIT 4
 
+#define RXM_MSG_CQ_BATCH 16
+#define RXM_RX_SLAB_CNT 2
+
+#define RXM_WARMUP_MAX_PENDING	64
+#define RXM_CONN_REAP_SCAN	8
+
+#define RXM_ADAPT_CLASSES	8
+#define RXM_ADAPT_MIN_SAMPLES	4
+#define RXM_ADAPT_PROBE		32
+
 #define RXM_MR_MODES	(OFI_MR_BASIC_MAP | FI_MR_LOCAL)
 
 #define RXM_PASSTHRU_TX_OP_FLAGS (FI_TRANSMIT_COMPLETE)
@@ -91,15 +102,21 @@ extern size_t rxm_eager_limit;
 #define RXM_MR_PROV_KEY(info) ((info->domain_attr->mr_mode == FI_MR_BASIC) ||\
 			       info->domain_attr->mr_mode & FI_MR_PROV_KEY)
 
-#define RXM_UPDATE_STATE(subsystem, buf, new_state)			\
+#define RXM_UPDATE_PKT_STATE(subsystem, buf, pkt, new_state)		\
 	do {								\
 		FI_DBG(&rxm_prov, subsystem, "[PROTO] msg_id: 0x%"	\
-		       PRIx64 " %s -> %s\n", (buf)->pkt.ctrl_hdr.msg_id,\
+		       PRIx64 " %s -> %s\n", (pkt)->ctrl_hdr.msg_id,	\
 		       rxm_proto_state_str[(buf)->hdr.state],		\
 		       rxm_proto_state_str[new_state]);			\
 		(buf)->hdr.state = new_state;				\
 	} while (0)
 
+#define RXM_UPDATE_STATE(subsystem, buf, new_state)			\
+	RXM_UPDATE_PKT_STATE(subsystem, buf, &(buf)->pkt, new_state)
+
+#define RXM_UPDATE_RX_STATE(subsystem, rx_buf, new_state)		\
+	RXM_UPDATE_PKT_STATE(subsystem, rx_buf, (rx_buf)->pkt, new_state)
+
 #define RXM_DBG_ADDR_TAG(subsystem, log_str, addr, tag) 	\
 	FI_DBG(&rxm_prov, subsystem, log_str 			\
 	       " (fi_addr: 0x%" PRIx64 " tag: 0x%" PRIx64 ")\n",\
@@ -152,6 +169,7 @@ enum rxm_cmap_signal {
 	FUNC(RXM_CMAP_CONNREQ_RECV),	\
 	FUNC(RXM_CMAP_CONNECTED_NOTIFY),\
 	FUNC(RXM_CMAP_CONNECTED),	\
+	FUNC(RXM_CMAP_CLOSING),		\
 	FUNC(RXM_CMAP_SHUTDOWN),	\
 
 enum rxm_cmap_state {
@@ -164,9 +182,9 @@ extern char *rxm_cm_state_str[];
 	do {								\
 		FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "[CM] handle: "	\
 		       "%p %s -> %s\n",	handle,				\
-		       rxm_cm_state_str[handle->state],			\
+		       rxm_cm_state_str[(handle)->state],		\
 		       rxm_cm_state_str[new_state]);			\
-		handle->state = new_state;				\
+		(handle)->state = new_state;				\
 	} while (0)
 
 struct rxm_cmap_handle {
@@ -345,7 +363,9 @@ struct rxm_atomic_resp_hdr {
 	FUNC(RXM_RNDV_ACK_RECVD),	\
 	FUNC(RXM_RNDV_FINISH),		\
 	FUNC(RXM_ATOMIC_RESP_WAIT),	\
-	FUNC(RXM_ATOMIC_RESP_SENT)
+	FUNC(RXM_ATOMIC_RESP_SENT),	\
+	FUNC(RXM_COALESCED_TX),		\
+	FUNC(RXM_RX_SLAB)
 
 enum rxm_proto_state {
 	RXM_PROTO_STATES(OFI_ENUM_VAL)
@@ -360,6 +380,9 @@ enum {
 	rxm_ctrl_rndv_ack,
 	rxm_ctrl_atomic,
 	rxm_ctrl_atomic_resp,
+	rxm_ctrl_coalesced,
+	rxm_ctrl_close,
+	rxm_ctrl_close_resp,
 };
 
 struct rxm_pkt {
@@ -368,6 +391,27 @@ struct rxm_pkt {
 	char data[];
 };
 
+/*
+ * A coalesced packet carries several eager messages to the same peer.
+ * Each message is an ofi_op_hdr followed by its payload, padded to 8
+ * bytes; pkt.hdr.size is the total length of the messages.
+ */
+static inline size_t rxm_coalesced_msg_size(size_t len)
+{
+	return ofi_get_aligned_size(sizeof(struct ofi_op_hdr) + len, 8);
+}
+
+/*
+ * The completions of the messages in a coalesced packet are held until
+ * the packet's send completes.  They are kept at the end of the packet's
+ * eager buffer, growing down towards the messages.
+ */
+struct rxm_coalesce_comp {
+	void		*context;
+	uint64_t	flags;
+	uint64_t	comp_flags;
+};
+
 union rxm_sar_ctrl_data {
 	struct {
 		enum rxm_sar_seg_type {
@@ -422,6 +466,7 @@ enum rxm_buf_pool_type {
 	RXM_BUF_POOL_TX_SAR,
 	RXM_BUF_POOL_TX_END	= RXM_BUF_POOL_TX_SAR,
 	RXM_BUF_POOL_RMA,
+	RXM_BUF_POOL_RX_SLAB,
 	RXM_BUF_POOL_MAX,
 };
 
@@ -441,6 +486,8 @@ struct rxm_rx_buf {
 	struct rxm_ep *ep;
 	/* MSG EP / shared context to which bufs would be posted to */
 	struct fid_ep *msg_ep;
+	/* Links the buffer on the repost list, or on its connection's list
+	 * of posted buffers while it's posted to a MSG EP */
 	struct dlist_entry repost_entry;
 	struct rxm_conn *conn;
 	struct rxm_recv_entry *recv_entry;
@@ -456,8 +503,42 @@ struct rxm_rx_buf {
 	size_t rndv_rma_index;
 	struct fid_mr *mr[RXM_IOV_LIMIT];
 
+	/* Set if pkt points into a slab rather than at pkt_data */
+	struct rxm_rx_slab *slab;
+	size_t pkt_len;
+	struct rxm_pkt *pkt;
+
 	/* Must stay at bottom */
-	struct rxm_pkt pkt;
+	struct rxm_pkt pkt_data;
+};
+
+/*
+ * A multi-receive buffer posted to a MSG EP.  Messages are placed in it back
+ * to back by the MSG provider and are handed to the rx path in place, through
+ * rx buffers that point into the slab.  Once the space left in it drops below
+ * the MSG EP's FI_OPT_MIN_MULTI_RECV, the slab is reposted when the last of
+ * those rx buffers is released, with another slab posted in the meantime if
+ * some are still in use.
+ */
+struct rxm_rx_slab {
+	/* Must stay at top */
+	struct rxm_buf hdr;
+
+	struct rxm_ep *ep;
+	struct fid_ep *msg_ep;
+	struct rxm_conn *conn;
+	struct dlist_entry entry;
+	/* Where the MSG provider places the next message */
+	char *cur;
+	/* Rx buffers still pointing into the slab */
+	int ref;
+	/* Given back by the MSG provider, reposted once ref drops to 0 */
+	uint8_t retired;
+	/* Freed rather than reposted, as another slab took its place */
+	uint8_t replaced;
+
+	/* Must stay at bottom */
+	char data[];
 };
 
 struct rxm_tx_base_buf {
@@ -474,6 +555,9 @@ struct rxm_tx_eager_buf {
 
 	void *app_context;
 	uint64_t flags;
+	struct rxm_conn *conn;
+	/* messages held in a coalesced packet, see rxm_coalesce_comp() */
+	size_t comp_cnt;
 
 	/* Must stay at bottom */
 	struct rxm_pkt pkt;
@@ -485,6 +569,9 @@ struct rxm_tx_sar_buf {
 
 	void *app_context;
 	uint64_t flags;
+	struct rxm_conn *conn;
+	/* Set in the first segment when the SAR limit adapts */
+	uint64_t start;
 
 	/* Must stay at bottom */
 	struct rxm_pkt pkt;
@@ -498,6 +585,9 @@ struct rxm_tx_rndv_buf {
 	uint64_t flags;
 	struct fid_mr *mr[RXM_IOV_LIMIT];
 	uint8_t count;
+	struct rxm_conn *conn;
+	/* Set when the SAR limit adapts */
+	uint64_t start;
 
 	/* Must stay at bottom */
 	struct rxm_pkt pkt;
@@ -514,6 +604,7 @@ struct rxm_rma_buf {
 		struct fid_mr *mr[RXM_IOV_LIMIT];
 		uint8_t count;
 	} mr;
+	struct rxm_conn *conn;
 	/* Must stay at bottom */
 	struct rxm_pkt pkt;
 };
@@ -524,6 +615,7 @@ struct rxm_tx_atomic_buf {
 
 	void *app_context;
 	uint64_t flags;
+	struct rxm_conn *conn;
 	struct iovec result_iov[RXM_IOV_LIMIT];
 	uint8_t result_iov_count;
 
@@ -631,6 +723,23 @@ struct rxm_buf_pool {
 	struct rxm_ep *rxm_ep;
 };
 
+/*
+ * An FI_CONNECT_PEERS request.  Up to max_pending of the addresses are
+ * being connected to at a time; pending holds those, addr all of them.
+ */
+struct rxm_conn_warmup {
+	struct dlist_entry	entry;
+	void			*context;
+	size_t			count;
+	size_t			next;
+	size_t			connected;
+	int			err;
+	size_t			max_pending;
+	size_t			pending_cnt;
+	fi_addr_t		*pending;
+	fi_addr_t		addr[];
+};
+
 struct rxm_msg_eq_entry {
 	ssize_t			rd;
 	uint32_t		event;
@@ -667,16 +776,84 @@ struct rxm_ep {
 	size_t			inject_limit;
 	size_t			eager_limit;
 	size_t			sar_limit;
+	int			sar_adapt;
+
+	size_t			coalesce_size;
+	int			coalesce_usec;
+	size_t			rx_slab_size;
+
+	/* Incoming atomic requests are queued when atomic_queue_size is set,
+	 * and run ahead of other completions.  Each response takes one of
+	 * atomic_resp_credits until it completes */
+	size_t			atomic_queue_size;
+	size_t			atomic_resp_credits;
+	struct dlist_entry	atomic_req_queue;
+
+	/* Connections beyond max_conn are closed once idle, least recently
+	 * used first.  conn_cnt counts those on conn_lru_list, which holds
+	 * the connected ones that aren't closing */
+	size_t			max_conn;
+	size_t			conn_cnt;
+	struct dlist_entry	conn_lru_list;
+	struct dlist_entry	conn_close_list;
 
 	struct rxm_buf_pool	*buf_pools;
 
 	struct dlist_entry	repost_ready_list;
 	struct dlist_entry	deferred_tx_conn_queue;
+	struct dlist_entry	coalesce_conn_list;
+	struct dlist_entry	warmup_list;
 
 	struct rxm_recv_queue	recv_queue;
 	struct rxm_recv_queue	trecv_queue;
 };
 
+enum {
+	RXM_ADAPT_SAR,
+	RXM_ADAPT_RNDV,
+	RXM_ADAPT_PROTOS,
+};
+
+/*
+ * Times taken by SAR and rendezvous messages within a size class until
+ * the peer has them, in usec per MiB, as 1/8 weighted moving averages.
+ * Class n holds sizes above the eager limit and up to the eager limit
+ * rounded up to a power of two times 2^n.
+ */
+struct rxm_adapt_class {
+	uint64_t cost[RXM_ADAPT_PROTOS];
+	uint32_t samples[RXM_ADAPT_PROTOS];
+};
+
+static inline size_t rxm_adapt_class(size_t len)
+{
+	return MIN((size_t) (ofi_msb(len - 1) - ofi_msb(rxm_eager_limit)),
+		   RXM_ADAPT_CLASSES - 1);
+}
+
+/* Sample counts stop at RXM_ADAPT_MIN_SAMPLES, so this stays true */
+static inline int rxm_adapt_converged(struct rxm_adapt_class *class)
+{
+	return class->samples[RXM_ADAPT_SAR] >= RXM_ADAPT_MIN_SAMPLES &&
+	       class->samples[RXM_ADAPT_RNDV] >= RXM_ADAPT_MIN_SAMPLES;
+}
+
+/*
+ * Idle connections are closed by agreement with the peer: one side sends
+ * rxm_ctrl_close and the other replies with rxm_ctrl_close_resp.  As
+ * neither side sends anything more once it agreed, the side asking closes
+ * its MSG EP on an accepting reply, and the other on seeing it closed.
+ */
+enum rxm_conn_close_state {
+	RXM_CONN_OPEN,
+	/* Close requested, waiting for the peer's reply */
+	RXM_CONN_CLOSE_SENT,
+	/* Close accepted, waiting for the peer to close */
+	RXM_CONN_CLOSE_WAIT,
+	/* No more traffic, the MSG EP can be closed */
+	RXM_CONN_CLOSE_READY,
+};
+
 struct rxm_conn {
 	/* This should stay at the top */
 	struct rxm_cmap_handle handle;
@@ -694,10 +871,41 @@ struct rxm_conn {
 	struct dlist_entry sar_rx_msg_list;
 	struct dlist_entry sar_deferred_rx_msg_list;
 
+	/* Eager messages waiting to be sent as one coalesced packet */
+	struct rxm_tx_eager_buf *coalesce_buf;
+	uint64_t coalesce_start;
+	struct dlist_entry coalesce_entry;
+
+	/* Messages up to this size are sent via SAR, adapted from the send
+	 * costs of both protocols when FI_OFI_RXM_SAR_ADAPT is set */
+	size_t sar_limit;
+	uint32_t adapt_sends;
+	struct rxm_adapt_class adapt[RXM_ADAPT_CLASSES];
+
 	/* This is saved MSG EP fid, that hasn't been closed during
 	 * handling of CONN_RECV in RXM_CMAP_CONNREQ_SENT for passive side */
 	struct fid_ep *saved_msg_ep;
 	uint32_t rndv_tx_credits;
+
+	/* Rendezvous, atomic and RMA requests waiting on the peer */
+	uint32_t peer_wait;
+	/* Eager, coalesced and SAR segment sends posted to msg_ep whose
+	 * completions haven't been read */
+	uint32_t tx_cnt;
+	/* Atomic requests from the peer on the EP's atomic_req_queue */
+	uint32_t atomic_req_cnt;
+	/* Receive buffers and slabs posted to msg_ep */
+	struct dlist_entry posted_rx_list;
+	struct dlist_entry rx_slab_list;
+
+	struct dlist_entry lru_entry;
+	struct dlist_entry close_entry;
+	enum rxm_conn_close_state close_state;
+	/* Set while the reply to the peer's close request is unsent */
+	int close_reply;
+	/* Connection request from the peer received while closing */
+	struct fi_info *close_connreq;
+	union rxm_cm_data close_cm_data;
 };
 
 extern struct fi_provider rxm_prov;
@@ -729,9 +937,13 @@ int rxm_conn_cmap_alloc(struct rxm_ep *rxm_ep);
 void rxm_cq_write_error(struct util_cq *cq, struct util_cntr *cntr,
 			void *op_context, int err);
 void rxm_ep_progress(struct util_ep *util_ep);
+void rxm_ep_progress_coll(struct util_ep *util_ep);
 void rxm_ep_do_progress(struct util_ep *util_ep);
+void rxm_ep_drain_msg_cq(struct rxm_ep *rxm_ep);
 
 int rxm_msg_ep_prepost_recv(struct rxm_ep *rxm_ep, struct fid_ep *msg_ep);
+void rxm_rx_slab_put(struct rxm_rx_slab *rx_slab);
+void rxm_rx_slab_discard(struct rxm_rx_slab *rx_slab);
 
 int rxm_ep_query_atomic(struct fid_domain *domain, enum fi_datatype datatype,
 			enum fi_op op, struct fi_atomic_attr *attr,
@@ -801,6 +1013,45 @@ rxm_ep_dequeue_deferred_tx_queue(struct rxm_deferred_tx_entry *tx_entry)
 }
 
 int rxm_conn_process_eq_events(struct rxm_ep *rxm_ep);
+int rxm_conn_warmup(struct rxm_ep *rxm_ep, struct fi_connect_peers *peers);
+void rxm_conn_warmup_progress(struct rxm_ep *rxm_ep);
+void rxm_conn_warmup_cleanup(struct rxm_ep *rxm_ep);
+void rxm_conn_adapt_sample(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
+			   int proto, size_t len, uint64_t start);
+void rxm_conn_process_close(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn);
+void rxm_conn_process_close_resp(struct rxm_ep *rxm_ep,
+				 struct rxm_conn *rxm_conn, uint64_t status);
+void rxm_conn_reap(struct rxm_ep *rxm_ep);
+
+static inline void rxm_conn_touch(struct rxm_ep *rxm_ep,
+				  struct rxm_conn *rxm_conn)
+{
+	if (rxm_conn && !dlist_empty(&rxm_conn->lru_entry)) {
+		dlist_remove(&rxm_conn->lru_entry);
+		dlist_insert_tail(&rxm_conn->lru_entry,
+				  &rxm_ep->conn_lru_list);
+	}
+}
+
+ssize_t rxm_ep_send_coalesced(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn);
+int rxm_finish_coalesced_send(struct rxm_ep *rxm_ep,
+			      struct rxm_tx_eager_buf *tx_buf, int err);
+int rxm_ep_progress_coalesced(struct rxm_ep *rxm_ep, int force);
+
+/* Messages that aren't coalesced must not overtake the ones that are */
+static inline ssize_t
+rxm_ep_flush_coalesced(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn)
+{
+	ssize_t ret;
+
+	if (OFI_LIKELY(!rxm_conn->coalesce_buf))
+		return 0;
+
+	ret = rxm_ep_send_coalesced(rxm_ep, rxm_conn);
+	if (ret == -FI_EAGAIN)
+		rxm_ep_do_progress(&rxm_ep->util_ep);
+	return ret;
+}
 
 static inline void rxm_ep_msg_mr_closev(struct fid_mr **mr, size_t count)
 {
@@ -916,18 +1167,18 @@ rxm_process_recv_entry(struct rxm_recv_queue *recv_queue,
 					  recv_entry->tag, recv_entry->ignore);
 	if (rx_buf) {
 		assert((recv_queue->type == RXM_RECV_QUEUE_MSG &&
-			rx_buf->pkt.hdr.op == ofi_op_msg) ||
+			rx_buf->pkt->hdr.op == ofi_op_msg) ||
 		       (recv_queue->type == RXM_RECV_QUEUE_TAGGED &&
-			rx_buf->pkt.hdr.op == ofi_op_tagged));
+			rx_buf->pkt->hdr.op == ofi_op_tagged));
 		dlist_remove(&rx_buf->unexp_msg.entry);
 		rx_buf->recv_entry = recv_entry;
 
-		if (rx_buf->pkt.ctrl_hdr.type != rxm_ctrl_seg) {
+		if (rx_buf->pkt->ctrl_hdr.type != rxm_ctrl_seg) {
 			return rxm_cq_handle_rx_buf(rx_buf);
 		} else {
 			struct dlist_entry *entry;
 			enum rxm_sar_seg_type last =
-				(rxm_sar_get_seg_type(&rx_buf->pkt.ctrl_hdr)
+				(rxm_sar_get_seg_type(&rx_buf->pkt->ctrl_hdr)
 								== RXM_SAR_SEG_LAST);
 			ssize_t ret = rxm_cq_handle_rx_buf(rx_buf);
 			struct rxm_recv_match_attr match_attr;
@@ -946,19 +1197,19 @@ rxm_process_recv_entry(struct rxm_recv_queue *recv_queue,
 							     &match_attr))
 					continue;
 				/* Handle unordered completions from MSG provider */
-				if ((rx_buf->pkt.ctrl_hdr.msg_id != recv_entry->sar.msg_id) ||
-				    ((rx_buf->pkt.ctrl_hdr.type != rxm_ctrl_seg)))
+				if ((rx_buf->pkt->ctrl_hdr.msg_id != recv_entry->sar.msg_id) ||
+				    ((rx_buf->pkt->ctrl_hdr.type != rxm_ctrl_seg)))
 					continue;
 
 				if (!rx_buf->conn) {
 					rx_buf->conn = rxm_key2conn(rx_buf->ep,
-								    rx_buf->pkt.ctrl_hdr.conn_id);
+								    rx_buf->pkt->ctrl_hdr.conn_id);
 				}
 				if (recv_entry->sar.conn != rx_buf->conn)
 					continue;
 				rx_buf->recv_entry = recv_entry;
 				dlist_remove(&rx_buf->unexp_msg.entry);
-				last = (rxm_sar_get_seg_type(&rx_buf->pkt.ctrl_hdr)
+				last = (rxm_sar_get_seg_type(&rx_buf->pkt->ctrl_hdr)
 								== RXM_SAR_SEG_LAST);
 				ret = rxm_cq_handle_rx_buf(rx_buf);
 				if (ret || last)
@@ -992,6 +1243,9 @@ rxm_ep_prepare_tx(struct rxm_ep *rxm_ep, fi_addr_t dest_addr,
 			return ret;
 	}
 
+	if (OFI_UNLIKELY(rxm_ep->max_conn))
+		rxm_conn_touch(rxm_ep, *rxm_conn);
+
 	if (OFI_UNLIKELY(!dlist_empty(&(*rxm_conn)->deferred_tx_queue))) {
 		rxm_ep_do_progress(&rxm_ep->util_ep);
 		if (!dlist_empty(&(*rxm_conn)->deferred_tx_queue))
@@ -1051,9 +1305,40 @@ rxm_rx_buf_finish(struct rxm_rx_buf *rx_buf)
 	if (rx_buf->repost) {
 		dlist_insert_tail(&rx_buf->repost_entry,
 				  &rx_buf->ep->repost_ready_list);
-	} else {
-		ofi_buf_free(rx_buf);
+		return;
+	}
+
+	if (rx_buf->slab) {
+		rxm_rx_slab_put(rx_buf->slab);
+		rx_buf->slab = NULL;
+		rx_buf->pkt = &rx_buf->pkt_data;
 	}
+	ofi_buf_free(rx_buf);
+}
+
+static inline struct rxm_coalesce_comp *
+rxm_coalesce_comp(struct rxm_tx_eager_buf *tx_buf, size_t index)
+{
+	assert(!((uintptr_t) tx_buf->pkt.data & 7));
+	return (struct rxm_coalesce_comp *)
+	       (tx_buf->pkt.data + (rxm_eager_limit & ~(size_t) 7)) -
+	       (index + 1);
+}
+
+static inline int
+rxm_coalesce_fits(struct rxm_tx_eager_buf *tx_buf, size_t msg_size)
+{
+	return tx_buf->pkt.hdr.size + msg_size +
+	       (tx_buf->comp_cnt + 1) * sizeof(struct rxm_coalesce_comp) <=
+	       (rxm_eager_limit & ~(size_t) 7);
+}
+
+/* Coalesced packets borrow buffers from the eager TX pool */
+static inline void rxm_coalesced_buf_free(struct rxm_tx_eager_buf *tx_buf)
+{
+	tx_buf->hdr.state = RXM_TX;
+	tx_buf->pkt.ctrl_hdr.type = rxm_ctrl_eager;
+	ofi_buf_free(tx_buf);
 }
 
 static inline struct rxm_rma_buf *rxm_rma_buf_alloc(struct rxm_ep *rxm_ep)
@@ -1088,13 +1373,13 @@ static inline int rxm_cq_write_recv_comp(struct rxm_rx_buf *rx_buf,
 {
 	if (rx_buf->ep->rxm_info->caps & FI_SOURCE)
 		return ofi_cq_write_src(rx_buf->ep->util_ep.rx_cq, context,
-					flags, len, buf, rx_buf->pkt.hdr.data,
-					rx_buf->pkt.hdr.tag,
+					flags, len, buf, rx_buf->pkt->hdr.data,
+					rx_buf->pkt->hdr.tag,
 					rx_buf->conn->handle.fi_addr);
 	else
 		return ofi_cq_write(rx_buf->ep->util_ep.rx_cq, context,
-				    flags, len, buf, rx_buf->pkt.hdr.data,
-				    rx_buf->pkt.hdr.tag);
+				    flags, len, buf, rx_buf->pkt->hdr.data,
+				    rx_buf->pkt->hdr.tag);
 }
 
 static inline int
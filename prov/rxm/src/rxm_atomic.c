@@ -111,6 +111,10 @@ rxm_ep_atomic_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		return -FI_EINVAL;
 	}
 
+	ret = rxm_ep_flush_coalesced(rxm_ep, rxm_conn);
+	if (OFI_UNLIKELY(ret))
+		return ret;
+
 	if (msg->op != FI_ATOMIC_READ) {
 		assert(msg->msg_iov);
 		ofi_ioc_to_iov(msg->msg_iov, buf_iov, msg->iov_count,
@@ -168,9 +172,12 @@ rxm_ep_atomic_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		ofi_ioc_to_iov(resultv, tx_buf->result_iov, result_iov_count,
 			       datatype_sz);
 
+	tx_buf->conn = rxm_conn;
 	ret = rxm_ep_send_atomic_req(rxm_ep, rxm_conn, tx_buf, tot_len);
-	if (OFI_LIKELY(!ret))
+	if (OFI_LIKELY(!ret)) {
+		rxm_conn->peer_wait++;
 		return ret;
+	}
 
 	ofi_buf_free(tx_buf);
 restore_credit:
@@ -492,6 +499,9 @@ int rxm_ep_query_atomic(struct fid_domain *domain, enum fi_datatype datatype,
 	size_t tot_size;
 	int ret;
 
+	if (flags & FI_COLLECTIVE)
+		return ofi_query_collective(domain, datatype, op, attr, flags);
+
 	if (flags & FI_TAGGED) {
 		FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
 			"tagged atomic op not supported\n");
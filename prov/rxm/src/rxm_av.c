@@ -190,6 +190,7 @@ static struct fi_ops_av rxm_av_ops = {
 	.remove = rxm_av_remove,
 	.lookup = rxm_av_lookup,
 	.straddr = rxm_av_straddr,
+	.av_set = ofi_av_set,
 };
 
 int rxm_av_open(struct fid_domain *domain_fid, struct fi_av_attr *attr,
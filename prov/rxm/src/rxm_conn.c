@@ -55,6 +55,8 @@ static void *rxm_conn_progress(void *arg);
 static void *rxm_conn_atomic_progress(void *arg);
 static int
 rxm_conn_handle_event(struct rxm_ep *rxm_ep, struct rxm_msg_eq_entry *entry);
+static void rxm_conn_warmup_fail(struct rxm_ep *rxm_ep, fi_addr_t fi_addr,
+				 int err);
 
 
 /*
@@ -87,6 +89,15 @@ static inline ssize_t rxm_eq_readerr(struct rxm_ep *rxm_ep,
 
 	OFI_EQ_STRERROR(&rxm_prov, FI_LOG_WARN, FI_LOG_EP_CTRL,
 			rxm_ep->msg_eq, &entry->err_entry);
+
+	/* Any other error on a MSG EP is a connection that couldn't be set
+	 * up, which is handled the same as one refused without cm_data */
+	if (entry->err_entry.fid &&
+	    entry->err_entry.fid->fclass == FI_CLASS_EP) {
+		entry->context = entry->err_entry.fid->context;
+		entry->err_entry.err_data_size = 0;
+		return -FI_ECONNREFUSED;
+	}
 	return -entry->err_entry.err;
 }
 
@@ -229,7 +240,8 @@ rxm_conn_inject_pkt_alloc(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 
 	return inject_pkt;
 }
-static void rxm_conn_res_free(struct rxm_conn *rxm_conn)
+
+static void rxm_conn_inject_pkts_free(struct rxm_conn *rxm_conn)
 {
 	ofi_freealign(rxm_conn->inject_pkt);
 	rxm_conn->inject_pkt = NULL;
@@ -240,36 +252,141 @@ static void rxm_conn_res_free(struct rxm_conn *rxm_conn)
 	ofi_freealign(rxm_conn->tinject_data_pkt);
 	rxm_conn->tinject_data_pkt = NULL;
 }
+
+static int rxm_conn_inject_pkts_alloc(struct rxm_ep *rxm_ep,
+				      struct rxm_conn *rxm_conn)
+{
+	rxm_conn->inject_pkt =
+		rxm_conn_inject_pkt_alloc(rxm_ep, rxm_conn, ofi_op_msg, 0);
+	rxm_conn->inject_data_pkt =
+		rxm_conn_inject_pkt_alloc(rxm_ep, rxm_conn,
+					  ofi_op_msg, FI_REMOTE_CQ_DATA);
+	rxm_conn->tinject_pkt =
+		rxm_conn_inject_pkt_alloc(rxm_ep, rxm_conn, ofi_op_tagged, 0);
+	rxm_conn->tinject_data_pkt =
+		rxm_conn_inject_pkt_alloc(rxm_ep, rxm_conn,
+					  ofi_op_tagged, FI_REMOTE_CQ_DATA);
+
+	if (!rxm_conn->inject_pkt || !rxm_conn->inject_data_pkt ||
+	    !rxm_conn->tinject_pkt || !rxm_conn->tinject_data_pkt) {
+		rxm_conn_inject_pkts_free(rxm_conn);
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "unable to allocate "
+			"inject pkt for connection\n");
+		return -FI_ENOMEM;
+	}
+	return 0;
+}
+
+static void rxm_conn_res_free(struct rxm_conn *rxm_conn)
+{
+	/* Messages still waiting to be coalesced never reach the peer */
+	if (rxm_conn->coalesce_buf) {
+		dlist_remove(&rxm_conn->coalesce_entry);
+		if (rxm_conn->handle.cmap)
+			rxm_finish_coalesced_send(
+				container_of(rxm_conn->handle.cmap->ep,
+					     struct rxm_ep, util_ep),
+				rxm_conn->coalesce_buf, -FI_ECANCELED);
+		else
+			rxm_coalesced_buf_free(rxm_conn->coalesce_buf);
+		rxm_conn->coalesce_buf = NULL;
+	}
+	rxm_conn_inject_pkts_free(rxm_conn);
+}
+
 static int rxm_conn_res_alloc(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn)
 {
 	dlist_init(&rxm_conn->deferred_conn_entry);
 	dlist_init(&rxm_conn->deferred_tx_queue);
 	dlist_init(&rxm_conn->sar_rx_msg_list);
 	dlist_init(&rxm_conn->sar_deferred_rx_msg_list);
+	dlist_init(&rxm_conn->posted_rx_list);
+	dlist_init(&rxm_conn->rx_slab_list);
+	dlist_init(&rxm_conn->lru_entry);
+	dlist_init(&rxm_conn->close_entry);
+	rxm_conn->sar_limit = rxm_ep->sar_limit;
+
+	if (rxm_ep->util_ep.domain->threading != FI_THREAD_SAFE)
+		return rxm_conn_inject_pkts_alloc(rxm_ep, rxm_conn);
+	return 0;
+}
+
+static void rxm_conn_lru_add(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn)
+{
+	if (!rxm_ep->max_conn)
+		return;
+
+	assert(dlist_empty(&rxm_conn->lru_entry));
+	dlist_insert_tail(&rxm_conn->lru_entry, &rxm_ep->conn_lru_list);
+	rxm_ep->conn_cnt++;
+}
+
+static void rxm_conn_lru_del(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn)
+{
+	if (dlist_empty(&rxm_conn->lru_entry))
+		return;
+
+	dlist_remove_init(&rxm_conn->lru_entry);
+	rxm_ep->conn_cnt--;
+}
 
-	if (rxm_ep->util_ep.domain->threading != FI_THREAD_SAFE) {
-		rxm_conn->inject_pkt =
-			rxm_conn_inject_pkt_alloc(rxm_ep, rxm_conn,
-						  ofi_op_msg, 0);
-		rxm_conn->inject_data_pkt =
-			rxm_conn_inject_pkt_alloc(rxm_ep, rxm_conn,
-						  ofi_op_msg, FI_REMOTE_CQ_DATA);
-		rxm_conn->tinject_pkt =
-			rxm_conn_inject_pkt_alloc(rxm_ep, rxm_conn,
-						  ofi_op_tagged, 0);
-		rxm_conn->tinject_data_pkt =
-			rxm_conn_inject_pkt_alloc(rxm_ep, rxm_conn,
-						  ofi_op_tagged, FI_REMOTE_CQ_DATA);
-
-		if (!rxm_conn->inject_pkt || !rxm_conn->inject_data_pkt ||
-		    !rxm_conn->tinject_pkt || !rxm_conn->tinject_data_pkt) {
-			rxm_conn_res_free(rxm_conn);
-			FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "unable to allocate "
-				"inject pkt for connection\n");
-			return -FI_ENOMEM;
+/*
+ * The SAR limit is raised to the top of every size class, starting from
+ * the smallest, in which SAR sends have reached the peer at least as fast
+ * as rendezvous sends.  Classes without enough samples of both keep the
+ * protocol they are using.
+ */
+static size_t rxm_conn_adapt_limit(struct rxm_ep *rxm_ep,
+				   struct rxm_conn *rxm_conn)
+{
+	struct rxm_adapt_class *class;
+	size_t i, limit = rxm_eager_limit, top;
+
+	for (i = 0; i < RXM_ADAPT_CLASSES; i++) {
+		class = &rxm_conn->adapt[i];
+		top = (i == RXM_ADAPT_CLASSES - 1) ? SIZE_MAX :
+		      (size_t) 1 << (ofi_msb(rxm_eager_limit) + 1 + i);
+
+		if (rxm_adapt_converged(class)) {
+			if (class->cost[RXM_ADAPT_SAR] >
+			    class->cost[RXM_ADAPT_RNDV])
+				break;
+		} else if (top > rxm_conn->sar_limit) {
+			limit = MAX(limit, rxm_conn->sar_limit);
+			break;
 		}
+		limit = top;
+	}
+	return MIN(limit, rxm_ep->sar_limit);
+}
+
+void rxm_conn_adapt_sample(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
+			   int proto, size_t len, uint64_t start)
+{
+	struct rxm_adapt_class *class;
+	uint64_t cost;
+	size_t limit;
+
+	if (len <= rxm_eager_limit || len > rxm_ep->sar_limit)
+		return;
+
+	class = &rxm_conn->adapt[rxm_adapt_class(len)];
+	cost = ((fi_gettime_us() - start) << 20) / len;
+	if (class->samples[proto]) {
+		class->cost[proto] = (7 * class->cost[proto] + cost) / 8;
+	} else {
+		class->cost[proto] = cost;
+	}
+	if (class->samples[proto] < RXM_ADAPT_MIN_SAMPLES)
+		class->samples[proto]++;
+
+	limit = rxm_conn_adapt_limit(rxm_ep, rxm_conn);
+	if (limit != rxm_conn->sar_limit) {
+		FI_DBG(&rxm_prov, FI_LOG_EP_DATA, "SAR limit for connection "
+		       "%p moved from %zu to %zu\n", (void *) rxm_conn,
+		       rxm_conn->sar_limit, limit);
+		rxm_conn->sar_limit = limit;
 	}
-	return 0;
 }
 
 static void rxm_conn_free(struct rxm_cmap_handle *handle)
@@ -277,6 +394,20 @@ static void rxm_conn_free(struct rxm_cmap_handle *handle)
 	struct rxm_conn *rxm_conn =
 		container_of(handle, struct rxm_conn, handle);
 
+	if (handle->cmap) {
+		rxm_conn_lru_del(container_of(handle->cmap->ep, struct rxm_ep,
+					      util_ep), rxm_conn);
+	}
+	dlist_remove(&rxm_conn->close_entry);
+	if (rxm_conn->close_connreq)
+		fi_freeinfo(rxm_conn->close_connreq);
+
+	/* Buffers still posted go back to their pools with the endpoint */
+	while (!dlist_empty(&rxm_conn->posted_rx_list))
+		dlist_remove_init(rxm_conn->posted_rx_list.next);
+	while (!dlist_empty(&rxm_conn->rx_slab_list))
+		dlist_remove_init(rxm_conn->rx_slab_list.next);
+
 	/* This handles case when saved_msg_ep wasn't closed */
 	if (rxm_conn->saved_msg_ep) {
 		if (fi_close(&rxm_conn->saved_msg_ep->fid)) {
@@ -478,6 +609,8 @@ void rxm_cmap_process_connect(struct rxm_cmap *cmap,
 		assert(handle->state == RXM_CMAP_CONNREQ_RECV);
 	}
 	RXM_CM_UPDATE_STATE(handle, RXM_CMAP_CONNECTED_NOTIFY);
+	rxm_conn_lru_add(container_of(cmap->ep, struct rxm_ep, util_ep),
+			 rxm_conn);
 
 	/* Set the remote key to the inject packets */
 	if (cmap->ep->domain->threading != FI_THREAD_SAFE) {
@@ -600,6 +733,12 @@ int rxm_cmap_process_connreq(struct rxm_cmap *cmap, void *addr,
 	case RXM_CMAP_CONNREQ_RECV:
 		*handle_ret = handle;
 		break;
+	case RXM_CMAP_CLOSING:
+		FI_DBG(cmap->av->prov, FI_LOG_EP_CTRL,
+		       "Connection is closing, deferring request\n");
+		*handle_ret = handle;
+		ret = -FI_EINPROGRESS;
+		break;
 	case RXM_CMAP_SHUTDOWN:
 		FI_WARN(cmap->av->prov, FI_LOG_EP_CTRL, "handle :%p marked for "
 			"deletion / shutdown, reject connection\n", handle);
@@ -665,6 +804,7 @@ int rxm_cmap_connect(struct rxm_ep *rxm_ep, fi_addr_t fi_addr,
 		break;
 	case RXM_CMAP_CONNREQ_SENT:
 	case RXM_CMAP_CONNREQ_RECV:
+	case RXM_CMAP_CLOSING:
 	case RXM_CMAP_SHUTDOWN:
 		ret = -FI_EAGAIN;
 		break;
@@ -818,6 +958,14 @@ static int rxm_msg_ep_open(struct rxm_ep *rxm_ep, struct fi_info *msg_info,
 	struct fid_ep *msg_ep;
 	int ret;
 
+	/* Inject packets are released with the MSG EP of an idle connection */
+	if (rxm_ep->util_ep.domain->threading != FI_THREAD_SAFE &&
+	    !rxm_conn->inject_pkt) {
+		ret = rxm_conn_inject_pkts_alloc(rxm_ep, rxm_conn);
+		if (ret)
+			return ret;
+	}
+
 	rxm_domain = container_of(rxm_ep->util_ep.domain, struct rxm_domain,
 			util_domain);
 	ret = fi_endpoint(rxm_domain->msg_domain, msg_info, &msg_ep, context);
@@ -980,9 +1128,9 @@ static int rxm_conn_reprocess_directed_recvs(struct rxm_recv_queue *recv_queue)
 		if (ret) {
 			err_entry.op_context = rx_buf;
 			err_entry.flags = rx_buf->recv_entry->comp_flags;
-			err_entry.len = rx_buf->pkt.hdr.size;
-			err_entry.data = rx_buf->pkt.hdr.data;
-			err_entry.tag = rx_buf->pkt.hdr.tag;
+			err_entry.len = rx_buf->pkt->hdr.size;
+			err_entry.data = rx_buf->pkt->hdr.data;
+			err_entry.tag = rx_buf->pkt->hdr.tag;
 			err_entry.err = ret;
 			err_entry.prov_errno = ret;
 			ofi_cq_write_error(recv_queue->rxm_ep->util_ep.rx_cq,
@@ -1090,6 +1238,36 @@ static size_t rxm_conn_get_rx_size(struct rxm_ep *rxm_ep,
 		return msg_info->rx_attr->size;
 }
 
+static void rxm_conn_close_ready(struct rxm_ep *rxm_ep,
+				 struct rxm_conn *rxm_conn)
+{
+	rxm_conn->close_state = RXM_CONN_CLOSE_READY;
+	if (dlist_empty(&rxm_conn->close_entry))
+		dlist_insert_tail(&rxm_conn->close_entry,
+				  &rxm_ep->conn_close_list);
+}
+
+/*
+ * The peer only connects again once it has closed its end, so a request
+ * arriving while the connection closes is kept until it is closed here too.
+ */
+static int rxm_conn_defer_connreq(struct rxm_ep *rxm_ep,
+				  struct rxm_conn *rxm_conn,
+				  struct fi_info *msg_info,
+				  union rxm_cm_data *remote_cm_data)
+{
+	if (rxm_conn->close_connreq)
+		return -FI_EALREADY;
+
+	rxm_conn->close_connreq = fi_dupinfo(msg_info);
+	if (!rxm_conn->close_connreq)
+		return -FI_ENOMEM;
+
+	rxm_conn->close_cm_data = *remote_cm_data;
+	rxm_conn_close_ready(rxm_ep, rxm_conn);
+	return 0;
+}
+
 static int
 rxm_msg_process_connreq(struct rxm_ep *rxm_ep, struct fi_info *msg_info,
 			union rxm_cm_data *remote_cm_data)
@@ -1130,6 +1308,13 @@ rxm_msg_process_connreq(struct rxm_ep *rxm_ep, struct fi_info *msg_info,
 
 	ret = rxm_cmap_process_connreq(rxm_ep->cmap, &remote_pep_addr,
 				       &handle, &reject_cm_data.reject.reason);
+	if (ret == -FI_EINPROGRESS) {
+		ret = rxm_conn_defer_connreq(rxm_ep, container_of(handle,
+					     struct rxm_conn, handle),
+					     msg_info, remote_cm_data);
+		if (!ret)
+			return 0;
+	}
 	if (ret)
 		goto err1;
 
@@ -1198,6 +1383,20 @@ static int rxm_conn_handle_notify(struct fi_eq_entry *eq_entry)
 	}
 }
 
+/* The peer closing a connection that is closing means it can be closed */
+static void rxm_conn_process_shutdown(struct rxm_ep *rxm_ep, struct fid *fid)
+{
+	struct rxm_conn *rxm_conn =
+		container_of(fid->context, struct rxm_conn, handle);
+
+	if (rxm_conn->handle.state != RXM_CMAP_CLOSING ||
+	    !rxm_conn->msg_ep || &rxm_conn->msg_ep->fid != fid)
+		return;
+
+	rxm_conn->close_reply = 0;
+	rxm_conn_close_ready(rxm_ep, rxm_conn);
+}
+
 static void rxm_conn_wake_up_wait_obj(struct rxm_ep *rxm_ep)
 {
 	if (rxm_ep->util_ep.tx_cq && rxm_ep->util_ep.tx_cq->wait)
@@ -1211,8 +1410,16 @@ rxm_conn_handle_event(struct rxm_ep *rxm_ep, struct rxm_msg_eq_entry *entry)
 {
 	union rxm_cm_data *cm_data = entry->err_entry.err_data;
 	enum rxm_cmap_reject_reason reject_reason;
+	struct rxm_cmap_handle *handle;
+	enum rxm_cmap_state state;
+	fi_addr_t fi_addr;
 
 	if (entry->rd == -FI_ECONNREFUSED) {
+		/* Taken now, as a rejected handle is deleted */
+		handle = entry->context;
+		fi_addr = handle->fi_addr;
+		state = handle->state;
+
 		if (OFI_UNLIKELY(entry->err_entry.err_data_size !=
 				 sizeof(cm_data->reject))) {
 			FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "connection reject: "
@@ -1220,7 +1427,7 @@ rxm_conn_handle_event(struct rxm_ep *rxm_ep, struct rxm_msg_eq_entry *entry)
 				"(data length expected: %zu found: %zu)\n",
 				sizeof(cm_data->reject),
 				entry->err_entry.err_data_size);
-			goto err;
+			goto refused;
 		}
 
 		assert(cm_data);
@@ -1230,7 +1437,7 @@ rxm_conn_handle_event(struct rxm_ep *rxm_ep, struct rxm_msg_eq_entry *entry)
 				", remote:  %" PRIu8 ")\n",
 				(uint8_t) RXM_CM_DATA_VERSION,
 				cm_data->reject.version);
-			goto err;
+			goto refused;
 		}
 		reject_reason = cm_data->reject.reason;
 
@@ -1249,8 +1456,14 @@ rxm_conn_handle_event(struct rxm_ep *rxm_ep, struct rxm_msg_eq_entry *entry)
 			        "received unknown reject reason: %d\n",
 				reject_reason);
 		}
-		rxm_cmap_process_reject(rxm_ep->cmap, entry->context,
-					reject_reason);
+		rxm_cmap_process_reject(rxm_ep->cmap, handle, reject_reason);
+
+		/* Otherwise the connection goes on with the peer's request */
+		if (state == RXM_CMAP_CONNREQ_SENT &&
+		    reject_reason != RXM_CMAP_REJECT_SIMULT_CONN)
+			rxm_conn_warmup_fail(rxm_ep, fi_addr, -FI_ECONNREFUSED);
+		else if (!dlist_empty(&rxm_ep->warmup_list))
+			rxm_conn_warmup_progress(rxm_ep);
 		return 0;
 	}
 
@@ -1290,17 +1503,438 @@ rxm_conn_handle_event(struct rxm_ep *rxm_ep, struct rxm_msg_eq_entry *entry)
 		       "Received connection shutdown\n");
 		rxm_cmap_process_shutdown(rxm_ep->cmap,
 					  entry->cm_entry.fid->context);
+		rxm_conn_process_shutdown(rxm_ep, entry->cm_entry.fid);
 		break;
 	default:
 		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
 			"Unknown event: %u\n", entry->event);
 		goto err;
 	}
+	if (!dlist_empty(&rxm_ep->warmup_list))
+		rxm_conn_warmup_progress(rxm_ep);
 	return 0;
+refused:
+	rxm_conn_warmup_fail(rxm_ep, fi_addr, -entry->err_entry.err);
 err:
 	return -FI_EOTHER;
 }
 
+/*
+ * Returns 1 if the connection to fi_addr is up, 0 while it's being set up
+ * and a negative error code if it failed.  Connections that aren't being
+ * set up are initiated, without progressing the MSG EQ, as this is called
+ * from the EQ event handler.
+ */
+static int rxm_conn_warmup_start(struct rxm_ep *rxm_ep, fi_addr_t fi_addr)
+{
+	struct rxm_cmap *cmap = rxm_ep->cmap;
+	struct rxm_cmap_handle *handle;
+	int ret;
+
+	if (fi_addr >= cmap->num_allocated)
+		return -FI_EHOSTUNREACH;
+
+	handle = rxm_cmap_acquire_handle(cmap, fi_addr);
+	if (!handle)
+		return -FI_ECONNREFUSED;
+
+	switch (handle->state) {
+	case RXM_CMAP_CONNECTED_NOTIFY:
+	case RXM_CMAP_CONNECTED:
+		return 1;
+	case RXM_CMAP_IDLE:
+		FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "initiating MSG_EP connect "
+		       "for fi_addr: %" PRIu64 "\n", fi_addr);
+		ret = rxm_conn_connect(cmap->ep, handle,
+				       ofi_av_get_addr(cmap->av, fi_addr));
+		if (ret) {
+			rxm_cmap_del_handle(handle);
+			return ret;
+		}
+		RXM_CM_UPDATE_STATE(handle, RXM_CMAP_CONNREQ_SENT);
+		return 0;
+	case RXM_CMAP_CONNREQ_SENT:
+	case RXM_CMAP_CONNREQ_RECV:
+	case RXM_CMAP_CLOSING:
+		return 0;
+	default:
+		return -FI_ECONNREFUSED;
+	}
+}
+
+static void rxm_conn_warmup_complete(struct rxm_ep *rxm_ep,
+				     struct rxm_conn_warmup *warmup)
+{
+	struct fi_eq_err_entry entry = {
+		.fid = &rxm_ep->util_ep.ep_fid.fid,
+		.context = warmup->context,
+		.data = warmup->connected,
+		.err = warmup->err,
+	};
+	ssize_t size, ret;
+	uint64_t flags;
+
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "connected to %zu of %zu peers\n",
+	       warmup->connected, warmup->count);
+
+	if (warmup->err) {
+		size = sizeof(struct fi_eq_err_entry);
+		flags = UTIL_FLAG_ERROR;
+	} else {
+		size = sizeof(struct fi_eq_entry);
+		flags = 0;
+	}
+
+	ret = fi_eq_write(&rxm_ep->util_ep.eq->eq_fid, FI_CONNECT_COMPLETE,
+			  &entry, size, flags);
+	if (ret != size)
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "error writing to EQ\n");
+}
+
+static void rxm_conn_warmup_result(struct rxm_conn_warmup *warmup,
+				   fi_addr_t fi_addr, int ret)
+{
+	if (ret > 0) {
+		warmup->connected++;
+	} else {
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "unable to connect to "
+			"fi_addr: %" PRIu64 ": %s\n", fi_addr,
+			fi_strerror(-ret));
+		warmup->err = -ret;
+	}
+}
+
+/*
+ * The connection to fi_addr was refused or couldn't be set up.  It's
+ * reported as failed by the requests waiting on it, rather than being
+ * started over when the handle is found idle again.
+ */
+static void rxm_conn_warmup_fail(struct rxm_ep *rxm_ep, fi_addr_t fi_addr,
+				 int err)
+{
+	struct rxm_conn_warmup *warmup;
+	size_t i;
+
+	if (dlist_empty(&rxm_ep->warmup_list))
+		return;
+
+	dlist_foreach_container(&rxm_ep->warmup_list, struct rxm_conn_warmup,
+				warmup, entry) {
+		for (i = 0; i < warmup->pending_cnt; i++) {
+			if (warmup->pending[i] != fi_addr)
+				continue;
+			rxm_conn_warmup_result(warmup, fi_addr, err);
+			warmup->pending[i] =
+				warmup->pending[--warmup->pending_cnt];
+			break;
+		}
+	}
+	rxm_conn_warmup_progress(rxm_ep);
+}
+
+/*
+ * Called as the MSG EQ is progressed.  Finished connections are replaced
+ * by new ones up to the request's limit, and the request is completed
+ * once all of them have been set up or failed.
+ */
+void rxm_conn_warmup_progress(struct rxm_ep *rxm_ep)
+{
+	struct rxm_conn_warmup *warmup;
+	struct dlist_entry *tmp;
+	fi_addr_t fi_addr;
+	size_t i;
+	int ret;
+
+	dlist_foreach_container_safe(&rxm_ep->warmup_list,
+				     struct rxm_conn_warmup, warmup,
+				     entry, tmp) {
+		for (i = 0; i < warmup->pending_cnt; ) {
+			fi_addr = warmup->pending[i];
+			ret = rxm_conn_warmup_start(rxm_ep, fi_addr);
+			if (!ret) {
+				i++;
+				continue;
+			}
+			rxm_conn_warmup_result(warmup, fi_addr, ret);
+			warmup->pending[i] =
+				warmup->pending[--warmup->pending_cnt];
+		}
+
+		while (warmup->pending_cnt < warmup->max_pending &&
+		       warmup->next < warmup->count) {
+			fi_addr = warmup->addr[warmup->next++];
+			ret = rxm_conn_warmup_start(rxm_ep, fi_addr);
+			if (!ret)
+				warmup->pending[warmup->pending_cnt++] = fi_addr;
+			else
+				rxm_conn_warmup_result(warmup, fi_addr, ret);
+		}
+
+		if (!warmup->pending_cnt) {
+			dlist_remove(&warmup->entry);
+			rxm_conn_warmup_complete(rxm_ep, warmup);
+			free(warmup);
+		}
+	}
+}
+
+int rxm_conn_warmup(struct rxm_ep *rxm_ep, struct fi_connect_peers *peers)
+{
+	struct rxm_conn_warmup *warmup;
+	size_t max_pending;
+
+	if (!peers || (peers->count && !peers->addr))
+		return -FI_EINVAL;
+	if (!rxm_ep->util_ep.eq)
+		return -FI_ENOEQ;
+
+	max_pending = peers->max_pending ? peers->max_pending :
+		      RXM_WARMUP_MAX_PENDING;
+	max_pending = MIN(max_pending, MAX(peers->count, 1));
+
+	warmup = malloc(sizeof(*warmup) +
+			(peers->count + max_pending) * sizeof(fi_addr_t));
+	if (!warmup)
+		return -FI_ENOMEM;
+
+	warmup->context = peers->context;
+	warmup->count = peers->count;
+	warmup->next = 0;
+	warmup->connected = 0;
+	warmup->err = 0;
+	warmup->max_pending = max_pending;
+	warmup->pending_cnt = 0;
+	warmup->pending = &warmup->addr[peers->count];
+	if (peers->count)
+		memcpy(warmup->addr, peers->addr,
+		       peers->count * sizeof(fi_addr_t));
+
+	dlist_insert_tail(&warmup->entry, &rxm_ep->warmup_list);
+	rxm_conn_warmup_progress(rxm_ep);
+	return 0;
+}
+
+void rxm_conn_warmup_cleanup(struct rxm_ep *rxm_ep)
+{
+	struct rxm_conn_warmup *warmup;
+
+	while (!dlist_empty(&rxm_ep->warmup_list)) {
+		dlist_pop_front(&rxm_ep->warmup_list, struct rxm_conn_warmup,
+				warmup, entry);
+		free(warmup);
+	}
+}
+
+/*
+ * Idle connections
+ */
+
+static int rxm_conn_busy(struct rxm_conn *rxm_conn)
+{
+	return rxm_conn->peer_wait || rxm_conn->tx_cnt ||
+	       rxm_conn->atomic_req_cnt || rxm_conn->coalesce_buf ||
+	       rxm_conn->saved_msg_ep || rxm_conn->close_reply ||
+	       !dlist_empty(&rxm_conn->deferred_tx_queue) ||
+	       !dlist_empty(&rxm_conn->sar_rx_msg_list) ||
+	       !dlist_empty(&rxm_conn->sar_deferred_rx_msg_list);
+}
+
+static int rxm_conn_send_close(struct rxm_conn *rxm_conn, uint8_t type,
+			       uint64_t status)
+{
+	struct rxm_pkt pkt = {
+		.ctrl_hdr = {
+			.version = RXM_CTRL_VERSION,
+			.type = type,
+			.conn_id = rxm_conn->handle.remote_key,
+			.ctrl_data = status,
+		},
+		.hdr = {
+			.version = OFI_OP_VERSION,
+			.op = ofi_op_msg,
+		},
+	};
+	int ret;
+
+	ret = (int) fi_inject(rxm_conn->msg_ep, &pkt, sizeof(pkt), 0);
+	if (ret && ret != -FI_EAGAIN)
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
+			"unable to send close message: %d\n", ret);
+	return ret;
+}
+
+/* An accepted close is replied to with 0, a refused one with FI_EBUSY */
+static void rxm_conn_reply_close(struct rxm_ep *rxm_ep,
+				 struct rxm_conn *rxm_conn)
+{
+	uint64_t status;
+
+	status = (rxm_conn->close_state == RXM_CONN_CLOSE_WAIT) ? 0 : FI_EBUSY;
+	if (!rxm_conn_send_close(rxm_conn, rxm_ctrl_close_resp, status)) {
+		rxm_conn->close_reply = 0;
+		return;
+	}
+
+	rxm_conn->close_reply = 1;
+	if (dlist_empty(&rxm_conn->close_entry))
+		dlist_insert_tail(&rxm_conn->close_entry,
+				  &rxm_ep->conn_close_list);
+}
+
+void rxm_conn_process_close(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn)
+{
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "peer asked to close connection "
+	       "%p\n", (void *) rxm_conn);
+
+	/* Both sides asked at the same time, each takes the other's
+	 * request as its reply */
+	if (rxm_conn->close_state == RXM_CONN_CLOSE_SENT) {
+		rxm_conn_close_ready(rxm_ep, rxm_conn);
+		return;
+	}
+
+	if (rxm_conn->handle.state == RXM_CMAP_CONNECTED_NOTIFY)
+		rxm_cmap_process_conn_notify(rxm_ep->cmap, &rxm_conn->handle);
+
+	if (rxm_conn->handle.state == RXM_CMAP_CONNECTED &&
+	    rxm_conn->close_state == RXM_CONN_OPEN &&
+	    !rxm_conn_busy(rxm_conn)) {
+		RXM_CM_UPDATE_STATE(&rxm_conn->handle, RXM_CMAP_CLOSING);
+		rxm_conn->close_state = RXM_CONN_CLOSE_WAIT;
+		rxm_conn_lru_del(rxm_ep, rxm_conn);
+	}
+	rxm_conn_reply_close(rxm_ep, rxm_conn);
+}
+
+void rxm_conn_process_close_resp(struct rxm_ep *rxm_ep,
+				 struct rxm_conn *rxm_conn, uint64_t status)
+{
+	if (rxm_conn->close_state != RXM_CONN_CLOSE_SENT) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
+			"unexpected reply to close request\n");
+		return;
+	}
+
+	if (!status) {
+		rxm_conn_close_ready(rxm_ep, rxm_conn);
+		return;
+	}
+
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "peer refused to close connection "
+	       "%p\n", (void *) rxm_conn);
+	rxm_conn->close_state = RXM_CONN_OPEN;
+	RXM_CM_UPDATE_STATE(&rxm_conn->handle, RXM_CMAP_CONNECTED);
+	rxm_conn_lru_add(rxm_ep, rxm_conn);
+}
+
+/*
+ * Only the MSG EP and what is tied to it is released.  The connection
+ * stays in the cmap, with any state still referring to it, and connects
+ * again when it is next used.
+ *
+ * Completions the MSG EP wrote before it was closed are handled first;
+ * their buffers see the MSG EP gone and are discarded.  Buffers still
+ * posted after that were dropped by the MSG provider, which doesn't
+ * report closed receives, and are freed here, slabs once no received
+ * message points into them anymore.
+ */
+static void rxm_conn_reset(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn)
+{
+	struct rxm_rx_buf *rx_buf;
+	struct rxm_rx_slab *rx_slab;
+	struct fi_info *connreq;
+
+	FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "closing idle connection %p\n",
+	       (void *) rxm_conn);
+
+	if (fi_close(&rxm_conn->msg_ep->fid))
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL, "unable to close msg_ep\n");
+	rxm_conn->msg_ep = NULL;
+	rxm_ep_drain_msg_cq(rxm_ep);
+
+	while (!dlist_empty(&rxm_conn->posted_rx_list)) {
+		dlist_pop_front(&rxm_conn->posted_rx_list, struct rxm_rx_buf,
+				rx_buf, repost_entry);
+		ofi_buf_free(rx_buf);
+	}
+	while (!dlist_empty(&rxm_conn->rx_slab_list)) {
+		rx_slab = container_of(rxm_conn->rx_slab_list.next,
+				       struct rxm_rx_slab, entry);
+		rxm_rx_slab_discard(rx_slab);
+	}
+	rxm_conn_inject_pkts_free(rxm_conn);
+
+	rxm_conn->close_state = RXM_CONN_OPEN;
+	RXM_CM_UPDATE_STATE(&rxm_conn->handle, RXM_CMAP_IDLE);
+
+	connreq = rxm_conn->close_connreq;
+	if (connreq) {
+		rxm_conn->close_connreq = NULL;
+		rxm_msg_process_connreq(rxm_ep, connreq,
+					&rxm_conn->close_cm_data);
+		fi_freeinfo(connreq);
+	}
+}
+
+/*
+ * Finishes closing connections, and asks peers to close the least
+ * recently used idle connections while there are more than max_conn.
+ * Busy connections are passed over until they next come up.
+ */
+void rxm_conn_reap(struct rxm_ep *rxm_ep)
+{
+	struct rxm_conn *rxm_conn;
+	struct dlist_entry *tmp, reset_list;
+	size_t i;
+
+	/* Resetting drains the MSG CQ, which may come back here, so the
+	 * connections to reset are taken off conn_close_list first */
+	dlist_init(&reset_list);
+	dlist_foreach_container_safe(&rxm_ep->conn_close_list, struct rxm_conn,
+				     rxm_conn, close_entry, tmp) {
+		if (rxm_conn->close_reply) {
+			rxm_conn_reply_close(rxm_ep, rxm_conn);
+			if (rxm_conn->close_reply)
+				continue;
+		}
+
+		if (rxm_conn->close_state != RXM_CONN_CLOSE_READY) {
+			dlist_remove_init(&rxm_conn->close_entry);
+		} else if (!rxm_conn_busy(rxm_conn)) {
+			dlist_remove(&rxm_conn->close_entry);
+			dlist_insert_tail(&rxm_conn->close_entry, &reset_list);
+		}
+	}
+
+	while (!dlist_empty(&reset_list)) {
+		dlist_pop_front(&reset_list, struct rxm_conn, rxm_conn,
+				close_entry);
+		dlist_init(&rxm_conn->close_entry);
+		rxm_conn_reset(rxm_ep, rxm_conn);
+	}
+
+	if (!dlist_empty(&rxm_ep->warmup_list))
+		rxm_conn_warmup_progress(rxm_ep);
+
+	for (i = 0; i < RXM_CONN_REAP_SCAN &&
+		    rxm_ep->conn_cnt > rxm_ep->max_conn; i++) {
+		rxm_conn = container_of(rxm_ep->conn_lru_list.next,
+					struct rxm_conn, lru_entry);
+		if (rxm_conn->handle.state != RXM_CMAP_CONNECTED ||
+		    rxm_conn_busy(rxm_conn) ||
+		    rxm_conn_send_close(rxm_conn, rxm_ctrl_close, 0)) {
+			rxm_conn_touch(rxm_ep, rxm_conn);
+			continue;
+		}
+
+		FI_DBG(&rxm_prov, FI_LOG_EP_CTRL, "asking peer to close idle "
+		       "connection %p\n", (void *) rxm_conn);
+		RXM_CM_UPDATE_STATE(&rxm_conn->handle, RXM_CMAP_CLOSING);
+		rxm_conn->close_state = RXM_CONN_CLOSE_SENT;
+		rxm_conn_lru_del(rxm_ep, rxm_conn);
+	}
+}
+
 static ssize_t rxm_eq_sread(struct rxm_ep *rxm_ep, size_t len,
 			    struct rxm_msg_eq_entry *entry)
 {
@@ -1446,7 +2080,7 @@ static int rxm_conn_atomic_progress_eq_cq(struct rxm_ep *rxm_ep,
 				goto exit;
 		}
 		if (again || fds[1].revents & POLLIN)
-			rxm_ep_progress(&rxm_ep->util_ep);
+			rxm_ep->util_ep.progress(&rxm_ep->util_ep);
 	}
 exit:
 	return -1;
@@ -95,16 +95,66 @@ static int rxm_match_iov(const struct iovec *iov, void **desc,
 	return FI_SUCCESS;
 }
 
+/* Receive buffers posted to a MSG EP are tracked by its connection */
+static inline void rxm_rx_buf_unpost(struct rxm_rx_buf *rx_buf)
+{
+	if (!rx_buf->ep->srx_ctx)
+		dlist_remove(&rx_buf->repost_entry);
+}
+
 static inline uint64_t
 rxm_cq_get_rx_comp_and_op_flags(struct rxm_rx_buf *rx_buf)
 {
-	return (rx_buf->pkt.hdr.flags | ofi_rx_flags[rx_buf->pkt.hdr.op]);
+	return (rx_buf->pkt->hdr.flags | ofi_rx_flags[rx_buf->pkt->hdr.op]);
 }
 
 static inline uint64_t
 rxm_cq_get_rx_comp_flags(struct rxm_rx_buf *rx_buf)
 {
-	return (rx_buf->pkt.hdr.flags);
+	return (rx_buf->pkt->hdr.flags);
+}
+
+/* The slab's msg_ep may already be closed, so the connection is taken from
+ * the slab rather than looked up through the msg_ep */
+static struct rxm_rx_buf *rxm_rx_slab_buf_alloc(struct rxm_rx_slab *rx_slab)
+{
+	struct rxm_rx_buf *rx_buf;
+
+	rx_buf = ofi_buf_alloc(rx_slab->ep->buf_pools[RXM_BUF_POOL_RX].pool);
+	if (OFI_UNLIKELY(!rx_buf)) {
+		FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+			"ran out of buffers from RX buffer pool\n");
+		return NULL;
+	}
+
+	assert(rx_buf->ep == rx_slab->ep);
+	rx_buf->hdr.state = RXM_RX;
+	rx_buf->msg_ep = rx_slab->msg_ep;
+	rx_buf->conn = rx_slab->conn;
+	rx_buf->repost = 0;
+	return rx_buf;
+}
+
+/*
+ * Messages carved out of a slab are copied into an rx buffer of their own
+ * before they're queued for later, so that they don't keep the slab from
+ * being reposted.
+ */
+static struct rxm_rx_buf *rxm_rx_buf_detach(struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_rx_buf *new_rx_buf;
+
+	if (!rx_buf->slab)
+		return rx_buf;
+
+	new_rx_buf = rxm_rx_slab_buf_alloc(rx_buf->slab);
+	if (OFI_LIKELY(new_rx_buf != NULL)) {
+		new_rx_buf->recv_entry = rx_buf->recv_entry;
+		new_rx_buf->comp_flags = rx_buf->comp_flags;
+		memcpy(new_rx_buf->pkt, rx_buf->pkt, rx_buf->pkt_len);
+	}
+	rxm_rx_buf_finish(rx_buf);
+	return new_rx_buf;
 }
 
 static int rxm_finish_buf_recv(struct rxm_rx_buf *rx_buf)
@@ -112,10 +162,17 @@ static int rxm_finish_buf_recv(struct rxm_rx_buf *rx_buf)
 	uint64_t flags;
 	char *data;
 
-	if (rx_buf->pkt.ctrl_hdr.type == rxm_ctrl_seg &&
-	    rxm_sar_get_seg_type(&rx_buf->pkt.ctrl_hdr) != RXM_SAR_SEG_FIRST) {
+	if (rx_buf->pkt->ctrl_hdr.type == rxm_ctrl_seg &&
+	    rxm_sar_get_seg_type(&rx_buf->pkt->ctrl_hdr) != RXM_SAR_SEG_FIRST) {
+		rx_buf = rxm_rx_buf_detach(rx_buf);
+		if (OFI_UNLIKELY(!rx_buf))
+			return -FI_ENOMEM;
+
 		dlist_insert_tail(&rx_buf->unexp_msg.entry,
 				  &rx_buf->conn->sar_deferred_rx_msg_list);
+		if (!rx_buf->repost)
+			return 0;
+
 		rx_buf = rxm_rx_buf_alloc(rx_buf->ep, rx_buf->msg_ep, 1);
 		if (OFI_UNLIKELY(!rx_buf)) {
 			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
@@ -130,20 +187,20 @@ static int rxm_finish_buf_recv(struct rxm_rx_buf *rx_buf)
 
 	flags = rxm_cq_get_rx_comp_and_op_flags(rx_buf);
 
-	if (rx_buf->pkt.ctrl_hdr.type != rxm_ctrl_eager)
+	if (rx_buf->pkt->ctrl_hdr.type != rxm_ctrl_eager)
 		flags |= FI_MORE;
 
-	if (rx_buf->pkt.ctrl_hdr.type == rxm_ctrl_rndv)
-		data = rxm_pkt_rndv_data(&rx_buf->pkt);
+	if (rx_buf->pkt->ctrl_hdr.type == rxm_ctrl_rndv)
+		data = rxm_pkt_rndv_data(rx_buf->pkt);
 	else
-		data = rx_buf->pkt.data;
+		data = rx_buf->pkt->data;
 
 	FI_DBG(&rxm_prov, FI_LOG_CQ, "writing buffered recv completion: "
-	       "length: %" PRIu64 "\n", rx_buf->pkt.hdr.size);
+	       "length: %" PRIu64 "\n", rx_buf->pkt->hdr.size);
 	rx_buf->recv_context.ep = &rx_buf->ep->util_ep.ep_fid;
 
 	return rxm_cq_write_recv_comp(rx_buf, &rx_buf->recv_context, flags,
-				      rx_buf->pkt.hdr.size, data);
+				      rx_buf->pkt->hdr.size, data);
 }
 
 static int rxm_cq_write_error_trunc(struct rxm_rx_buf *rx_buf, size_t done_len)
@@ -155,15 +212,15 @@ static int rxm_cq_write_error_trunc(struct rxm_rx_buf *rx_buf, size_t done_len)
 
 	FI_WARN(&rxm_prov, FI_LOG_CQ, "Message truncated: "
 		"recv buf length: %zu message length: %" PRIu64 "\n",
-		done_len, rx_buf->pkt.hdr.size);
+		done_len, rx_buf->pkt->hdr.size);
 	ret = ofi_cq_write_error_trunc(rx_buf->ep->util_ep.rx_cq,
 				       rx_buf->recv_entry->context,
 				       rx_buf->recv_entry->comp_flags |
 				       rxm_cq_get_rx_comp_flags(rx_buf),
-				       rx_buf->pkt.hdr.size,
+				       rx_buf->pkt->hdr.size,
 				       rx_buf->recv_entry->rxm_iov.iov[0].iov_base,
-				       rx_buf->pkt.hdr.data, rx_buf->pkt.hdr.tag,
-				       rx_buf->pkt.hdr.size - done_len);
+				       rx_buf->pkt->hdr.data, rx_buf->pkt->hdr.tag,
+				       rx_buf->pkt->hdr.size - done_len);
 	if (OFI_UNLIKELY(ret)) {
 		FI_WARN(&rxm_prov, FI_LOG_CQ,
 			"Unable to write recv error CQ\n");
@@ -177,10 +234,12 @@ static int rxm_finish_recv(struct rxm_rx_buf *rx_buf, size_t done_len)
 	int ret;
 	struct rxm_recv_entry *recv_entry = rx_buf->recv_entry;
 
-	if (OFI_UNLIKELY(done_len < rx_buf->pkt.hdr.size)) {
+	if (OFI_UNLIKELY(done_len < rx_buf->pkt->hdr.size)) {
 		ret = rxm_cq_write_error_trunc(rx_buf, done_len);
 		if (ret)
 			return ret;
+	} else if (recv_entry->flags & FI_COLLECTIVE) {
+		ofi_coll_handle_comp(recv_entry->context);
 	} else {
 		if (rx_buf->recv_entry->flags & FI_COMPLETION ||
 		    rx_buf->ep->rxm_info->mode & FI_BUFFERED_RECV) {
@@ -188,7 +247,7 @@ static int rxm_finish_recv(struct rxm_rx_buf *rx_buf, size_t done_len)
 					rx_buf, rx_buf->recv_entry->context,
 					rx_buf->recv_entry->comp_flags |
 					rxm_cq_get_rx_comp_flags(rx_buf),
-					rx_buf->pkt.hdr.size,
+					rx_buf->pkt->hdr.size,
 					rx_buf->recv_entry->rxm_iov.iov[0].iov_base);
 			if (ret)
 				return ret;
@@ -198,7 +257,7 @@ static int rxm_finish_recv(struct rxm_rx_buf *rx_buf, size_t done_len)
 
 	if (rx_buf->recv_entry->flags & FI_MULTI_RECV) {
 		struct rxm_iov rxm_iov;
-		size_t recv_size = rx_buf->pkt.hdr.size;
+		size_t recv_size = rx_buf->pkt->hdr.size;
 		struct rxm_ep *rxm_ep = rx_buf->ep;
 
 		rxm_rx_buf_finish(rx_buf);
@@ -262,6 +321,27 @@ rxm_cq_tx_comp_write(struct rxm_ep *rxm_ep, uint64_t comp_flags,
 	return 0;
 }
 
+/* Sends posted by the collective scheduler on behalf of a multicast group
+ * complete into the scheduler rather than the application's CQ/counter.
+ */
+static inline int
+rxm_finish_send_comp(struct rxm_ep *rxm_ep, struct rxm_pkt *pkt,
+		     void *app_context, uint64_t flags)
+{
+	int ret;
+
+	assert(ofi_tx_cq_flags(pkt->hdr.op) & FI_SEND);
+	if (flags & FI_COLLECTIVE) {
+		ofi_coll_handle_comp(app_context);
+		return 0;
+	}
+
+	ret = rxm_cq_tx_comp_write(rxm_ep, ofi_tx_cq_flags(pkt->hdr.op),
+				   app_context, flags);
+	ofi_ep_tx_cntr_inc(&rxm_ep->util_ep);
+	return ret;
+}
+
 static inline int rxm_finish_rma(struct rxm_ep *rxm_ep, struct rxm_rma_buf *rma_buf,
 				 uint64_t comp_flags)
 {
@@ -280,21 +360,45 @@ static inline int rxm_finish_rma(struct rxm_ep *rxm_ep, struct rxm_rma_buf *rma_
 		rxm_ep_msg_mr_closev(rma_buf->mr.mr, rma_buf->mr.count);
 	}
 
+	rma_buf->conn->peer_wait--;
 	ofi_buf_free(rma_buf);
 	return ret;
 }
 
-static inline int rxm_finish_eager_send(struct rxm_ep *rxm_ep, struct rxm_tx_eager_buf *tx_buf)
+/*
+ * Writes the held completions of the messages in a coalesced packet, or
+ * an error completion for each of them if the packet couldn't be sent.
+ */
+int rxm_finish_coalesced_send(struct rxm_ep *rxm_ep,
+			      struct rxm_tx_eager_buf *tx_buf, int err)
 {
-	int ret = rxm_cq_tx_comp_write(rxm_ep, ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
-				       tx_buf->app_context, tx_buf->flags);
-
-	assert(ofi_tx_cq_flags(tx_buf->pkt.hdr.op) & FI_SEND);
-	ofi_ep_tx_cntr_inc(&rxm_ep->util_ep);
+	struct rxm_coalesce_comp *comp;
+	size_t i;
+	int ret = 0;
 
+	for (i = 0; i < tx_buf->comp_cnt; i++) {
+		comp = rxm_coalesce_comp(tx_buf, i);
+		if (err) {
+			rxm_cq_write_error(rxm_ep->util_ep.tx_cq,
+					   rxm_ep->util_ep.tx_cntr,
+					   comp->context, err);
+			continue;
+		}
+		if (rxm_cq_tx_comp_write(rxm_ep, comp->comp_flags,
+					 comp->context, comp->flags) && !ret)
+			ret = -FI_EOVERRUN;
+		ofi_ep_tx_cntr_inc(&rxm_ep->util_ep);
+	}
+	rxm_coalesced_buf_free(tx_buf);
 	return ret;
 }
 
+static inline int rxm_finish_eager_send(struct rxm_ep *rxm_ep, struct rxm_tx_eager_buf *tx_buf)
+{
+	return rxm_finish_send_comp(rxm_ep, &tx_buf->pkt, tx_buf->app_context,
+				    tx_buf->flags);
+}
+
 static inline int rxm_finish_sar_segment_send(struct rxm_ep *rxm_ep, struct rxm_tx_sar_buf *tx_buf)
 {
 	int ret = FI_SUCCESS;
@@ -307,14 +411,16 @@ static inline int rxm_finish_sar_segment_send(struct rxm_ep *rxm_ep, struct rxm_
 		ofi_buf_free(tx_buf);
 		break;
 	case RXM_SAR_SEG_LAST:
-		ret = rxm_cq_tx_comp_write(rxm_ep, ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
+		ret = rxm_finish_send_comp(rxm_ep, &tx_buf->pkt,
 					   tx_buf->app_context, tx_buf->flags);
-
-		assert(ofi_tx_cq_flags(tx_buf->pkt.hdr.op) & FI_SEND);
-		ofi_ep_tx_cntr_inc(&rxm_ep->util_ep);
 		first_tx_buf = ofi_bufpool_get_ibuf(rxm_ep->
 					buf_pools[RXM_BUF_POOL_TX_SAR].pool,
 					tx_buf->pkt.ctrl_hdr.msg_id);
+		if (rxm_ep->sar_adapt)
+			rxm_conn_adapt_sample(rxm_ep, first_tx_buf->conn,
+					      RXM_ADAPT_SAR,
+					      first_tx_buf->pkt.hdr.size,
+					      first_tx_buf->start);
 		ofi_buf_free(first_tx_buf);
 		ofi_buf_free(tx_buf);
 		break;
@@ -325,7 +431,7 @@ static inline int rxm_finish_sar_segment_send(struct rxm_ep *rxm_ep, struct rxm_
 
 static inline int rxm_finish_send_rndv_ack(struct rxm_rx_buf *rx_buf)
 {
-	RXM_UPDATE_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_FINISH);
+	RXM_UPDATE_RX_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_FINISH);
 
 	if (rx_buf->recv_entry->rndv.tx_buf) {
 		ofi_buf_free(rx_buf->recv_entry->rndv.tx_buf);
@@ -347,12 +453,13 @@ static int rxm_rndv_tx_finish(struct rxm_ep *rxm_ep, struct rxm_tx_rndv_buf *tx_
 	if (!rxm_ep->rxm_mr_local)
 		rxm_ep_msg_mr_closev(tx_buf->mr, tx_buf->count);
 
-	ret = rxm_cq_tx_comp_write(rxm_ep, ofi_tx_cq_flags(tx_buf->pkt.hdr.op),
-				   tx_buf->app_context, tx_buf->flags);
-
-	assert(ofi_tx_cq_flags(tx_buf->pkt.hdr.op) & FI_SEND);
-	ofi_ep_tx_cntr_inc(&rxm_ep->util_ep);
+	ret = rxm_finish_send_comp(rxm_ep, &tx_buf->pkt, tx_buf->app_context,
+				   tx_buf->flags);
 
+	if (rxm_ep->sar_adapt)
+		rxm_conn_adapt_sample(rxm_ep, tx_buf->conn, RXM_ADAPT_RNDV,
+				      tx_buf->pkt.hdr.size, tx_buf->start);
+	tx_buf->conn->peer_wait--;
 	ofi_buf_free(tx_buf);
 
 	return ret;
@@ -363,12 +470,12 @@ static int rxm_rndv_handle_ack(struct rxm_ep *rxm_ep, struct rxm_rx_buf *rx_buf)
 	struct rxm_tx_rndv_buf *tx_buf;
 
 	tx_buf = ofi_bufpool_get_ibuf(rxm_ep->buf_pools[RXM_BUF_POOL_TX_RNDV].pool,
-				      rx_buf->pkt.ctrl_hdr.msg_id);
+				      rx_buf->pkt->ctrl_hdr.msg_id);
 
 	FI_DBG(&rxm_prov, FI_LOG_CQ, "Got ACK for msg_id: 0x%" PRIx64 "\n",
-	       rx_buf->pkt.ctrl_hdr.msg_id);
+	       rx_buf->pkt->ctrl_hdr.msg_id);
 
-	assert(tx_buf->pkt.ctrl_hdr.msg_id == rx_buf->pkt.ctrl_hdr.msg_id);
+	assert(tx_buf->pkt.ctrl_hdr.msg_id == rx_buf->pkt->ctrl_hdr.msg_id);
 
 	rxm_rx_buf_finish(rx_buf);
 
@@ -386,7 +493,7 @@ static int rxm_rx_buf_match_msg_id(struct dlist_entry *item, const void *arg)
 	uint64_t msg_id = *((uint64_t *)arg);
 	struct rxm_rx_buf *rx_buf =
 		container_of(item, struct rxm_rx_buf, unexp_msg.entry);
-	return (msg_id == rx_buf->pkt.ctrl_hdr.msg_id);
+	return (msg_id == rx_buf->pkt->ctrl_hdr.msg_id);
 }
 
 static inline
@@ -395,12 +502,12 @@ ssize_t rxm_cq_copy_seg_data(struct rxm_rx_buf *rx_buf, int *done)
 	uint64_t done_len = ofi_copy_to_iov(rx_buf->recv_entry->rxm_iov.iov,
 					    rx_buf->recv_entry->rxm_iov.count,
 					    rx_buf->recv_entry->sar.total_recv_len,
-					    rx_buf->pkt.data,
-					    rx_buf->pkt.ctrl_hdr.seg_size);
+					    rx_buf->pkt->data,
+					    rx_buf->pkt->ctrl_hdr.seg_size);
 	rx_buf->recv_entry->sar.total_recv_len += done_len;
 
-	if ((rxm_sar_get_seg_type(&rx_buf->pkt.ctrl_hdr) == RXM_SAR_SEG_LAST) ||
-	    (done_len != rx_buf->pkt.ctrl_hdr.seg_size)) {
+	if ((rxm_sar_get_seg_type(&rx_buf->pkt->ctrl_hdr) == RXM_SAR_SEG_LAST) ||
+	    (done_len != rx_buf->pkt->ctrl_hdr.seg_size)) {
 		dlist_remove(&rx_buf->recv_entry->sar.entry);
 
 		/* Mark rxm_recv_entry::msg_id as unknown for futher re-use */
@@ -415,11 +522,11 @@ ssize_t rxm_cq_copy_seg_data(struct rxm_rx_buf *rx_buf, int *done)
 		if (rx_buf->recv_entry->sar.msg_id == RXM_SAR_RX_INIT) {
 			if (!rx_buf->conn) {
 				rx_buf->conn = rxm_key2conn(rx_buf->ep,
-							    rx_buf->pkt.ctrl_hdr.conn_id);
+							    rx_buf->pkt->ctrl_hdr.conn_id);
 			}
 
 			rx_buf->recv_entry->sar.conn = rx_buf->conn;
-			rx_buf->recv_entry->sar.msg_id = rx_buf->pkt.ctrl_hdr.msg_id;
+			rx_buf->recv_entry->sar.msg_id = rx_buf->pkt->ctrl_hdr.msg_id;
 
 			dlist_insert_tail(&rx_buf->recv_entry->sar.entry,
 					  &rx_buf->conn->sar_rx_msg_list);
@@ -442,7 +549,7 @@ ssize_t rxm_cq_handle_seg_data(struct rxm_rx_buf *rx_buf)
 	if (rx_buf->ep->rxm_info->mode & FI_BUFFERED_RECV) {
 		struct rxm_recv_entry *recv_entry = rx_buf->recv_entry;
 		struct rxm_conn *conn = rx_buf->conn;
-		uint64_t msg_id = rx_buf->pkt.ctrl_hdr.msg_id;
+		uint64_t msg_id = rx_buf->pkt->ctrl_hdr.msg_id;
 		struct dlist_entry *entry;
 		ssize_t ret;
 
@@ -502,20 +609,23 @@ ssize_t rxm_cq_handle_rndv(struct rxm_rx_buf *rx_buf)
 	struct rxm_rx_buf *new_rx_buf;
 	int ret = 0;
 
-	rx_buf->repost = 0;
+	if (rx_buf->repost) {
+		rx_buf->repost = 0;
 
-	/* En-queue new rx buf to be posted ASAP so that we don't block any
-	 * incoming messages. RNDV processing can take a while. */
-	new_rx_buf = rxm_rx_buf_alloc(rx_buf->ep, rx_buf->msg_ep, 1);
-	if (OFI_UNLIKELY(!new_rx_buf))
-		return -FI_ENOMEM;
-	dlist_insert_tail(&new_rx_buf->repost_entry,
-			  &new_rx_buf->ep->repost_ready_list);
+		/* En-queue new rx buf to be posted ASAP so that we don't
+		 * block any incoming messages. RNDV processing can take a
+		 * while. */
+		new_rx_buf = rxm_rx_buf_alloc(rx_buf->ep, rx_buf->msg_ep, 1);
+		if (OFI_UNLIKELY(!new_rx_buf))
+			return -FI_ENOMEM;
+		dlist_insert_tail(&new_rx_buf->repost_entry,
+				  &new_rx_buf->ep->repost_ready_list);
+	}
 
 	if (!rx_buf->conn) {
 		assert(rx_buf->ep->srx_ctx);
 		rx_buf->conn = rxm_key2conn(rx_buf->ep,
-					    rx_buf->pkt.ctrl_hdr.conn_id);
+					    rx_buf->pkt->ctrl_hdr.conn_id);
 		if (OFI_UNLIKELY(!rx_buf->conn))
 			return -FI_EOTHER;
 	}
@@ -523,14 +633,14 @@ ssize_t rxm_cq_handle_rndv(struct rxm_rx_buf *rx_buf)
 
 	FI_DBG(&rxm_prov, FI_LOG_CQ,
 	       "Got incoming recv with msg_id: 0x%" PRIx64 "\n",
-	       rx_buf->pkt.ctrl_hdr.msg_id);
+	       rx_buf->pkt->ctrl_hdr.msg_id);
 
-	rx_buf->rndv_hdr = (struct rxm_rndv_hdr *)rx_buf->pkt.data;
+	rx_buf->rndv_hdr = (struct rxm_rndv_hdr *)rx_buf->pkt->data;
 	rx_buf->rndv_rma_index = 0;
 
 	if (!rx_buf->ep->rxm_mr_local) {
 		total_recv_len = MIN(rx_buf->recv_entry->total_len,
-				     rx_buf->pkt.hdr.size);
+				     rx_buf->pkt->hdr.size);
 		ret = rxm_ep_msg_mr_regv_lim(rx_buf->ep,
 					     rx_buf->recv_entry->rxm_iov.iov,
 					     rx_buf->recv_entry->rxm_iov.count,
@@ -548,13 +658,13 @@ ssize_t rxm_cq_handle_rndv(struct rxm_rx_buf *rx_buf)
 			rx_buf->recv_entry->rxm_iov.desc[i] =
 				fi_mr_desc(rx_buf->recv_entry->rxm_iov.desc[i]);
 		total_recv_len = MIN(rx_buf->recv_entry->total_len,
-				     rx_buf->pkt.hdr.size);
+				     rx_buf->pkt->hdr.size);
 	}
 
 	assert(rx_buf->rndv_hdr->count &&
 	       (rx_buf->rndv_hdr->count <= RXM_IOV_LIMIT));
 
-	RXM_UPDATE_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_READ);
+	RXM_UPDATE_RX_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_READ);
 
 	for (i = 0; i < rx_buf->rndv_hdr->count; i++) {
 		size_t copy_len = MIN(rx_buf->rndv_hdr->iov[i].len,
@@ -602,14 +712,14 @@ ssize_t rxm_cq_handle_eager(struct rxm_rx_buf *rx_buf)
 {
 	uint64_t done_len = ofi_copy_to_iov(rx_buf->recv_entry->rxm_iov.iov,
 					    rx_buf->recv_entry->rxm_iov.count,
-					    0, rx_buf->pkt.data,
-					    rx_buf->pkt.hdr.size);
+					    0, rx_buf->pkt->data,
+					    rx_buf->pkt->hdr.size);
 	return rxm_finish_recv(rx_buf, done_len);
 }
 
 ssize_t rxm_cq_handle_rx_buf(struct rxm_rx_buf *rx_buf)
 {
-	switch (rx_buf->pkt.ctrl_hdr.type) {
+	switch (rx_buf->pkt->ctrl_hdr.type) {
 	case rxm_ctrl_eager:
 		return rxm_cq_handle_eager(rx_buf);
 	case rxm_ctrl_rndv:
@@ -631,6 +741,7 @@ rxm_cq_match_rx_buf(struct rxm_rx_buf *rx_buf,
 	struct dlist_entry *entry;
 	struct rxm_ep *rxm_ep;
 	struct fid_ep *msg_ep;
+	uint8_t repost;
 
 	entry = dlist_remove_first_match(&recv_queue->recv_list,
 					 recv_queue->match_recv, match_attr);
@@ -640,13 +751,23 @@ rxm_cq_match_rx_buf(struct rxm_rx_buf *rx_buf,
 				 match_attr->tag);
 		FI_DBG(&rxm_prov, FI_LOG_CQ, "Enqueueing msg to unexpected msg"
 		       "queue\n");
+		rx_buf = rxm_rx_buf_detach(rx_buf);
+		if (OFI_UNLIKELY(!rx_buf))
+			return -FI_ENOMEM;
+
 		rx_buf->unexp_msg.addr = match_attr->addr;
 		rx_buf->unexp_msg.tag = match_attr->tag;
+		repost = rx_buf->repost;
 		rx_buf->repost = 0;
 
 		dlist_insert_tail(&rx_buf->unexp_msg.entry,
 				  &recv_queue->unexp_msg_list);
 
+		/* Messages unpacked from a coalesced packet or carved out of
+		 * a slab don't hold a posted receive that needs replacing */
+		if (!repost)
+			return 0;
+
 		msg_ep = rx_buf->msg_ep;
 		rxm_ep = rx_buf->ep;
 
@@ -675,7 +796,7 @@ static inline ssize_t rxm_handle_recv_comp(struct rxm_rx_buf *rx_buf)
 	if (rx_buf->ep->rxm_info->caps & (FI_SOURCE | FI_DIRECTED_RECV)) {
 		if (rx_buf->ep->srx_ctx)
 			rx_buf->conn =
-				rxm_key2conn(rx_buf->ep, rx_buf->pkt.ctrl_hdr.conn_id);
+				rxm_key2conn(rx_buf->ep, rx_buf->pkt->ctrl_hdr.conn_id);
 		if (OFI_UNLIKELY(!rx_buf->conn))
 			return -FI_EOTHER;
 		match_attr.addr = rx_buf->conn->handle.fi_addr;
@@ -684,14 +805,14 @@ static inline ssize_t rxm_handle_recv_comp(struct rxm_rx_buf *rx_buf)
 	if (rx_buf->ep->rxm_info->mode & FI_BUFFERED_RECV)
 		return rxm_finish_buf_recv(rx_buf);
 
-	switch(rx_buf->pkt.hdr.op) {
+	switch(rx_buf->pkt->hdr.op) {
 	case ofi_op_msg:
 		FI_DBG(&rxm_prov, FI_LOG_CQ, "Got MSG op\n");
 		return rxm_cq_match_rx_buf(rx_buf, &rx_buf->ep->recv_queue,
 					   &match_attr);
 	case ofi_op_tagged:
 		FI_DBG(&rxm_prov, FI_LOG_CQ, "Got TAGGED op\n");
-		match_attr.tag = rx_buf->pkt.hdr.tag;
+		match_attr.tag = rx_buf->pkt->hdr.tag;
 		return rxm_cq_match_rx_buf(rx_buf, &rx_buf->ep->trecv_queue,
 					   &match_attr);
 	default:
@@ -701,6 +822,80 @@ static inline ssize_t rxm_handle_recv_comp(struct rxm_rx_buf *rx_buf)
 	}
 }
 
+/*
+ * Messages left in a coalesced packet that can't be unpacked were never
+ * matched to a receive, so each is reported as an error without a
+ * context.
+ */
+static void rxm_coalesced_drop(struct rxm_rx_buf *rx_buf, size_t offset,
+			       int err)
+{
+	struct util_ep *util_ep = &rx_buf->ep->util_ep;
+	struct fi_cq_err_entry err_entry = {0};
+	struct ofi_op_hdr *hdr;
+
+	for (; offset < rx_buf->pkt->hdr.size;
+	     offset += rxm_coalesced_msg_size(hdr->size)) {
+		hdr = (struct ofi_op_hdr *) (rx_buf->pkt->data + offset);
+		if (util_ep->rx_cntr)
+			rxm_cntr_incerr(util_ep->rx_cntr);
+		if (!util_ep->rx_cq)
+			continue;
+
+		err_entry.flags = ofi_rx_cq_flags(hdr->op);
+		err_entry.len = hdr->size;
+		err_entry.tag = hdr->tag;
+		err_entry.err = -err;
+		err_entry.prov_errno = err;
+		if (ofi_cq_write_error(util_ep->rx_cq, &err_entry)) {
+			FI_WARN(&rxm_prov, FI_LOG_CQ,
+				"Unable to ofi_cq_write_error\n");
+			assert(0);
+		}
+	}
+}
+
+/*
+ * Each message in a coalesced packet is copied out into an rx buffer of
+ * its own, so it can be matched and queued as unexpected just like an
+ * eager message that arrived alone.
+ */
+static ssize_t rxm_handle_coalesced(struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_rx_buf *msg_buf;
+	struct ofi_op_hdr *hdr;
+	size_t offset = 0;
+	ssize_t ret = 0;
+
+	while (offset < rx_buf->pkt->hdr.size) {
+		hdr = (struct ofi_op_hdr *) (rx_buf->pkt->data + offset);
+		assert(offset + rxm_coalesced_msg_size(hdr->size) <=
+		       rx_buf->pkt->hdr.size);
+
+		msg_buf = rxm_rx_buf_alloc(rx_buf->ep, rx_buf->msg_ep, 0);
+		if (OFI_UNLIKELY(!msg_buf)) {
+			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+				"ran out of buffers from RX buffer pool\n");
+			rxm_coalesced_drop(rx_buf, offset, -FI_ENOMEM);
+			break;
+		}
+		offset += rxm_coalesced_msg_size(hdr->size);
+		msg_buf->conn = rx_buf->conn;
+		msg_buf->pkt->ctrl_hdr = rx_buf->pkt->ctrl_hdr;
+		msg_buf->pkt->ctrl_hdr.type = rxm_ctrl_eager;
+		memcpy(&msg_buf->pkt->hdr, hdr, sizeof(*hdr) + hdr->size);
+
+		ret = rxm_handle_recv_comp(msg_buf);
+		if (OFI_UNLIKELY(ret)) {
+			rxm_coalesced_drop(rx_buf, offset, (int) ret);
+			break;
+		}
+	}
+
+	rxm_rx_buf_finish(rx_buf);
+	return ret;
+}
+
 static int rxm_sar_match_msg_id(struct dlist_entry *item, const void *arg)
 {
 	uint64_t msg_id = *((uint64_t *)arg);
@@ -715,15 +910,15 @@ ssize_t rxm_sar_handle_segment(struct rxm_rx_buf *rx_buf)
 	struct dlist_entry *sar_entry;
 
 	rx_buf->conn = rxm_key2conn(rx_buf->ep,
-				    rx_buf->pkt.ctrl_hdr.conn_id);
+				    rx_buf->pkt->ctrl_hdr.conn_id);
 	if (OFI_UNLIKELY(!rx_buf->conn))
 		return -FI_EOTHER;
 	FI_DBG(&rxm_prov, FI_LOG_CQ,
 	       "Got incoming recv with msg_id: 0x%" PRIx64 "for conn - %p\n",
-	       rx_buf->pkt.ctrl_hdr.msg_id, rx_buf->conn);
+	       rx_buf->pkt->ctrl_hdr.msg_id, rx_buf->conn);
 	sar_entry = dlist_find_first_match(&rx_buf->conn->sar_rx_msg_list,
 					   rxm_sar_match_msg_id,
-					   &rx_buf->pkt.ctrl_hdr.msg_id);
+					   &rx_buf->pkt->ctrl_hdr.msg_id);
 	if (!sar_entry)
 		return rxm_handle_recv_comp(rx_buf);
 	rx_buf->recv_entry =
@@ -751,7 +946,7 @@ static ssize_t rxm_rndv_send_ack_inject(struct rxm_rx_buf *rx_buf)
 	pkt.ctrl_hdr.version	= RXM_CTRL_VERSION;
 	pkt.ctrl_hdr.type	= rxm_ctrl_rndv_ack;
 	pkt.ctrl_hdr.conn_id 	= rx_buf->conn->handle.remote_key;
-	pkt.ctrl_hdr.msg_id 	= rx_buf->pkt.ctrl_hdr.msg_id;
+	pkt.ctrl_hdr.msg_id 	= rx_buf->pkt->ctrl_hdr.msg_id;
 
 	return fi_sendmsg(rx_buf->conn->msg_ep, &msg, FI_INJECT);
 }
@@ -762,7 +957,7 @@ static ssize_t rxm_rndv_send_ack(struct rxm_rx_buf *rx_buf)
 
 	assert(rx_buf->conn);
 
-	if (sizeof(rx_buf->pkt) <= rx_buf->ep->inject_limit) {
+	if (sizeof(*rx_buf->pkt) <= rx_buf->ep->inject_limit) {
 		ret = rxm_rndv_send_ack_inject(rx_buf);
 		if (!ret)
 			goto out;
@@ -788,7 +983,7 @@ static ssize_t rxm_rndv_send_ack(struct rxm_rx_buf *rx_buf)
 	rx_buf->recv_entry->rndv.tx_buf->pkt.ctrl_hdr.conn_id =
 		rx_buf->conn->handle.remote_key;
 	rx_buf->recv_entry->rndv.tx_buf->pkt.ctrl_hdr.msg_id =
-		rx_buf->pkt.ctrl_hdr.msg_id;
+		rx_buf->pkt->ctrl_hdr.msg_id;
 
 	ret = fi_send(rx_buf->conn->msg_ep, &rx_buf->recv_entry->rndv.tx_buf->pkt,
 		      sizeof(rx_buf->recv_entry->rndv.tx_buf->pkt),
@@ -816,7 +1011,7 @@ static ssize_t rxm_rndv_send_ack(struct rxm_rx_buf *rx_buf)
 		goto err;
 	}
 out:
-	RXM_UPDATE_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_ACK_SENT);
+	RXM_UPDATE_RX_STATE(FI_LOG_CQ, rx_buf, RXM_RNDV_ACK_SENT);
 	return 0;
 err:
 	ofi_buf_free(rx_buf->recv_entry->rndv.tx_buf);
@@ -839,8 +1034,11 @@ static int rxm_handle_remote_write(struct rxm_ep *rxm_ep,
 		return ret;
 	}
 	ofi_ep_rem_wr_cntr_inc(&rxm_ep->util_ep);
-	if (comp->op_context)
+	if (comp->op_context &&
+	    RXM_GET_PROTO_STATE(comp->op_context) == RXM_RX) {
+		rxm_rx_buf_unpost(comp->op_context);
 		rxm_rx_buf_finish(comp->op_context);
+	}
 	return 0;
 }
 
@@ -858,6 +1056,16 @@ static inline void rxm_ep_format_atomic_resp_pkt_hdr(struct rxm_conn *rxm_conn,
 	tx_buf->pkt.hdr.atomic.ioc_count = 0;
 }
 
+/* Responses to queued atomic requests each hold a credit until freed */
+static inline void
+rxm_atomic_resp_buf_free(struct rxm_ep *rxm_ep,
+			 struct rxm_tx_atomic_buf *resp_buf)
+{
+	if (rxm_ep->atomic_queue_size)
+		rxm_ep->atomic_resp_credits++;
+	ofi_buf_free(resp_buf);
+}
+
 static ssize_t rxm_atomic_send_resp(struct rxm_ep *rxm_ep,
 				    struct rxm_rx_buf *rx_buf,
 				    struct rxm_tx_atomic_buf *resp_buf,
@@ -873,11 +1081,11 @@ static ssize_t rxm_atomic_send_resp(struct rxm_ep *rxm_ep,
 	rxm_ep_format_atomic_resp_pkt_hdr(rx_buf->conn,
 					  resp_buf,
 					  resp_len,
-					  rx_buf->pkt.hdr.op,
-					  rx_buf->pkt.hdr.atomic.datatype,
-					  rx_buf->pkt.hdr.atomic.op);
+					  rx_buf->pkt->hdr.op,
+					  rx_buf->pkt->hdr.atomic.datatype,
+					  rx_buf->pkt->hdr.atomic.op);
 	resp_buf->pkt.ctrl_hdr.conn_id = rx_buf->conn->handle.remote_key;
-	resp_buf->pkt.ctrl_hdr.msg_id = rx_buf->pkt.ctrl_hdr.msg_id;
+	resp_buf->pkt.ctrl_hdr.msg_id = rx_buf->pkt->ctrl_hdr.msg_id;
 	atomic_hdr = (struct rxm_atomic_resp_hdr *) resp_buf->pkt.data;
 	atomic_hdr->status = htonl(status);
 	atomic_hdr->result_len = htonl(result_len);
@@ -886,7 +1094,7 @@ static ssize_t rxm_atomic_send_resp(struct rxm_ep *rxm_ep,
 		ret = fi_inject(rx_buf->conn->msg_ep, &resp_buf->pkt,
 				resp_len, 0);
 		if (OFI_LIKELY(!ret))
-			ofi_buf_free(resp_buf);
+			rxm_atomic_resp_buf_free(rxm_ep, resp_buf);
 	} else {
 		ret = rxm_atomic_send_respmsg(rxm_ep, rx_buf->conn, resp_buf,
 					      resp_len);
@@ -941,13 +1149,13 @@ static inline void rxm_do_atomic(struct rxm_pkt *pkt, void *dst, void *src,
 	}
 }
 
-static inline ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
-					    struct rxm_rx_buf *rx_buf)
+static ssize_t rxm_exec_atomic_req(struct rxm_ep *rxm_ep,
+				   struct rxm_rx_buf *rx_buf)
 {
 	struct rxm_atomic_hdr *req_hdr =
-			(struct rxm_atomic_hdr *) rx_buf->pkt.data;
-	enum fi_datatype datatype = rx_buf->pkt.hdr.atomic.datatype;
-	enum fi_op atomic_op = rx_buf->pkt.hdr.atomic.op;
+			(struct rxm_atomic_hdr *) rx_buf->pkt->data;
+	enum fi_datatype datatype = rx_buf->pkt->hdr.atomic.datatype;
+	enum fi_op atomic_op = rx_buf->pkt->hdr.atomic.op;
 	size_t datatype_sz = ofi_datatype_size(datatype);
 	size_t len;
 	ssize_t result_len;
@@ -961,15 +1169,9 @@ static inline ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
 
 	assert(!(rx_buf->comp_flags &
 		 ~(FI_RECV | FI_RECV | FI_REMOTE_CQ_DATA)));
-	assert(rx_buf->pkt.hdr.op == ofi_op_atomic ||
-	       rx_buf->pkt.hdr.op == ofi_op_atomic_fetch ||
-	       rx_buf->pkt.hdr.op == ofi_op_atomic_compare);
-
-	if (rx_buf->ep->srx_ctx)
-		rx_buf->conn = rxm_key2conn(rx_buf->ep,
-					    rx_buf->pkt.ctrl_hdr.conn_id);
-	if (OFI_UNLIKELY(!rx_buf->conn))
-		return -FI_EOTHER;
+	assert(rx_buf->pkt->hdr.op == ofi_op_atomic ||
+	       rx_buf->pkt->hdr.op == ofi_op_atomic_fetch ||
+	       rx_buf->pkt->hdr.op == ofi_op_atomic_compare);
 
 	resp_buf = (struct rxm_tx_atomic_buf *)
 		   rxm_tx_buf_alloc(rxm_ep, RXM_BUF_POOL_TX_ATOMIC);
@@ -980,13 +1182,15 @@ static inline ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
 		 * processed again */
 		return -FI_EAGAIN;
 	}
+	if (rxm_ep->atomic_queue_size)
+		rxm_ep->atomic_resp_credits--;
 
-	for (i = 0; i < rx_buf->pkt.hdr.atomic.ioc_count; i++) {
+	for (i = 0; i < rx_buf->pkt->hdr.atomic.ioc_count; i++) {
 		ret = ofi_mr_verify(&domain->util_domain.mr_map,
 				    req_hdr->rma_ioc[i].count * datatype_sz,
 				    (uintptr_t *)&req_hdr->rma_ioc[i].addr,
 				    req_hdr->rma_ioc[i].key,
-				    ofi_rx_mr_reg_flags(rx_buf->pkt.hdr.op,
+				    ofi_rx_mr_reg_flags(rx_buf->pkt->hdr.op,
 							atomic_op));
 		if (ret) {
 			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
@@ -997,11 +1201,11 @@ static inline ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
 	}
 
 	len = ofi_total_rma_ioc_cnt(req_hdr->rma_ioc,
-			rx_buf->pkt.hdr.atomic.ioc_count) * datatype_sz;
+			rx_buf->pkt->hdr.atomic.ioc_count) * datatype_sz;
 	resp_hdr = (struct rxm_atomic_resp_hdr *) resp_buf->pkt.data;
 
-	for (i = 0, offset = 0; i < rx_buf->pkt.hdr.atomic.ioc_count; i++) {
-		rxm_do_atomic(&rx_buf->pkt,
+	for (i = 0, offset = 0; i < rx_buf->pkt->hdr.atomic.ioc_count; i++) {
+		rxm_do_atomic(rx_buf->pkt,
 			      (uintptr_t *) req_hdr->rma_ioc[i].addr,
 			      req_hdr->data + offset,
 			      req_hdr->data + len + offset,
@@ -1009,9 +1213,9 @@ static inline ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
 			      req_hdr->rma_ioc[i].count, datatype, atomic_op);
 		offset += req_hdr->rma_ioc[i].count * datatype_sz;
 	}
-	result_len = rx_buf->pkt.hdr.op == ofi_op_atomic ? 0 : offset;
+	result_len = rx_buf->pkt->hdr.op == ofi_op_atomic ? 0 : offset;
 
-	if (rx_buf->pkt.hdr.op == ofi_op_atomic)
+	if (rx_buf->pkt->hdr.op == ofi_op_atomic)
 		ofi_ep_rem_wr_cntr_inc(&rxm_ep->util_ep);
 	else
 		ofi_ep_rem_rd_cntr_inc(&rxm_ep->util_ep);
@@ -1022,21 +1226,60 @@ send_nak:
 	return rxm_atomic_send_resp(rxm_ep, rx_buf, resp_buf, 0, ret);
 }
 
+/* Queued requests may wait for credits, so they hand their posted
+ * receive over to a new rx buffer */
+static ssize_t rxm_queue_atomic_req(struct rxm_ep *rxm_ep,
+				    struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_rx_buf *new_rx_buf;
+
+	if (rx_buf->repost) {
+		new_rx_buf = rxm_rx_buf_alloc(rxm_ep, rx_buf->msg_ep, 1);
+		if (OFI_UNLIKELY(!new_rx_buf)) {
+			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+				"ran out of buffers from RX buffer pool\n");
+			return -FI_ENOMEM;
+		}
+		dlist_insert_tail(&new_rx_buf->repost_entry,
+				  &rxm_ep->repost_ready_list);
+		rx_buf->repost = 0;
+	}
+
+	rx_buf->conn->atomic_req_cnt++;
+	dlist_insert_tail(&rx_buf->repost_entry, &rxm_ep->atomic_req_queue);
+	return 0;
+}
+
+static inline ssize_t rxm_handle_atomic_req(struct rxm_ep *rxm_ep,
+					    struct rxm_rx_buf *rx_buf)
+{
+	if (rx_buf->ep->srx_ctx)
+		rx_buf->conn = rxm_key2conn(rx_buf->ep,
+					    rx_buf->pkt->ctrl_hdr.conn_id);
+	if (OFI_UNLIKELY(!rx_buf->conn))
+		return -FI_EOTHER;
+
+	if (rxm_ep->atomic_queue_size)
+		return rxm_queue_atomic_req(rxm_ep, rx_buf);
+
+	return rxm_exec_atomic_req(rxm_ep, rx_buf);
+}
+
 
 static inline ssize_t rxm_handle_atomic_resp(struct rxm_ep *rxm_ep,
 					     struct rxm_rx_buf *rx_buf)
 {
 	struct rxm_tx_atomic_buf *tx_buf;
 	struct rxm_atomic_resp_hdr *resp_hdr =
-			(struct rxm_atomic_resp_hdr *) rx_buf->pkt.data;
+			(struct rxm_atomic_resp_hdr *) rx_buf->pkt->data;
 	uint64_t len;
 	int ret = 0;
 
 	tx_buf = ofi_bufpool_get_ibuf(rxm_ep->buf_pools[RXM_BUF_POOL_TX_ATOMIC].pool,
-				      rx_buf->pkt.ctrl_hdr.msg_id);
+				      rx_buf->pkt->ctrl_hdr.msg_id);
 	FI_DBG(&rxm_prov, FI_LOG_CQ, "received atomic response: op: %" PRIu8
-	       " msg_id: 0x%" PRIx64 "\n", rx_buf->pkt.hdr.op,
-	       rx_buf->pkt.ctrl_hdr.msg_id);
+	       " msg_id: 0x%" PRIx64 "\n", rx_buf->pkt->hdr.op,
+	       rx_buf->pkt->ctrl_hdr.msg_id);
 
 	assert(!(rx_buf->comp_flags & ~(FI_RECV | FI_REMOTE_CQ_DATA)));
 
@@ -1083,6 +1326,7 @@ static inline ssize_t rxm_handle_atomic_resp(struct rxm_ep *rxm_ep,
 	}
 err:
 	rxm_rx_buf_finish(rx_buf);
+	tx_buf->conn->peer_wait--;
 	ofi_buf_free(tx_buf);
 	ofi_atomic_inc32(&rxm_ep->atomic_tx_credits);
 	assert(ofi_atomic_get32(&rxm_ep->atomic_tx_credits) <=
@@ -1091,6 +1335,211 @@ err:
 	return ret;
 }
 
+static ssize_t rxm_handle_close(struct rxm_ep *rxm_ep,
+				struct rxm_rx_buf *rx_buf)
+{
+	struct rxm_conn *rxm_conn;
+
+	rxm_conn = rx_buf->conn ? rx_buf->conn :
+		   rxm_key2conn(rxm_ep, rx_buf->pkt->ctrl_hdr.conn_id);
+	if (rxm_conn) {
+		if (rx_buf->pkt->ctrl_hdr.type == rxm_ctrl_close)
+			rxm_conn_process_close(rxm_ep, rxm_conn);
+		else
+			rxm_conn_process_close_resp(rxm_ep, rxm_conn,
+						    rx_buf->pkt->ctrl_hdr.ctrl_data);
+	}
+	rxm_rx_buf_finish(rx_buf);
+	return 0;
+}
+
+static ssize_t rxm_handle_rx_pkt(struct rxm_ep *rxm_ep,
+				 struct rxm_rx_buf *rx_buf)
+{
+	assert((rx_buf->pkt->hdr.version == OFI_OP_VERSION) &&
+	       (rx_buf->pkt->ctrl_hdr.version == RXM_CTRL_VERSION));
+
+	if (OFI_UNLIKELY(rxm_ep->max_conn))
+		rxm_conn_touch(rxm_ep, rx_buf->conn ? rx_buf->conn :
+			       rxm_key2conn(rxm_ep, rx_buf->pkt->ctrl_hdr.conn_id));
+
+	switch (rx_buf->pkt->ctrl_hdr.type) {
+	case rxm_ctrl_eager:
+	case rxm_ctrl_rndv:
+		return rxm_handle_recv_comp(rx_buf);
+	case rxm_ctrl_rndv_ack:
+		return rxm_rndv_handle_ack(rxm_ep, rx_buf);
+	case rxm_ctrl_seg:
+		return rxm_sar_handle_segment(rx_buf);
+	case rxm_ctrl_atomic:
+		return rxm_handle_atomic_req(rxm_ep, rx_buf);
+	case rxm_ctrl_atomic_resp:
+		return rxm_handle_atomic_resp(rxm_ep, rx_buf);
+	case rxm_ctrl_coalesced:
+		return rxm_handle_coalesced(rx_buf);
+	case rxm_ctrl_close:
+	case rxm_ctrl_close_resp:
+		return rxm_handle_close(rxm_ep, rx_buf);
+	default:
+		FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown message type\n");
+		assert(0);
+		return -FI_EINVAL;
+	}
+}
+
+/* Space that must be left in a slab for the MSG provider to keep using it */
+static inline size_t rxm_rx_slab_min(void)
+{
+	return rxm_eager_limit + sizeof(struct rxm_pkt);
+}
+
+static int rxm_msg_ep_recv_slab(struct rxm_rx_slab *rx_slab)
+{
+	struct iovec iov = {
+		.iov_base = rx_slab->data,
+		.iov_len = rx_slab->ep->rx_slab_size,
+	};
+	struct fi_msg msg = {
+		.msg_iov = &iov,
+		.desc = &rx_slab->hdr.desc,
+		.iov_count = 1,
+		.addr = FI_ADDR_UNSPEC,
+		.context = rx_slab,
+		.data = 0,
+	};
+	int ret;
+
+	rx_slab->cur = rx_slab->data;
+	rx_slab->retired = 0;
+	rx_slab->replaced = 0;
+	ret = (int) fi_recvmsg(rx_slab->msg_ep, &msg, FI_MULTI_RECV);
+	if (ret)
+		FI_WARN(&rxm_prov, FI_LOG_EP_CTRL,
+			"unable to post recv slab: %d\n", ret);
+	return ret;
+}
+
+/* Discards the slab instead if its msg_ep was closed */
+static void rxm_rx_slab_repost(struct rxm_rx_slab *rx_slab)
+{
+	if (rx_slab->msg_ep != rx_slab->conn->msg_ep ||
+	    rxm_msg_ep_recv_slab(rx_slab)) {
+		dlist_remove(&rx_slab->entry);
+		ofi_buf_free(rx_slab);
+	}
+}
+
+static int rxm_msg_ep_post_slab(struct rxm_ep *rxm_ep, struct fid_ep *msg_ep)
+{
+	struct rxm_rx_slab *rx_slab;
+	int ret;
+
+	rx_slab = ofi_buf_alloc(rxm_ep->buf_pools[RXM_BUF_POOL_RX_SLAB].pool);
+	if (OFI_UNLIKELY(!rx_slab))
+		return -FI_ENOMEM;
+
+	assert(rx_slab->ep == rxm_ep);
+	rx_slab->msg_ep = msg_ep;
+	rx_slab->conn = container_of(msg_ep->fid.context,
+				     struct rxm_conn, handle);
+	rx_slab->ref = 0;
+	ret = rxm_msg_ep_recv_slab(rx_slab);
+	if (OFI_UNLIKELY(ret)) {
+		ofi_buf_free(rx_slab);
+		return ret;
+	}
+	dlist_insert_tail(&rx_slab->entry, &rx_slab->conn->rx_slab_list);
+	return 0;
+}
+
+/*
+ * The MSG provider is done with the slab.  While messages still point into
+ * it, another slab is posted in its place so the MSG EP isn't left short of
+ * receive space, and this one is freed once the last message is released.
+ */
+static void rxm_rx_slab_release(struct rxm_rx_slab *rx_slab)
+{
+	if (!rx_slab->ref) {
+		rxm_rx_slab_repost(rx_slab);
+		return;
+	}
+
+	rx_slab->retired = 1;
+	if (rx_slab->msg_ep == rx_slab->conn->msg_ep &&
+	    !rxm_msg_ep_post_slab(rx_slab->ep, rx_slab->msg_ep))
+		rx_slab->replaced = 1;
+}
+
+void rxm_rx_slab_put(struct rxm_rx_slab *rx_slab)
+{
+	assert(rx_slab->ref > 0);
+	if (--rx_slab->ref || !rx_slab->retired)
+		return;
+
+	if (rx_slab->replaced) {
+		dlist_remove(&rx_slab->entry);
+		ofi_buf_free(rx_slab);
+	} else {
+		rxm_rx_slab_repost(rx_slab);
+	}
+}
+
+/* Frees the slab, or leaves that to the last message still pointing into it */
+void rxm_rx_slab_discard(struct rxm_rx_slab *rx_slab)
+{
+	dlist_remove_init(&rx_slab->entry);
+	if (rx_slab->ref) {
+		rx_slab->retired = 1;
+		rx_slab->replaced = 1;
+	} else {
+		ofi_buf_free(rx_slab);
+	}
+}
+
+/*
+ * Providers differ in which completion of a multi-receive buffer carries
+ * the buffer address and FI_MULTI_RECV, so the slab tracks where messages
+ * are placed itself, and releases the slab by the same rule the provider
+ * uses.  Each message is handed on in place, through an rx buffer that
+ * points into the slab.
+ */
+static ssize_t rxm_handle_slab_comp(struct rxm_ep *rxm_ep,
+				    struct fi_cq_data_entry *comp)
+{
+	struct rxm_rx_slab *rx_slab = comp->op_context;
+	struct rxm_rx_buf *rx_buf;
+	ssize_t ret;
+	char *msg;
+	int full;
+
+	msg = comp->buf ? comp->buf : rx_slab->cur;
+	rx_slab->cur = msg + comp->len;
+	assert(comp->len <= rxm_rx_slab_min());
+	assert(rx_slab->cur <= rx_slab->data + rxm_ep->rx_slab_size);
+	full = (size_t) (rx_slab->data + rxm_ep->rx_slab_size -
+			 rx_slab->cur) < rxm_rx_slab_min();
+
+	rx_buf = rxm_rx_slab_buf_alloc(rx_slab);
+	if (OFI_UNLIKELY(!rx_buf)) {
+		if (full)
+			rxm_rx_slab_release(rx_slab);
+		return -FI_ENOMEM;
+	}
+
+	rx_buf->slab = rx_slab;
+	rx_buf->pkt = (struct rxm_pkt *) msg;
+	rx_buf->pkt_len = comp->len;
+	rx_slab->ref++;
+
+	ret = rxm_handle_rx_pkt(rxm_ep, rx_buf);
+
+	/* Checked once the message was handled, so a slab that nothing
+	 * points into anymore is reposted right away */
+	if (full)
+		rxm_rx_slab_release(rx_slab);
+	return ret;
+}
+
 static ssize_t rxm_cq_handle_comp(struct rxm_ep *rxm_ep,
 				  struct fi_cq_data_entry *comp)
 {
@@ -1113,12 +1562,14 @@ static ssize_t rxm_cq_handle_comp(struct rxm_ep *rxm_ep,
 	case RXM_TX:
 		tx_eager_buf = comp->op_context;
 		assert(comp->flags & FI_SEND);
+		tx_eager_buf->conn->tx_cnt--;
 		ret = rxm_finish_eager_send(rxm_ep, tx_eager_buf);
 		ofi_buf_free(tx_eager_buf);
 		return ret;
 	case RXM_SAR_TX:
 		tx_sar_buf = comp->op_context;
 		assert(comp->flags & FI_SEND);
+		tx_sar_buf->conn->tx_cnt--;
 		return rxm_finish_sar_segment_send(rxm_ep, tx_sar_buf);
 	case RXM_RMA:
 		rma_buf = comp->op_context;
@@ -1128,26 +1579,11 @@ static ssize_t rxm_cq_handle_comp(struct rxm_ep *rxm_ep,
 	case RXM_RX:
 		rx_buf = comp->op_context;
 		assert(!(comp->flags & FI_REMOTE_READ));
-		assert((rx_buf->pkt.hdr.version == OFI_OP_VERSION) &&
-		       (rx_buf->pkt.ctrl_hdr.version == RXM_CTRL_VERSION));
-
-		switch (rx_buf->pkt.ctrl_hdr.type) {
-		case rxm_ctrl_eager:
-		case rxm_ctrl_rndv:
-			return rxm_handle_recv_comp(rx_buf);
-		case rxm_ctrl_rndv_ack:
-			return rxm_rndv_handle_ack(rxm_ep, rx_buf);
-		case rxm_ctrl_seg:
-			return rxm_sar_handle_segment(rx_buf);
-		case rxm_ctrl_atomic:
-			return rxm_handle_atomic_req(rxm_ep, rx_buf);
-		case rxm_ctrl_atomic_resp:
-			return rxm_handle_atomic_resp(rxm_ep, rx_buf);
-		default:
-			FI_WARN(&rxm_prov, FI_LOG_CQ, "Unknown message type\n");
-			assert(0);
-			return -FI_EINVAL;
-		}
+		rxm_rx_buf_unpost(rx_buf);
+		return rxm_handle_rx_pkt(rxm_ep, rx_buf);
+	case RXM_RX_SLAB:
+		assert(!(comp->flags & FI_REMOTE_READ));
+		return rxm_handle_slab_comp(rxm_ep, comp);
 	case RXM_RNDV_TX:
 		tx_rndv_buf = comp->op_context;
 		assert(comp->flags & FI_SEND);
@@ -1170,13 +1606,18 @@ static ssize_t rxm_cq_handle_comp(struct rxm_ep *rxm_ep,
 	case RXM_ATOMIC_RESP_SENT:
 		tx_atomic_buf = comp->op_context;
 		assert(comp->flags & FI_SEND);
-		ofi_buf_free(tx_atomic_buf);
+		rxm_atomic_resp_buf_free(rxm_ep, tx_atomic_buf);
 		return 0;
 	case RXM_ATOMIC_RESP_WAIT:
 		/* Optional atomic request completion; TX completion
 		 * processing is performed when atomic response is received */
 		assert(comp->flags & FI_SEND);
 		return 0;
+	case RXM_COALESCED_TX:
+		tx_eager_buf = comp->op_context;
+		assert(comp->flags & FI_SEND);
+		tx_eager_buf->conn->tx_cnt--;
+		return rxm_finish_coalesced_send(rxm_ep, tx_eager_buf, 0);
 	default:
 		FI_WARN(&rxm_prov, FI_LOG_CQ, "Invalid state!\n");
 		assert(0);
@@ -1239,7 +1680,8 @@ static void rxm_cq_write_error_all(struct rxm_ep *rxm_ep, int err)
 #define RXM_IS_PROTO_STATE_TX(state)	\
 	((state == RXM_SAR_TX) ||	\
 	 (state == RXM_TX) ||		\
-	 (state == RXM_RNDV_TX))
+	 (state == RXM_RNDV_TX) ||	\
+	 (state == RXM_COALESCED_TX))
 
 static void rxm_cq_read_write_error(struct rxm_ep *rxm_ep)
 {
@@ -1277,20 +1719,34 @@ static void rxm_cq_read_write_error(struct rxm_ep *rxm_ep)
 	switch (state) {
 	case RXM_SAR_TX:
 		sar_buf = err_entry.op_context;
+		sar_buf->conn->tx_cnt--;
 		err_entry.op_context = sar_buf->app_context;
 		err_entry.flags = ofi_tx_cq_flags(sar_buf->pkt.hdr.op);
 		break;
 	case RXM_TX:
 		eager_buf = err_entry.op_context;
+		eager_buf->conn->tx_cnt--;
 		err_entry.op_context = eager_buf->app_context;
 		err_entry.flags = ofi_tx_cq_flags(eager_buf->pkt.hdr.op);
 		break;
 	case RXM_RNDV_TX:
 		rndv_buf = err_entry.op_context;
+		rndv_buf->conn->peer_wait--;
 		err_entry.op_context = rndv_buf->app_context;
 		err_entry.flags = ofi_tx_cq_flags(rndv_buf->pkt.hdr.op);
 		break;
+	case RXM_COALESCED_TX:
+		eager_buf = err_entry.op_context;
+		eager_buf->conn->tx_cnt--;
+		rxm_finish_coalesced_send(rxm_ep, eager_buf, -err_entry.err);
+		return;
+	case RXM_ATOMIC_RESP_SENT:
+		/* The peer's request fails without a response, there's
+		 * nothing to report it against here */
+		rxm_atomic_resp_buf_free(rxm_ep, err_entry.op_context);
+		return;
 	case RXM_RX:
+		rxm_rx_buf_unpost(err_entry.op_context);
 		/* Silently drop any MSG CQ error entries for canceled receive
 		 * operations as these are internal to RxM. This situation can
 		 * happen when the MSG EP receives a reject / shutdown and CM
@@ -1301,6 +1757,28 @@ static void rxm_cq_read_write_error(struct rxm_ep *rxm_ep)
 			return;
 		}
 		/* fall through */
+	case RXM_RX_SLAB:
+		if (err_entry.err == FI_ECANCELED) {
+			if (state == RXM_RX_SLAB)
+				rxm_rx_slab_discard(err_entry.op_context);
+			else
+				ofi_buf_free(err_entry.op_context);
+			return;
+		}
+		/* The buffer is back from the MSG provider, so it's put
+		 * back to use before the error is reported */
+		if (state == RXM_RX_SLAB)
+			rxm_rx_slab_release(err_entry.op_context);
+		else
+			rxm_rx_buf_finish(err_entry.op_context);
+
+		/* The message was never seen, so there's no receive to
+		 * report the error against */
+		util_cq = rxm_ep->util_ep.rx_cq;
+		util_cntr = rxm_ep->util_ep.rx_cntr;
+		err_entry.op_context = NULL;
+		err_entry.flags = FI_RECV;
+		break;
 	case RXM_RNDV_ACK_SENT:
 		/* fall through */
 	case RXM_RNDV_READ:
@@ -1337,11 +1815,15 @@ static inline int rxm_msg_ep_recv(struct rxm_rx_buf *rx_buf)
 		rx_buf->conn = NULL;
 	rx_buf->hdr.state = RXM_RX;
 
-	ret = (int)fi_recv(rx_buf->msg_ep, &rx_buf->pkt,
+	ret = (int)fi_recv(rx_buf->msg_ep, rx_buf->pkt,
 			   rxm_eager_limit + sizeof(struct rxm_pkt),
 			   rx_buf->hdr.desc, FI_ADDR_UNSPEC, rx_buf);
-	if (OFI_LIKELY(!ret))
+	if (OFI_LIKELY(!ret)) {
+		if (!rx_buf->ep->srx_ctx)
+			dlist_insert_tail(&rx_buf->repost_entry,
+					  &rx_buf->conn->posted_rx_list);
 		return 0;
+	}
 
 	if (ret != -FI_EAGAIN) {
 		int level = FI_LOG_WARN;
@@ -1353,12 +1835,45 @@ static inline int rxm_msg_ep_recv(struct rxm_rx_buf *rx_buf)
 	return ret;
 }
 
+/*
+ * Slabs are only used if the MSG provider lets the minimum space left in
+ * a multi-receive buffer be set, which is taken to mean it supports them.
+ */
+static int rxm_msg_ep_prepost_slabs(struct rxm_ep *rxm_ep,
+				    struct fid_ep *msg_ep)
+{
+	size_t min = rxm_rx_slab_min();
+	int ret;
+	size_t i;
+
+	ret = fi_setopt(&msg_ep->fid, FI_OPT_ENDPOINT, FI_OPT_MIN_MULTI_RECV,
+			&min, sizeof(min));
+	if (ret) {
+		FI_INFO(&rxm_prov, FI_LOG_EP_CTRL, "MSG provider doesn't "
+			"support multi-receive buffers, not using slabs\n");
+		return -FI_ENOSYS;
+	}
+
+	for (i = 0; i < RXM_RX_SLAB_CNT; i++) {
+		ret = rxm_msg_ep_post_slab(rxm_ep, msg_ep);
+		if (OFI_UNLIKELY(ret))
+			return ret;
+	}
+	return 0;
+}
+
 int rxm_msg_ep_prepost_recv(struct rxm_ep *rxm_ep, struct fid_ep *msg_ep)
 {
 	struct rxm_rx_buf *rx_buf;
 	int ret;
 	size_t i;
 
+	if (rxm_ep->rx_slab_size) {
+		ret = rxm_msg_ep_prepost_slabs(rxm_ep, msg_ep);
+		if (ret != -FI_ENOSYS)
+			return ret;
+	}
+
 	for (i = 0; i < rxm_ep->msg_info->rx_attr->size; i++) {
 		rx_buf = rxm_rx_buf_alloc(rxm_ep, msg_ep, 1);
 		if (OFI_UNLIKELY(!rx_buf))
@@ -1373,23 +1888,17 @@ int rxm_msg_ep_prepost_recv(struct rxm_ep *rxm_ep, struct fid_ep *msg_ep)
 	return 0;
 }
 
-void rxm_ep_do_progress(struct util_ep *util_ep)
+static void rxm_ep_repost_rx_bufs(struct rxm_ep *rxm_ep)
 {
-	struct rxm_ep *rxm_ep = container_of(util_ep, struct rxm_ep, util_ep);
-	struct fi_cq_data_entry comp;
-	struct dlist_entry *conn_entry_tmp;
-	struct rxm_conn *rxm_conn;
 	struct rxm_rx_buf *buf;
-	ssize_t ret;
-	size_t comp_read = 0;
-	uint64_t timestamp;
+	int ret;
 
 	while (!dlist_empty(&rxm_ep->repost_ready_list)) {
 		dlist_pop_front(&rxm_ep->repost_ready_list, struct rxm_rx_buf,
 				buf, repost_entry);
 
 		/* Discard rx buffer if its msg_ep was closed */
-		if (!rxm_ep->srx_ctx && !buf->conn->msg_ep) {
+		if (!rxm_ep->srx_ctx && buf->msg_ep != buf->conn->msg_ep) {
 			ofi_buf_free(&buf->hdr);
 			continue;
 		}
@@ -1400,33 +1909,179 @@ void rxm_ep_do_progress(struct util_ep *util_ep)
 				ofi_buf_free(&buf->hdr);
 		}
 	}
+}
 
-	do {
+/*
+ * Runs queued atomic requests while response credits last.  A request
+ * that finds no response buffer hasn't been run yet, and stays at the
+ * head of the queue for the next progress call.
+ */
+static void rxm_ep_progress_atomic_queue(struct rxm_ep *rxm_ep)
+{
+	struct rxm_rx_buf *rx_buf;
+	struct rxm_conn *rxm_conn;
+	ssize_t ret;
+
+	while (!dlist_empty(&rxm_ep->atomic_req_queue) &&
+	       rxm_ep->atomic_resp_credits) {
+		dlist_pop_front(&rxm_ep->atomic_req_queue, struct rxm_rx_buf,
+				rx_buf, repost_entry);
+		rxm_conn = rx_buf->conn;
+
+		ret = rxm_exec_atomic_req(rxm_ep, rx_buf);
+		if (ret == -FI_EAGAIN) {
+			dlist_insert_head(&rx_buf->repost_entry,
+					  &rxm_ep->atomic_req_queue);
+			break;
+		}
+		rxm_conn->atomic_req_cnt--;
+		if (OFI_UNLIKELY(ret))
+			rxm_cq_write_error_all(rxm_ep, (int) ret);
+	}
+}
+
+/*
+ * Atomic requests read from the MSG CQ are queued ahead of the rest of
+ * the batch, unless a message from the same peer was received before
+ * them, as they must not pass it.  Returns a mask of the handled entries.
+ */
+static uint32_t rxm_ep_handle_atomic_comps(struct rxm_ep *rxm_ep,
+					   struct fi_cq_data_entry *comp,
+					   ssize_t count)
+{
+	uint64_t held[RXM_MSG_CQ_BATCH];
+	struct rxm_rx_buf *rx_buf;
+	size_t held_cnt = 0, j;
+	uint32_t handled = 0;
+	uint64_t key;
+	ssize_t i, ret;
+
+	for (i = 0; i < count; i++) {
+		if (comp[i].flags & FI_REMOTE_WRITE)
+			continue;
+
+		rx_buf = NULL;
+		switch (RXM_GET_PROTO_STATE(comp[i].op_context)) {
+		case RXM_RX:
+			rx_buf = comp[i].op_context;
+			key = rx_buf->pkt->ctrl_hdr.conn_id;
+			break;
+		case RXM_RX_SLAB:
+			key = ((struct rxm_rx_slab *) comp[i].op_context)->
+				conn->handle.key;
+			break;
+		default:
+			continue;
+		}
+
+		for (j = 0; j < held_cnt && held[j] != key; j++)
+			;
+		if (j < held_cnt)
+			continue;
+
+		if (rx_buf && rx_buf->pkt->ctrl_hdr.type == rxm_ctrl_atomic) {
+			ret = rxm_cq_handle_comp(rxm_ep, &comp[i]);
+			if (OFI_UNLIKELY(ret))
+				rxm_cq_write_error_all(rxm_ep, (int) ret);
+			handled |= 1U << i;
+		} else {
+			held[held_cnt++] = key;
+		}
+	}
+
+	rxm_ep_progress_atomic_queue(rxm_ep);
+	return handled;
+}
+
+/* Reads and handles up to count MSG CQ completions, returns fi_cq_read's
+ * result */
+static ssize_t rxm_ep_read_msg_cq(struct rxm_ep *rxm_ep, size_t count)
+{
+	struct fi_cq_data_entry comp[RXM_MSG_CQ_BATCH];
+	uint32_t handled = 0;
+	ssize_t ret, i;
+	int err;
+
+	ret = fi_cq_read(rxm_ep->msg_cq, comp, MIN(count, RXM_MSG_CQ_BATCH));
+	if (ret > 0) {
+		if (OFI_UNLIKELY(rxm_ep->atomic_queue_size))
+			handled = rxm_ep_handle_atomic_comps(rxm_ep, comp, ret);
+		for (i = 0; i < ret; i++) {
+			if (i + 1 < ret)
+				OFI_PREFETCH(comp[i + 1].op_context);
+			if (OFI_UNLIKELY(handled & (1U << i)))
+				continue;
 
-		ret = fi_cq_read(rxm_ep->msg_cq, &comp, 1);
-		if (ret > 0) {
 			// We don't have enough info to write a good
 			// error entry to the CQ at this point
-			ret = rxm_cq_handle_comp(rxm_ep, &comp);
-			if (OFI_UNLIKELY(ret)) {
-				rxm_cq_write_error_all(rxm_ep, ret);
-			} else {
-				ret = 1;
-			}
-		} else if (ret < 0 && (ret != -FI_EAGAIN)) {
-			if (ret == -FI_EAVAIL)
-				rxm_cq_read_write_error(rxm_ep);
-			else
-				rxm_cq_write_error_all(rxm_ep, ret);
-		} else {
+			err = rxm_cq_handle_comp(rxm_ep, &comp[i]);
+			if (OFI_UNLIKELY(err))
+				rxm_cq_write_error_all(rxm_ep, err);
+		}
+
+		/* run requests held back behind earlier messages */
+		if (OFI_UNLIKELY(!dlist_empty(&rxm_ep->atomic_req_queue)))
+			rxm_ep_progress_atomic_queue(rxm_ep);
+
+		/* keep the MSG EPs stocked while draining */
+		if (!dlist_empty(&rxm_ep->repost_ready_list))
+			rxm_ep_repost_rx_bufs(rxm_ep);
+	} else if (ret < 0 && (ret != -FI_EAGAIN)) {
+		if (ret == -FI_EAVAIL)
+			rxm_cq_read_write_error(rxm_ep);
+		else
+			rxm_cq_write_error_all(rxm_ep, ret);
+	}
+	return ret;
+}
+
+/*
+ * Handles everything in the MSG CQ, so that no completion read later can
+ * refer to the buffers of a MSG EP that was just closed.
+ */
+void rxm_ep_drain_msg_cq(struct rxm_ep *rxm_ep)
+{
+	ssize_t ret;
+
+	do {
+		ret = rxm_ep_read_msg_cq(rxm_ep, RXM_MSG_CQ_BATCH);
+	} while (ret > 0 || ret == -FI_EAVAIL);
+}
+
+void rxm_ep_do_progress(struct util_ep *util_ep)
+{
+	struct rxm_ep *rxm_ep = container_of(util_ep, struct rxm_ep, util_ep);
+	struct dlist_entry *conn_entry_tmp;
+	struct rxm_conn *rxm_conn;
+	ssize_t ret;
+	size_t comp_read = 0;
+	uint64_t timestamp;
+
+	rxm_ep_repost_rx_bufs(rxm_ep);
+
+	if (OFI_UNLIKELY(!dlist_empty(&rxm_ep->atomic_req_queue)))
+		rxm_ep_progress_atomic_queue(rxm_ep);
+
+	do {
+		ret = rxm_ep_read_msg_cq(rxm_ep, rxm_ep->comp_per_progress -
+						 comp_read);
+		if (ret > 0) {
+			comp_read += ret;
+		} else if (!ret || ret == -FI_EAGAIN) {
 			timestamp = fi_gettime_us();
 			if (timestamp - rxm_ep->msg_cq_last_poll >
 				rxm_cm_progress_interval) {
 				rxm_ep->msg_cq_last_poll = timestamp;
 				rxm_msg_eq_progress(rxm_ep);
+				if (rxm_ep->max_conn ||
+				    !dlist_empty(&rxm_ep->conn_close_list))
+					rxm_conn_reap(rxm_ep);
 			}
 		}
-	} while ((ret > 0) && (++comp_read < rxm_ep->comp_per_progress));
+	} while ((ret > 0) && (comp_read < rxm_ep->comp_per_progress));
+
+	if (OFI_UNLIKELY(!dlist_empty(&rxm_ep->coalesce_conn_list)))
+		rxm_ep_progress_coalesced(rxm_ep, 0);
 
 	if (OFI_UNLIKELY(!dlist_empty(&rxm_ep->deferred_tx_conn_queue))) {
 		dlist_foreach_container_safe(&rxm_ep->deferred_tx_conn_queue,
@@ -1443,6 +2098,12 @@ void rxm_ep_progress(struct util_ep *util_ep)
 	ofi_ep_lock_release(util_ep);
 }
 
+void rxm_ep_progress_coll(struct util_ep *util_ep)
+{
+	rxm_ep_progress(util_ep);
+	ofi_coll_ep_progress(&util_ep->ep_fid);
+}
+
 static int rxm_cq_close(struct fid *fid)
 {
 	struct util_cq *util_cq;
@@ -153,6 +153,7 @@ static void rxm_buf_init(struct ofi_bufpool_region *region, void *buf)
 	struct rxm_tx_rndv_buf *tx_rndv_buf;
 	struct rxm_tx_atomic_buf *tx_atomic_buf;
 	struct rxm_rma_buf *rma_buf;
+	struct rxm_rx_slab *rx_slab;
 	void *mr_desc;
 	uint8_t type;
 
@@ -166,6 +167,7 @@ static void rxm_buf_init(struct ofi_bufpool_region *region, void *buf)
 	case RXM_BUF_POOL_RX:
 		rx_buf = buf;
 		rx_buf->ep = pool->rxm_ep;
+		rx_buf->pkt = &rx_buf->pkt_data;
 
 		rx_buf->hdr.desc = mr_desc;
 		pkt = NULL;
@@ -225,6 +227,14 @@ static void rxm_buf_init(struct ofi_bufpool_region *region, void *buf)
 		pkt = &rma_buf->pkt;
 		type = rxm_ctrl_eager;
 		break;
+	case RXM_BUF_POOL_RX_SLAB:
+		rx_slab = buf;
+		rx_slab->ep = pool->rxm_ep;
+		rx_slab->hdr.state = RXM_RX_SLAB;
+
+		rx_slab->hdr.desc = mr_desc;
+		pkt = NULL;
+		break;
 	default:
 		assert(0);
 		pkt = NULL;
@@ -358,6 +368,7 @@ static int rxm_ep_txrx_pool_create(struct rxm_ep *rxm_ep)
 		[RXM_BUF_POOL_TX_ATOMIC] = rxm_ep->msg_info->tx_attr->size,
 		[RXM_BUF_POOL_TX_SAR] = rxm_ep->msg_info->tx_attr->size,
 		[RXM_BUF_POOL_RMA] = rxm_ep->msg_info->tx_attr->size,
+		[RXM_BUF_POOL_RX_SLAB] = RXM_RX_SLAB_CNT,
 	};
 	size_t entry_sizes[] = {		
 		[RXM_BUF_POOL_RX] = rxm_eager_limit +
@@ -376,6 +387,8 @@ static int rxm_ep_txrx_pool_create(struct rxm_ep *rxm_ep)
 					sizeof(struct rxm_tx_sar_buf),
 		[RXM_BUF_POOL_RMA] = rxm_eager_limit +
 				     sizeof(struct rxm_rma_buf),
+		[RXM_BUF_POOL_RX_SLAB] = rxm_ep->rx_slab_size +
+					 sizeof(struct rxm_rx_slab),
 	};
 
 	dlist_init(&rxm_ep->repost_ready_list);
@@ -388,10 +401,13 @@ static int rxm_ep_txrx_pool_create(struct rxm_ep *rxm_ep)
 		if ((i == RXM_BUF_POOL_TX_INJECT) &&
 		    (rxm_ep->util_ep.domain->threading != FI_THREAD_SAFE))
 			continue;
+		if ((i == RXM_BUF_POOL_RX_SLAB) && !rxm_ep->rx_slab_size)
+			continue;
 
 		ret = rxm_buf_pool_create(rxm_ep, entry_sizes[i],
 					  (i == RXM_BUF_POOL_RX ||
-					   i == RXM_BUF_POOL_TX_ATOMIC) ? 0 :
+					   i == RXM_BUF_POOL_TX_ATOMIC ||
+					   i == RXM_BUF_POOL_RX_SLAB) ? 0 :
 					  rxm_ep->rxm_info->tx_attr->size,
 					  queue_sizes[i],
 					  &rxm_ep->buf_pools[i], i);
@@ -469,6 +485,22 @@ static int rxm_getname(fid_t fid, void *addr, size_t *addrlen)
 	return fi_getname(&rxm_ep->msg_pep->fid, addr, addrlen);
 }
 
+static int rxm_ep_join(struct fid_ep *ep_fid, const void *addr, uint64_t flags,
+		       struct fid_mc **mc, void *context)
+{
+	struct rxm_ep *rxm_ep;
+	const struct fi_collective_addr *coll_addr = addr;
+
+	rxm_ep = container_of(ep_fid, struct rxm_ep, util_ep.ep_fid);
+	if (!(flags & FI_COLLECTIVE) ||
+	    !(rxm_ep->rxm_info->caps & FI_COLLECTIVE))
+		return -FI_ENOSYS;
+
+	return ofi_join_collective(&rxm_ep->util_ep.ep_fid,
+				   coll_addr->coll_addr, coll_addr->set,
+				   flags, mc, context);
+}
+
 static struct fi_ops_cm rxm_ops_cm = {
 	.size = sizeof(struct fi_ops_cm),
 	.setname = rxm_setname,
@@ -479,7 +511,7 @@ static struct fi_ops_cm rxm_ops_cm = {
 	.accept = fi_no_accept,
 	.reject = fi_no_reject,
 	.shutdown = fi_no_shutdown,
-	.join = fi_no_join,
+	.join = rxm_ep_join,
 };
 
 static int rxm_ep_cancel_recv(struct rxm_ep *rxm_ep,
@@ -638,7 +670,7 @@ static int rxm_ep_discard_recv(struct rxm_ep *rxm_ep, struct rxm_rx_buf *rx_buf,
 	dlist_insert_tail(&rx_buf->repost_entry,
 			  &rx_buf->ep->repost_ready_list);
 	return ofi_cq_write(rxm_ep->util_ep.rx_cq, context, FI_TAGGED | FI_RECV,
-			    0, NULL, rx_buf->pkt.hdr.data, rx_buf->pkt.hdr.tag);
+			    0, NULL, rx_buf->pkt->hdr.data, rx_buf->pkt->hdr.tag);
 }
 
 static int rxm_ep_peek_recv(struct rxm_ep *rxm_ep, fi_addr_t addr, uint64_t tag,
@@ -672,8 +704,8 @@ static int rxm_ep_peek_recv(struct rxm_ep *rxm_ep, fi_addr_t addr, uint64_t tag,
 	}
 
 	return ofi_cq_write(rxm_ep->util_ep.rx_cq, context, FI_TAGGED | FI_RECV,
-			    rx_buf->pkt.hdr.size, NULL,
-			    rx_buf->pkt.hdr.data, rx_buf->pkt.hdr.tag);
+			    rx_buf->pkt->hdr.size, NULL,
+			    rx_buf->pkt->hdr.data, rx_buf->pkt->hdr.tag);
 }
 
 static inline ssize_t
@@ -930,6 +962,138 @@ rxm_ep_msg_normal_send(struct rxm_conn *rxm_conn, struct rxm_pkt *tx_pkt,
 	return fi_send(rxm_conn->msg_ep, tx_pkt, pkt_size, desc, 0, context);
 }
 
+ssize_t rxm_ep_send_coalesced(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn)
+{
+	struct rxm_tx_eager_buf *tx_buf = rxm_conn->coalesce_buf;
+	ssize_t ret;
+
+	if (OFI_UNLIKELY(!rxm_conn->msg_ep))
+		ret = -FI_ENOTCONN;
+	else
+		ret = rxm_ep_msg_normal_send(rxm_conn, &tx_buf->pkt,
+					     sizeof(struct rxm_pkt) +
+					     tx_buf->pkt.hdr.size,
+					     tx_buf->hdr.desc, tx_buf);
+	if (OFI_UNLIKELY(ret)) {
+		if (ret == -FI_EAGAIN)
+			return ret;
+		FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+			"unable to send coalesced packet: %zd\n", ret);
+		rxm_finish_coalesced_send(rxm_ep, tx_buf, (int) ret);
+	} else {
+		rxm_conn->tx_cnt++;
+	}
+
+	rxm_conn->coalesce_buf = NULL;
+	dlist_remove(&rxm_conn->coalesce_entry);
+	return ret;
+}
+
+/*
+ * Returns -FI_EAGAIN if any coalesced packets are left unsent.  Packets
+ * are queued in the order they were started, so only the head of the
+ * list needs to be checked against the time budget.
+ */
+int rxm_ep_progress_coalesced(struct rxm_ep *rxm_ep, int force)
+{
+	struct rxm_conn *rxm_conn;
+	uint64_t now = fi_gettime_us();
+
+	while (!dlist_empty(&rxm_ep->coalesce_conn_list)) {
+		rxm_conn = container_of(rxm_ep->coalesce_conn_list.next,
+					struct rxm_conn, coalesce_entry);
+		if (!force && (now - rxm_conn->coalesce_start <
+			       (uint64_t) rxm_ep->coalesce_usec))
+			return -FI_EAGAIN;
+		if (rxm_ep_send_coalesced(rxm_ep, rxm_conn) == -FI_EAGAIN)
+			return -FI_EAGAIN;
+	}
+	return 0;
+}
+
+static inline int
+rxm_ep_can_coalesce(struct rxm_ep *rxm_ep, size_t data_len, uint64_t flags)
+{
+	return rxm_ep->coalesce_size && (data_len <= rxm_ep->coalesce_size) &&
+	       !(flags & (FI_TRANSMIT_COMPLETE | FI_DELIVERY_COMPLETE |
+			  FI_COLLECTIVE));
+}
+
+/*
+ * Copies the message into the connection's coalesced packet.  Its
+ * completion is held with the packet and written once the packet's send
+ * completes, or as an error if the send fails.  The packet goes out once
+ * it holds coalesce_size bytes, or once a message without FI_MORE finds
+ * it older than coalesce_usec.  Progress sends packets that run out of
+ * time.
+ */
+static ssize_t
+rxm_ep_coalesce_send(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
+		     const struct iovec *iov, size_t count, size_t data_len,
+		     void *context, uint64_t data, uint64_t flags, uint64_t tag,
+		     uint8_t op)
+{
+	struct rxm_tx_eager_buf *tx_buf = rxm_conn->coalesce_buf;
+	size_t msg_size = rxm_coalesced_msg_size(data_len);
+	struct rxm_coalesce_comp *comp;
+	struct ofi_op_hdr *hdr;
+	ssize_t ret;
+
+	if (tx_buf && !rxm_coalesce_fits(tx_buf, msg_size)) {
+		ret = rxm_ep_flush_coalesced(rxm_ep, rxm_conn);
+		if (ret)
+			return ret;
+		tx_buf = NULL;
+	}
+
+	if (!tx_buf) {
+		tx_buf = (struct rxm_tx_eager_buf *)
+			 rxm_tx_buf_alloc(rxm_ep, RXM_BUF_POOL_TX);
+		if (OFI_UNLIKELY(!tx_buf)) {
+			FI_WARN(&rxm_prov, FI_LOG_EP_DATA,
+				"Ran out of buffers from Eager buffer pool\n");
+			return -FI_EAGAIN;
+		}
+		tx_buf->hdr.state = RXM_COALESCED_TX;
+		tx_buf->app_context = NULL;
+		tx_buf->flags = 0;
+		tx_buf->conn = rxm_conn;
+		tx_buf->comp_cnt = 0;
+		rxm_ep_format_tx_buf_pkt(rxm_conn, 0, ofi_op_msg, 0, 0, 0,
+					 &tx_buf->pkt);
+		tx_buf->pkt.ctrl_hdr.type = rxm_ctrl_coalesced;
+
+		rxm_conn->coalesce_buf = tx_buf;
+		rxm_conn->coalesce_start = fi_gettime_us();
+		dlist_insert_tail(&rxm_conn->coalesce_entry,
+				  &rxm_ep->coalesce_conn_list);
+	}
+
+	comp = rxm_coalesce_comp(tx_buf, tx_buf->comp_cnt++);
+	comp->context = context;
+	comp->flags = flags;
+	comp->comp_flags = ofi_tx_cq_flags(op);
+
+	hdr = (struct ofi_op_hdr *) (tx_buf->pkt.data + tx_buf->pkt.hdr.size);
+	hdr->version = OFI_OP_VERSION;
+	hdr->op = op;
+	hdr->flags = (flags & FI_REMOTE_CQ_DATA);
+	hdr->size = data_len;
+	hdr->data = data;
+	hdr->tag = tag;
+	ofi_copy_from_iov(hdr + 1, data_len, iov, count, 0);
+	tx_buf->pkt.hdr.size += msg_size;
+
+	if ((tx_buf->pkt.hdr.size >= rxm_ep->coalesce_size) ||
+	    (!(flags & FI_MORE) && (fi_gettime_us() - rxm_conn->coalesce_start >=
+				    (uint64_t) rxm_ep->coalesce_usec))) {
+		/* The message has been accepted, progress retries the send */
+		if (rxm_ep_send_coalesced(rxm_ep, rxm_conn) == -FI_EAGAIN)
+			rxm_ep_do_progress(&rxm_ep->util_ep);
+	}
+	return 0;
+}
+
 static inline ssize_t
 rxm_ep_alloc_rndv_tx_res(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn, void *context,
 			uint8_t count, const struct iovec *iov, void **desc, size_t data_len,
@@ -952,6 +1116,9 @@ rxm_ep_alloc_rndv_tx_res(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn, void
 	tx_buf->app_context = context;
 	tx_buf->flags = flags;
 	tx_buf->count = count;
+	tx_buf->conn = rxm_conn;
+	if (rxm_ep->sar_adapt)
+		tx_buf->start = fi_gettime_us();
 
 	if (!rxm_ep->rxm_mr_local) {
 		ret = rxm_ep_msg_mr_regv(rxm_ep, iov, tx_buf->count,
@@ -1001,6 +1168,7 @@ rxm_ep_rndv_tx_send(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	}
 	if (OFI_UNLIKELY(ret))
 		goto err;
+	rxm_conn->peer_wait++;
 	return FI_SUCCESS;
 err:
 	FI_DBG(&rxm_prov, FI_LOG_EP_DATA,
@@ -1043,6 +1211,7 @@ rxm_ep_sar_tx_prepare_segment(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	tx_buf->pkt.ctrl_hdr.seg_no = seg_no;
 	tx_buf->app_context = app_context;
 	tx_buf->flags = flags;
+	tx_buf->conn = rxm_conn;
 	rxm_sar_set_seg_type(&tx_buf->pkt.ctrl_hdr, seg_type);
 
 	return tx_buf;
@@ -1061,6 +1230,38 @@ rxm_ep_sar_tx_cleanup(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	ofi_buf_free(tx_buf);
 }
 
+/*
+ * Rendezvous sends complete when the peer acks having read the data.  With
+ * FI_OFI_RXM_SAR_ADAPT the last SAR segment is sent with
+ * FI_TRANSMIT_COMPLETE, so that SAR sends are timed up to the same point.
+ */
+static inline ssize_t
+rxm_ep_sar_tx_send_segment(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
+			   struct rxm_tx_sar_buf *tx_buf)
+{
+	struct iovec iov = {
+		.iov_base = &tx_buf->pkt,
+		.iov_len = sizeof(struct rxm_pkt) + tx_buf->pkt.ctrl_hdr.seg_size,
+	};
+	struct fi_msg msg = {
+		.msg_iov = &iov,
+		.desc = &tx_buf->hdr.desc,
+		.iov_count = 1,
+		.context = tx_buf,
+	};
+	ssize_t ret;
+
+	if (!rxm_ep->sar_adapt ||
+	    rxm_sar_get_seg_type(&tx_buf->pkt.ctrl_hdr) != RXM_SAR_SEG_LAST)
+		ret = fi_send(rxm_conn->msg_ep, iov.iov_base, iov.iov_len,
+			      tx_buf->hdr.desc, 0, tx_buf);
+	else
+		ret = fi_sendmsg(rxm_conn->msg_ep, &msg, FI_TRANSMIT_COMPLETE);
+	if (!ret)
+		rxm_conn->tx_cnt++;
+	return ret;
+}
+
 static inline ssize_t
 rxm_ep_sar_tx_prepare_and_send_segment(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 				       void *app_context, size_t data_len, size_t remain_len,
@@ -1090,8 +1291,7 @@ rxm_ep_sar_tx_prepare_and_send_segment(struct rxm_ep *rxm_ep, struct rxm_conn *r
 
 	*out_tx_buf = tx_buf;
 
-	return fi_send(rxm_conn->msg_ep, &tx_buf->pkt, sizeof(struct rxm_pkt) +
-		       tx_buf->pkt.ctrl_hdr.seg_size, tx_buf->hdr.desc, 0, tx_buf);
+	return rxm_ep_sar_tx_send_segment(rxm_ep, rxm_conn, tx_buf);
 }
 
 static inline ssize_t
@@ -1114,12 +1314,14 @@ rxm_ep_sar_tx_send(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	if (OFI_UNLIKELY(!first_tx_buf))
 		return -FI_EAGAIN;
 
+	if (rxm_ep->sar_adapt)
+		first_tx_buf->start = fi_gettime_us();
+
 	ofi_copy_from_iov(first_tx_buf->pkt.data, rxm_eager_limit,
 			  iov, count, iov_offset);
 	iov_offset += rxm_eager_limit;
 
-	ret = fi_send(rxm_conn->msg_ep, &first_tx_buf->pkt, sizeof(struct rxm_pkt) +
-		      first_tx_buf->pkt.ctrl_hdr.seg_size, first_tx_buf->hdr.desc, 0, first_tx_buf);
+	ret = rxm_ep_sar_tx_send_segment(rxm_ep, rxm_conn, first_tx_buf);
 	if (OFI_UNLIKELY(ret)) {
 		if (OFI_LIKELY(ret == -FI_EAGAIN))
 			rxm_ep_do_progress(&rxm_ep->util_ep);
@@ -1192,6 +1394,7 @@ rxm_ep_emulate_inject(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	rxm_ep_format_tx_buf_pkt(rxm_conn, len, op, data, tag, flags, &tx_buf->pkt);
 	memcpy(tx_buf->pkt.data, buf, len);
 	tx_buf->flags = flags;
+	tx_buf->conn = rxm_conn;
 
 	ret = rxm_ep_msg_normal_send(rxm_conn, &tx_buf->pkt, pkt_size,
 				     tx_buf->hdr.desc, tx_buf);
@@ -1199,8 +1402,10 @@ rxm_ep_emulate_inject(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		if (OFI_LIKELY(ret == -FI_EAGAIN))
 			rxm_ep_do_progress(&rxm_ep->util_ep);
 		ofi_buf_free(tx_buf);
+		return ret;
 	}
-	return ret;
+	rxm_conn->tx_cnt++;
+	return 0;
 }
 
 static inline ssize_t
@@ -1212,6 +1417,23 @@ rxm_ep_inject_send_fast(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 
 	assert(len <= rxm_ep->rxm_info->tx_attr->inject_size);
 
+	if (rxm_ep_can_coalesce(rxm_ep, len, 0)) {
+		struct iovec iov = {
+			.iov_base = (void *) buf,
+			.iov_len = len,
+		};
+
+		return rxm_ep_coalesce_send(rxm_ep, rxm_conn, &iov, 1, len,
+					    NULL, inject_pkt->hdr.data,
+					    inject_pkt->hdr.flags,
+					    inject_pkt->hdr.tag,
+					    inject_pkt->hdr.op);
+	}
+
+	ret = rxm_ep_flush_coalesced(rxm_ep, rxm_conn);
+	if (OFI_UNLIKELY(ret))
+		return ret;
+
 	if (pkt_size <= rxm_ep->inject_limit) {
 		inject_pkt->hdr.size = len;
 		memcpy(inject_pkt->data, buf, len);
@@ -1235,6 +1457,21 @@ rxm_ep_inject_send(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 
 	assert(len <= rxm_ep->rxm_info->tx_attr->inject_size);
 
+	if (rxm_ep_can_coalesce(rxm_ep, len, flags)) {
+		struct iovec iov = {
+			.iov_base = (void *) buf,
+			.iov_len = len,
+		};
+
+		return rxm_ep_coalesce_send(rxm_ep, rxm_conn, &iov, 1, len,
+					    NULL, data, flags & ~FI_COMPLETION,
+					    tag, op);
+	}
+
+	ret = rxm_ep_flush_coalesced(rxm_ep, rxm_conn);
+	if (OFI_UNLIKELY(ret))
+		return ret;
+
 	if (pkt_size <= rxm_ep->inject_limit) {
 		struct rxm_tx_base_buf *tx_buf = (struct rxm_tx_base_buf *)
 			rxm_tx_buf_alloc(rxm_ep, RXM_BUF_POOL_TX_INJECT);
@@ -1260,6 +1497,35 @@ unlock:
 
 }
 
+/*
+ * With FI_OFI_RXM_SAR_ADAPT, every RXM_ADAPT_PROBE'th message that may go
+ * either way uses the protocol the connection's SAR limit doesn't pick,
+ * until both have been sampled enough in the message's size class.  From
+ * then on only the chosen protocol is sampled; if it gets slower than the
+ * other one was, the limit moves and the other one is sampled in turn.
+ */
+static inline int
+rxm_ep_use_sar(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
+	       size_t data_len)
+{
+	int sar;
+
+	/* SAR uses eager_limit as segment size */
+	if (data_len > rxm_ep->sar_limit ||
+	    (rxm_eager_limit >=
+	     (1ULL << (8 * sizeof_field(struct ofi_ctrl_hdr, seg_size)))))
+		return 0;
+
+	if (!rxm_ep->sar_adapt)
+		return 1;
+
+	sar = data_len <= rxm_conn->sar_limit;
+	if (!rxm_adapt_converged(&rxm_conn->adapt[rxm_adapt_class(data_len)]) &&
+	    !(++rxm_conn->adapt_sends % RXM_ADAPT_PROBE))
+		sar = !sar;
+	return sar;
+}
+
 static ssize_t
 rxm_ep_send_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		   const struct iovec *iov, void **desc, size_t count,
@@ -1275,6 +1541,15 @@ rxm_ep_send_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		(data_len > rxm_ep->rxm_info->tx_attr->inject_size)) ||
 	       (data_len <= rxm_ep->rxm_info->tx_attr->inject_size));
 
+	if (rxm_ep_can_coalesce(rxm_ep, data_len, flags))
+		return rxm_ep_coalesce_send(rxm_ep, rxm_conn, iov, count,
+					    data_len, context, data, flags,
+					    tag, op);
+
+	ret = rxm_ep_flush_coalesced(rxm_ep, rxm_conn);
+	if (OFI_UNLIKELY(ret))
+		return ret;
+
 	if (data_len <= rxm_eager_limit) {
 		struct rxm_tx_eager_buf *tx_buf = (struct rxm_tx_eager_buf *)
 			rxm_tx_buf_alloc(rxm_ep, RXM_BUF_POOL_TX);
@@ -1292,6 +1567,7 @@ rxm_ep_send_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 				  iov, count, 0);
 		tx_buf->app_context = context;
 		tx_buf->flags = flags;
+		tx_buf->conn = rxm_conn;
 
 		ret = rxm_ep_msg_normal_send(rxm_conn, &tx_buf->pkt, total_len,
 					     tx_buf->hdr.desc, tx_buf);
@@ -1299,11 +1575,10 @@ rxm_ep_send_common(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 			if (ret == -FI_EAGAIN)
 				rxm_ep_do_progress(&rxm_ep->util_ep);
 			ofi_buf_free(tx_buf);
+		} else {
+			rxm_conn->tx_cnt++;
 		}
-	} else if (data_len <= rxm_ep->sar_limit &&
-		   /* SAR uses eager_limit as segment size */
-		   (rxm_eager_limit <
-		    (1ULL << (8 * sizeof_field(struct ofi_ctrl_hdr, seg_size))))) {
+	} else if (rxm_ep_use_sar(rxm_ep, rxm_conn, data_len)) {
 		ret = rxm_ep_sar_tx_send(rxm_ep, rxm_conn, context,
 					 count, iov, data_len,
 					 rxm_ep_sar_calc_segs_cnt(rxm_ep, data_len),
@@ -1357,8 +1632,8 @@ rxm_ep_progress_sar_deferred_segments(struct rxm_deferred_tx_entry *def_tx_entry
 	struct rxm_tx_sar_buf *tx_buf = def_tx_entry->sar_seg.cur_seg_tx_buf;
 
 	if (tx_buf) {
-		ret = fi_send(def_tx_entry->rxm_conn->msg_ep, &tx_buf->pkt, sizeof(tx_buf->pkt) +
-			      tx_buf->pkt.ctrl_hdr.seg_size, tx_buf->hdr.desc, 0, tx_buf);
+		ret = rxm_ep_sar_tx_send_segment(def_tx_entry->rxm_ep,
+						 def_tx_entry->rxm_conn, tx_buf);
 		if (OFI_UNLIKELY(ret)) {
 			if (OFI_LIKELY(ret != -FI_EAGAIN)) {
 				rxm_ep_sar_handle_segment_failure(def_tx_entry, ret);
@@ -1435,9 +1710,9 @@ void rxm_ep_progress_deferred_queue(struct rxm_ep *rxm_ep,
 						   def_tx_entry->rndv_read.rx_buf->
 						   recv_entry->context, ret);
 			}
-			RXM_UPDATE_STATE(FI_LOG_EP_DATA,
-					 def_tx_entry->rndv_ack.rx_buf,
-					 RXM_RNDV_ACK_SENT);
+			RXM_UPDATE_RX_STATE(FI_LOG_EP_DATA,
+					    def_tx_entry->rndv_ack.rx_buf,
+					    RXM_RNDV_ACK_SENT);
 			rxm_ep_dequeue_deferred_tx_queue(def_tx_entry);
 			free(def_tx_entry);
 			break;
@@ -1919,6 +2194,16 @@ static struct fi_ops_tagged rxm_ops_tagged_thread_unsafe = {
 	.injectdata = rxm_ep_tinjectdata_fast,
 };
 
+static struct fi_ops_collective rxm_ops_collective = {
+	.size = sizeof(struct fi_ops_collective),
+	.barrier = ofi_ep_barrier,
+	.writeread = ofi_ep_writeread,
+	.writereadmsg = ofi_ep_writereadmsg,
+	.broadcast = ofi_ep_broadcast,
+	.scatter = ofi_ep_scatter,
+	.gather = ofi_ep_gather,
+};
+
 static int rxm_ep_msg_res_close(struct rxm_ep *rxm_ep)
 {
 	int ret, retv = 0;
@@ -1965,6 +2250,11 @@ static int rxm_ep_close(struct fid *fid)
 	struct rxm_ep *rxm_ep =
 		container_of(fid, struct rxm_ep, util_ep.ep_fid.fid);
 
+	/* Coalesced messages have been completed to the app already */
+	if (!dlist_empty(&rxm_ep->coalesce_conn_list))
+		rxm_ep_progress_coalesced(rxm_ep, 1);
+
+	rxm_conn_warmup_cleanup(rxm_ep);
 	if (rxm_ep->cmap)
 		rxm_cmap_free(rxm_ep->cmap);
 
@@ -2002,7 +2292,12 @@ static int rxm_ep_trywait_cq(void *arg)
 	rxm_fabric = container_of(rxm_ep->util_ep.domain->fabric,
 				  struct rxm_fabric, util_fabric);
 	ofi_ep_lock_acquire(&rxm_ep->util_ep);
-	ret = fi_trywait(rxm_fabric->msg_fabric, fids, 1);
+	/* Don't leave coalesced messages behind while the app sleeps */
+	if (!dlist_empty(&rxm_ep->coalesce_conn_list) &&
+	    rxm_ep_progress_coalesced(rxm_ep, 1))
+		ret = -FI_EAGAIN;
+	else
+		ret = fi_trywait(rxm_fabric->msg_fabric, fids, 1);
 	ofi_ep_lock_release(&rxm_ep->util_ep);
 	return ret;
 }
@@ -2182,6 +2477,34 @@ static void rxm_ep_settings_init(struct rxm_ep *rxm_ep)
 
 	rxm_ep_sar_init(rxm_ep);
 
+	/* A message that may be coalesced always fits in an empty packet,
+	 * along with its held completion */
+	rxm_ep->coalesce_size = MIN(rxm_ep->coalesce_size,
+				    (rxm_eager_limit & ~(size_t) 7) -
+				    sizeof(struct ofi_op_hdr) -
+				    sizeof(struct rxm_coalesce_comp));
+
+	/* Receive slabs need room for at least two full sized messages.
+	 * They can't be used with a shared receive context, as that isn't
+	 * tied to a single connection. */
+	if (rxm_ep->srx_ctx)
+		rxm_ep->rx_slab_size = 0;
+	else if (rxm_ep->rx_slab_size)
+		rxm_ep->rx_slab_size = MAX(rxm_ep->rx_slab_size,
+					   2 * (rxm_eager_limit +
+						sizeof(struct rxm_pkt)));
+
+	/* Peers are asked to close idle connections with injected packets */
+	if (rxm_ep->max_conn && rxm_ep->inject_limit < sizeof(struct rxm_pkt)) {
+		FI_WARN(&rxm_prov, FI_LOG_CORE, "MSG provider inject size "
+			"too small to close idle connections\n");
+		rxm_ep->max_conn = 0;
+	}
+
+	if (!(rxm_ep->rxm_info->caps & FI_ATOMIC))
+		rxm_ep->atomic_queue_size = 0;
+	rxm_ep->atomic_resp_credits = rxm_ep->atomic_queue_size;
+
  	FI_INFO(&rxm_prov, FI_LOG_CORE,
 		"Settings:\n"
 		"\t\t MR local: MSG - %d, RxM - %d\n"
@@ -2191,12 +2514,20 @@ static void rxm_ep_settings_init(struct rxm_ep *rxm_ep)
 	        "\t\t FI_EP_MSG provider inject size: %zu\n"
 	        "\t\t rxm inject size: %zu\n"
 		"\t\t Protocol limits: Eager: %zu, "
-				      "SAR: %zu\n",
+				      "SAR: %zu\n"
+		"\t\t Coalescing: size: %zu, time: %d usec\n"
+		"\t\t Receive slab size: %zu\n"
+		"\t\t Adaptive SAR limit: %d\n"
+		"\t\t Max connections: %zu\n"
+		"\t\t Atomic queue size: %zu\n",
 		rxm_ep->msg_mr_local, rxm_ep->rxm_mr_local,
 		rxm_ep->comp_per_progress, rxm_ep->buffered_min,
 		rxm_ep->min_multi_recv_size, rxm_ep->inject_limit,
 		rxm_ep->rxm_info->tx_attr->inject_size,
-		rxm_eager_limit, rxm_ep->sar_limit);
+		rxm_eager_limit, rxm_ep->sar_limit,
+		rxm_ep->coalesce_size, rxm_ep->coalesce_usec,
+		rxm_ep->rx_slab_size, rxm_ep->sar_adapt, rxm_ep->max_conn,
+		rxm_ep->atomic_queue_size);
 }
 
 static int rxm_ep_txrx_res_open(struct rxm_ep *rxm_ep)
@@ -2208,6 +2539,7 @@ static int rxm_ep_txrx_res_open(struct rxm_ep *rxm_ep)
 		return ret;
 
 	dlist_init(&rxm_ep->deferred_tx_conn_queue);
+	dlist_init(&rxm_ep->coalesce_conn_list);
 
 	ret = rxm_ep_rx_queue_init(rxm_ep);
 	if (ret)
@@ -2303,6 +2635,14 @@ static int rxm_ep_ctrl(struct fid *fid, int command, void *arg)
 			}
 		}
 		break;
+	case FI_CONNECT_PEERS:
+		if (!rxm_ep->cmap)
+			return -FI_EOPBADSTATE;
+
+		ofi_ep_lock_acquire(&rxm_ep->util_ep);
+		ret = rxm_conn_warmup(rxm_ep, arg);
+		ofi_ep_lock_release(&rxm_ep->util_ep);
+		return ret;
 	default:
 		return -FI_ENOSYS;
 	}
@@ -2421,8 +2761,25 @@ int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 			     (int *)&rxm_ep->comp_per_progress))
 		rxm_ep->comp_per_progress = 1;
 
+	fi_param_get_size_t(&rxm_prov, "coalesce_size",
+			    &rxm_ep->coalesce_size);
+	if (fi_param_get_int(&rxm_prov, "coalesce_usec",
+			     &rxm_ep->coalesce_usec) ||
+	    rxm_ep->coalesce_usec < 0)
+		rxm_ep->coalesce_usec = 10;
+	fi_param_get_size_t(&rxm_prov, "rx_slab_size", &rxm_ep->rx_slab_size);
+	fi_param_get_bool(&rxm_prov, "sar_adapt", &rxm_ep->sar_adapt);
+	fi_param_get_size_t(&rxm_prov, "max_conn", &rxm_ep->max_conn);
+	fi_param_get_size_t(&rxm_prov, "atomic_queue",
+			    &rxm_ep->atomic_queue_size);
+	dlist_init(&rxm_ep->warmup_list);
+	dlist_init(&rxm_ep->atomic_req_queue);
+	dlist_init(&rxm_ep->conn_lru_list);
+	dlist_init(&rxm_ep->conn_close_list);
+
 	ret = ofi_endpoint_init(domain, &rxm_util_prov, info, &rxm_ep->util_ep,
-				context, &rxm_ep_progress);
+				context, (info->caps & FI_COLLECTIVE) ?
+				&rxm_ep_progress_coll : &rxm_ep_progress);
 	if (ret)
 		goto err1;
 
@@ -2448,6 +2805,9 @@ int rxm_endpoint(struct fid_domain *domain, struct fi_info *info,
 	if (rxm_ep->rxm_info->caps & FI_ATOMIC)
 		(*ep_fid)->atomic = &rxm_ops_atomic;
 
+	if (rxm_ep->rxm_info->caps & FI_COLLECTIVE)
+		(*ep_fid)->collective = &rxm_ops_collective;
+
 	return 0;
 err2:
 	ofi_endpoint_close(&rxm_ep->util_ep);
@@ -100,7 +100,7 @@ int rxm_info_to_core(uint32_t version, const struct fi_info *hints,
 
 	if (hints) {
 		core_info->caps = hints->caps & RXM_PASSTHRU_CAPS;
-		if (hints->caps & (FI_ATOMIC | FI_TAGGED))
+		if (hints->caps & (FI_ATOMIC | FI_TAGGED | FI_COLLECTIVE))
 			core_info->caps |= FI_MSG | FI_SEND | FI_RECV;
 
 		/* FI_RMA cap is needed for large message transfer protocol */
@@ -220,15 +220,20 @@ static void rxm_alter_info(const struct fi_info *hints, struct fi_info *info)
 		 * may affect performance in fast-path */
 		if (!hints) {
 			cur->caps &= ~(FI_DIRECTED_RECV | FI_SOURCE |
-				       FI_ATOMIC);
-			cur->tx_attr->caps &= ~FI_ATOMIC;
-			cur->rx_attr->caps &= ~FI_ATOMIC;
+				       FI_ATOMIC | FI_COLLECTIVE);
+			cur->tx_attr->caps &= ~(FI_ATOMIC | FI_COLLECTIVE);
+			cur->rx_attr->caps &= ~(FI_ATOMIC | FI_COLLECTIVE);
 			cur->domain_attr->data_progress = FI_PROGRESS_MANUAL;
 		} else {
 			if (!(hints->caps & FI_DIRECTED_RECV))
 				cur->caps &= ~FI_DIRECTED_RECV;
 			if (!(hints->caps & FI_SOURCE))
 				cur->caps &= ~FI_SOURCE;
+			if (!(hints->caps & FI_COLLECTIVE)) {
+				cur->caps &= ~FI_COLLECTIVE;
+				cur->tx_attr->caps &= ~FI_COLLECTIVE;
+				cur->rx_attr->caps &= ~FI_COLLECTIVE;
+			}
 
 			if (hints->mode & FI_BUFFERED_RECV)
 				cur->mode |= FI_BUFFERED_RECV;
@@ -375,6 +380,43 @@ RXM_INI
 			"(default: 1) that would be read per progress "
 			"(RxM CQ read).");
 
+	fi_param_define(&rxm_prov, "coalesce_size", FI_PARAM_SIZE_T,
+			"Set this to pack eager messages sent to the same peer "
+			"into one MSG provider transfer (default: 0, disabled). "
+			"A packet is sent once it holds this many bytes. "
+			"Messages larger than this are sent on their own.");
+
+	fi_param_define(&rxm_prov, "coalesce_usec", FI_PARAM_INT,
+			"Defines how long (in microseconds) coalesced messages "
+			"may wait for more messages to the same peer before "
+			"they are sent (default: 10). A message posted with "
+			"FI_MORE never causes the packet to be sent early.");
+
+	fi_param_define(&rxm_prov, "rx_slab_size", FI_PARAM_SIZE_T,
+			"Set this to receive into multi-receive buffers of "
+			"this size posted to each MSG endpoint, instead of one "
+			"posted buffer per message (default: 0, disabled). "
+			"Only used if the MSG provider supports FI_MULTI_RECV "
+			"and shared receive contexts are not in use.");
+
+	fi_param_define(&rxm_prov, "max_conn", FI_PARAM_SIZE_T,
+			"Set this to close the least recently used idle "
+			"connections once an endpoint has more than this many "
+			"(default: 0, unlimited). Closed connections are set "
+			"up again when next used.");
+
+	fi_param_define(&rxm_prov, "atomic_queue", FI_PARAM_SIZE_T,
+			"Set this to queue incoming atomic requests and run "
+			"them ahead of other completions, with up to this many "
+			"responses outstanding (default: 0, run in completion "
+			"order).");
+
+	fi_param_define(&rxm_prov, "sar_adapt", FI_PARAM_BOOL,
+			"Move the size at which messages switch from SAR to "
+			"rendezvous per connection, between the eager limit "
+			"and FI_OFI_RXM_SAR_LIMIT, based on how fast messages "
+			"of each protocol reach the peer (default: no).");
+
 	fi_param_define(&rxm_prov, "sar_limit", FI_PARAM_SIZE_T,
 			"Set this environment variable to enable and control "
 			"RxM SAR (Segmentation And Reassembly) protocol "
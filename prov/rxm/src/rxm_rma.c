@@ -81,6 +81,10 @@ rxm_ep_rma_common(struct rxm_ep *rxm_ep, const struct fi_msg_rma *msg, uint64_t
 	if (OFI_UNLIKELY(ret))
 		goto unlock;
 
+	ret = rxm_ep_flush_coalesced(rxm_ep, rxm_conn);
+	if (OFI_UNLIKELY(ret))
+		goto unlock;
+
 	rma_buf = rxm_rma_buf_alloc(rxm_ep);
 	if (OFI_UNLIKELY(!rma_buf)) {
 		ret = -FI_EAGAIN;
@@ -89,6 +93,7 @@ rxm_ep_rma_common(struct rxm_ep *rxm_ep, const struct fi_msg_rma *msg, uint64_t
 
 	rma_buf->app_context = msg->context;
 	rma_buf->flags = flags;
+	rma_buf->conn = rxm_conn;
 
 	ret = rxm_ep_rma_reg_iov(rxm_ep, msg_rma.msg_iov, msg_rma.desc, mr_desc,
 				 msg_rma.iov_count, comp_flags & (FI_WRITE | FI_READ),
@@ -100,8 +105,10 @@ rxm_ep_rma_common(struct rxm_ep *rxm_ep, const struct fi_msg_rma *msg, uint64_t
 	msg_rma.context = rma_buf;
 
 	ret = rma_msg(rxm_conn->msg_ep, &msg_rma, flags);
-	if (OFI_LIKELY(!ret))
+	if (OFI_LIKELY(!ret)) {
+		rxm_conn->peer_wait++;
 		goto unlock;
+	}
 
 	if ((rxm_ep->msg_mr_local) && (!rxm_ep->rxm_mr_local))
 		rxm_ep_msg_mr_closev(rma_buf->mr.mr, rma_buf->mr.count);
@@ -214,6 +221,7 @@ rxm_ep_rma_emulate_inject_msg(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 	rma_buf->pkt.hdr.size = total_size;
 	rma_buf->app_context = msg->context;
 	rma_buf->flags = flags;
+	rma_buf->conn = rxm_conn;
 	rxm_ep_format_rma_msg(rma_buf, msg, &rxm_msg_iov, &rxm_rma_msg);
 
 	flags = (flags & ~FI_INJECT) | FI_COMPLETION;
@@ -223,8 +231,10 @@ rxm_ep_rma_emulate_inject_msg(struct rxm_ep *rxm_ep, struct rxm_conn *rxm_conn,
 		if (ret == -FI_EAGAIN)
 			rxm_ep_do_progress(&rxm_ep->util_ep);
 		ofi_buf_free(rma_buf);
+		return ret;
 	}
-	return ret;
+	rxm_conn->peer_wait++;
+	return 0;
 }
 
 static inline ssize_t
@@ -271,6 +281,10 @@ rxm_ep_rma_inject_common(struct rxm_ep *rxm_ep, const struct fi_msg_rma *msg, ui
 	if (OFI_UNLIKELY(ret))
 		goto unlock;
 
+	ret = rxm_ep_flush_coalesced(rxm_ep, rxm_conn);
+	if (OFI_UNLIKELY(ret))
+		goto unlock;
+
 	if ((total_size > rxm_ep->msg_info->tx_attr->inject_size) ||
 	    (flags & FI_COMPLETION) || (msg->iov_count > 1) ||
 	    (msg->rma_iov_count > 1)) {
@@ -429,6 +443,10 @@ static ssize_t rxm_ep_inject_write(struct fid_ep *ep_fid, const void *buf,
 	if (OFI_UNLIKELY(ret))
 		goto unlock;
 
+	ret = rxm_ep_flush_coalesced(rxm_ep, rxm_conn);
+	if (OFI_UNLIKELY(ret))
+		goto unlock;
+
 	if (len > rxm_ep->msg_info->tx_attr->inject_size) {
 		ret = rxm_ep_rma_emulate_inject(
 			rxm_ep, rxm_conn, buf, len, 0,
@@ -466,6 +484,10 @@ static ssize_t rxm_ep_inject_writedata(struct fid_ep *ep_fid, const void *buf,
 	if (OFI_UNLIKELY(ret))
 		goto unlock;
 
+	ret = rxm_ep_flush_coalesced(rxm_ep, rxm_conn);
+	if (OFI_UNLIKELY(ret))
+		goto unlock;
+
 	if (len > rxm_ep->msg_info->tx_attr->inject_size) {
 		ret = rxm_ep_rma_emulate_inject(
 			rxm_ep, rxm_conn, buf, len, data, dest_addr,
@@ -223,8 +223,9 @@ static int smr_progress_multi_recv(struct smr_ep *ep, struct smr_queue *queue,
 	return 0;
 }
 
-static void smr_do_atomic(void *src, void *dst, void *cmp, enum fi_datatype datatype,
-			  enum fi_op op, size_t cnt, uint16_t flags)
+static void smr_do_atomic(struct smr_ep *ep, void *src, void *dst, void *cmp,
+			  enum fi_datatype datatype, enum fi_op op, size_t cnt,
+			  uint16_t flags)
 {
 	char tmp_result[SMR_INJECT_SIZE];
 
@@ -235,7 +236,8 @@ static void smr_do_atomic(void *src, void *dst, void *cmp, enum fi_datatype data
 		ofi_atomic_readwrite_handlers[op][datatype](dst, src,
 			tmp_result, cnt);
 	} else if (op != FI_ATOMIC_READ) {
-		ofi_atomic_write_handlers[op][datatype](dst, src, cnt);
+		ofi_atomic_write_handler(ep->util_ep.domain->threading,
+					 op, datatype)(dst, src, cnt);
 	}
 
 	if (flags & SMR_RMA_REQ)
@@ -243,8 +245,9 @@ static void smr_do_atomic(void *src, void *dst, void *cmp, enum fi_datatype data
 		       cnt * ofi_datatype_size(datatype));
 }
 
-static int smr_progress_inline_atomic(struct smr_cmd *cmd, struct fi_ioc *ioc,
-			       size_t ioc_count, size_t *len)
+static int smr_progress_inline_atomic(struct smr_ep *ep, struct smr_cmd *cmd,
+				      struct fi_ioc *ioc, size_t ioc_count,
+				      size_t *len)
 {
 	int i;
 	uint8_t *src, *comp;
@@ -261,9 +264,10 @@ static int smr_progress_inline_atomic(struct smr_cmd *cmd, struct fi_ioc *ioc,
 	}
 
 	for (i = *len = 0; i < ioc_count && *len < cmd->msg.hdr.size; i++) {
-		smr_do_atomic(&src[*len], ioc[i].addr, comp ? &comp[*len] : NULL,
-			      cmd->msg.hdr.datatype, cmd->msg.hdr.atomic_op,
-			      ioc[i].count, cmd->msg.hdr.op_flags);
+		smr_do_atomic(ep, &src[*len], ioc[i].addr,
+			      comp ? &comp[*len] : NULL, cmd->msg.hdr.datatype,
+			      cmd->msg.hdr.atomic_op, ioc[i].count,
+			      cmd->msg.hdr.op_flags);
 		*len += ioc[i].count * ofi_datatype_size(cmd->msg.hdr.datatype);
 	}
 
@@ -302,9 +306,10 @@ static int smr_progress_inject_atomic(struct smr_cmd *cmd, struct fi_ioc *ioc,
 	}
 
 	for (i = *len = 0; i < ioc_count && *len < cmd->msg.hdr.size; i++) {
-		smr_do_atomic(&src[*len], ioc[i].addr, comp ? &comp[*len] : NULL,
-			      cmd->msg.hdr.datatype, cmd->msg.hdr.atomic_op,
-			      ioc[i].count, cmd->msg.hdr.op_flags);
+		smr_do_atomic(ep, &src[*len], ioc[i].addr,
+			      comp ? &comp[*len] : NULL, cmd->msg.hdr.datatype,
+			      cmd->msg.hdr.atomic_op, ioc[i].count,
+			      cmd->msg.hdr.op_flags);
 		*len += ioc[i].count * ofi_datatype_size(cmd->msg.hdr.datatype);
 	}
 
@@ -511,7 +516,8 @@ static int smr_progress_cmd_atomic(struct smr_ep *ep, struct smr_cmd *cmd)
 
 	switch (cmd->msg.hdr.op_src) {
 	case smr_src_inline:
-		err = smr_progress_inline_atomic(cmd, ioc, ioc_count, &total_len);
+		err = smr_progress_inline_atomic(ep, cmd, ioc, ioc_count,
+						 &total_len);
 		break;
 	case smr_src_inject:
 		err = smr_progress_inject_atomic(cmd, ioc, ioc_count, &total_len, ep, ret);
@@ -36,6 +36,16 @@ AC_DEFUN([FI_SOCKETS_CONFIGURE],[
 
 	      AC_CHECK_FUNCS([getifaddrs])
 
+	#See if io_uring can be used to progress connections
+	SOCKETS_HAVE_IO_URING=0
+	AS_IF([test $sockets_h_happy -eq 1],[
+		AC_CHECK_DECL([IORING_REGISTER_PROBE],
+			[SOCKETS_HAVE_IO_URING=1],[],
+			[#include <linux/io_uring.h>])
+		])
+	AC_DEFINE_UNQUOTED([SOCKETS_HAVE_IO_URING],[$SOCKETS_HAVE_IO_URING],
+		[Whether linux/io_uring.h has the support used by sockets])
+
 	AS_IF([test $sockets_h_happy -eq 1 && \
 	       test $sockets_shm_happy -eq 1], [$1], [$2])
 ])
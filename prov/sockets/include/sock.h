@@ -60,6 +60,7 @@
 #include <ofi_file.h>
 #include <ofi_osd.h>
 #include <ofi_util.h>
+#include <ofi_iov.h>
 
 #ifndef _SOCK_H_
 #define _SOCK_H_
@@ -816,6 +817,24 @@ enum {
 	SOCK_PE_TX,
 };
 
+enum {
+	SOCK_URING_OP_IDLE,
+	SOCK_URING_OP_BUSY,
+	SOCK_URING_OP_DONE,
+};
+
+/* Header, tag and CQ data ahead of the payload of a send */
+#define SOCK_PE_MAX_IOV (SOCK_EP_MAX_IOV_LIMIT + 3)
+
+/* A socket send or recv handed to the io_uring backend */
+struct sock_uring_op {
+	const void *buf;
+	ssize_t res;
+	int state;
+	struct msghdr msg;
+	struct iovec iov[SOCK_PE_MAX_IOV];
+};
+
 struct sock_pe_entry {
 	union {
 		struct sock_tx_pe_entry tx;
@@ -853,8 +872,12 @@ struct sock_pe_entry {
 	struct dlist_entry ctx_entry;
 	struct ofi_ringbuf comm_buf;
 	size_t cache_sz;
+	struct sock_uring_op send_op;
+	struct sock_uring_op recv_op;
 };
 
+struct sock_uring;
+
 struct sock_pe {
 	struct sock_domain *domain;
 	int num_free_entries;
@@ -879,6 +902,7 @@ struct sock_pe {
 	volatile int do_progress;
 	struct sock_pe_entry *pe_atomic;
 	fi_epoll_t epoll_set;
+	struct sock_uring *uring;
 };
 
 typedef int (*sock_cq_report_fn) (struct sock_cq *cq, fi_addr_t addr,
@@ -1206,12 +1230,59 @@ void sock_rx_release_entry(struct sock_rx_entry *rx_entry);
 
 ssize_t sock_comm_send(struct sock_pe_entry *pe_entry, const void *buf, size_t len);
 ssize_t sock_comm_recv(struct sock_pe_entry *pe_entry, void *buf, size_t len);
+ssize_t sock_comm_sendv(struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt, size_t offset);
+ssize_t sock_comm_recvv(struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt);
 ssize_t sock_comm_peek(struct sock_conn *conn, void *buf, size_t len);
 ssize_t sock_comm_discard(struct sock_pe_entry *pe_entry, size_t len);
 int sock_comm_tx_done(struct sock_pe_entry *pe_entry);
 ssize_t sock_comm_flush(struct sock_pe_entry *pe_entry);
 int sock_comm_is_disconnected(struct sock_pe_entry *pe_entry);
 
+#if SOCKETS_HAVE_IO_URING
+struct sock_uring *sock_uring_init(void);
+void sock_uring_close(struct sock_uring *uring);
+int sock_uring_fd(struct sock_uring *uring);
+ssize_t sock_uring_send(struct sock_uring *uring,
+			struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt);
+ssize_t sock_uring_recv(struct sock_uring *uring,
+			struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt);
+int sock_uring_progress(struct sock_uring *uring);
+void sock_uring_cancel(struct sock_uring *uring,
+		       struct sock_pe_entry *pe_entry);
+#else
+static inline struct sock_uring *sock_uring_init(void)
+{
+	return NULL;
+}
+static inline void sock_uring_close(struct sock_uring *uring) {}
+static inline int sock_uring_fd(struct sock_uring *uring)
+{
+	return -1;
+}
+static inline ssize_t
+sock_uring_send(struct sock_uring *uring, struct sock_pe_entry *pe_entry,
+		const struct iovec *iov, size_t iov_cnt)
+{
+	return -FI_ENOSYS;
+}
+static inline ssize_t
+sock_uring_recv(struct sock_uring *uring, struct sock_pe_entry *pe_entry,
+		const struct iovec *iov, size_t iov_cnt)
+{
+	return -FI_ENOSYS;
+}
+static inline int sock_uring_progress(struct sock_uring *uring)
+{
+	return 0;
+}
+static inline void sock_uring_cancel(struct sock_uring *uring,
+				     struct sock_pe_entry *pe_entry) {}
+#endif
+
 ssize_t sock_ep_recvmsg(struct fid_ep *ep, const struct fi_msg *msg,
 			uint64_t flags);
 ssize_t sock_ep_sendmsg(struct fid_ep *ep, const struct fi_msg *msg,
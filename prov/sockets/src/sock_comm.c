@@ -44,22 +44,44 @@
 #define SOCK_LOG_DBG(...) _SOCK_LOG_DBG(FI_LOG_EP_DATA, __VA_ARGS__)
 #define SOCK_LOG_ERROR(...) _SOCK_LOG_ERROR(FI_LOG_EP_DATA, __VA_ARGS__)
 
-static ssize_t sock_comm_send_socket(struct sock_conn *conn,
-				     const void *buf, size_t len)
+static ssize_t sock_comm_send_socket(struct sock_pe_entry *pe_entry,
+				     const struct iovec *iov, size_t iov_cnt)
 {
+	struct sock_conn *conn = pe_entry->conn;
+	struct sock_pe *pe = pe_entry->ep_attr->domain->pe;
+	struct msghdr msg;
 	ssize_t ret;
+	int err = 0;
+
+	if (pe->uring) {
+		ret = sock_uring_send(pe->uring, pe_entry, iov, iov_cnt);
+		if (ret == -FI_EINPROGRESS)
+			return 0;
+		if (ret < 0)
+			err = (int) -ret;
+	} else {
+		if (iov_cnt == 1) {
+			ret = ofi_send_socket(conn->sock_fd, iov[0].iov_base,
+					      iov[0].iov_len, MSG_NOSIGNAL);
+		} else {
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = (struct iovec *) iov;
+			msg.msg_iovlen = iov_cnt;
+			ret = ofi_sendmsg_tcp(conn->sock_fd, &msg, MSG_NOSIGNAL);
+		}
+		if (ret < 0)
+			err = ofi_sockerr();
+	}
 
-	ret = ofi_send_socket(conn->sock_fd, buf, len, MSG_NOSIGNAL);
 	if (ret < 0) {
-		if (OFI_SOCK_TRY_SND_RCV_AGAIN(ofi_sockerr())) {
+		if (OFI_SOCK_TRY_SND_RCV_AGAIN(err)) {
 			ret = 0;
-		} else if (ofi_sockerr() == EPIPE) {
+		} else if (err == EPIPE) {
 			conn->connected = 0;
 			SOCK_LOG_DBG("Disconnected port: %d\n",
 				     ofi_addr_get_port(&conn->addr.sa));
 		} else {
-			SOCK_LOG_DBG("write error: %s\n",
-				     strerror(ofi_sockerr()));
+			SOCK_LOG_DBG("write error: %s\n", strerror(err));
 		}
 	}
 	if (ret > 0)
@@ -69,42 +91,44 @@ static ssize_t sock_comm_send_socket(struct sock_conn *conn,
 
 ssize_t sock_comm_flush(struct sock_pe_entry *pe_entry)
 {
-	ssize_t ret1, ret2 = 0;
-	size_t endlen, len, xfer_len;
+	struct iovec iov[2];
+	size_t endlen, len;
+	ssize_t ret;
 
 	len = ofi_rbused(&pe_entry->comm_buf);
+	if (!len)
+		return 0;
+
 	endlen = pe_entry->comm_buf.size -
 		(pe_entry->comm_buf.rcnt & pe_entry->comm_buf.size_mask);
 
-	xfer_len = MIN(len, endlen);
-	ret1 = sock_comm_send_socket(pe_entry->conn, (char*)pe_entry->comm_buf.buf +
-				     (pe_entry->comm_buf.rcnt & pe_entry->comm_buf.size_mask),
-				     xfer_len);
-	if (ret1 > 0)
-		pe_entry->comm_buf.rcnt += ret1;
-
-	if (ret1 == xfer_len && xfer_len < len) {
-		ret2 = sock_comm_send_socket(pe_entry->conn, (char*)pe_entry->comm_buf.buf +
-					     (pe_entry->comm_buf.rcnt & pe_entry->comm_buf.size_mask),
-					     len - xfer_len);
-		if (ret2 > 0)
-			pe_entry->comm_buf.rcnt += ret2;
-		else
-			ret2 = 0;
-	}
+	/* a wrapped ring goes out in one sendmsg */
+	iov[0].iov_base = (char *) pe_entry->comm_buf.buf +
+			  (pe_entry->comm_buf.rcnt & pe_entry->comm_buf.size_mask);
+	iov[0].iov_len = MIN(len, endlen);
+	iov[1].iov_base = pe_entry->comm_buf.buf;
+	iov[1].iov_len = len - iov[0].iov_len;
 
-	return (ret1 > 0) ? ret1 + ret2 : 0;
+	ret = sock_comm_send_socket(pe_entry, iov, iov[1].iov_len ? 2 : 1);
+	if (ret <= 0)
+		return 0;
+
+	pe_entry->comm_buf.rcnt += ret;
+	return ret;
 }
 
 ssize_t sock_comm_send(struct sock_pe_entry *pe_entry,
 		       const void *buf, size_t len)
 {
+	struct iovec iov;
 	ssize_t ret, used;
 
 	if (len > pe_entry->cache_sz) {
 		used = ofi_rbused(&pe_entry->comm_buf);
 		if (used == sock_comm_flush(pe_entry)) {
-			return sock_comm_send_socket(pe_entry->conn, buf, len);
+			iov.iov_base = (void *) buf;
+			iov.iov_len = len;
+			return sock_comm_send_socket(pe_entry, &iov, 1);
 		} else {
 			return 0;
 		}
@@ -123,16 +147,74 @@ ssize_t sock_comm_send(struct sock_pe_entry *pe_entry,
 	return ret;
 }
 
+/*
+ * Send a whole message straight from where its pieces live, past the first
+ * offset bytes that already went out, rather than copying each piece into
+ * comm_buf.  Anything still buffered is sent first.
+ */
+ssize_t sock_comm_sendv(struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt, size_t offset)
+{
+	struct iovec msg_iov[SOCK_PE_MAX_IOV];
+	size_t i, cnt;
+	ssize_t used;
+
+	used = ofi_rbused(&pe_entry->comm_buf);
+	if (used != sock_comm_flush(pe_entry))
+		return 0;
+
+	for (i = 0; i < iov_cnt && offset >= iov[i].iov_len; i++)
+		offset -= iov[i].iov_len;
+
+	for (cnt = 0; i < iov_cnt; i++) {
+		if (!iov[i].iov_len)
+			continue;
+		msg_iov[cnt].iov_base = (char *) iov[i].iov_base + offset;
+		msg_iov[cnt++].iov_len = iov[i].iov_len - offset;
+		offset = 0;
+	}
+
+	return cnt ? sock_comm_send_socket(pe_entry, msg_iov, cnt) : 0;
+}
+
 int sock_comm_tx_done(struct sock_pe_entry *pe_entry)
 {
 	return ofi_rbempty(&pe_entry->comm_buf);
 }
 
-static ssize_t sock_comm_recv_socket(struct sock_conn *conn,
-			      void *buf, size_t len)
+static ssize_t sock_comm_recv_socket(struct sock_pe_entry *pe_entry,
+				     const struct iovec *iov, size_t iov_cnt)
 {
+	struct sock_conn *conn = pe_entry->conn;
+	struct sock_pe *pe = pe_entry->ep_attr->domain->pe;
+	struct msghdr msg;
 	ssize_t ret;
-	ret = ofi_recv_socket(conn->sock_fd, buf, len, 0);
+	int err = 0;
+
+	/*
+	 * The header is read right after it was peeked, and the entry is
+	 * dropped if that fails, so it is not left in flight on the ring.
+	 */
+	if (pe->uring && pe_entry->pe.rx.header_read) {
+		ret = sock_uring_recv(pe->uring, pe_entry, iov, iov_cnt);
+		if (ret == -FI_EINPROGRESS)
+			return 0;
+		if (ret < 0)
+			err = (int) -ret;
+	} else {
+		if (iov_cnt == 1) {
+			ret = ofi_recv_socket(conn->sock_fd, iov[0].iov_base,
+					      iov[0].iov_len, 0);
+		} else {
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = (struct iovec *) iov;
+			msg.msg_iovlen = iov_cnt;
+			ret = ofi_recvmsg_tcp(conn->sock_fd, &msg, 0);
+		}
+		if (ret < 0)
+			err = ofi_sockerr();
+	}
+
 	if (ret == 0) {
 		conn->connected = 0;
 		SOCK_LOG_DBG("Disconnected: port %d\n",
@@ -141,7 +223,8 @@ static ssize_t sock_comm_recv_socket(struct sock_conn *conn,
 	}
 
 	if (ret < 0) {
-		SOCK_LOG_DBG("read %s\n", strerror(ofi_sockerr()));
+		SOCK_LOG_DBG("read %s\n", strerror(err));
+		OFI_UNUSED(err);
 		ret = 0;
 	}
 
@@ -150,10 +233,12 @@ static ssize_t sock_comm_recv_socket(struct sock_conn *conn,
 	return ret;
 }
 
-static void sock_comm_recv_buffer(struct sock_pe_entry *pe_entry)
+static void sock_comm_recv_buffer(struct sock_pe_entry *pe_entry,
+				  size_t max_read)
 {
+	struct iovec iov;
 	int ret;
-	size_t max_read, avail;
+	size_t avail;
 
 	avail = ofi_rbavail(&pe_entry->comm_buf);
 	assert(avail == pe_entry->comm_buf.size);
@@ -161,27 +246,46 @@ static void sock_comm_recv_buffer(struct sock_pe_entry *pe_entry)
 		pe_entry->comm_buf.wcnt =
 		pe_entry->comm_buf.wpos = 0;
 
-	max_read = pe_entry->rem ? pe_entry->rem :
-		pe_entry->total_len - pe_entry->done_len;
-	ret = sock_comm_recv_socket(pe_entry->conn, (char *) pe_entry->comm_buf.buf,
-				    MIN(max_read, avail));
+	iov.iov_base = pe_entry->comm_buf.buf;
+	iov.iov_len = MIN(max_read, avail);
+	ret = sock_comm_recv_socket(pe_entry, &iov, 1);
 	pe_entry->comm_buf.wpos += ret;
 	ofi_rbcommit(&pe_entry->comm_buf);
 }
 
 ssize_t sock_comm_recv(struct sock_pe_entry *pe_entry, void *buf, size_t len)
 {
-	ssize_t read_len;
+	struct iovec iov;
+
+	iov.iov_base = buf;
+	iov.iov_len = len;
+	return sock_comm_recvv(pe_entry, &iov, 1);
+}
+
+/*
+ * Scatter data straight into the destination buffers.  Whatever is left
+ * in comm_buf from an earlier read is handed out first, and only
+ * transfers that are too small to be worth a direct read go through
+ * comm_buf.
+ */
+ssize_t sock_comm_recvv(struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt)
+{
+	ssize_t read_len = 0;
+	size_t i, len;
+
 	if (ofi_rbempty(&pe_entry->comm_buf)) {
-		if (len <= pe_entry->cache_sz) {
-			sock_comm_recv_buffer(pe_entry);
-		} else {
-			return sock_comm_recv_socket(pe_entry->conn, buf, len);
-		}
+		if (ofi_total_iov_len(iov, iov_cnt) > pe_entry->cache_sz)
+			return sock_comm_recv_socket(pe_entry, iov, iov_cnt);
+		sock_comm_recv_buffer(pe_entry, pe_entry->rem ? pe_entry->rem :
+				      pe_entry->total_len - pe_entry->done_len);
 	}
 
-	read_len = MIN(len, ofi_rbused(&pe_entry->comm_buf));
-	ofi_rbread(&pe_entry->comm_buf, buf, read_len);
+	for (i = 0; i < iov_cnt && !ofi_rbempty(&pe_entry->comm_buf); i++) {
+		len = MIN(iov[i].iov_len, ofi_rbused(&pe_entry->comm_buf));
+		ofi_rbread(&pe_entry->comm_buf, iov[i].iov_base, len);
+		read_len += len;
+	}
 	SOCK_LOG_DBG("read from buffer: %lu\n", read_len);
 	return read_len;
 }
@@ -206,18 +310,25 @@ ssize_t sock_comm_peek(struct sock_conn *conn, void *buf, size_t len)
 	return ret;
 }
 
+/*
+ * Drop len bytes by reading them into comm_buf and discarding them there,
+ * so the ring never writes into a buffer that is gone once we return.
+ * Returns the number of bytes discarded, which is less than len if the
+ * socket runs dry.
+ */
 ssize_t sock_comm_discard(struct sock_pe_entry *pe_entry, size_t len)
 {
-	void *buf;
-	int ret;
+	size_t done = 0;
 
-	buf = malloc(len);
-	if (!buf)
-		return 0;
-
-	ret = sock_comm_recv(pe_entry, buf, len);
-	free(buf);
-	return ret;
+	while (done < len) {
+		if (ofi_rbempty(&pe_entry->comm_buf)) {
+			sock_comm_recv_buffer(pe_entry, len - done);
+			if (ofi_rbempty(&pe_entry->comm_buf))
+				break;
+		}
+		done += ofi_rbdiscard(&pe_entry->comm_buf, len - done);
+	}
+	return done;
 }
 
 int sock_comm_is_disconnected(struct sock_pe_entry *pe_entry)
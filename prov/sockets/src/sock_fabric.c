@@ -65,6 +65,7 @@ int sock_keepalive_enable;
 int sock_keepalive_time = INT_MAX;
 int sock_keepalive_intvl = INT_MAX;
 int sock_keepalive_probes = INT_MAX;
+int sock_io_uring;
 
 uint64_t SOCK_EP_RDM_SEC_CAP = SOCK_EP_RDM_SEC_CAP_BASE;
 uint64_t SOCK_EP_RDM_CAP = SOCK_EP_RDM_CAP_BASE;
@@ -354,6 +355,7 @@ static void sock_read_default_params()
 		fi_param_get_int(&sock_prov, "keepalive_time", &sock_keepalive_time);
 		fi_param_get_int(&sock_prov, "keepalive_intvl", &sock_keepalive_intvl);
 		fi_param_get_int(&sock_prov, "keepalive_probes", &sock_keepalive_probes);
+		fi_param_get_bool(&sock_prov, "io_uring", &sock_io_uring);
 
 		read_default_params = 1;
 	}
@@ -744,6 +746,9 @@ SOCKETS_INI
 	fi_param_define(&sock_prov, "iface", FI_PARAM_STRING,
 			"Specify interface name");
 
+	fi_param_define(&sock_prov, "io_uring", FI_PARAM_BOOL,
+			"Batch socket sends and receives through io_uring (Linux only)");
+
 	fastlock_init(&sock_list_lock);
 	dlist_init(&sock_fab_list);
 	dlist_init(&sock_dom_list);
@@ -85,6 +85,12 @@ static inline int sock_pe_is_data_msg(int msg_id)
 	}
 }
 
+static inline int sock_pe_is_send_msg(struct sock_pe_entry *pe_entry)
+{
+	return pe_entry->msg_hdr.op_type == SOCK_OP_SEND ||
+	       pe_entry->msg_hdr.op_type == SOCK_OP_TSEND;
+}
+
 static inline ssize_t sock_pe_send_field(struct sock_pe_entry *pe_entry,
 					 void *field, size_t field_len,
 					 size_t start_offset)
@@ -150,6 +156,9 @@ static inline void sock_pe_discard_field(struct sock_pe_entry *pe_entry)
 static void sock_pe_release_entry(struct sock_pe *pe,
 				  struct sock_pe_entry *pe_entry)
 {
+	if (pe->uring)
+		sock_uring_cancel(pe->uring, pe_entry);
+
 	assert((pe_entry->type != SOCK_PE_RX) ||
 		ofi_rbempty(&pe_entry->comm_buf));
 	dlist_remove(&pe_entry->ctx_entry);
@@ -857,6 +866,9 @@ out:
 /*
  * Provider re-uses compare buffer to return result.  This can be optimized
  * in the future to have a separate buffer.
+ *
+ * All atomics targeting the domain are applied by its progress engine while
+ * holding pe->lock, so plain writes can use the non-atomic kernels.
  */
 static void sock_pe_do_atomic(void *cmp, void *dst, void *src,
 			      enum fi_datatype datatype, enum fi_op op,
@@ -873,7 +885,7 @@ static void sock_pe_do_atomic(void *cmp, void *dst, void *src,
 		ofi_atomic_readwrite_handlers[op][datatype](dst, src,
 			cmp /*results*/, cnt);
 	} else {
-		ofi_atomic_write_handlers[op][datatype](dst, src, cnt);
+		ofi_atomic_reduce_handlers[op][datatype](dst, src, cnt);
 	}
 }
 
@@ -1303,9 +1315,10 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 {
 	ssize_t i, ret = 0;
 	struct sock_rx_entry *rx_entry;
-	uint64_t len, rem, offset, data_len, done_data, used;
+	struct iovec iov[SOCK_EP_MAX_IOV_LIMIT];
+	uint64_t len, rem, data_len, done_data, used, iov_len;
+	size_t cnt;
 
-	offset = 0;
 	len = sizeof(struct sock_msg_hdr);
 
 	if (pe_entry->msg_hdr.op_type == SOCK_OP_TSEND) {
@@ -1364,29 +1377,33 @@ static int sock_pe_process_rx_send(struct sock_pe *pe,
 	rem = pe_entry->data_len - done_data;
 	used = rx_entry->used;
 
-	for (i = 0; rem > 0 && i < rx_entry->rx_op.dest_iov_len; i++) {
-
-		/* skip used contents in rx_entry */
+	/* scatter the rest of the payload past the used part of rx_entry */
+	for (i = 0, cnt = 0, iov_len = 0;
+	     iov_len < rem && i < rx_entry->rx_op.dest_iov_len; i++) {
 		if (used >= rx_entry->iov[i].iov.len) {
 			used -= rx_entry->iov[i].iov.len;
 			continue;
 		}
 
-		offset = used;
-		data_len = MIN(rx_entry->iov[i].iov.len - used, rem);
-		ret = sock_comm_recv(pe_entry,
-				     (char *) (uintptr_t) rx_entry->iov[i].iov.addr + offset,
-				     data_len);
+		iov[cnt].iov_base = (char *) (uintptr_t)
+				    rx_entry->iov[i].iov.addr + used;
+		iov[cnt].iov_len = MIN(rx_entry->iov[i].iov.len - used,
+				       rem - iov_len);
+		iov_len += iov[cnt++].iov_len;
+		used = 0;
+	}
+
+	if (cnt) {
+		ret = sock_comm_recvv(pe_entry, iov, cnt);
 		if (ret <= 0)
 			return ret;
 
 		if (!pe_entry->buf)
-			pe_entry->buf = rx_entry->iov[i].iov.addr + offset;
+			pe_entry->buf = (uintptr_t) iov[0].iov_base;
 		rem -= ret;
-		used = 0;
 		pe_entry->done_len += ret;
 		rx_entry->used += ret;
-		if (ret != data_len)
+		if (ret != iov_len)
 			return 0;
 	}
 
@@ -1822,45 +1839,45 @@ static int sock_pe_progress_tx_send(struct sock_pe *pe,
 				    struct sock_pe_entry *pe_entry,
 				    struct sock_conn *conn)
 {
-	size_t len, i;
+	struct iovec iov[SOCK_PE_MAX_IOV];
+	size_t i, cnt = 0;
+	ssize_t ret;
+
 	if (pe_entry->pe.tx.send_done)
 		return 0;
 
-	len = sizeof(struct sock_msg_hdr);
+	/* the header, tag, CQ data and payload go out in one sendmsg */
+	iov[cnt].iov_base = &pe_entry->msg_hdr;
+	iov[cnt++].iov_len = sizeof(struct sock_msg_hdr);
+
 	if (pe_entry->pe.tx.tx_op.op == SOCK_OP_TSEND) {
-		if (sock_pe_send_field(pe_entry, &pe_entry->tag,
-				       SOCK_TAG_SIZE, len))
-			return 0;
-		len += SOCK_TAG_SIZE;
+		iov[cnt].iov_base = &pe_entry->tag;
+		iov[cnt++].iov_len = SOCK_TAG_SIZE;
 	}
 
 	if (pe_entry->flags & FI_REMOTE_CQ_DATA) {
-		if (sock_pe_send_field(pe_entry, &pe_entry->data,
-				       SOCK_CQ_DATA_SIZE, len))
-			return 0;
-		len += SOCK_CQ_DATA_SIZE;
+		iov[cnt].iov_base = &pe_entry->data;
+		iov[cnt++].iov_len = SOCK_CQ_DATA_SIZE;
 	}
 
 	if (pe_entry->flags & FI_INJECT) {
-		if (sock_pe_send_field(pe_entry, pe_entry->pe.tx.inject,
-				       pe_entry->pe.tx.tx_op.src_iov_len, len))
-			return 0;
-		len += pe_entry->pe.tx.tx_op.src_iov_len;
+		iov[cnt].iov_base = pe_entry->pe.tx.inject;
+		iov[cnt++].iov_len = pe_entry->pe.tx.tx_op.src_iov_len;
 		pe_entry->data_len = pe_entry->pe.tx.tx_op.src_iov_len;
 	} else {
 		pe_entry->data_len = 0;
 		for (i = 0; i < pe_entry->pe.tx.tx_op.src_iov_len; i++) {
-			if (sock_pe_send_field(pe_entry,
-				    (void *) (uintptr_t) pe_entry->pe.tx.tx_iov[i].src.iov.addr,
-				    pe_entry->pe.tx.tx_iov[i].src.iov.len, len))
-				return 0;
-			len += pe_entry->pe.tx.tx_iov[i].src.iov.len;
+			iov[cnt].iov_base = (void *) (uintptr_t)
+				pe_entry->pe.tx.tx_iov[i].src.iov.addr;
+			iov[cnt++].iov_len = pe_entry->pe.tx.tx_iov[i].src.iov.len;
 			pe_entry->data_len += pe_entry->pe.tx.tx_iov[i].src.iov.len;
 		}
 	}
 
-	sock_comm_flush(pe_entry);
-	if (!sock_comm_tx_done(pe_entry))
+	ret = sock_comm_sendv(pe_entry, iov, cnt, pe_entry->done_len);
+	if (ret > 0)
+		pe_entry->done_len += ret;
+	if (pe_entry->done_len < pe_entry->total_len)
 		return 0;
 
 	pe_entry->tag = 0;
@@ -1957,7 +1974,7 @@ static int sock_pe_progress_tx_entry(struct sock_pe *pe,
 		goto out;
 	}
 
-	if (!pe_entry->pe.tx.header_sent) {
+	if (!pe_entry->pe.tx.header_sent && !sock_pe_is_send_msg(pe_entry)) {
 		if (sock_pe_send_field(pe_entry, &pe_entry->msg_hdr,
 				       sizeof(struct sock_msg_hdr), 0))
 			goto out;
@@ -2392,13 +2409,14 @@ static int sock_pe_progress_rx_ep(struct sock_pe *pe,
 
 int sock_pe_progress_rx_ctx(struct sock_pe *pe, struct sock_rx_ctx *rx_ctx)
 {
-	int ret = 0;
+	int ret = 0, reaped = 0;
 	struct sock_ep_attr *ep_attr;
 	struct dlist_entry *entry;
 	struct sock_pe_entry *pe_entry;
 
 	fastlock_acquire(&pe->lock);
 
+progress:
 	fastlock_acquire(&rx_ctx->lock);
 	sock_pe_progress_buffered_rx(rx_ctx);
 	fastlock_release(&rx_ctx->lock);
@@ -2428,6 +2446,10 @@ int sock_pe_progress_rx_ctx(struct sock_pe *pe, struct sock_rx_ctx *rx_ctx)
 		if (ret < 0)
 			goto out;
 	}
+
+	/* hand completed transfers back to their entries right away */
+	if (pe->uring && sock_uring_progress(pe->uring) > 0 && !reaped++)
+		goto progress;
 out:
 	if (ret < 0)
 		SOCK_LOG_ERROR("failed to progress RX ctx\n");
@@ -2497,12 +2519,13 @@ void sock_pe_progress_rx_ctrl_ctx(struct sock_pe *pe, struct sock_rx_ctx *rx_ctx
 
 int sock_pe_progress_tx_ctx(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 {
-	int ret = 0;
+	int ret = 0, reaped = 0;
 	struct dlist_entry *entry;
 	struct sock_pe_entry *pe_entry;
 
 	fastlock_acquire(&pe->lock);
 
+progress:
 	/* progress tx_ctx in PE table */
 	for (entry = tx_ctx->pe_entry_list.next;
 	     entry != &tx_ctx->pe_entry_list;) {
@@ -2525,6 +2548,9 @@ int sock_pe_progress_tx_ctx(struct sock_pe *pe, struct sock_tx_ctx *tx_ctx)
 		goto out;
 
 	sock_pe_progress_rx_ctrl_ctx(pe, tx_ctx->rx_ctrl_ctx, tx_ctx);
+
+	if (pe->uring && sock_uring_progress(pe->uring) > 0 && !reaped++)
+		goto progress;
 out:
 	if (ret < 0)
 		SOCK_LOG_ERROR("failed to progress TX ctx\n");
@@ -2717,6 +2743,15 @@ struct sock_pe *sock_pe_init(struct sock_domain *domain)
                 goto err3;
 	}
 
+	if (sock_io_uring) {
+		pe->uring = sock_uring_init();
+		if (!pe->uring)
+			SOCK_LOG_DBG("io_uring not available, using sockets\n");
+		else if (fi_epoll_add(pe->epoll_set, sock_uring_fd(pe->uring),
+				      FI_EPOLL_IN, NULL))
+			goto err4;
+	}
+
 	if (domain->progress_mode == FI_PROGRESS_AUTO) {
 		if (socketpair(AF_UNIX, SOCK_STREAM, 0, pe->signal_fds) < 0)
 			goto err4;
@@ -2741,6 +2776,8 @@ err5:
 	ofi_close_socket(pe->signal_fds[0]);
 	ofi_close_socket(pe->signal_fds[1]);
 err4:
+	if (pe->uring)
+		sock_uring_close(pe->uring);
 	fi_epoll_close(pe->epoll_set);
 err3:
 	ofi_bufpool_destroy(pe->atomic_rx_pool);
@@ -2771,6 +2808,7 @@ static void sock_pe_free_util_pool(struct sock_pe *pe)
 
 void sock_pe_finalize(struct sock_pe *pe)
 {
+	struct sock_pe_entry *pe_entry;
 	int i;
 	if (pe->domain->progress_mode == FI_PROGRESS_AUTO) {
 		pe->do_progress = 0;
@@ -2780,6 +2818,15 @@ void sock_pe_finalize(struct sock_pe *pe)
 		ofi_close_socket(pe->signal_fds[1]);
 	}
 
+	if (pe->uring) {
+		for (i = 0; i < SOCK_PE_MAX_ENTRIES; i++)
+			sock_uring_cancel(pe->uring, &pe->pe_table[i]);
+		dlist_foreach_container(&pe->pool_list, struct sock_pe_entry,
+					pe_entry, entry)
+			sock_uring_cancel(pe->uring, pe_entry);
+		sock_uring_close(pe->uring);
+	}
+
 	for (i = 0; i < SOCK_PE_MAX_ENTRIES; i++) {
 		ofi_rbfree(&pe->pe_table[i].comm_buf);
 	}
@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2019 Intel Corporation, Inc.  All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#if SOCKETS_HAVE_IO_URING
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "sock.h"
+#include "sock_util.h"
+
+#define SOCK_LOG_DBG(...) _SOCK_LOG_DBG(FI_LOG_EP_DATA, __VA_ARGS__)
+#define SOCK_LOG_ERROR(...) _SOCK_LOG_ERROR(FI_LOG_EP_DATA, __VA_ARGS__)
+
+/* A send and a recv can be outstanding for each entry in the PE table */
+#define SOCK_URING_DEPTH	(SOCK_PE_MAX_ENTRIES * 2)
+
+/*
+ * Sends and receives of all the active PE entries are queued on the ring
+ * as they are issued, and submitted together with a single system call at
+ * the end of each progress pass, which also reaps whatever completed.  A
+ * PE entry owns at most one send and one recv at a time, and simply
+ * retries the transfer until it finds the result of the earlier one.
+ */
+struct sock_uring {
+	int fd;
+	size_t inflight;
+	unsigned to_submit;
+	unsigned sq_tail_local;
+
+	unsigned sq_entries;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+
+	unsigned cq_entries;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void *sq_ring;
+	void *cq_ring;
+	size_t sq_ring_sz;
+	size_t cq_ring_sz;
+	size_t sqes_sz;
+};
+
+static int sock_uring_supported(int fd)
+{
+	struct io_uring_probe *probe;
+	size_t size;
+	int ret = 0;
+
+	size = sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op);
+	probe = calloc(1, size);
+	if (!probe)
+		return 0;
+
+	if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE,
+		    probe, 256))
+		goto out;
+
+	ret = probe->last_op >= IORING_OP_RECV &&
+	      (probe->ops[IORING_OP_SEND].flags & IO_URING_OP_SUPPORTED) &&
+	      (probe->ops[IORING_OP_RECV].flags & IO_URING_OP_SUPPORTED) &&
+	      (probe->ops[IORING_OP_SENDMSG].flags & IO_URING_OP_SUPPORTED) &&
+	      (probe->ops[IORING_OP_RECVMSG].flags & IO_URING_OP_SUPPORTED) &&
+	      (probe->ops[IORING_OP_ASYNC_CANCEL].flags & IO_URING_OP_SUPPORTED);
+out:
+	free(probe);
+	return ret;
+}
+
+static int sock_uring_map(struct sock_uring *uring,
+			  struct io_uring_params *params)
+{
+	uring->sq_ring_sz = params->sq_off.array +
+			    params->sq_entries * sizeof(unsigned);
+	uring->cq_ring_sz = params->cq_off.cqes +
+			    params->cq_entries * sizeof(struct io_uring_cqe);
+	if (params->features & IORING_FEAT_SINGLE_MMAP) {
+		uring->sq_ring_sz = MAX(uring->sq_ring_sz, uring->cq_ring_sz);
+		uring->cq_ring_sz = uring->sq_ring_sz;
+	}
+
+	uring->sq_ring = mmap(NULL, uring->sq_ring_sz, PROT_READ | PROT_WRITE,
+			      MAP_SHARED | MAP_POPULATE, uring->fd,
+			      IORING_OFF_SQ_RING);
+	if (uring->sq_ring == MAP_FAILED)
+		return -errno;
+
+	if (params->features & IORING_FEAT_SINGLE_MMAP) {
+		uring->cq_ring = uring->sq_ring;
+	} else {
+		uring->cq_ring = mmap(NULL, uring->cq_ring_sz,
+				      PROT_READ | PROT_WRITE,
+				      MAP_SHARED | MAP_POPULATE, uring->fd,
+				      IORING_OFF_CQ_RING);
+		if (uring->cq_ring == MAP_FAILED)
+			goto err1;
+	}
+
+	uring->sqes_sz = params->sq_entries * sizeof(struct io_uring_sqe);
+	uring->sqes = mmap(NULL, uring->sqes_sz, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_POPULATE, uring->fd,
+			   IORING_OFF_SQES);
+	if (uring->sqes == MAP_FAILED)
+		goto err2;
+
+	uring->sq_entries = params->sq_entries;
+	uring->sq_head = (unsigned *) ((char *) uring->sq_ring +
+				       params->sq_off.head);
+	uring->sq_tail = (unsigned *) ((char *) uring->sq_ring +
+				       params->sq_off.tail);
+	uring->sq_mask = (unsigned *) ((char *) uring->sq_ring +
+				       params->sq_off.ring_mask);
+	uring->sq_array = (unsigned *) ((char *) uring->sq_ring +
+					params->sq_off.array);
+	uring->sq_tail_local = *uring->sq_tail;
+
+	uring->cq_entries = params->cq_entries;
+	uring->cq_head = (unsigned *) ((char *) uring->cq_ring +
+				       params->cq_off.head);
+	uring->cq_tail = (unsigned *) ((char *) uring->cq_ring +
+				       params->cq_off.tail);
+	uring->cq_mask = (unsigned *) ((char *) uring->cq_ring +
+				       params->cq_off.ring_mask);
+	uring->cqes = (struct io_uring_cqe *) ((char *) uring->cq_ring +
+					       params->cq_off.cqes);
+	return 0;
+
+err2:
+	if (uring->cq_ring != uring->sq_ring)
+		munmap(uring->cq_ring, uring->cq_ring_sz);
+err1:
+	munmap(uring->sq_ring, uring->sq_ring_sz);
+	return -FI_ENOMEM;
+}
+
+struct sock_uring *sock_uring_init(void)
+{
+	struct io_uring_params params;
+	struct sock_uring *uring;
+
+	uring = calloc(1, sizeof(*uring));
+	if (!uring)
+		return NULL;
+
+	memset(&params, 0, sizeof(params));
+	uring->fd = syscall(__NR_io_uring_setup, SOCK_URING_DEPTH, &params);
+	if (uring->fd < 0) {
+		SOCK_LOG_DBG("io_uring_setup failed: %s\n", strerror(errno));
+		goto err1;
+	}
+
+	if (!sock_uring_supported(uring->fd)) {
+		SOCK_LOG_DBG("io_uring socket operations not supported\n");
+		goto err2;
+	}
+
+	if (sock_uring_map(uring, &params))
+		goto err2;
+
+	SOCK_LOG_DBG("io_uring init: %u sq / %u cq entries\n",
+		     uring->sq_entries, uring->cq_entries);
+	return uring;
+
+err2:
+	close(uring->fd);
+err1:
+	free(uring);
+	return NULL;
+}
+
+void sock_uring_close(struct sock_uring *uring)
+{
+	munmap(uring->sqes, uring->sqes_sz);
+	if (uring->cq_ring != uring->sq_ring)
+		munmap(uring->cq_ring, uring->cq_ring_sz);
+	munmap(uring->sq_ring, uring->sq_ring_sz);
+	close(uring->fd);
+	free(uring);
+}
+
+int sock_uring_fd(struct sock_uring *uring)
+{
+	return uring->fd;
+}
+
+static int sock_uring_enter(struct sock_uring *uring, unsigned min_complete)
+{
+	int ret;
+
+	if (!uring->to_submit && !min_complete)
+		return 0;
+
+	__atomic_store_n(uring->sq_tail, uring->sq_tail_local,
+			 __ATOMIC_RELEASE);
+	ret = syscall(__NR_io_uring_enter, uring->fd, uring->to_submit,
+		      min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0,
+		      NULL, 0);
+	if (ret < 0) {
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			SOCK_LOG_ERROR("io_uring_enter failed: %s\n",
+				       strerror(errno));
+		return -errno;
+	}
+
+	uring->to_submit -= ret;
+	return 0;
+}
+
+static int sock_uring_reap(struct sock_uring *uring)
+{
+	struct io_uring_cqe *cqe;
+	struct sock_uring_op *op;
+	unsigned head, tail;
+	int cnt = 0;
+
+	head = *uring->cq_head;
+	tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		cqe = &uring->cqes[head & *uring->cq_mask];
+		uring->inflight--;
+
+		/* cancel requests don't carry an op */
+		op = (struct sock_uring_op *) (uintptr_t) cqe->user_data;
+		if (!op)
+			continue;
+
+		op->res = cqe->res;
+		op->state = SOCK_URING_OP_DONE;
+		cnt++;
+	}
+	__atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+	return cnt;
+}
+
+static struct io_uring_sqe *sock_uring_get_sqe(struct sock_uring *uring)
+{
+	struct io_uring_sqe *sqe;
+	unsigned index;
+
+	/* every request needs room for its completion */
+	if (uring->inflight >= uring->cq_entries)
+		return NULL;
+
+	if (uring->sq_tail_local -
+	    __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) >=
+	    uring->sq_entries) {
+		sock_uring_enter(uring, 0);
+		if (uring->sq_tail_local -
+		    __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) >=
+		    uring->sq_entries)
+			return NULL;
+	}
+
+	index = uring->sq_tail_local & *uring->sq_mask;
+	uring->sq_array[index] = index;
+	uring->sq_tail_local++;
+	uring->to_submit++;
+	uring->inflight++;
+
+	sqe = &uring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	return sqe;
+}
+
+static ssize_t sock_uring_xfer(struct sock_uring *uring,
+			       struct sock_uring_op *op, int send, int fd,
+			       const struct iovec *iov, size_t iov_cnt,
+			       int flags)
+{
+	struct io_uring_sqe *sqe;
+	struct msghdr msg;
+	ssize_t ret;
+
+	switch (op->state) {
+	case SOCK_URING_OP_BUSY:
+		return -FI_EINPROGRESS;
+	case SOCK_URING_OP_DONE:
+		/* transfers are always retried from the first byte not done */
+		assert(op->buf == iov[0].iov_base);
+		op->state = SOCK_URING_OP_IDLE;
+		return op->res;
+	default:
+		break;
+	}
+
+	sqe = sock_uring_get_sqe(uring);
+	if (!sqe) {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = (struct iovec *) iov;
+		msg.msg_iovlen = iov_cnt;
+		ret = send ? ofi_sendmsg_tcp(fd, &msg, flags) :
+			     ofi_recvmsg_tcp(fd, &msg, flags);
+		return ret < 0 ? -ofi_sockerr() : ret;
+	}
+
+	sqe->fd = fd;
+	sqe->msg_flags = flags;
+	sqe->user_data = (uintptr_t) op;
+	if (iov_cnt == 1) {
+		sqe->opcode = send ? IORING_OP_SEND : IORING_OP_RECV;
+		sqe->addr = (uintptr_t) iov[0].iov_base;
+		sqe->len = MIN(iov[0].iov_len, INT_MAX);
+	} else {
+		/* the kernel reads the iovec when it gets to the request */
+		assert(iov_cnt <= SOCK_PE_MAX_IOV);
+		memcpy(op->iov, iov, sizeof(*iov) * iov_cnt);
+		memset(&op->msg, 0, sizeof(op->msg));
+		op->msg.msg_iov = op->iov;
+		op->msg.msg_iovlen = iov_cnt;
+		sqe->opcode = send ? IORING_OP_SENDMSG : IORING_OP_RECVMSG;
+		sqe->addr = (uintptr_t) &op->msg;
+		sqe->len = 1;
+	}
+
+	op->buf = iov[0].iov_base;
+	op->state = SOCK_URING_OP_BUSY;
+	return -FI_EINPROGRESS;
+}
+
+/*
+ * Return the number of bytes sent, a negative errno on failure, or
+ * -FI_EINPROGRESS while the send is queued or in flight.
+ */
+ssize_t sock_uring_send(struct sock_uring *uring,
+			struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt)
+{
+	return sock_uring_xfer(uring, &pe_entry->send_op, 1,
+			       pe_entry->conn->sock_fd, iov, iov_cnt,
+			       MSG_NOSIGNAL);
+}
+
+ssize_t sock_uring_recv(struct sock_uring *uring,
+			struct sock_pe_entry *pe_entry,
+			const struct iovec *iov, size_t iov_cnt)
+{
+	return sock_uring_xfer(uring, &pe_entry->recv_op, 0,
+			       pe_entry->conn->sock_fd, iov, iov_cnt, 0);
+}
+
+int sock_uring_progress(struct sock_uring *uring)
+{
+	sock_uring_enter(uring, 0);
+	return sock_uring_reap(uring);
+}
+
+static void sock_uring_cancel_op(struct sock_uring *uring,
+				 struct sock_uring_op *op)
+{
+	struct io_uring_sqe *sqe;
+	int ret;
+
+	if (op->state == SOCK_URING_OP_BUSY) {
+		sqe = sock_uring_get_sqe(uring);
+		if (sqe) {
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->addr = (uintptr_t) op;
+		}
+
+		/* the kernel may still be using the buffer until the op retires */
+		while (op->state == SOCK_URING_OP_BUSY) {
+			ret = sock_uring_enter(uring, 1);
+			if (ret && ret != -EINTR)
+				break;
+			sock_uring_reap(uring);
+		}
+	}
+	op->state = SOCK_URING_OP_IDLE;
+}
+
+void sock_uring_cancel(struct sock_uring *uring,
+		       struct sock_pe_entry *pe_entry)
+{
+	sock_uring_cancel_op(uring, &pe_entry->send_op);
+	sock_uring_cancel_op(uring, &pe_entry->recv_op);
+}
+
+#endif /* SOCKETS_HAVE_IO_URING */
@@ -32,6 +32,13 @@ AC_DEFUN([FI_UDP_CONFIGURE],[
 				[],
 				[udp_shm_happy=1],
 				[udp_shm_happy=0])])
+
+	       # batched datagram I/O is optional
+	       AC_CHECK_FUNCS([recvmmsg sendmmsg])
+	       AC_CHECK_DECLS([UDP_SEGMENT, UDP_GRO], [], [],
+			      [[#include <netinet/udp.h>]])
+	       AC_CHECK_DECLS([SO_REUSEPORT, SO_ATTACH_REUSEPORT_CBPF],
+			      [], [], [[#include <sys/socket.h>]])
 	      ])
 
 	AS_IF([test $udp_h_happy -eq 1 && \
@@ -41,6 +41,9 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
+#if HAVE_DECL_UDP_SEGMENT || HAVE_DECL_UDP_GRO
+#include <netinet/udp.h>
+#endif
 
 #include <rdma/fabric.h>
 #include <rdma/fi_atomic.h>
@@ -55,6 +58,7 @@
 
 #include <ofi.h>
 #include <ofi_enosys.h>
+#include <ofi_iov.h>
 #include <ofi_rbuf.h>
 #include <ofi_list.h>
 #include <ofi_signal.h>
@@ -72,6 +76,17 @@ extern struct fi_provider udpx_prov;
 extern struct util_prov udpx_util_prov;
 extern struct fi_info udpx_info;
 
+struct udpx_env {
+	int	rx_batch;
+	int	tx_batch;
+	int	tx_defer_usec;
+	int	gso;
+	int	gro;
+	char	*sep_steer;
+};
+
+extern struct udpx_env udpx_env;
+
 
 int udpx_fabric(struct fi_fabric_attr *attr, struct fid_fabric **fabric,
 		void *context);
@@ -83,6 +98,17 @@ int udpx_eq_open(struct fid_fabric *fabric, struct fi_eq_attr *attr,
 
 #define UDPX_FLAG_MULTI_RECV	1
 #define UDPX_IOV_LIMIT		4
+#define UDPX_MMSG_LIMIT		64
+#define UDPX_GSO_MAX_SEGS	64
+#define UDPX_GSO_MAX_BYTES	(UINT16_MAX - 40 - 8)
+#define UDPX_GRO_BUF_SIZE	(1 << 16)
+
+#if !HAVE_RECVMMSG && !HAVE_SENDMMSG
+struct mmsghdr {
+	struct msghdr		msg_hdr;
+	unsigned int		msg_len;
+};
+#endif
 
 struct udpx_ep_entry {
 	void			*context;
@@ -94,7 +120,61 @@ struct udpx_ep_entry {
 
 OFI_DECLARE_CIRQUE(struct udpx_ep_entry, udpx_rx_cirq);
 
+/*
+ * Sends deferred by FI_MORE or the tx_defer_usec budget.  The iov array
+ * references the user's buffers, which must remain valid until the send
+ * completes, same as for a non-deferred send.
+ */
+struct udpx_tx_entry {
+	void			*context;
+	struct iovec		iov[UDPX_IOV_LIMIT];
+	union ofi_sock_ip	addr;
+	socklen_t		addrlen;
+	uint8_t			iov_count;
+	size_t			len;
+};
+
+/*
+ * With GSO enabled, a single hdr may carry a train of queued sends to
+ * the same peer.  msg_cnt[i] is the number of entries covered by hdr[i].
+ */
+struct udpx_txq {
+	struct udpx_tx_entry	entry[UDPX_MMSG_LIMIT];
+	struct mmsghdr		hdr[UDPX_MMSG_LIMIT];
+	int			msg_cnt[UDPX_MMSG_LIMIT];
+	struct iovec		iov[UDPX_MMSG_LIMIT * UDPX_IOV_LIMIT];
+	union {
+		struct cmsghdr	align;
+		char		buf[CMSG_SPACE(sizeof(uint16_t))];
+	} ctrl[UDPX_MMSG_LIMIT];
+	int			count;
+	uint64_t		start_us;
+};
+
+struct udpx_rx_batch {
+	struct mmsghdr		hdr[UDPX_MMSG_LIMIT];
+	union ofi_sock_ip	addr[UDPX_MMSG_LIMIT];
+};
+
+/*
+ * A GRO receive may return a train of segments in one call.  Posted
+ * receives that can hold a segment of the last train's segment size
+ * (seg_hint) are scattered into directly, one segment each.  Segments
+ * that do not fit are left in buf and handed to posted receives one at
+ * a time, with anything left over held for the next progress call.
+ */
+struct udpx_gro {
+	union ofi_sock_ip	addr;
+	size_t			seg_hint;
+	size_t			seg_size;
+	size_t			len;
+	size_t			off;
+	struct iovec		iov[UDPX_MMSG_LIMIT * UDPX_IOV_LIMIT + 1];
+	uint8_t			buf[UDPX_GRO_BUF_SIZE];
+};
+
 struct udpx_ep;
+struct udpx_sep;
 typedef void (*udpx_rx_comp_func)(struct udpx_ep *ep, void *context,
 		uint64_t flags, size_t len, void *buf, void *addr);
 typedef void (*udpx_tx_comp_func)(struct udpx_ep *ep, void *context);
@@ -104,6 +184,13 @@ struct udpx_ep {
 	udpx_rx_comp_func	rx_comp;
 	udpx_tx_comp_func	tx_comp;
 	struct udpx_rx_cirq	*rxq;    /* protected by rx_cq lock */
+	struct udpx_rx_batch	*rx_batch; /* protected by rx_cq lock */
+	struct udpx_txq		*txq;    /* protected by tx_cq lock */
+	struct udpx_gro		*gro;    /* protected by rx_cq lock */
+	struct udpx_sep		*sep;    /* set for scalable ep contexts */
+	int			gso;
+	int			rx_batch_max;
+	int			tx_batch_max;
 	SOCKET			sock;
 	int			is_bound;
 	ofi_atomic32_t		ref;
@@ -111,6 +198,43 @@ struct udpx_ep {
 
 int udpx_endpoint(struct fid_domain *domain, struct fi_info *info,
 		  struct fid_ep **ep, void *context);
+int udpx_ctx_open(struct udpx_sep *sep, struct fi_info *info, SOCKET sock,
+		  struct udpx_ep **ep, void *context);
+void udpx_bind_src_addr(struct fid *fid);
+
+
+#define UDPX_MAX_CTX		16
+
+enum udpx_steer {
+	UDPX_STEER_HASH,
+	UDPX_STEER_CPU,
+	UDPX_STEER_SRC,
+};
+
+/*
+ * A scalable endpoint backs one address with a group of SO_REUSEPORT
+ * sockets, one per rx context, so that each rx context may be
+ * progressed by a separate thread.  Tx context i sends from socket
+ * i % sock_cnt so that replies return to the same address.
+ */
+struct udpx_sep {
+	struct fid_ep		ep_fid;
+	struct util_domain	*domain;
+	struct fi_info		*info;
+	struct util_av		*av;
+	struct util_eq		*eq;
+	fastlock_t		lock;
+	ofi_atomic32_t		ref;
+	int			is_bound;
+	int			sock_cnt;
+	SOCKET			sock[UDPX_MAX_CTX];
+	struct udpx_ep		*tx_ctx[UDPX_MAX_CTX];
+	struct udpx_ep		*rx_ctx[UDPX_MAX_CTX];
+};
+
+int udpx_scalable_ep(struct fid_domain *domain, struct fi_info *info,
+		     struct fid_ep **sep, void *context);
+void udpx_sep_remove_ctx(struct udpx_ep *ep);
 
 
 int udpx_cq_open(struct fid_domain *domain, struct fi_cq_attr *attr,
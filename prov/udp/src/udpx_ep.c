@@ -270,38 +270,425 @@ static void udpx_rx_src_comp_signal(struct udpx_ep *ep, void *context,
 	ep->util_ep.rx_cq->wait->signal(ep->util_ep.rx_cq->wait);
 }
 
-static void udpx_ep_progress(struct util_ep *util_ep)
+static int udpx_recvmmsg(SOCKET sock, struct mmsghdr *hdr, int cnt)
 {
-	struct udpx_ep *ep;
+#if HAVE_RECVMMSG
+	return recvmmsg(sock, hdr, cnt, 0, NULL);
+#else
+	ssize_t ret;
+
+	ret = ofi_recvmsg_udp(sock, &hdr->msg_hdr, 0);
+	if (ret < 0)
+		return -1;
+	hdr->msg_len = (unsigned int) ret;
+	return 1;
+#endif
+}
+
+static int udpx_sendmmsg(SOCKET sock, struct mmsghdr *hdr, int cnt)
+{
+#if HAVE_SENDMMSG
+	return sendmmsg(sock, hdr, cnt, 0);
+#else
+	ssize_t ret;
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		ret = ofi_sendmsg_udp(sock, &hdr[i].msg_hdr, 0);
+		if (ret < 0)
+			return i ? i : -1;
+		hdr[i].msg_len = (unsigned int) ret;
+	}
+	return cnt;
+#endif
+}
+
+struct udpx_tx_err {
+	void	*context;
+	int	err;
+};
+
+static bool udpx_gso_append(struct udpx_txq *txq, int first, int cnt,
+			    struct udpx_tx_entry *entry, size_t total)
+{
+	struct udpx_tx_entry *head = &txq->entry[first];
+
+	return cnt < UDPX_GSO_MAX_SEGS &&
+	       txq->entry[first + cnt - 1].len == head->len &&
+	       entry->len && entry->len <= head->len &&
+	       total + entry->len <= UDPX_GSO_MAX_BYTES &&
+	       entry->addrlen == head->addrlen &&
+	       !memcmp(&entry->addr, &head->addr, head->addrlen);
+}
+
+static void udpx_gso_set(struct udpx_txq *txq, int msg, size_t seg_size)
+{
+#if HAVE_DECL_UDP_SEGMENT
+	struct msghdr *hdr = &txq->hdr[msg].msg_hdr;
+	struct cmsghdr *cmsg;
+
+	hdr->msg_control = txq->ctrl[msg].buf;
+	hdr->msg_controllen = sizeof(txq->ctrl[msg].buf);
+	cmsg = CMSG_FIRSTHDR(hdr);
+	cmsg->cmsg_level = IPPROTO_UDP;
+	cmsg->cmsg_type = UDP_SEGMENT;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+	*(uint16_t *) CMSG_DATA(cmsg) = (uint16_t) seg_size;
+#endif
+}
+
+/*
+ * Set up the hdr array for the queued sends starting at entry first.
+ * With GSO, consecutive sends to the same peer are coalesced into a
+ * single train of equal sized segments, only the last of which may be
+ * short.  Returns the number of hdrs.
+ */
+static int udpx_txq_build(struct udpx_ep *ep, int first)
+{
+	struct udpx_txq *txq = ep->txq;
+	struct udpx_tx_entry *entry;
+	struct msghdr *hdr;
+	struct iovec *iov = txq->iov;
+	size_t total;
+	int msg;
+
+	for (msg = 0; first < txq->count; msg++) {
+		entry = &txq->entry[first];
+		hdr = &txq->hdr[msg].msg_hdr;
+		hdr->msg_name = &entry->addr;
+		hdr->msg_namelen = entry->addrlen;
+		hdr->msg_iov = iov;
+		hdr->msg_iovlen = 0;
+		hdr->msg_control = NULL;
+		hdr->msg_controllen = 0;
+		hdr->msg_flags = 0;
+
+		txq->msg_cnt[msg] = 0;
+		total = 0;
+		do {
+			memcpy(iov, entry->iov,
+			       sizeof(*iov) * entry->iov_count);
+			iov += entry->iov_count;
+			hdr->msg_iovlen += entry->iov_count;
+			total += entry->len;
+			txq->msg_cnt[msg]++;
+			entry = &txq->entry[first + txq->msg_cnt[msg]];
+		} while (ep->gso && first + txq->msg_cnt[msg] < txq->count &&
+			 udpx_gso_append(txq, first, txq->msg_cnt[msg],
+					 entry, total));
+
+		if (txq->msg_cnt[msg] > 1)
+			udpx_gso_set(txq, msg, txq->entry[first].len);
+		first += txq->msg_cnt[msg];
+	}
+	return msg;
+}
+
+/*
+ * Push queued sends to the socket with as few syscalls as possible.
+ * Sends that fail with a hard error are returned in err[] so that the
+ * caller may report them once the tx_cq lock has been released.  Sends
+ * that would block remain queued.  Caller holds the tx_cq lock.
+ */
+static int udpx_txq_send(struct udpx_ep *ep, struct udpx_tx_err *err)
+{
+	struct udpx_txq *txq = ep->txq;
+	int i, ret, msg = 0, msg_cnt, done = 0, err_cnt = 0;
+
+	msg_cnt = udpx_txq_build(ep, 0);
+	while (msg < msg_cnt) {
+		ret = udpx_sendmmsg(ep->sock, &txq->hdr[msg], msg_cnt - msg);
+		if (ret > 0) {
+			for (; ret; ret--, msg++) {
+				for (i = 0; i < txq->msg_cnt[msg]; i++, done++) {
+					ep->util_ep.tx_cq->reserved--;
+					ep->tx_comp(ep, txq->entry[done].context);
+				}
+			}
+			continue;
+		}
+
+		ret = ofi_sockerr();
+		if (OFI_SOCK_TRY_SND_RCV_AGAIN(ret))
+			break;
+
+		if (txq->msg_cnt[msg] > 1 && (ret == EINVAL || ret == EIO ||
+		    ret == EMSGSIZE || ret == ENOPROTOOPT)) {
+			FI_WARN(&udpx_prov, FI_LOG_EP_DATA,
+				"GSO send failed %d (%s), disabling GSO\n",
+				ret, strerror(ret));
+			ep->gso = 0;
+			msg_cnt = udpx_txq_build(ep, done);
+			msg = 0;
+			continue;
+		}
+
+		for (i = 0; i < txq->msg_cnt[msg]; i++, done++) {
+			ep->util_ep.tx_cq->reserved--;
+			err[err_cnt].context = txq->entry[done].context;
+			err[err_cnt++].err = ret;
+		}
+		msg++;
+	}
+
+	if (done) {
+		txq->count -= done;
+		memmove(&txq->entry[0], &txq->entry[done],
+			sizeof(txq->entry[0]) * txq->count);
+	}
+	return err_cnt;
+}
+
+static void udpx_tx_report_err(struct udpx_ep *ep, struct udpx_tx_err *err,
+			       int err_cnt)
+{
+	struct fi_cq_err_entry err_entry;
+	int i;
+
+	for (i = 0; i < err_cnt; i++) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_DATA, "send failed %d (%s)\n",
+			err[i].err, strerror(err[i].err));
+		memset(&err_entry, 0, sizeof err_entry);
+		err_entry.op_context = err[i].context;
+		err_entry.flags = FI_SEND;
+		err_entry.err = err[i].err;
+		err_entry.prov_errno = err[i].err;
+		(void) ofi_cq_write_error(ep->util_ep.tx_cq, &err_entry);
+	}
+}
+
+static bool udpx_tx_flush_needed(struct udpx_ep *ep, uint64_t flags)
+{
+	if (ep->txq->count >= ep->tx_batch_max)
+		return true;
+	if (flags & FI_MORE)
+		return false;
+
+	return !udpx_env.tx_defer_usec ||
+	       (fi_gettime_us() - ep->txq->start_us >=
+		(uint64_t) udpx_env.tx_defer_usec);
+}
+
+static void udpx_ep_progress_tx(struct udpx_ep *ep)
+{
+	struct udpx_tx_err err[UDPX_MMSG_LIMIT];
+	int err_cnt;
+
+	fastlock_acquire(&ep->util_ep.tx_cq->cq_lock);
+	err_cnt = (ep->txq->count && udpx_tx_flush_needed(ep, 0)) ?
+		  udpx_txq_send(ep, err) : 0;
+	fastlock_release(&ep->util_ep.tx_cq->cq_lock);
+
+	if (err_cnt)
+		udpx_tx_report_err(ep, err, err_cnt);
+}
+
+/*
+ * Lay out the receive iov for the next GRO train.  Each of the first
+ * posted receives that can hold seg_hint bytes is given exactly that
+ * much space, so a train of matching segments lands in place.  Until a
+ * train has been seen, only the first receive is used, at its full
+ * size.  The bounce buffer follows to catch the remainder.  Returns the
+ * number of receives used and the space given to each.
+ */
+static int udpx_gro_prep(struct udpx_ep *ep, int cnt, size_t *iov_cnt,
+			 size_t *seg)
+{
+	struct udpx_gro *gro = ep->gro;
+	struct udpx_ep_entry *entry;
+	size_t count, size;
+	int i;
+
+	*iov_cnt = 0;
+	*seg = gro->seg_hint;
+	if (!*seg) {
+		entry = ofi_cirque_head(ep->rxq);
+		*seg = MIN(ofi_total_iov_len(entry->iov, entry->iov_count),
+			   UDPX_GRO_BUF_SIZE);
+		cnt = 1;
+	}
+
+	for (i = 0, size = 0; i < cnt && *seg &&
+	     size + *seg <= UDPX_GRO_BUF_SIZE; i++, size += *seg) {
+		entry = &ep->rxq->buf[(ep->rxq->rcnt + i) &
+				      ep->rxq->size_mask];
+		count = entry->iov_count;
+		memcpy(&gro->iov[*iov_cnt], entry->iov,
+		       sizeof(*entry->iov) * count);
+		if (ofi_truncate_iov(&gro->iov[*iov_cnt], &count, *seg))
+			break;
+		*iov_cnt += count;
+	}
+
+	gro->iov[*iov_cnt].iov_base = gro->buf;
+	gro->iov[*iov_cnt].iov_len = sizeof(gro->buf) - size;
+	return i;
+}
+
+/*
+ * Receive the next GRO train and complete the receives it landed in.
+ * If the segments did not line up with the receive layout, the train
+ * is gathered back into the bounce buffer and handed out from there.
+ * Returns the number of receives completed, or a negative error.
+ * Caller holds the rx_cq lock and guarantees cnt posted receives and
+ * free CQ entries.
+ */
+static int udpx_gro_recv(struct udpx_ep *ep, int cnt)
+{
+	struct udpx_gro *gro = ep->gro;
+	union {
+		struct cmsghdr	align;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	} ctrl;
 	struct udpx_ep_entry *entry;
+	struct cmsghdr *cmsg;
 	struct msghdr hdr;
-	struct sockaddr_in6 addr;
+	size_t iov_cnt, seg, direct, len;
 	ssize_t ret;
+	int i, n, seg_size;
 
-	ep = container_of(util_ep, struct udpx_ep, util_ep);
-	hdr.msg_name = &addr;
-	hdr.msg_namelen = sizeof(addr);
-	hdr.msg_control = NULL;
-	hdr.msg_controllen = 0;
+	n = udpx_gro_prep(ep, cnt, &iov_cnt, &seg);
+	direct = n * seg;
+
+	hdr.msg_name = &gro->addr;
+	hdr.msg_namelen = sizeof(gro->addr);
+	hdr.msg_iov = gro->iov;
+	hdr.msg_iovlen = iov_cnt + 1;
+	hdr.msg_control = ctrl.buf;
+	hdr.msg_controllen = sizeof(ctrl.buf);
 	hdr.msg_flags = 0;
 
+	ret = ofi_recvmsg_udp(ep->sock, &hdr, 0);
+	if (ret < 0)
+		return -ofi_sockerr();
+
+	len = (size_t) ret;
+	gro->seg_size = len;
+#if HAVE_DECL_UDP_GRO
+	for (cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+		if (cmsg->cmsg_level == IPPROTO_UDP &&
+		    cmsg->cmsg_type == UDP_GRO) {
+			memcpy(&seg_size, CMSG_DATA(cmsg), sizeof(seg_size));
+			if (seg_size > 0) {
+				gro->seg_size = (size_t) seg_size;
+				gro->seg_hint = gro->seg_size;
+			}
+			break;
+		}
+	}
+#else
+	(void) cmsg;
+	(void) seg_size;
+#endif
+
+	gro->off = 0;
+	gro->len = len > direct ? len - direct : 0;
+	if (n && gro->seg_size != seg &&
+	    (len > gro->seg_size || len > seg)) {
+		memmove(&gro->buf[direct], gro->buf, gro->len);
+		ofi_copy_from_iov(gro->buf, MIN(len, direct), gro->iov,
+				  iov_cnt, 0);
+		gro->len = len;
+		return 0;
+	}
+
+	n = MIN(n, len ? (int) ((len + seg - 1) / seg) : 1);
+	for (i = 0; i < n; i++) {
+		entry = ofi_cirque_head(ep->rxq);
+		ep->rx_comp(ep, entry->context, 0, MIN(seg, len - i * seg),
+			    NULL, &gro->addr);
+		ofi_cirque_discard(ep->rxq);
+	}
+	return n;
+}
+
+/*
+ * Hand the segments of GRO trains to posted receives, one segment per
+ * receive and completion, as if each had arrived as its own datagram.
+ * Trains are received until the socket is drained or cnt receives have
+ * completed.  Caller holds the rx_cq lock and guarantees cnt posted
+ * receives and free CQ entries.
+ */
+static void udpx_ep_progress_gro(struct udpx_ep *ep, int cnt)
+{
+	struct udpx_gro *gro = ep->gro;
+	struct udpx_ep_entry *entry;
+	size_t seg, len;
+	int ret;
+
+	while (cnt) {
+		if (gro->off >= gro->len) {
+			ret = udpx_gro_recv(ep, cnt);
+			if (ret < 0)
+				break;
+			cnt -= ret;
+			continue;
+		}
+
+		seg = MIN(gro->seg_size, gro->len - gro->off);
+		entry = ofi_cirque_head(ep->rxq);
+		len = ofi_copy_to_iov(entry->iov, entry->iov_count, 0,
+				      &gro->buf[gro->off], seg);
+		ep->rx_comp(ep, entry->context, 0, len, NULL, &gro->addr);
+		ofi_cirque_discard(ep->rxq);
+		gro->off += seg;
+		cnt--;
+	}
+}
+
+static void udpx_ep_progress_rx(struct udpx_ep *ep)
+{
+	struct udpx_rx_batch *batch = ep->rx_batch;
+	struct udpx_ep_entry *entry;
+	struct msghdr *hdr;
+	int i, cnt;
+
 	fastlock_acquire(&ep->util_ep.rx_cq->cq_lock);
-	if (ofi_cirque_isempty(ep->rxq))
+	cnt = (int) MIN(ofi_cirque_usedcnt(ep->rxq),
+			ofi_cq_avail(ep->util_ep.rx_cq));
+	cnt = MIN(cnt, ep->rx_batch_max);
+	if (!cnt)
 		goto out;
 
-	entry = ofi_cirque_head(ep->rxq);
-	hdr.msg_iov = entry->iov;
-	hdr.msg_iovlen = entry->iov_count;
+	if (ep->gro) {
+		udpx_ep_progress_gro(ep, cnt);
+		goto out;
+	}
 
-	ret = ofi_recvmsg_udp(ep->sock, &hdr, 0);
-	if (ret >= 0) {
-		ep->rx_comp(ep, entry->context, 0, ret, NULL, &addr);
+	for (i = 0; i < cnt; i++) {
+		entry = &ep->rxq->buf[(ep->rxq->rcnt + i) & ep->rxq->size_mask];
+		hdr = &batch->hdr[i].msg_hdr;
+		hdr->msg_name = &batch->addr[i];
+		hdr->msg_namelen = sizeof(batch->addr[i]);
+		hdr->msg_iov = entry->iov;
+		hdr->msg_iovlen = entry->iov_count;
+		hdr->msg_control = NULL;
+		hdr->msg_controllen = 0;
+		hdr->msg_flags = 0;
+	}
+
+	cnt = udpx_recvmmsg(ep->sock, batch->hdr, cnt);
+	for (i = 0; i < cnt; i++) {
+		entry = ofi_cirque_head(ep->rxq);
+		ep->rx_comp(ep, entry->context, 0, batch->hdr[i].msg_len,
+			    NULL, &batch->addr[i]);
 		ofi_cirque_discard(ep->rxq);
 	}
 out:
 	fastlock_release(&ep->util_ep.rx_cq->cq_lock);
 }
 
+static void udpx_ep_progress(struct util_ep *util_ep)
+{
+	struct udpx_ep *ep;
+
+	ep = container_of(util_ep, struct udpx_ep, util_ep);
+	if (ep->txq && ep->util_ep.tx_cq)
+		udpx_ep_progress_tx(ep);
+	if (ep->util_ep.rx_cq)
+		udpx_ep_progress_rx(ep);
+}
+
 static ssize_t udpx_recvmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 			    uint64_t flags)
 {
@@ -387,30 +774,114 @@ udpx_dest_addrlen(struct udpx_ep *ep, fi_addr_t addr, uint64_t flags)
 		ep->util_ep.av->addrlen;
 }
 
-static ssize_t udpx_sendto(struct udpx_ep *ep, const void *buf, size_t len,
-			   const void *addr, size_t addrlen, void *context)
+static bool udpx_tx_defer(struct udpx_ep *ep, size_t iov_count,
+			  uint64_t flags)
+{
+	return ep->txq && !(flags & FI_INJECT) &&
+	       iov_count <= UDPX_IOV_LIMIT &&
+	       ((flags & FI_MORE) || udpx_env.tx_defer_usec ||
+		ep->txq->count);
+}
+
+/*
+ * Queue a send behind any earlier deferred sends, flushing the queue
+ * once the caller stops setting FI_MORE, the batch fills, or the
+ * deferral budget expires.  Caller holds the tx_cq lock.
+ */
+static ssize_t udpx_tx_queue(struct udpx_ep *ep, const struct iovec *iov,
+			     size_t iov_count, const void *addr,
+			     size_t addrlen, void *context, uint64_t flags,
+			     struct udpx_tx_err *err, int *err_cnt)
 {
+	struct udpx_txq *txq = ep->txq;
+	struct udpx_tx_entry *entry;
+
+	if (txq->count >= ep->tx_batch_max) {
+		*err_cnt = udpx_txq_send(ep, err);
+		if (txq->count >= ep->tx_batch_max)
+			return -FI_EAGAIN;
+	}
+
+	if (!txq->count && udpx_env.tx_defer_usec)
+		txq->start_us = fi_gettime_us();
+
+	/* the completion is written when the queue is flushed, possibly
+	 * after other endpoints sharing the CQ have posted */
+	ep->util_ep.tx_cq->reserved++;
+	entry = &txq->entry[txq->count++];
+	entry->context = context;
+	memcpy(entry->iov, iov, sizeof(*iov) * iov_count);
+	entry->iov_count = (uint8_t) iov_count;
+	memcpy(&entry->addr, addr, addrlen);
+	entry->addrlen = (socklen_t) addrlen;
+	entry->len = ofi_total_iov_len(iov, iov_count);
+
+	if (udpx_tx_flush_needed(ep, flags))
+		*err_cnt += udpx_txq_send(ep, err + *err_cnt);
+	return 0;
+}
+
+static ssize_t udpx_tx_post(struct udpx_ep *ep, const struct iovec *iov,
+			    size_t iov_count, const void *addr,
+			    size_t addrlen, void *context, uint64_t flags)
+{
+	struct udpx_tx_err err[UDPX_MMSG_LIMIT * 2];
+	struct msghdr hdr;
+	int err_cnt = 0;
 	ssize_t ret;
 
 	fastlock_acquire(&ep->util_ep.tx_cq->cq_lock);
-	if (ofi_cirque_isfull(ep->util_ep.tx_cq->cirq)) {
+	if (!ofi_cq_avail(ep->util_ep.tx_cq)) {
 		ret = -FI_EAGAIN;
 		goto out;
 	}
 
-	ret = ofi_sendto_socket(ep->sock, buf, len, 0,
-				addr, (socklen_t)addrlen);
-	if (ret == (ssize_t)len) {
+	if (udpx_tx_defer(ep, iov_count, flags)) {
+		ret = udpx_tx_queue(ep, iov, iov_count, addr, addrlen,
+				    context, flags, err, &err_cnt);
+		goto out;
+	}
+
+	if (ep->txq && ep->txq->count) {
+		err_cnt = udpx_txq_send(ep, err);
+		if (ep->txq->count) {
+			ret = -FI_EAGAIN;
+			goto out;
+		}
+	}
+
+	hdr.msg_name = (void *) addr;
+	hdr.msg_namelen = (socklen_t) addrlen;
+	hdr.msg_iov = (struct iovec *) iov;
+	hdr.msg_iovlen = iov_count;
+	hdr.msg_control = NULL;
+	hdr.msg_controllen = 0;
+	hdr.msg_flags = 0;
+
+	ret = ofi_sendmsg_udp(ep->sock, &hdr, 0);
+	if (ret >= 0) {
 		ep->tx_comp(ep, context);
 		ret = 0;
 	} else {
-		ret = -errno;
+		ret = -ofi_sockerr();
 	}
 out:
 	fastlock_release(&ep->util_ep.tx_cq->cq_lock);
+	if (err_cnt)
+		udpx_tx_report_err(ep, err, err_cnt);
 	return ret;
 }
 
+static ssize_t udpx_sendto(struct udpx_ep *ep, const void *buf, size_t len,
+			   const void *addr, size_t addrlen, void *context)
+{
+	struct iovec iov;
+
+	iov.iov_base = (void *) buf;
+	iov.iov_len = len;
+	return udpx_tx_post(ep, &iov, 1, addr, addrlen, context, 0);
+}
+
 static ssize_t udpx_send(struct fid_ep *ep_fid, const void *buf, size_t len,
 			 void *desc, fi_addr_t dest_addr, void *context)
 {
@@ -436,34 +907,12 @@ static ssize_t udpx_sendmsg(struct fid_ep *ep_fid, const struct fi_msg *msg,
 			    uint64_t flags)
 {
 	struct udpx_ep *ep;
-	struct msghdr hdr;
-	ssize_t ret;
 
 	ep = container_of(ep_fid, struct udpx_ep, util_ep.ep_fid.fid);
-	hdr.msg_name = (void *)udpx_dest_addr(ep, msg->addr, flags);
-	hdr.msg_namelen = (int)udpx_dest_addrlen(ep, msg->addr, flags);
-	hdr.msg_iov = (struct iovec *)msg->msg_iov;
-	hdr.msg_iovlen = msg->iov_count;
-	hdr.msg_control = NULL;
-	hdr.msg_controllen = 0;
-	hdr.msg_flags = 0;
-
-	fastlock_acquire(&ep->util_ep.tx_cq->cq_lock);
-	if (ofi_cirque_isfull(ep->util_ep.tx_cq->cirq)) {
-		ret = -FI_EAGAIN;
-		goto out;
-	}
-
-	ret = ofi_sendmsg_udp(ep->sock, &hdr, 0);
-	if (ret >= 0) {
-		ep->tx_comp(ep, msg->context);
-		ret = 0;
-	} else {
-		ret = -errno;
-	}
-out:
-	fastlock_release(&ep->util_ep.tx_cq->cq_lock);
-	return ret;
+	return udpx_tx_post(ep, msg->msg_iov, msg->iov_count,
+			    udpx_dest_addr(ep, msg->addr, flags),
+			    udpx_dest_addrlen(ep, msg->addr, flags),
+			    msg->context, flags);
 }
 
 static ssize_t udpx_sendv(struct fid_ep *ep_fid, const struct iovec *iov,
@@ -568,8 +1017,25 @@ static int udpx_ep_close(struct fid *fid)
 				&ep->util_ep.ep_fid.fid);
 	}
 
+	if (ep->util_ep.tx_cq) {
+		fid_list_remove(&ep->util_ep.tx_cq->ep_list,
+				&ep->util_ep.tx_cq->ep_list_lock,
+				&ep->util_ep.ep_fid.fid);
+		if (ep->txq) {
+			fastlock_acquire(&ep->util_ep.tx_cq->cq_lock);
+			ep->util_ep.tx_cq->reserved -= ep->txq->count;
+			fastlock_release(&ep->util_ep.tx_cq->cq_lock);
+		}
+	}
+
+	free(ep->gro);
+	free(ep->txq);
+	free(ep->rx_batch);
 	udpx_rx_cirq_free(ep->rxq);
-	ofi_close_socket(ep->sock);
+	if (ep->sep)
+		udpx_sep_remove_ctx(ep);
+	else
+		ofi_close_socket(ep->sock);
 	ofi_endpoint_close(&ep->util_ep);
 	free(ep);
 	return 0;
@@ -590,6 +1056,15 @@ static int udpx_ep_bind_cq(struct udpx_ep *ep, struct util_cq *cq,
 		ofi_atomic_inc32(&cq->ref);
 		ep->tx_comp = cq->wait ? udpx_tx_comp_signal :
 					 udpx_tx_comp;
+
+		/* progress the tx cq to flush deferred sends */
+		if (ep->txq) {
+			ret = fid_list_insert(&cq->ep_list,
+					      &cq->ep_list_lock,
+					      &ep->util_ep.ep_fid.fid);
+			if (ret)
+				return ret;
+		}
 	}
 
 	if (flags & FI_RECV) {
@@ -658,7 +1133,7 @@ static int udpx_ep_bind(struct fid *ep_fid, struct fid *bfid, uint64_t flags)
 	return ret;
 }
 
-static void udpx_bind_src_addr(struct udpx_ep *ep)
+void udpx_bind_src_addr(struct fid *fid)
 {
 	int ret;
 	struct addrinfo ai, *rai = NULL, *cur_ai;
@@ -680,8 +1155,7 @@ static void udpx_bind_src_addr(struct udpx_ep *ep)
 		;
 
 	if (cur_ai) {
-		ret = udpx_setname(&ep->util_ep.ep_fid.fid, cur_ai->ai_addr,
-				   cur_ai->ai_addrlen);
+		ret = fi_setname(fid, cur_ai->ai_addr, cur_ai->ai_addrlen);
 	} else {
 		ret = -FI_EADDRNOTAVAIL;
 	}
@@ -698,13 +1172,21 @@ static int udpx_ep_ctrl(struct fid *fid, int command, void *arg)
 	ep = container_of(fid, struct udpx_ep, util_ep.ep_fid.fid);
 	switch (command) {
 	case FI_ENABLE:
-		if (!ep->util_ep.rx_cq || !ep->util_ep.tx_cq)
+		/* scalable ep contexts only need the CQ for their direction */
+		if (ep->sep) {
+			if ((ofi_send_allowed(ep->util_ep.caps) &&
+			     !ep->util_ep.tx_cq) ||
+			    (ofi_recv_allowed(ep->util_ep.caps) &&
+			     !ep->util_ep.rx_cq))
+				return -FI_ENOCQ;
+		} else if (!ep->util_ep.rx_cq || !ep->util_ep.tx_cq) {
 			return -FI_ENOCQ;
+		}
 		if (!ep->util_ep.av)
 			return -FI_ENOAV;
 
 		if (!ep->is_bound)
-			udpx_bind_src_addr(ep);
+			udpx_bind_src_addr(&ep->util_ep.ep_fid.fid);
 		break;
 	default:
 		return -FI_ENOSYS;
@@ -720,7 +1202,56 @@ static struct fi_ops udpx_ep_fi_ops = {
 	.ops_open = fi_no_ops_open,
 };
 
-static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info)
+static void udpx_ep_init_gso(struct udpx_ep *ep)
+{
+#if HAVE_DECL_UDP_SEGMENT
+	socklen_t len;
+	int val;
+
+	if (!udpx_env.gso)
+		return;
+
+	if (!ep->txq) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"GSO requires tx batching, ignoring\n");
+		return;
+	}
+
+	len = sizeof(val);
+	if (getsockopt(ep->sock, IPPROTO_UDP, UDP_SEGMENT, (void *) &val,
+		       &len)) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"GSO not supported %d (%s)\n", errno, strerror(errno));
+		return;
+	}
+	ep->gso = 1;
+#endif
+}
+
+static int udpx_ep_init_gro(struct udpx_ep *ep)
+{
+#if HAVE_DECL_UDP_GRO
+	int val = 1;
+
+	if (!udpx_env.gro)
+		return 0;
+
+	if (setsockopt(ep->sock, IPPROTO_UDP, UDP_GRO, (void *) &val,
+		       sizeof(val))) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"GRO not supported %d (%s)\n", errno, strerror(errno));
+		return 0;
+	}
+
+	ep->gro = calloc(1, sizeof(*ep->gro));
+	if (!ep->gro)
+		return -FI_ENOMEM;
+#endif
+	return 0;
+}
+
+static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info,
+			SOCKET sock)
 {
 	int family;
 	int ret;
@@ -732,6 +1263,29 @@ static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info)
 		return ret;
 	}
 
+	ep->rx_batch_max = udpx_env.rx_batch;
+	ep->rx_batch = calloc(1, sizeof(*ep->rx_batch));
+	if (!ep->rx_batch) {
+		ret = -FI_ENOMEM;
+		goto err1;
+	}
+
+	ep->tx_batch_max = udpx_env.tx_batch;
+	if (ep->tx_batch_max > 1) {
+		ep->txq = calloc(1, sizeof(*ep->txq));
+		if (!ep->txq) {
+			ret = -FI_ENOMEM;
+			goto err1;
+		}
+	}
+
+	/* scalable ep contexts share a socket owned by the sep */
+	if (sock != INVALID_SOCKET) {
+		ep->sock = sock;
+		ep->is_bound = 1;
+		goto offload;
+	}
+
 	family = info->src_addr ?
 		 ((struct sockaddr *) info->src_addr)->sa_family : AF_INET;
 	ep->sock = socket(family, SOCK_DGRAM, IPPROTO_UDP);
@@ -751,16 +1305,27 @@ static int udpx_ep_init(struct udpx_ep *ep, struct fi_info *info)
 	if (ret)
 		goto err2;
 
+offload:
+	udpx_ep_init_gso(ep);
+	if (ofi_recv_allowed(ep->util_ep.caps)) {
+		ret = udpx_ep_init_gro(ep);
+		if (ret)
+			goto err2;
+	}
+
 	return 0;
 err2:
-	ofi_close_socket(ep->sock);
+	if (sock == INVALID_SOCKET)
+		ofi_close_socket(ep->sock);
 err1:
+	free(ep->txq);
+	free(ep->rx_batch);
 	udpx_rx_cirq_free(ep->rxq);
 	return ret;
 }
 
-int udpx_endpoint(struct fid_domain *domain, struct fi_info *info,
-		  struct fid_ep **ep_fid, void *context)
+static int udpx_ep_open(struct fid_domain *domain, struct fi_info *info,
+			SOCKET sock, struct udpx_ep **ep_out, void *context)
 {
 	struct udpx_ep *ep;
 	int ret;
@@ -774,17 +1339,16 @@ int udpx_endpoint(struct fid_domain *domain, struct fi_info *info,
 	if (ret)
 		goto err1;
 
-	ret = udpx_ep_init(ep, info);
+	ret = udpx_ep_init(ep, info, sock);
 	if (ret)
 		goto err2;
 
-	*ep_fid = &ep->util_ep.ep_fid;
-	(*ep_fid)->fid.ops = &udpx_ep_fi_ops;
-	(*ep_fid)->ops = &udpx_ep_ops;
-	(*ep_fid)->cm = &udpx_cm_ops;
-	(*ep_fid)->msg = (info->tx_attr->op_flags & FI_MULTICAST) ?
-			 &udpx_msg_mcast_ops : &udpx_msg_ops;
-
+	ep->util_ep.ep_fid.fid.ops = &udpx_ep_fi_ops;
+	ep->util_ep.ep_fid.ops = &udpx_ep_ops;
+	ep->util_ep.ep_fid.cm = &udpx_cm_ops;
+	ep->util_ep.ep_fid.msg = (info->tx_attr->op_flags & FI_MULTICAST) ?
+				 &udpx_msg_mcast_ops : &udpx_msg_ops;
+	*ep_out = ep;
 	return 0;
 err2:
 	ofi_endpoint_close(&ep->util_ep);
@@ -792,3 +1356,52 @@ err1:
 	free(ep);
 	return ret;
 }
+
+int udpx_endpoint(struct fid_domain *domain, struct fi_info *info,
+		  struct fid_ep **ep_fid, void *context)
+{
+	struct udpx_ep *ep;
+	int ret;
+
+	ret = udpx_ep_open(domain, info, INVALID_SOCKET, &ep, context);
+	if (ret)
+		return ret;
+
+	*ep_fid = &ep->util_ep.ep_fid;
+	return 0;
+}
+
+/*
+ * Open a tx or rx context of a scalable endpoint.  The context is a
+ * regular udp endpoint restricted to one direction that shares one of
+ * the sep's sockets.
+ */
+int udpx_ctx_open(struct udpx_sep *sep, struct fi_info *info, SOCKET sock,
+		  struct udpx_ep **ep_out, void *context)
+{
+	struct udpx_ep *ep;
+	int ret;
+
+	ret = udpx_ep_open(&sep->domain->domain_fid, info, sock, &ep,
+			   context);
+	if (ret)
+		return ret;
+
+	ep->sep = sep;
+	if (sep->av) {
+		ret = ofi_ep_bind_av(&ep->util_ep, sep->av);
+		if (ret)
+			goto err;
+	}
+	if (sep->eq) {
+		ret = ofi_ep_bind_eq(&ep->util_ep, sep->eq);
+		if (ret)
+			goto err;
+	}
+
+	*ep_out = ep;
+	return 0;
+err:
+	fi_close(&ep->util_ep.ep_fid.fid);
+	return ret;
+}
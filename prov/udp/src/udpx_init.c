@@ -96,6 +96,28 @@ static void udpx_getinfo_ifs(struct fi_info **info)
 #define udpx_getinfo_ifs(info) do{}while(0)
 #endif
 
+struct udpx_env udpx_env = {
+	.rx_batch	= 32,
+	.tx_batch	= 32,
+	.tx_defer_usec	= 0,
+	.gso		= 0,
+	.gro		= 0,
+};
+
+static void udpx_init_env(void)
+{
+	fi_param_get_int(&udpx_prov, "rx_batch", &udpx_env.rx_batch);
+	fi_param_get_int(&udpx_prov, "tx_batch", &udpx_env.tx_batch);
+	fi_param_get_int(&udpx_prov, "tx_defer_usec", &udpx_env.tx_defer_usec);
+	fi_param_get_bool(&udpx_prov, "gso", &udpx_env.gso);
+	fi_param_get_bool(&udpx_prov, "gro", &udpx_env.gro);
+	fi_param_get_str(&udpx_prov, "sep_steer", &udpx_env.sep_steer);
+
+	udpx_env.rx_batch = MIN(MAX(udpx_env.rx_batch, 1), UDPX_MMSG_LIMIT);
+	udpx_env.tx_batch = MIN(MAX(udpx_env.tx_batch, 0), UDPX_MMSG_LIMIT);
+	udpx_env.tx_defer_usec = MAX(udpx_env.tx_defer_usec, 0);
+}
+
 static int udpx_getinfo(uint32_t version, const char *node, const char *service,
 			uint64_t flags, const struct fi_info *hints,
 			struct fi_info **info)
@@ -131,6 +153,30 @@ UDP_INI
 {
 	fi_param_define(&udpx_prov, "iface", FI_PARAM_STRING,
 			"Specify interface name");
+	fi_param_define(&udpx_prov, "rx_batch", FI_PARAM_INT,
+			"Maximum number of datagrams received per progress "
+			"call (default: 32, max: 64)");
+	fi_param_define(&udpx_prov, "tx_batch", FI_PARAM_INT,
+			"Maximum number of sends that may be deferred and "
+			"flushed together.  0 or 1 disables deferring sends "
+			"(default: 32, max: 64)");
+	fi_param_define(&udpx_prov, "tx_defer_usec", FI_PARAM_INT,
+			"Defer all sends, not just those posted with FI_MORE, "
+			"for up to this many microseconds so that they may "
+			"be batched.  0 disables (default: 0)");
+	fi_param_define(&udpx_prov, "gso", FI_PARAM_BOOL,
+			"Use UDP segmentation offload to send queued "
+			"datagrams to the same peer as a single train "
+			"(default: no)");
+	fi_param_define(&udpx_prov, "gro", FI_PARAM_BOOL,
+			"Use UDP receive offload to receive trains of "
+			"datagrams with a single call (default: no)");
+	fi_param_define(&udpx_prov, "sep_steer", FI_PARAM_STRING,
+			"How datagrams are spread across the rx contexts of "
+			"a scalable endpoint: hash (kernel hash of source "
+			"address and port), cpu (receiving CPU), or src "
+			"(source address only) (default: hash)");
+	udpx_init_env();
 
 	return &udpx_prov;
 }
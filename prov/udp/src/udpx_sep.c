@@ -0,0 +1,510 @@
+/*
+ * Copyright (c) 2020 Intel Corporation. All rights reserved.
+ *
+ * This software is available to you under a choice of one of two
+ * licenses.  You may choose to be licensed under the terms of the GNU
+ * General Public License (GPL) Version 2, available from the file
+ * COPYING in the main directory of this source tree, or the
+ * BSD license below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "udpx.h"
+
+#if HAVE_DECL_SO_ATTACH_REUSEPORT_CBPF
+#include <linux/filter.h>
+#endif
+
+
+static enum udpx_steer udpx_sep_steer_type(void)
+{
+	if (!udpx_env.sep_steer || !strcasecmp(udpx_env.sep_steer, "hash"))
+		return UDPX_STEER_HASH;
+	if (!strcasecmp(udpx_env.sep_steer, "cpu"))
+		return UDPX_STEER_CPU;
+	if (!strcasecmp(udpx_env.sep_steer, "src"))
+		return UDPX_STEER_SRC;
+
+	FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+		"unknown steering mode %s, using hash\n", udpx_env.sep_steer);
+	return UDPX_STEER_HASH;
+}
+
+/*
+ * By default the kernel selects a socket from the reuseport group by
+ * hashing the source address and port.  Optionally replace that with a
+ * classic BPF program that selects by receiving CPU or by source address
+ * alone.  Must be called once all sockets have joined the group.
+ */
+static int udpx_sep_attach_steer(struct udpx_sep *sep, int family)
+{
+#if HAVE_DECL_SO_ATTACH_REUSEPORT_CBPF
+	struct sock_filter code[3];
+	struct sock_fprog prog;
+
+	switch (udpx_sep_steer_type()) {
+	case UDPX_STEER_CPU:
+		code[0] = (struct sock_filter)
+			{ BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU };
+		break;
+	case UDPX_STEER_SRC:
+		/* last word of the source IP address */
+		code[0] = (struct sock_filter)
+			{ BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_NET_OFF +
+			  (family == AF_INET6 ? 20 : 12) };
+		break;
+	default:
+		return 0;
+	}
+	code[1] = (struct sock_filter)
+		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t) sep->sock_cnt };
+	code[2] = (struct sock_filter) { BPF_RET | BPF_A, 0, 0, 0 };
+
+	prog.len = sizeof(code) / sizeof(code[0]);
+	prog.filter = code;
+	if (setsockopt(sep->sock[0], SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+		       (void *) &prog, sizeof(prog))) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"attach steering program failed %d (%s)\n",
+			errno, strerror(errno));
+		return -errno;
+	}
+	return 0;
+#else
+	if (udpx_sep_steer_type() != UDPX_STEER_HASH) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"steering programs not supported, using hash\n");
+	}
+	return 0;
+#endif
+}
+
+static int udpx_sep_setname(fid_t fid, void *addr, size_t addrlen)
+{
+	struct udpx_sep *sep;
+	union ofi_sock_ip bound_addr;
+	socklen_t len;
+	int i, ret = 0;
+
+	sep = container_of(fid, struct udpx_sep, ep_fid.fid);
+	fastlock_acquire(&sep->lock);
+	if (sep->is_bound) {
+		ret = -FI_EINVAL;
+		goto out;
+	}
+
+	ofi_straddr_dbg(&udpx_prov, FI_LOG_EP_CTRL, "bind addr: ", addr);
+	if (bind(sep->sock[0], addr, (socklen_t) addrlen)) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL, "bind %d (%s)\n",
+			errno, strerror(errno));
+		ret = -errno;
+		goto out;
+	}
+
+	/* pick up the port assigned by the kernel, if any */
+	len = sizeof(bound_addr);
+	if (ofi_getsockname(sep->sock[0], &bound_addr.sa, &len)) {
+		ret = -ofi_sockerr();
+		goto out;
+	}
+
+	for (i = 1; i < sep->sock_cnt; i++) {
+		if (bind(sep->sock[i], &bound_addr.sa, len)) {
+			FI_WARN(&udpx_prov, FI_LOG_EP_CTRL, "bind %d (%s)\n",
+				errno, strerror(errno));
+			ret = -errno;
+			goto out;
+		}
+	}
+
+	ret = udpx_sep_attach_steer(sep, bound_addr.sa.sa_family);
+	if (!ret)
+		sep->is_bound = 1;
+out:
+	fastlock_release(&sep->lock);
+	return ret;
+}
+
+static int udpx_sep_getname(fid_t fid, void *addr, size_t *addrlen)
+{
+	struct udpx_sep *sep;
+	size_t buflen = *addrlen;
+
+	sep = container_of(fid, struct udpx_sep, ep_fid.fid);
+	if (ofi_getsockname(sep->sock[0], addr, (socklen_t *) addrlen))
+		return -ofi_sockerr();
+
+	return buflen < *addrlen ? -FI_ETOOSMALL : 0;
+}
+
+static struct fi_ops_cm udpx_sep_cm_ops = {
+	.size = sizeof(struct fi_ops_cm),
+	.setname = udpx_sep_setname,
+	.getname = udpx_sep_getname,
+	.getpeer = fi_no_getpeer,
+	.connect = fi_no_connect,
+	.listen = fi_no_listen,
+	.accept = fi_no_accept,
+	.reject = fi_no_reject,
+	.shutdown = fi_no_shutdown,
+	.join = fi_no_join,
+};
+
+static struct fi_info *
+udpx_sep_ctx_info(struct udpx_sep *sep, uint64_t caps,
+		  const struct fi_tx_attr *tx_attr,
+		  const struct fi_rx_attr *rx_attr)
+{
+	struct fi_info *info;
+
+	info = fi_dupinfo(sep->info);
+	if (!info)
+		return NULL;
+
+	info->caps = caps;
+	info->ep_attr->tx_ctx_cnt = 1;
+	info->ep_attr->rx_ctx_cnt = 1;
+	if (tx_attr)
+		*info->tx_attr = *tx_attr;
+	if (rx_attr)
+		*info->rx_attr = *rx_attr;
+	return info;
+}
+
+/*
+ * The context is opened without holding sep->lock, since closing it on
+ * a failure path takes the lock in udpx_sep_remove_ctx.  The lock only
+ * covers publishing the context, and a context that loses a race to
+ * fill the same slot is closed again.
+ */
+static int udpx_sep_ctx(struct udpx_sep *sep, struct udpx_ep **ctx,
+			struct fi_info *info, SOCKET sock,
+			struct fid_ep **ep_fid, void *context)
+{
+	struct udpx_ep *new_ctx;
+	int ret;
+
+	if (!info)
+		return -FI_ENOMEM;
+
+	ret = udpx_ctx_open(sep, info, sock, &new_ctx, context);
+	fi_freeinfo(info);
+	if (ret)
+		return ret;
+
+	fastlock_acquire(&sep->lock);
+	if (*ctx) {
+		fastlock_release(&sep->lock);
+		fi_close(&new_ctx->util_ep.ep_fid.fid);
+		return -FI_EBUSY;
+	}
+	*ctx = new_ctx;
+	ofi_atomic_inc32(&sep->ref);
+	fastlock_release(&sep->lock);
+
+	*ep_fid = &new_ctx->util_ep.ep_fid;
+	return 0;
+}
+
+static int udpx_sep_tx_ctx(struct fid_ep *ep, int index,
+			   struct fi_tx_attr *attr, struct fid_ep **tx_ep,
+			   void *context)
+{
+	struct udpx_sep *sep;
+
+	sep = container_of(ep, struct udpx_sep, ep_fid);
+	if (index < 0 || (size_t) index >= sep->info->ep_attr->tx_ctx_cnt)
+		return -FI_EINVAL;
+
+	if (!sep->is_bound)
+		udpx_bind_src_addr(&sep->ep_fid.fid);
+
+	return udpx_sep_ctx(sep, &sep->tx_ctx[index],
+			    udpx_sep_ctx_info(sep, (sep->info->caps & ~FI_RECV) |
+					      FI_SEND, attr, NULL),
+			    sep->sock[index % sep->sock_cnt], tx_ep, context);
+}
+
+static int udpx_sep_rx_ctx(struct fid_ep *ep, int index,
+			   struct fi_rx_attr *attr, struct fid_ep **rx_ep,
+			   void *context)
+{
+	struct udpx_sep *sep;
+
+	sep = container_of(ep, struct udpx_sep, ep_fid);
+	if (index < 0 || index >= sep->sock_cnt)
+		return -FI_EINVAL;
+
+	if (!sep->is_bound)
+		udpx_bind_src_addr(&sep->ep_fid.fid);
+
+	return udpx_sep_ctx(sep, &sep->rx_ctx[index],
+			    udpx_sep_ctx_info(sep, (sep->info->caps & ~FI_SEND) |
+					      FI_RECV, NULL, attr),
+			    sep->sock[index], rx_ep, context);
+}
+
+static struct fi_ops_ep udpx_sep_ops = {
+	.size = sizeof(struct fi_ops_ep),
+	.cancel = fi_no_cancel,
+	.getopt = fi_no_getopt,
+	.setopt = fi_no_setopt,
+	.tx_ctx = udpx_sep_tx_ctx,
+	.rx_ctx = udpx_sep_rx_ctx,
+	.rx_size_left = fi_no_rx_size_left,
+	.tx_size_left = fi_no_tx_size_left,
+};
+
+void udpx_sep_remove_ctx(struct udpx_ep *ep)
+{
+	struct udpx_sep *sep = ep->sep;
+	int i;
+
+	fastlock_acquire(&sep->lock);
+	for (i = 0; i < UDPX_MAX_CTX; i++) {
+		if (sep->tx_ctx[i] == ep || sep->rx_ctx[i] == ep) {
+			if (sep->tx_ctx[i] == ep)
+				sep->tx_ctx[i] = NULL;
+			else
+				sep->rx_ctx[i] = NULL;
+			ofi_atomic_dec32(&sep->ref);
+			break;
+		}
+	}
+	fastlock_release(&sep->lock);
+}
+
+static int udpx_sep_close(struct fid *fid)
+{
+	struct udpx_sep *sep;
+	int i;
+
+	sep = container_of(fid, struct udpx_sep, ep_fid.fid);
+	if (ofi_atomic_get32(&sep->ref)) {
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL, "SEP busy\n");
+		return -FI_EBUSY;
+	}
+
+	for (i = 0; i < sep->sock_cnt; i++)
+		ofi_close_socket(sep->sock[i]);
+	if (sep->av)
+		ofi_atomic_dec32(&sep->av->ref);
+	if (sep->eq)
+		ofi_atomic_dec32(&sep->eq->ref);
+	ofi_atomic_dec32(&sep->domain->ref);
+	fastlock_destroy(&sep->lock);
+	fi_freeinfo(sep->info);
+	free(sep);
+	return 0;
+}
+
+static int udpx_sep_bind(struct fid *fid, struct fid *bfid, uint64_t flags)
+{
+	struct udpx_sep *sep;
+	int i, ret;
+
+	ret = ofi_ep_bind_valid(&udpx_prov, bfid, flags);
+	if (ret)
+		return ret;
+
+	sep = container_of(fid, struct udpx_sep, ep_fid.fid);
+	fastlock_acquire(&sep->lock);
+	switch (bfid->fclass) {
+	case FI_CLASS_AV:
+		if (sep->av) {
+			ret = -FI_EINVAL;
+			break;
+		}
+		sep->av = container_of(bfid, struct util_av, av_fid.fid);
+		ofi_atomic_inc32(&sep->av->ref);
+		for (i = 0; i < UDPX_MAX_CTX && !ret; i++) {
+			if (sep->tx_ctx[i])
+				ret = ofi_ep_bind_av(&sep->tx_ctx[i]->util_ep,
+						     sep->av);
+			if (sep->rx_ctx[i] && !ret)
+				ret = ofi_ep_bind_av(&sep->rx_ctx[i]->util_ep,
+						     sep->av);
+		}
+		break;
+	case FI_CLASS_EQ:
+		if (sep->eq) {
+			ret = -FI_EINVAL;
+			break;
+		}
+		sep->eq = container_of(bfid, struct util_eq, eq_fid.fid);
+		ofi_atomic_inc32(&sep->eq->ref);
+		break;
+	default:
+		FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+			"invalid fid class\n");
+		ret = -FI_EINVAL;
+		break;
+	}
+	fastlock_release(&sep->lock);
+	return ret;
+}
+
+static int udpx_sep_ctrl(struct fid *fid, int command, void *arg)
+{
+	struct udpx_sep *sep;
+
+	sep = container_of(fid, struct udpx_sep, ep_fid.fid);
+	switch (command) {
+	case FI_ENABLE:
+		if (!sep->av)
+			return -FI_ENOAV;
+
+		if (!sep->is_bound)
+			udpx_bind_src_addr(&sep->ep_fid.fid);
+		break;
+	default:
+		return -FI_ENOSYS;
+	}
+	return 0;
+}
+
+static struct fi_ops udpx_sep_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = udpx_sep_close,
+	.bind = udpx_sep_bind,
+	.control = udpx_sep_ctrl,
+	.ops_open = fi_no_ops_open,
+};
+
+static int udpx_sep_open_sock(struct udpx_sep *sep, int family)
+{
+	int i, ret;
+#if HAVE_DECL_SO_REUSEPORT
+	int val = 1;
+#endif
+
+	for (i = 0; i < sep->sock_cnt; i++) {
+		sep->sock[i] = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+		if (sep->sock[i] < 0) {
+			ret = -errno;
+			goto err;
+		}
+
+#if HAVE_DECL_SO_REUSEPORT
+		if (setsockopt(sep->sock[i], SOL_SOCKET, SO_REUSEPORT,
+			       (void *) &val, sizeof(val))) {
+			FI_WARN(&udpx_prov, FI_LOG_EP_CTRL,
+				"SO_REUSEPORT failed %d (%s)\n",
+				errno, strerror(errno));
+			ret = -errno;
+			ofi_close_socket(sep->sock[i]);
+			goto err;
+		}
+#else
+		if (sep->sock_cnt > 1) {
+			ofi_close_socket(sep->sock[i]);
+			ret = -FI_ENOSYS;
+			goto err;
+		}
+#endif
+
+		ret = fi_fd_nonblock((int) sep->sock[i]);
+		if (ret) {
+			ofi_close_socket(sep->sock[i]);
+			goto err;
+		}
+	}
+	return 0;
+err:
+	while (i--)
+		ofi_close_socket(sep->sock[i]);
+	return ret;
+}
+
+int udpx_scalable_ep(struct fid_domain *domain, struct fi_info *info,
+		     struct fid_ep **sep_fid, void *context)
+{
+	struct udpx_sep *sep;
+	struct util_domain *util_domain;
+	int family, ret;
+
+	util_domain = container_of(domain, struct util_domain, domain_fid);
+	ret = ofi_prov_check_info(&udpx_util_prov,
+				  util_domain->fabric->fabric_fid.api_version,
+				  info);
+	if (ret)
+		return ret;
+
+	if (info->ep_attr->rx_ctx_cnt > UDPX_MAX_CTX ||
+	    info->ep_attr->tx_ctx_cnt > UDPX_MAX_CTX)
+		return -FI_EINVAL;
+
+	sep = calloc(1, sizeof(*sep));
+	if (!sep)
+		return -FI_ENOMEM;
+
+	sep->info = fi_dupinfo(info);
+	if (!sep->info) {
+		ret = -FI_ENOMEM;
+		goto err1;
+	}
+	if (!sep->info->ep_attr->tx_ctx_cnt)
+		sep->info->ep_attr->tx_ctx_cnt = 1;
+	if (!sep->info->ep_attr->rx_ctx_cnt)
+		sep->info->ep_attr->rx_ctx_cnt = 1;
+	sep->sock_cnt = (int) sep->info->ep_attr->rx_ctx_cnt;
+
+	family = info->src_addr ?
+		 ((struct sockaddr *) info->src_addr)->sa_family : AF_INET;
+	ret = udpx_sep_open_sock(sep, family);
+	if (ret)
+		goto err2;
+
+	fastlock_init(&sep->lock);
+	ofi_atomic_initialize32(&sep->ref, 0);
+	sep->domain = util_domain;
+	ofi_atomic_inc32(&util_domain->ref);
+
+	sep->ep_fid.fid.fclass = FI_CLASS_SEP;
+	sep->ep_fid.fid.context = context;
+	sep->ep_fid.fid.ops = &udpx_sep_fi_ops;
+	sep->ep_fid.ops = &udpx_sep_ops;
+	sep->ep_fid.cm = &udpx_sep_cm_ops;
+
+	if (info->src_addr) {
+		ret = udpx_sep_setname(&sep->ep_fid.fid, info->src_addr,
+				       info->src_addrlen);
+		if (ret) {
+			udpx_sep_close(&sep->ep_fid.fid);
+			return ret;
+		}
+	}
+
+	*sep_fid = &sep->ep_fid;
+	return 0;
+err2:
+	fi_freeinfo(sep->info);
+err1:
+	free(sep);
+	return ret;
+}
@@ -64,6 +64,14 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
  */
 #ifdef HAVE_BUILTIN_MM_ATOMICS
 
+/*
+ * Each element is an independent atomic.  Providers order the update
+ * against their own completion, so sequential consistency is not needed.
+ */
+#define OFI_ATOMIC_LOAD_ORDER	__ATOMIC_ACQUIRE
+#define OFI_ATOMIC_STORE_ORDER	__ATOMIC_RELEASE
+#define OFI_ATOMIC_RMW_ORDER	__ATOMIC_ACQ_REL
+
 #define OFI_OP_MIN(type,dst,src)	(dst) > (src)
 #define OFI_OP_MAX(type,dst,src)	(dst) < (src)
 #define OFI_OP_SUM(type,dst,src)	(dst) + (src)
@@ -71,25 +79,29 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 #define OFI_OP_LOR(type,dst,src)	(dst) || (src)
 #define OFI_OP_LAND(type,dst,src)	(dst) && (src)
 
+/* Integer sum maps onto fetch-add, floating point uses OFI_OP_SUM */
+#define OFI_OP_SUM_INT(type,dst,src)	\
+		__atomic_fetch_add(&(dst), (src), OFI_ATOMIC_RMW_ORDER)
 #define OFI_OP_BOR(type,dst,src)	\
-		__atomic_fetch_or(&(dst), (src), __ATOMIC_SEQ_CST)
+		__atomic_fetch_or(&(dst), (src), OFI_ATOMIC_RMW_ORDER)
 #define OFI_OP_BAND(type,dst,src)	\
-		__atomic_fetch_and(&(dst), (src), __ATOMIC_SEQ_CST)
+		__atomic_fetch_and(&(dst), (src), OFI_ATOMIC_RMW_ORDER)
 #define OFI_OP_LXOR(type,dst,src)	\
 		((dst) && !(src)) || (!(dst) && (src))
 #define OFI_OP_BXOR(type,dst,src)	\
-		__atomic_fetch_xor(&(dst), (src), __ATOMIC_SEQ_CST)
+		__atomic_fetch_xor(&(dst), (src), OFI_ATOMIC_RMW_ORDER)
 #define OFI_OP_WRITE(type,dst,src)	\
-		__atomic_store(&(dst), &(src), __ATOMIC_SEQ_CST)
+		__atomic_store(&(dst), &(src), OFI_ATOMIC_STORE_ORDER)
 
 #define OFI_OP_READ(type,dst,res)	\
-		__atomic_load(&(dst), &(res), __ATOMIC_SEQ_CST)
+		__atomic_load(&(dst), &(res), OFI_ATOMIC_LOAD_ORDER)
 #define OFI_OP_READWRITE(type,dst,src,res)	\
-		__atomic_exchange(&(dst), &(src), &(res), __ATOMIC_SEQ_CST)
+		__atomic_exchange(&(dst), &(src), &(res), OFI_ATOMIC_RMW_ORDER)
 
 #define OFI_OP_CSWAP_EQ(type,dst,src,cmp)	\
 		__atomic_compare_exchange(&(dst),&(cmp),&(src),0,	\
-					  __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+					  OFI_ATOMIC_RMW_ORDER,		\
+					  OFI_ATOMIC_LOAD_ORDER)
 #define OFI_OP_CSWAP_NE(type,dst,src,cmp)	((cmp) != (dst))
 #define OFI_OP_CSWAP_LE(type,dst,src,cmp)	((cmp) <= (dst))
 #define OFI_OP_CSWAP_LT(type,dst,src,cmp)	((cmp) <  (dst))
@@ -104,9 +116,7 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 #define OFI_OP_LOR_COMPLEX(type,dst,src)  ofi_complex_lor_##type(dst,src)
 #define OFI_OP_LAND_COMPLEX(type,dst,src) ofi_complex_land_##type(dst,src)
 #define OFI_OP_LXOR_COMPLEX(type,dst,src) ofi_complex_lxor_##type(dst,src)
-#define OFI_OP_CSWAP_EQ_COMPLEX(type,dst,src,cmp)	\
-		__atomic_compare_exchange(&(dst),&(cmp),&(src),0,	\
-					  __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define OFI_OP_CSWAP_EQ_COMPLEX		OFI_OP_CSWAP_EQ
 #define OFI_OP_CSWAP_NE_COMPLEX(type,dst,src,cmp)	\
 			(!ofi_complex_eq_##type(dst,cmp))
 
@@ -211,9 +221,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 				target = d[i];				\
 				val = op(type, d[i], s[i]);		\
 				success = __atomic_compare_exchange(	\
-						&d[i],&target,&val,0,	\
-						__ATOMIC_SEQ_CST,	\
-						__ATOMIC_SEQ_CST);	\
+						&d[i],&target,&val,1,	\
+						OFI_ATOMIC_RMW_ORDER,	\
+						__ATOMIC_RELAXED);	\
 			} while (!success);				\
 		}							\
 	}
@@ -237,9 +247,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 				if (op(type, d[i], s[i])) {		\
 					temp_s = s[i];			\
 					success = __atomic_compare_exchange( \
-						&d[i],&target,&temp_s, 0, \
-						__ATOMIC_SEQ_CST,	\
-						__ATOMIC_SEQ_CST);	\
+						&d[i],&target,&temp_s, 1, \
+						OFI_ATOMIC_RMW_ORDER,	\
+						__ATOMIC_RELAXED);	\
 				}					\
 			} while (!success);				\
 		}							\
@@ -263,9 +273,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 				target = d[i];				\
 				val = op(type, d[i], s[i]);		\
 				success = __atomic_compare_exchange(	\
-						&d[i],&target,&val,0,	\
-						__ATOMIC_SEQ_CST,	\
-						__ATOMIC_SEQ_CST);	\
+						&d[i],&target,&val,1,	\
+						OFI_ATOMIC_RMW_ORDER,	\
+						__ATOMIC_RELAXED);	\
 			} while (!success);				\
 		}							\
 	}
@@ -373,9 +383,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 				target = d[i];				\
 				val = op(type, d[i], s[i]);		\
 				success = __atomic_compare_exchange(	\
-						&d[i],&target,&val,0,	\
-						__ATOMIC_SEQ_CST,	\
-						__ATOMIC_SEQ_CST);	\
+						&d[i],&target,&val,1,	\
+						OFI_ATOMIC_RMW_ORDER,	\
+						__ATOMIC_RELAXED);	\
 			} while (!success);				\
 			r[i] = target;					\
 		}							\
@@ -401,9 +411,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 				if (op(type, d[i], s[i])) {		\
 					temp_s = s[i];		\
 					success = __atomic_compare_exchange( \
-						&d[i],&target,&temp_s, 0, \
-						__ATOMIC_SEQ_CST,	\
-						__ATOMIC_SEQ_CST);	\
+						&d[i],&target,&temp_s, 1, \
+						OFI_ATOMIC_RMW_ORDER,	\
+						__ATOMIC_RELAXED);	\
 				}					\
 			} while (!success);				\
 			r[i] = target;					\
@@ -461,9 +471,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 				target = d[i];				\
 				val = op(type, d[i], s[i]);		\
 				success = __atomic_compare_exchange(	\
-						&d[i],&target,&val,0,	\
-						__ATOMIC_SEQ_CST,	\
-						__ATOMIC_SEQ_CST);	\
+						&d[i],&target,&val,1,	\
+						OFI_ATOMIC_RMW_ORDER,	\
+						__ATOMIC_RELAXED);	\
 			} while (!success);				\
 			r[i] = target;					\
 		}							\
@@ -569,9 +579,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 				target = d[i];				\
 				val = op(type, d[i], s[i], c[i]);	\
 				success = __atomic_compare_exchange(	\
-						&d[i],&target,&val, 0,	\
-						__ATOMIC_SEQ_CST,	\
-						__ATOMIC_SEQ_CST);	\
+						&d[i],&target,&val, 1,	\
+						OFI_ATOMIC_RMW_ORDER,	\
+						__ATOMIC_RELAXED);	\
 			} while (!success);				\
 			r[i] = target;					\
 		}							\
@@ -599,9 +609,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 				if (op(type, d[i], s[i], c[i])) {	\
 					temp_s = s[i];			\
 					success = __atomic_compare_exchange( \
-						&d[i],&target,&temp_s, 0, \
-						__ATOMIC_SEQ_CST,	\
-						__ATOMIC_SEQ_CST);	\
+						&d[i],&target,&temp_s, 1, \
+						OFI_ATOMIC_RMW_ORDER,	\
+						__ATOMIC_RELAXED);	\
 				}					\
 			} while (!success);				\
 			r[i] = target;					\
@@ -653,9 +663,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 				if (op(type, d[i], s[i], c[i])) {	\
 					temp_s = s[i];			\
 					success = __atomic_compare_exchange( \
-						&d[i],&target,&temp_s, 0, \
-						__ATOMIC_SEQ_CST,	\
-						__ATOMIC_SEQ_CST);	\
+						&d[i],&target,&temp_s, 1, \
+						OFI_ATOMIC_RMW_ORDER,	\
+						__ATOMIC_RELAXED);	\
 				}					\
 			} while (!success);				\
 			r[i] = target;					\
@@ -728,10 +738,8 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 	OFI_DEF_NOOP_##FUNCNAME						\
 	OFI_DEF_NOOP_##FUNCNAME
 
-#ifdef HAVE_BUILTIN_MM_ATOMICS
-
-/* Only support 8 byte and under datatypes */
-#define OFI_DEFINE_ALL_HANDLERS(ATOMICTYPE, FUNCNAME, op)		\
+/* All datatypes, regardless of the atomic implementation in use */
+#define OFI_DEFINE_FULL_HANDLERS(ATOMICTYPE, FUNCNAME, op)		\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int8_t)			\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint8_t)			\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int16_t)			\
@@ -743,11 +751,11 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, float)			\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, double)			\
 	OFI_DEF_##ATOMICTYPE##_COMPLEX_##FUNCNAME(op ##_COMPLEX, float)	\
-	OFI_DEF_NOOP_##FUNCNAME						\
-	OFI_DEF_NOOP_##FUNCNAME						\
-	OFI_DEF_NOOP_##FUNCNAME
+	OFI_DEF_##ATOMICTYPE##_COMPLEX_##FUNCNAME(op ##_COMPLEX, double)\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, long_double)		\
+	OFI_DEF_##ATOMICTYPE##_COMPLEX_##FUNCNAME(op ##_COMPLEX, long_double)
 
-#define OFI_DEFINE_REALNO_HANDLERS(ATOMICTYPE, FUNCNAME, op)		\
+#define OFI_DEFINE_FULL_REALNO_HANDLERS(ATOMICTYPE, FUNCNAME, op)	\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int8_t)			\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint8_t)			\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int16_t)			\
@@ -760,11 +768,12 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, double)			\
 	OFI_DEF_NOOP_##FUNCNAME						\
 	OFI_DEF_NOOP_##FUNCNAME						\
-	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, long_double)		\
 	OFI_DEF_NOOP_##FUNCNAME
 
-#else /* HAVE_BUILTIN_MM_ATOMICS */
+#ifdef HAVE_BUILTIN_MM_ATOMICS
 
+/* Only support 8 byte and under datatypes */
 #define OFI_DEFINE_ALL_HANDLERS(ATOMICTYPE, FUNCNAME, op)		\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int8_t)			\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, uint8_t)			\
@@ -777,9 +786,9 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, float)			\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, double)			\
 	OFI_DEF_##ATOMICTYPE##_COMPLEX_##FUNCNAME(op ##_COMPLEX, float)	\
-	OFI_DEF_##ATOMICTYPE##_COMPLEX_##FUNCNAME(op ##_COMPLEX, double)\
-	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, long_double)		\
-	OFI_DEF_##ATOMICTYPE##_COMPLEX_##FUNCNAME(op ##_COMPLEX, long_double)
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME
 
 #define OFI_DEFINE_REALNO_HANDLERS(ATOMICTYPE, FUNCNAME, op)		\
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, int8_t)			\
@@ -794,9 +803,34 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, double)			\
 	OFI_DEF_NOOP_##FUNCNAME						\
 	OFI_DEF_NOOP_##FUNCNAME						\
-	OFI_DEF_##ATOMICTYPE##_##FUNCNAME(op, long_double)		\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME
+
+/*
+ * Integer types map onto a native fetch-op, floating point types fall
+ * back to a compare-exchange loop.
+ */
+#define OFI_DEFINE_SPLIT_HANDLERS(INTTYPE, FPTYPE, FUNCNAME, intop, fpop) \
+	OFI_DEF_##INTTYPE##_##FUNCNAME(intop, int8_t)			\
+	OFI_DEF_##INTTYPE##_##FUNCNAME(intop, uint8_t)			\
+	OFI_DEF_##INTTYPE##_##FUNCNAME(intop, int16_t)			\
+	OFI_DEF_##INTTYPE##_##FUNCNAME(intop, uint16_t)			\
+	OFI_DEF_##INTTYPE##_##FUNCNAME(intop, int32_t)			\
+	OFI_DEF_##INTTYPE##_##FUNCNAME(intop, uint32_t)			\
+	OFI_DEF_##INTTYPE##_##FUNCNAME(intop, int64_t)			\
+	OFI_DEF_##INTTYPE##_##FUNCNAME(intop, uint64_t)			\
+	OFI_DEF_##FPTYPE##_##FUNCNAME(fpop, float)			\
+	OFI_DEF_##FPTYPE##_##FUNCNAME(fpop, double)			\
+	OFI_DEF_##FPTYPE##_COMPLEX_##FUNCNAME(fpop ##_COMPLEX, float)	\
+	OFI_DEF_NOOP_##FUNCNAME						\
+	OFI_DEF_NOOP_##FUNCNAME						\
 	OFI_DEF_NOOP_##FUNCNAME
 
+#else /* HAVE_BUILTIN_MM_ATOMICS */
+
+#define OFI_DEFINE_ALL_HANDLERS		OFI_DEFINE_FULL_HANDLERS
+#define OFI_DEFINE_REALNO_HANDLERS	OFI_DEFINE_FULL_REALNO_HANDLERS
+
 #endif /* HAVE_BUILTIN_MM_ATOMICS */
 
 #define OFI_OP_NOT_SUPPORTED(op)	NULL, NULL, NULL, NULL, NULL,	\
@@ -810,7 +844,7 @@ size_t ofi_datatype_size(enum fi_datatype datatype)
 
 OFI_DEFINE_REALNO_HANDLERS(WRITEEXT_CMP, FUNC, OFI_OP_MIN)
 OFI_DEFINE_REALNO_HANDLERS(WRITEEXT_CMP, FUNC, OFI_OP_MAX)
-OFI_DEFINE_ALL_HANDLERS(WRITEEXT, FUNC, OFI_OP_SUM)
+OFI_DEFINE_SPLIT_HANDLERS(WRITE, WRITEEXT, FUNC, OFI_OP_SUM_INT, OFI_OP_SUM)
 OFI_DEFINE_ALL_HANDLERS(WRITEEXT, FUNC, OFI_OP_PROD)
 OFI_DEFINE_ALL_HANDLERS(WRITEEXT, FUNC, OFI_OP_LOR)
 OFI_DEFINE_ALL_HANDLERS(WRITEEXT, FUNC, OFI_OP_LAND)
@@ -825,7 +859,8 @@ void (*ofi_atomic_write_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
 {
 	{ OFI_DEFINE_REALNO_HANDLERS(WRITEEXT_CMP, NAME, OFI_OP_MIN) },
 	{ OFI_DEFINE_REALNO_HANDLERS(WRITEEXT_CMP, NAME, OFI_OP_MAX) },
-	{ OFI_DEFINE_ALL_HANDLERS(WRITEEXT, NAME, OFI_OP_SUM) },
+	{ OFI_DEFINE_SPLIT_HANDLERS(WRITE, WRITEEXT, NAME,
+				    OFI_OP_SUM_INT, OFI_OP_SUM) },
 	{ OFI_DEFINE_ALL_HANDLERS(WRITEEXT, NAME, OFI_OP_PROD) },
 	{ OFI_DEFINE_ALL_HANDLERS(WRITEEXT, NAME, OFI_OP_LOR) },
 	{ OFI_DEFINE_ALL_HANDLERS(WRITEEXT, NAME, OFI_OP_LAND) },
@@ -843,7 +878,8 @@ void (*ofi_atomic_write_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
 
 OFI_DEFINE_REALNO_HANDLERS(READWRITEEXT_CMP, FUNC, OFI_OP_MIN)
 OFI_DEFINE_REALNO_HANDLERS(READWRITEEXT_CMP, FUNC, OFI_OP_MAX)
-OFI_DEFINE_ALL_HANDLERS(READWRITEEXT, FUNC, OFI_OP_SUM)
+OFI_DEFINE_SPLIT_HANDLERS(READWRITE, READWRITEEXT, FUNC,
+			  OFI_OP_SUM_INT, OFI_OP_SUM)
 OFI_DEFINE_ALL_HANDLERS(READWRITEEXT, FUNC, OFI_OP_PROD)
 OFI_DEFINE_ALL_HANDLERS(READWRITEEXT, FUNC, OFI_OP_LOR)
 OFI_DEFINE_ALL_HANDLERS(READWRITEEXT, FUNC, OFI_OP_LAND)
@@ -859,7 +895,8 @@ void (*ofi_atomic_readwrite_handlers[OFI_READWRITE_OP_LAST][FI_DATATYPE_LAST])
 {
 	{ OFI_DEFINE_REALNO_HANDLERS(READWRITEEXT_CMP, NAME, OFI_OP_MIN) },
 	{ OFI_DEFINE_REALNO_HANDLERS(READWRITEEXT_CMP, NAME, OFI_OP_MAX) },
-	{ OFI_DEFINE_ALL_HANDLERS(READWRITEEXT, NAME, OFI_OP_SUM) },
+	{ OFI_DEFINE_SPLIT_HANDLERS(READWRITE, READWRITEEXT, NAME,
+				    OFI_OP_SUM_INT, OFI_OP_SUM) },
 	{ OFI_DEFINE_ALL_HANDLERS(READWRITEEXT, NAME, OFI_OP_PROD) },
 	{ OFI_DEFINE_ALL_HANDLERS(READWRITEEXT, NAME, OFI_OP_LOR) },
 	{ OFI_DEFINE_ALL_HANDLERS(READWRITEEXT, NAME, OFI_OP_LAND) },
@@ -1001,6 +1038,109 @@ static void ofi_log_atomic_info(const struct fi_provider *prov)
 
 #endif /* HAVE_BUILTIN_MM_ATOMICS */
 
+/*********************************************************************
+ * Non-atomic reduction dispatch table
+ *
+ * For targets that are private to the caller, such as collective
+ * scratch buffers or provider bounce buffers.  The kernels are plain
+ * element-wise loops that the compiler can vectorize.  On x86, clones
+ * for AVX2 and AVX-512 are built as well and the best one for the
+ * running CPU is picked by the loader.
+ *********************************************************************/
+
+#if HAVE_ATTRIBUTE_TARGET_CLONES
+#define OFI_REDUCE_CLONES \
+	__attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define OFI_REDUCE_CLONES
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define OFI_REDUCE_VECTORIZE	__attribute__((optimize("tree-vectorize")))
+#else
+#define OFI_REDUCE_VECTORIZE
+#endif
+
+/* Written as selects so that min/max map onto vector min/max */
+#define OFI_REDUCE_MIN(type,dst,src)	(dst) = (dst) > (src) ? (src) : (dst)
+#define OFI_REDUCE_MAX(type,dst,src)	(dst) = (dst) < (src) ? (src) : (dst)
+#define OFI_REDUCE_SUM(type,dst,src)	(dst) += (src)
+#define OFI_REDUCE_PROD(type,dst,src)	(dst) *= (src)
+#define OFI_REDUCE_LOR(type,dst,src)	(dst) = (dst) || (src)
+#define OFI_REDUCE_LAND(type,dst,src)	(dst) = (dst) && (src)
+#define OFI_REDUCE_BOR(type,dst,src)	(dst) |= (src)
+#define OFI_REDUCE_BAND(type,dst,src)	(dst) &= (src)
+#define OFI_REDUCE_LXOR(type,dst,src)	(dst) = !(dst) != !(src)
+#define OFI_REDUCE_BXOR(type,dst,src)	(dst) ^= (src)
+#define OFI_REDUCE_WRITE(type,dst,src)	(dst) = (src)
+
+#define OFI_REDUCE_SUM_COMPLEX(type,dst,src)	\
+		(dst) = ofi_complex_sum_##type(dst,src)
+#define OFI_REDUCE_PROD_COMPLEX(type,dst,src)	\
+		(dst) = ofi_complex_prod_##type(dst,src)
+#define OFI_REDUCE_LOR_COMPLEX(type,dst,src)	\
+		(dst) = ofi_complex_lor_##type(dst,src)
+#define OFI_REDUCE_LAND_COMPLEX(type,dst,src)	\
+		(dst) = ofi_complex_land_##type(dst,src)
+#define OFI_REDUCE_LXOR_COMPLEX(type,dst,src)	\
+		(dst) = ofi_complex_lxor_##type(dst,src)
+#define OFI_REDUCE_WRITE_COMPLEX	OFI_REDUCE_WRITE
+
+#define OFI_DEF_REDUCE_NAME(op, type) ofi_reduce_## op ##_## type,
+#define OFI_DEF_REDUCE_FUNC(op, type)					\
+	static void OFI_REDUCE_CLONES OFI_REDUCE_VECTORIZE		\
+	ofi_reduce_## op ##_## type					\
+		(void *dst, const void *src, size_t cnt)		\
+	{								\
+		size_t i;						\
+		type *d = (dst);					\
+		const type *s = (src);					\
+		for (i = 0; i < cnt; i++)				\
+			op(type, d[i], s[i]);				\
+	}
+
+#define OFI_DEF_REDUCE_COMPLEX_NAME(op, type) ofi_reduce_## op ##_## type,
+#define OFI_DEF_REDUCE_COMPLEX_FUNC(op, type)				\
+	static void OFI_REDUCE_CLONES OFI_REDUCE_VECTORIZE		\
+	ofi_reduce_## op ##_## type					\
+		(void *dst, const void *src, size_t cnt)		\
+	{								\
+		size_t i;						\
+		ofi_complex_##type *d = (dst);				\
+		const ofi_complex_##type *s = (src);			\
+		for (i = 0; i < cnt; i++)				\
+			op(type, d[i], s[i]);				\
+	}
+
+OFI_DEFINE_FULL_REALNO_HANDLERS(REDUCE, FUNC, OFI_REDUCE_MIN)
+OFI_DEFINE_FULL_REALNO_HANDLERS(REDUCE, FUNC, OFI_REDUCE_MAX)
+OFI_DEFINE_FULL_HANDLERS(REDUCE, FUNC, OFI_REDUCE_SUM)
+OFI_DEFINE_FULL_HANDLERS(REDUCE, FUNC, OFI_REDUCE_PROD)
+OFI_DEFINE_FULL_HANDLERS(REDUCE, FUNC, OFI_REDUCE_LOR)
+OFI_DEFINE_FULL_HANDLERS(REDUCE, FUNC, OFI_REDUCE_LAND)
+OFI_DEFINE_INT_HANDLERS(REDUCE, FUNC, OFI_REDUCE_BOR)
+OFI_DEFINE_INT_HANDLERS(REDUCE, FUNC, OFI_REDUCE_BAND)
+OFI_DEFINE_FULL_HANDLERS(REDUCE, FUNC, OFI_REDUCE_LXOR)
+OFI_DEFINE_INT_HANDLERS(REDUCE, FUNC, OFI_REDUCE_BXOR)
+OFI_DEFINE_FULL_HANDLERS(REDUCE, FUNC, OFI_REDUCE_WRITE)
+
+void (*ofi_atomic_reduce_handlers[OFI_WRITE_OP_LAST][FI_DATATYPE_LAST])
+	(void *dst, const void *src, size_t cnt) =
+{
+	{ OFI_DEFINE_FULL_REALNO_HANDLERS(REDUCE, NAME, OFI_REDUCE_MIN) },
+	{ OFI_DEFINE_FULL_REALNO_HANDLERS(REDUCE, NAME, OFI_REDUCE_MAX) },
+	{ OFI_DEFINE_FULL_HANDLERS(REDUCE, NAME, OFI_REDUCE_SUM) },
+	{ OFI_DEFINE_FULL_HANDLERS(REDUCE, NAME, OFI_REDUCE_PROD) },
+	{ OFI_DEFINE_FULL_HANDLERS(REDUCE, NAME, OFI_REDUCE_LOR) },
+	{ OFI_DEFINE_FULL_HANDLERS(REDUCE, NAME, OFI_REDUCE_LAND) },
+	{ OFI_DEFINE_INT_HANDLERS(REDUCE, NAME, OFI_REDUCE_BOR) },
+	{ OFI_DEFINE_INT_HANDLERS(REDUCE, NAME, OFI_REDUCE_BAND) },
+	{ OFI_DEFINE_FULL_HANDLERS(REDUCE, NAME, OFI_REDUCE_LXOR) },
+	{ OFI_DEFINE_INT_HANDLERS(REDUCE, NAME, OFI_REDUCE_BXOR) },
+	{ OFI_OP_NOT_SUPPORTED(FI_ATOMIC_READ) },
+	{ OFI_DEFINE_FULL_HANDLERS(REDUCE, NAME, OFI_REDUCE_WRITE) },
+};
+
 int ofi_atomic_valid(const struct fi_provider *prov,
 		     enum fi_datatype datatype, enum fi_op op, uint64_t flags)
 {
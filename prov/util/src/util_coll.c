@@ -41,6 +41,7 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <inttypes.h>
+#include <limits.h>
 
 #if HAVE_GETIFADDRS
 #include <net/if.h>
@@ -56,6 +57,22 @@
 #include <ofi_coll.h>
 #include <ofi_osd.h>
 
+/* Messages at or above the threshold are broadcast over a pipelined chain,
+ * smaller ones over a binomial tree.  Allgather switches from Bruck to ring
+ * similarly.
+ */
+#define UTIL_COLL_CHAIN_THRESHOLD		(64 * 1024)
+#define UTIL_COLL_ALLGATHER_RING_THRESHOLD	(64 * 1024)
+#define UTIL_COLL_SEG_SIZE			(32 * 1024)
+/* Each segment of an operation takes its own tag sequence number */
+#define UTIL_COLL_MAX_SEGS			(1 << 14)
+
+/* Large buffers are split into segments of this many bytes, so that the
+ * reduction or forwarding of one segment overlaps the transfer of the next.
+ * 0 disables segmentation.
+ */
+static size_t util_coll_seg_size = UTIL_COLL_SEG_SIZE;
+
 static uint64_t util_coll_cid[OFI_CONTEXT_ID_SIZE];
 /* TODO: if collective support is requested, initialize up front
  * when opening the domain or EP
@@ -160,6 +177,17 @@ int ofi_av_set_insert(struct fid_av_set *set, fi_addr_t addr)
 	return FI_SUCCESS;
 }
 
+int ofi_av_set_addr(struct fid_av_set *set, fi_addr_t *coll_addr)
+{
+	struct util_av_set *av_set;
+
+	av_set = container_of(set, struct util_av_set, av_set_fid);
+
+	/* sets are joined through the group of all AV members */
+	*coll_addr = (uintptr_t) av_set->av->coll_mc;
+	return FI_SUCCESS;
+}
+
 int ofi_av_set_remove(struct fid_av_set *set, fi_addr_t addr)
 
 {
@@ -199,6 +227,8 @@ static inline int util_coll_mc_alloc(struct util_coll_mc **coll_mc)
 
 	slist_init(&(*coll_mc)->barrier_list);
 	slist_init(&(*coll_mc)->deferred_list);
+	slist_init(&(*coll_mc)->build_list);
+	dlist_init(&(*coll_mc)->ready_entry);
 	return FI_SUCCESS;
 }
 
@@ -225,13 +255,14 @@ static int util_coll_sched_send(struct util_coll_mc *coll_mc, int dest,
 
 	xfer_item->hdr.type = UTIL_COLL_SEND;
 	xfer_item->hdr.is_barrier = is_barrier;
+	xfer_item->coll_mc = coll_mc;
 	xfer_item->hdr.tag = tag;
 	xfer_item->buf = buf;
 	xfer_item->count = count;
 	xfer_item->datatype = datatype;
 	xfer_item->dest_rank = dest;
 
-	slist_insert_tail(&xfer_item->hdr.entry, &coll_mc->deferred_list);
+	slist_insert_tail(&xfer_item->hdr.entry, &coll_mc->build_list);
 	return FI_SUCCESS;
 }
 
@@ -248,6 +279,7 @@ static int util_coll_sched_recv(struct util_coll_mc *coll_mc, int src,
 
 	xfer_item->hdr.type = UTIL_COLL_RECV;
 	xfer_item->hdr.is_barrier = is_barrier;
+	xfer_item->coll_mc = coll_mc;
 
 	xfer_item->hdr.tag = (recv_tag << 32) | (tag & 0xffffffff);
 	xfer_item->buf = buf;
@@ -255,7 +287,7 @@ static int util_coll_sched_recv(struct util_coll_mc *coll_mc, int src,
 	xfer_item->datatype = datatype;
 	xfer_item->src_rank = src;
 
-	slist_insert_tail(&xfer_item->hdr.entry, &coll_mc->deferred_list);
+	slist_insert_tail(&xfer_item->hdr.entry, &coll_mc->build_list);
 	return FI_SUCCESS;
 }
 
@@ -278,7 +310,7 @@ static int util_coll_sched_reduce(struct util_coll_mc *coll_mc, void *in_buf,
 	reduce_item->datatype = datatype;
 	reduce_item->op = op;
 
-	slist_insert_tail(&reduce_item->hdr.entry, &coll_mc->deferred_list);
+	slist_insert_tail(&reduce_item->hdr.entry, &coll_mc->build_list);
 	return FI_SUCCESS;
 }
 
@@ -299,13 +331,13 @@ static int util_coll_sched_copy(struct util_coll_mc *coll_mc, void *in_buf,
 	copy_item->count = count;
 	copy_item->datatype = datatype;
 
-	slist_insert_tail(&copy_item->hdr.entry, &coll_mc->deferred_list);
+	slist_insert_tail(&copy_item->hdr.entry, &coll_mc->build_list);
 	return FI_SUCCESS;
 }
 
 static int util_coll_sched_comp(struct util_coll_mc *coll_mc,
-				enum util_coll_op_type op_type,
-				void *data, util_coll_comp_t comp_fn)
+				enum util_coll_op_type op_type, void *data,
+				void *context, util_coll_comp_t comp_fn)
 {
 	struct util_coll_comp_item *comp_item;
 
@@ -318,12 +350,27 @@ static int util_coll_sched_comp(struct util_coll_mc *coll_mc,
 
 	comp_item->op_type = op_type;
 	comp_item->data = data;
+	comp_item->context = context;
 	comp_item->comp_fn = comp_fn;
 
-	slist_insert_tail(&comp_item->hdr.entry, &coll_mc->deferred_list);
+	slist_insert_tail(&comp_item->hdr.entry, &coll_mc->build_list);
 	return FI_SUCCESS;
 }
 
+/* Drops the work built so far for an operation that failed to be issued.
+ * None of it has been seen by the scheduler, so buffers it refers to may be
+ * freed afterwards.
+ */
+static void util_coll_sched_abort(struct util_coll_mc *coll_mc)
+{
+	struct slist_entry *entry;
+
+	while (!slist_empty(&coll_mc->build_list)) {
+		entry = slist_remove_head(&coll_mc->build_list);
+		free(container_of(entry, struct util_coll_hdr, entry));
+	}
+}
+
 static inline uint64_t util_coll_get_next_tag(struct util_coll_mc *coll_mc)
 {
 	uint64_t tag = coll_mc->my_rank;
@@ -333,18 +380,178 @@ static inline uint64_t util_coll_get_next_tag(struct util_coll_mc *coll_mc)
 	return tag;
 }
 
-/* TODO: when this fails, clean up the already scheduled work in this function */
+/* Reserve cnt consecutive tags, see util_coll_tag_offset */
+static inline uint64_t util_coll_get_next_tags(struct util_coll_mc *coll_mc,
+					       int cnt)
+{
+	uint64_t tag = util_coll_get_next_tag(coll_mc);
+
+	coll_mc->tag_seq += cnt - 1;
+	return tag;
+}
+
+static inline uint64_t util_coll_tag_offset(uint64_t tag, int i)
+{
+	return (tag & ~0xffffULL) | ((tag + i) & 0xffff);
+}
+
+/* Number of elements in each pipeline segment of a count element buffer,
+ * split into at most max_segs segments.
+ */
+static inline int util_coll_seg_count(int count, enum fi_datatype datatype,
+				      int max_segs)
+{
+	size_t seg_count;
+
+	if (!util_coll_seg_size || count <= 1)
+		return MAX(count, 1);
+
+	seg_count = MAX(util_coll_seg_size / ofi_datatype_size(datatype),
+			(size_t) ofi_div_ceil(count, MAX(max_segs, 1)));
+	return (int) MIN(seg_count, (size_t) count);
+}
+
+struct util_coll_pipeline;
+
+typedef int (*util_coll_unit_t)(struct util_coll_mc *coll_mc,
+				struct util_coll_pipeline *pipe,
+				int unit, int is_barrier);
+
+/* A pipelined schedule is a series of steps, each exchanging nseg segments
+ * and then reducing them.  Unit i covers segment (i % nseg) of step
+ * (i / nseg).
+ */
+struct util_coll_pipeline {
+	util_coll_unit_t	xfer;
+	util_coll_unit_t	reduce;
+	void			*send_buf;
+	void			*recv_buf;
+	int			count;
+	int			seg_count;
+	int			nseg;
+	enum fi_datatype	datatype;
+	enum fi_op		op;
+	uint64_t		tag;
+	/* algorithm specific */
+	int			new_id;
+	int			rem;
+};
+
+/* The reduction of each unit is scheduled behind the transfer of the next,
+ * and carries the barrier for it, so the two overlap.  Segment k of a step
+ * depends on segment k of the previous step, so with a single segment the
+ * reduction must instead complete before the next transfer is posted.
+ */
+static int util_coll_sched_pipeline(struct util_coll_mc *coll_mc,
+				    struct util_coll_pipeline *pipe,
+				    int nunits)
+{
+	int unit, ret;
+
+	for (unit = 0; unit <= nunits; unit++) {
+		if (pipe->nseg == 1 && unit) {
+			ret = pipe->reduce(coll_mc, pipe, unit - 1, NO_BARRIER);
+			if (ret)
+				return ret;
+		}
+
+		if (unit < nunits) {
+			ret = pipe->xfer(coll_mc, pipe, unit,
+					 (pipe->nseg == 1 || !unit) ?
+					 BARRIER : NO_BARRIER);
+			if (ret)
+				return ret;
+		}
+
+		if (pipe->nseg > 1 && unit) {
+			ret = pipe->reduce(coll_mc, pipe, unit - 1, BARRIER);
+			if (ret)
+				return ret;
+		}
+	}
+	return FI_SUCCESS;
+}
+
+static inline void util_coll_pipeline_seg(struct util_coll_pipeline *pipe,
+					  int seg, int len, int *offset,
+					  int *seg_len)
+{
+	*offset = seg * pipe->seg_count;
+	*seg_len = MAX(MIN(pipe->seg_count, len - *offset), 0);
+}
+
+static int util_coll_allreduce_peer(struct util_coll_pipeline *pipe, int step)
+{
+	int new_dest = pipe->new_id ^ (1 << step);
+
+	return (new_dest < pipe->rem) ? new_dest * 2 + 1 : new_dest + pipe->rem;
+}
+
+static int util_coll_allreduce_xfer(struct util_coll_mc *coll_mc,
+				    struct util_coll_pipeline *pipe,
+				    int unit, int is_barrier)
+{
+	size_t dtsize = ofi_datatype_size(pipe->datatype);
+	uint64_t tag;
+	int dest, offset, len, ret;
+
+	dest = util_coll_allreduce_peer(pipe, unit / pipe->nseg);
+	util_coll_pipeline_seg(pipe, unit % pipe->nseg, pipe->count,
+			       &offset, &len);
+	tag = util_coll_tag_offset(pipe->tag, unit % pipe->nseg);
+
+	ret = util_coll_sched_recv(coll_mc, dest,
+				   (char *) pipe->recv_buf + offset * dtsize,
+				   len, pipe->datatype, tag, NO_BARRIER);
+	if (ret)
+		return ret;
+
+	return util_coll_sched_send(coll_mc, dest,
+				    (char *) pipe->send_buf + offset * dtsize,
+				    len, pipe->datatype, tag, is_barrier);
+}
+
+static int util_coll_allreduce_reduce(struct util_coll_mc *coll_mc,
+				      struct util_coll_pipeline *pipe,
+				      int unit, int is_barrier)
+{
+	size_t dtsize = ofi_datatype_size(pipe->datatype);
+	char *send_seg, *recv_seg;
+	int dest, offset, len, ret;
+
+	dest = util_coll_allreduce_peer(pipe, unit / pipe->nseg);
+	util_coll_pipeline_seg(pipe, unit % pipe->nseg, pipe->count,
+			       &offset, &len);
+	send_seg = (char *) pipe->send_buf + offset * dtsize;
+	recv_seg = (char *) pipe->recv_buf + offset * dtsize;
+
+	if (dest < coll_mc->my_rank)
+		return util_coll_sched_reduce(coll_mc, recv_seg, send_seg, len,
+					      pipe->datatype, pipe->op,
+					      is_barrier);
+
+	ret = util_coll_sched_reduce(coll_mc, send_seg, recv_seg, len,
+				     pipe->datatype, pipe->op, NO_BARRIER);
+	if (ret)
+		return ret;
+
+	return util_coll_sched_copy(coll_mc, recv_seg, send_seg, len,
+				    pipe->datatype, is_barrier);
+}
+
 static int util_coll_allreduce(struct util_coll_mc *coll_mc, void *send_buf,
 			void *recv_buf, int count, enum fi_datatype datatype,
 			enum fi_op op)
 {
+	struct util_coll_pipeline pipe;
 	uint64_t tag;
 	int rem, pof2, my_new_id;
-	int dest, new_dest;
+	int nsteps, seg_count, nseg;
 	int ret;
-	int mask = 1;
 
-	tag = util_coll_get_next_tag(coll_mc);
+	seg_count = util_coll_seg_count(count, datatype, UTIL_COLL_MAX_SEGS);
+	nseg = ofi_div_ceil(count, seg_count);
+	tag = util_coll_get_next_tags(coll_mc, nseg);
 	pof2 = util_coll_pof2(coll_mc->av_set->fi_addr_count);
 	rem = coll_mc->av_set->fi_addr_count - pof2;
 
@@ -376,39 +583,26 @@ static int util_coll_allreduce(struct util_coll_mc *coll_mc, void *send_buf,
 	}
 
 	if (my_new_id != -1) {
-		while (mask < pof2) {
-			new_dest = my_new_id ^ mask;
-			dest = (new_dest < rem) ? new_dest * 2 + 1 :
-				new_dest + rem;
-
-			ret = util_coll_sched_recv(coll_mc, dest, recv_buf,
-						   count, datatype, tag, NO_BARRIER);
-			if (ret)
-				return ret;
-			ret = util_coll_sched_send(coll_mc, dest, send_buf,
-						   count, datatype, tag, BARRIER);
-			if (ret)
-				return ret;
-
-			if (dest < coll_mc->my_rank) {
-				ret = util_coll_sched_reduce(coll_mc, recv_buf, send_buf,
-							     count, datatype, op, BARRIER);
-				if (ret)
-					return ret;
-
-			} else {
-				ret = util_coll_sched_reduce(coll_mc, send_buf, recv_buf,
-							     count, datatype, op, BARRIER);
-				if (ret)
-					return ret;
-
-				ret = util_coll_sched_copy(coll_mc, recv_buf, send_buf,
-							   count, datatype, BARRIER);
-				if (ret)
-					return ret;
-			}
-			mask <<= 1;
-		}
+		memset(&pipe, 0, sizeof(pipe));
+		pipe.xfer = util_coll_allreduce_xfer;
+		pipe.reduce = util_coll_allreduce_reduce;
+		pipe.send_buf = send_buf;
+		pipe.recv_buf = recv_buf;
+		pipe.count = count;
+		pipe.seg_count = seg_count;
+		pipe.nseg = nseg;
+		pipe.datatype = datatype;
+		pipe.op = op;
+		pipe.tag = tag;
+		pipe.new_id = my_new_id;
+		pipe.rem = rem;
+
+		for (nsteps = 0; (1 << nsteps) < pof2; nsteps++)
+			;
+
+		ret = util_coll_sched_pipeline(coll_mc, &pipe, nsteps * nseg);
+		if (ret)
+			return ret;
 	}
 
 	if (coll_mc->my_rank < 2 * rem) {
@@ -429,12 +623,533 @@ static int util_coll_allreduce(struct util_coll_mc *coll_mc, void *send_buf,
 	return FI_SUCCESS;
 }
 
+/* Split count elements into nblocks nearly equal blocks */
+static inline void util_coll_get_block(int count, int nblocks, int idx,
+				       int *offset, int *len)
+{
+	int base = count / nblocks;
+	int rem = count % nblocks;
+
+	*len = base + (idx < rem);
+	*offset = idx * base + MIN(idx, rem);
+}
+
+static int util_coll_bcast_binomial(struct util_coll_mc *coll_mc, void *buf,
+				    int count, enum fi_datatype datatype,
+				    int root)
+{
+	uint64_t tag;
+	int size, vrank, mask, peer;
+	int ret;
+
+	tag = util_coll_get_next_tag(coll_mc);
+	size = coll_mc->av_set->fi_addr_count;
+	vrank = (coll_mc->my_rank - root + size) % size;
+
+	for (mask = 1; mask < size; mask <<= 1) {
+		if (vrank & mask) {
+			peer = (coll_mc->my_rank - mask + size) % size;
+			ret = util_coll_sched_recv(coll_mc, peer, buf, count,
+						   datatype, tag, BARRIER);
+			if (ret)
+				return ret;
+			break;
+		}
+	}
+
+	for (mask >>= 1; mask > 0; mask >>= 1) {
+		if (vrank + mask >= size)
+			continue;
+
+		peer = (coll_mc->my_rank + mask) % size;
+		ret = util_coll_sched_send(coll_mc, peer, buf, count,
+					   datatype, tag, NO_BARRIER);
+		if (ret)
+			return ret;
+	}
+	return FI_SUCCESS;
+}
+
+/* Pipelined chain: each rank forwards segment k to its successor while
+ * receiving segment k + 1 from its predecessor.
+ */
+static int util_coll_bcast_chain(struct util_coll_mc *coll_mc, void *buf,
+				 int count, enum fi_datatype datatype, int root)
+{
+	uint64_t base_tag, tag;
+	size_t dtsize;
+	char *seg_buf;
+	int size, vrank, prev, next;
+	int seg_count, seg_cnt, nseg, i;
+	int ret;
+
+	dtsize = ofi_datatype_size(datatype);
+	size = coll_mc->av_set->fi_addr_count;
+	vrank = (coll_mc->my_rank - root + size) % size;
+	prev = (coll_mc->my_rank - 1 + size) % size;
+	next = (coll_mc->my_rank + 1) % size;
+
+	seg_count = util_coll_seg_count(count, datatype, UTIL_COLL_MAX_SEGS);
+	nseg = ofi_div_ceil(count, seg_count);
+	base_tag = util_coll_get_next_tags(coll_mc, nseg);
+
+	for (i = 0; i < nseg; i++) {
+		tag = util_coll_tag_offset(base_tag, i);
+		seg_buf = (char *) buf + (size_t) i * seg_count * dtsize;
+		seg_cnt = MIN(seg_count, count - i * seg_count);
+
+		if (vrank) {
+			ret = util_coll_sched_recv(coll_mc, prev, seg_buf,
+						   seg_cnt, datatype, tag,
+						   BARRIER);
+			if (ret)
+				return ret;
+		}
+
+		if (vrank != size - 1) {
+			ret = util_coll_sched_send(coll_mc, next, seg_buf,
+						   seg_cnt, datatype, tag,
+						   NO_BARRIER);
+			if (ret)
+				return ret;
+		}
+	}
+	return FI_SUCCESS;
+}
+
+static int util_coll_bcast(struct util_coll_mc *coll_mc, void *buf, int count,
+			   enum fi_datatype datatype, int root)
+{
+	if (coll_mc->av_set->fi_addr_count > 2 && util_coll_seg_size &&
+	    count * ofi_datatype_size(datatype) >= UTIL_COLL_CHAIN_THRESHOLD)
+		return util_coll_bcast_chain(coll_mc, buf, count, datatype, root);
+
+	return util_coll_bcast_binomial(coll_mc, buf, count, datatype, root);
+}
+
+/* Bruck's algorithm: log(p) steps, with the blocks gathered in rotated
+ * order into tmp_buf and rotated back into place at the end.
+ */
+static int util_coll_allgather_bruck(struct util_coll_mc *coll_mc,
+				     void *send_buf, void *result, int count,
+				     enum fi_datatype datatype, void *tmp_buf)
+{
+	uint64_t tag;
+	size_t bytes;
+	char *tmp = tmp_buf;
+	int size, rank, dist, nblocks;
+	int ret;
+
+	tag = util_coll_get_next_tag(coll_mc);
+	size = coll_mc->av_set->fi_addr_count;
+	rank = coll_mc->my_rank;
+	bytes = count * ofi_datatype_size(datatype);
+
+	ret = util_coll_sched_copy(coll_mc, send_buf, tmp, count, datatype,
+				   NO_BARRIER);
+	if (ret)
+		return ret;
+
+	for (dist = 1; dist < size; dist <<= 1) {
+		nblocks = MIN(dist, size - dist);
+
+		ret = util_coll_sched_recv(coll_mc, (rank + dist) % size,
+					   tmp + dist * bytes, nblocks * count,
+					   datatype, tag, NO_BARRIER);
+		if (ret)
+			return ret;
+
+		ret = util_coll_sched_send(coll_mc, (rank - dist + size) % size,
+					   tmp, nblocks * count, datatype, tag,
+					   BARRIER);
+		if (ret)
+			return ret;
+	}
+
+	ret = util_coll_sched_copy(coll_mc, tmp, (char *) result + rank * bytes,
+				   (size - rank) * count, datatype, NO_BARRIER);
+	if (ret)
+		return ret;
+
+	return util_coll_sched_copy(coll_mc, tmp + (size - rank) * bytes,
+				    result, rank * count, datatype, NO_BARRIER);
+}
+
+static int util_coll_allgather_ring(struct util_coll_mc *coll_mc,
+				    void *send_buf, void *result, int count,
+				    enum fi_datatype datatype)
+{
+	uint64_t tag;
+	size_t bytes;
+	int size, rank, left, right, step;
+	int send_idx, recv_idx;
+	int ret;
+
+	size = coll_mc->av_set->fi_addr_count;
+	rank = coll_mc->my_rank;
+	left = (rank - 1 + size) % size;
+	right = (rank + 1) % size;
+	bytes = count * ofi_datatype_size(datatype);
+
+	ret = util_coll_sched_copy(coll_mc, send_buf,
+				   (char *) result + rank * bytes, count,
+				   datatype, NO_BARRIER);
+	if (ret)
+		return ret;
+
+	for (step = 0; step < size - 1; step++) {
+		/* every step talks to the same neighbors, so give each its
+		 * own tag rather than rely on message ordering
+		 */
+		tag = util_coll_get_next_tag(coll_mc);
+		send_idx = (rank - step + size) % size;
+		recv_idx = (rank - step - 1 + size) % size;
+
+		ret = util_coll_sched_recv(coll_mc, left,
+					   (char *) result + recv_idx * bytes,
+					   count, datatype, tag, NO_BARRIER);
+		if (ret)
+			return ret;
+
+		ret = util_coll_sched_send(coll_mc, right,
+					   (char *) result + send_idx * bytes,
+					   count, datatype, tag, BARRIER);
+		if (ret)
+			return ret;
+	}
+	return FI_SUCCESS;
+}
+
+/* Ring reduce-scatter.  Block (rank - step - 1) is passed to the right
+ * neighbor at each step, so that after size - 1 steps the fully reduced
+ * block owned by this rank ends up in acc_buf.
+ */
+static void util_coll_ring_blocks(struct util_coll_mc *coll_mc,
+				  struct util_coll_pipeline *pipe, int step,
+				  int *send_off, int *send_len,
+				  int *recv_off, int *recv_len)
+{
+	int size = coll_mc->av_set->fi_addr_count;
+	int rank = coll_mc->my_rank;
+
+	util_coll_get_block(pipe->count, size,
+			    (rank - step - 1 + 2 * size) % size,
+			    send_off, send_len);
+	util_coll_get_block(pipe->count, size,
+			    (rank - step - 2 + 2 * size) % size,
+			    recv_off, recv_len);
+}
+
+static int util_coll_reduce_scatter_xfer(struct util_coll_mc *coll_mc,
+					 struct util_coll_pipeline *pipe,
+					 int unit, int is_barrier)
+{
+	size_t dtsize = ofi_datatype_size(pipe->datatype);
+	int size, send_off, send_len, recv_off, recv_len;
+	int seg_off, seg_len, ret;
+	uint64_t tag;
+
+	size = coll_mc->av_set->fi_addr_count;
+	util_coll_ring_blocks(coll_mc, pipe, unit / pipe->nseg, &send_off,
+			      &send_len, &recv_off, &recv_len);
+	tag = util_coll_tag_offset(pipe->tag, unit);
+
+	util_coll_pipeline_seg(pipe, unit % pipe->nseg, recv_len,
+			       &seg_off, &seg_len);
+	ret = util_coll_sched_recv(coll_mc, (coll_mc->my_rank - 1 + size) % size,
+				   (char *) pipe->recv_buf + seg_off * dtsize,
+				   seg_len, pipe->datatype, tag, NO_BARRIER);
+	if (ret)
+		return ret;
+
+	util_coll_pipeline_seg(pipe, unit % pipe->nseg, send_len,
+			       &seg_off, &seg_len);
+	return util_coll_sched_send(coll_mc, (coll_mc->my_rank + 1) % size,
+				    (char *) pipe->send_buf +
+				    (send_off + seg_off) * dtsize,
+				    seg_len, pipe->datatype, tag, is_barrier);
+}
+
+static int util_coll_reduce_scatter_reduce(struct util_coll_mc *coll_mc,
+					   struct util_coll_pipeline *pipe,
+					   int unit, int is_barrier)
+{
+	size_t dtsize = ofi_datatype_size(pipe->datatype);
+	int send_off, send_len, recv_off, recv_len;
+	int seg_off, seg_len;
+
+	util_coll_ring_blocks(coll_mc, pipe, unit / pipe->nseg, &send_off,
+			      &send_len, &recv_off, &recv_len);
+	util_coll_pipeline_seg(pipe, unit % pipe->nseg, recv_len,
+			       &seg_off, &seg_len);
+
+	return util_coll_sched_reduce(coll_mc,
+				      (char *) pipe->recv_buf + seg_off * dtsize,
+				      (char *) pipe->send_buf +
+				      (recv_off + seg_off) * dtsize,
+				      seg_len, pipe->datatype, pipe->op,
+				      is_barrier);
+}
+
+static int util_coll_reduce_scatter_ring(struct util_coll_mc *coll_mc,
+					 void *acc_buf, void *scratch_buf,
+					 int count, enum fi_datatype datatype,
+					 enum fi_op op)
+{
+	struct util_coll_pipeline pipe;
+	int size, max_block, nunits;
+
+	size = coll_mc->av_set->fi_addr_count;
+	max_block = ofi_div_ceil(count, size);
+
+	memset(&pipe, 0, sizeof(pipe));
+	pipe.xfer = util_coll_reduce_scatter_xfer;
+	pipe.reduce = util_coll_reduce_scatter_reduce;
+	pipe.send_buf = acc_buf;
+	pipe.recv_buf = scratch_buf;
+	pipe.count = count;
+	pipe.seg_count = util_coll_seg_count(max_block, datatype,
+					     UTIL_COLL_MAX_SEGS / MAX(size - 1, 1));
+	pipe.nseg = ofi_div_ceil(max_block, pipe.seg_count);
+	pipe.datatype = datatype;
+	pipe.op = op;
+
+	nunits = (size - 1) * pipe.nseg;
+	pipe.tag = util_coll_get_next_tags(coll_mc, nunits);
+
+	return util_coll_sched_pipeline(coll_mc, &pipe, nunits);
+}
+
+/* Pairwise exchange: at step i, send to rank + i and receive from rank - i */
+static int util_coll_alltoall(struct util_coll_mc *coll_mc, void *send_buf,
+			      void *result, int count,
+			      enum fi_datatype datatype)
+{
+	uint64_t tag;
+	size_t bytes;
+	int size, rank, step, dest, src;
+	int ret;
+
+	tag = util_coll_get_next_tag(coll_mc);
+	size = coll_mc->av_set->fi_addr_count;
+	rank = coll_mc->my_rank;
+	bytes = count * ofi_datatype_size(datatype);
+
+	ret = util_coll_sched_copy(coll_mc, (char *) send_buf + rank * bytes,
+				   (char *) result + rank * bytes, count,
+				   datatype, NO_BARRIER);
+	if (ret)
+		return ret;
+
+	for (step = 1; step < size; step++) {
+		dest = (rank + step) % size;
+		src = (rank - step + size) % size;
+
+		ret = util_coll_sched_recv(coll_mc, src,
+					   (char *) result + src * bytes,
+					   count, datatype, tag, NO_BARRIER);
+		if (ret)
+			return ret;
+
+		ret = util_coll_sched_send(coll_mc, dest,
+					   (char *) send_buf + dest * bytes,
+					   count, datatype, tag, BARRIER);
+		if (ret)
+			return ret;
+	}
+	return FI_SUCCESS;
+}
+
+/* Returns the number of blocks held by the subtree rooted at vrank in a
+ * binomial tree, and the mask of the edge to its parent.
+ */
+static inline int util_coll_binomial_subtree(int size, int vrank, int *mask)
+{
+	if (!vrank) {
+		for (*mask = 1; *mask < size; *mask <<= 1)
+			;
+		return size;
+	}
+
+	for (*mask = 1; !(vrank & *mask); *mask <<= 1)
+		;
+	return MIN(*mask, size - vrank);
+}
+
+/* Rotate blocks between root-relative and absolute rank order */
+static int util_coll_sched_rotate(struct util_coll_mc *coll_mc, void *in_buf,
+				  void *out_buf, int count,
+				  enum fi_datatype datatype, int root,
+				  int to_relative)
+{
+	size_t bytes;
+	int size, ret;
+	char *in = in_buf, *out = out_buf;
+
+	size = coll_mc->av_set->fi_addr_count;
+	bytes = count * ofi_datatype_size(datatype);
+
+	if (to_relative) {
+		ret = util_coll_sched_copy(coll_mc, in + root * bytes, out,
+					   (size - root) * count, datatype,
+					   NO_BARRIER);
+		if (ret)
+			return ret;
+		return util_coll_sched_copy(coll_mc, in,
+					    out + (size - root) * bytes,
+					    root * count, datatype, NO_BARRIER);
+	}
+
+	ret = util_coll_sched_copy(coll_mc, in, out + root * bytes,
+				   (size - root) * count, datatype, NO_BARRIER);
+	if (ret)
+		return ret;
+	return util_coll_sched_copy(coll_mc, in + (size - root) * bytes, out,
+				    root * count, datatype, NO_BARRIER);
+}
+
+static int util_coll_scatter(struct util_coll_mc *coll_mc, void *send_buf,
+			     void *result, int count,
+			     enum fi_datatype datatype, int root,
+			     void **tmp_buf)
+{
+	uint64_t tag;
+	size_t bytes;
+	char *tmp;
+	int size, rank, vrank, mask, nblocks, peer;
+	int ret;
+
+	tag = util_coll_get_next_tag(coll_mc);
+	size = coll_mc->av_set->fi_addr_count;
+	rank = coll_mc->my_rank;
+	vrank = (rank - root + size) % size;
+	bytes = count * ofi_datatype_size(datatype);
+	nblocks = util_coll_binomial_subtree(size, vrank, &mask);
+
+	if (!vrank && !root) {
+		tmp = send_buf;
+	} else if (nblocks == 1) {
+		tmp = result;
+	} else {
+		tmp = malloc(nblocks * bytes);
+		if (!tmp)
+			return -FI_ENOMEM;
+		*tmp_buf = tmp;
+	}
+
+	if (vrank) {
+		peer = (rank - mask + size) % size;
+		ret = util_coll_sched_recv(coll_mc, peer, tmp, nblocks * count,
+					   datatype, tag, BARRIER);
+	} else if (root) {
+		ret = util_coll_sched_rotate(coll_mc, send_buf, tmp, count,
+					     datatype, root, 1);
+	} else {
+		ret = 0;
+	}
+	if (ret)
+		return ret;
+
+	for (mask >>= 1; mask > 0; mask >>= 1) {
+		if (vrank + mask >= size)
+			continue;
+
+		peer = (rank + mask) % size;
+		ret = util_coll_sched_send(coll_mc, peer, tmp + mask * bytes,
+					   MIN(mask, size - vrank - mask) * count,
+					   datatype, tag, NO_BARRIER);
+		if (ret)
+			return ret;
+	}
+
+	if (tmp == result)
+		return FI_SUCCESS;
+
+	return util_coll_sched_copy(coll_mc, tmp, result, count, datatype,
+				    NO_BARRIER);
+}
+
+static int util_coll_gather(struct util_coll_mc *coll_mc, void *send_buf,
+			    void *result, int count,
+			    enum fi_datatype datatype, int root,
+			    void **tmp_buf)
+{
+	uint64_t tag;
+	size_t bytes;
+	char *tmp;
+	int size, rank, vrank, mask, parent_mask, nblocks, nrecv, peer;
+	int ret;
+
+	tag = util_coll_get_next_tag(coll_mc);
+	size = coll_mc->av_set->fi_addr_count;
+	rank = coll_mc->my_rank;
+	vrank = (rank - root + size) % size;
+	bytes = count * ofi_datatype_size(datatype);
+	nblocks = util_coll_binomial_subtree(size, vrank, &parent_mask);
+
+	if (!vrank && !root) {
+		tmp = result;
+	} else if (nblocks == 1) {
+		tmp = send_buf;
+	} else {
+		tmp = malloc(nblocks * bytes);
+		if (!tmp)
+			return -FI_ENOMEM;
+		*tmp_buf = tmp;
+	}
+
+	if (tmp != send_buf) {
+		ret = util_coll_sched_copy(coll_mc, send_buf, tmp, count,
+					   datatype, NO_BARRIER);
+		if (ret)
+			return ret;
+	}
+
+	/* receive from all children at once, then forward the subtree */
+	for (mask = 1, nrecv = 0; mask < parent_mask; mask <<= 1) {
+		if (vrank + mask < size)
+			nrecv++;
+	}
+
+	for (mask = 1; mask < parent_mask; mask <<= 1) {
+		if (vrank + mask >= size)
+			continue;
+
+		peer = (rank + mask) % size;
+		ret = util_coll_sched_recv(coll_mc, peer, tmp + mask * bytes,
+					   MIN(mask, size - vrank - mask) * count,
+					   datatype, tag,
+					   --nrecv ? NO_BARRIER : BARRIER);
+		if (ret)
+			return ret;
+	}
+
+	if (vrank) {
+		peer = (rank - parent_mask + size) % size;
+		return util_coll_sched_send(coll_mc, peer, tmp, nblocks * count,
+					    datatype, tag, NO_BARRIER);
+	}
+
+	if (!root)
+		return FI_SUCCESS;
+
+	return util_coll_sched_rotate(coll_mc, tmp, result, count, datatype,
+				      root, 0);
+}
+
 static int util_coll_close(struct fid *fid)
 {
 	struct util_coll_mc *coll_mc;
+	struct util_ep *ep;
 
 	coll_mc = container_of(fid, struct util_coll_mc,
 			       mc_fid.fid);
+	if (coll_mc->ep) {
+		ep = container_of(coll_mc->ep, struct util_ep, ep_fid);
+		ofi_ep_lock_acquire(ep);
+		dlist_remove(&coll_mc->ready_entry);
+		ofi_ep_lock_release(ep);
+	}
 	free(coll_mc);
 	return FI_SUCCESS;
 }
@@ -451,6 +1166,17 @@ static struct fi_ops util_coll_fi_ops = {
  * e.g. require local address to be in AV?
  * Determine best way to handle first join request
  */
+static int util_coll_get_rank(struct util_av_set *av_set, fi_addr_t addr)
+{
+	int i;
+
+	for (i = 0; i < av_set->fi_addr_count; i++) {
+		if (av_set->fi_addr_array[i] == addr)
+			return i;
+	}
+	return -1;
+}
+
 static int util_coll_find_my_rank(struct fid_ep *ep,
 				  struct util_coll_mc *coll_mc)
 {
@@ -475,8 +1201,9 @@ static int util_coll_find_my_rank(struct fid_ep *ep,
 		free(addr);
 		return ret;
 	}
-	coll_mc->my_rank =
-		ofi_av_lookup_fi_addr(coll_mc->av_set->av, addr);
+	coll_mc->my_rank = util_coll_get_rank(coll_mc->av_set,
+			ofi_av_lookup_fi_addr(coll_mc->av_set->av, addr));
+	free(addr);
 
 	return FI_SUCCESS;
 }
@@ -528,200 +1255,120 @@ void util_coll_join_comp(struct util_coll_mc *coll_mc,
 			"join collective - eq write failed\n");
 }
 
-void util_coll_barrier_comp(struct util_coll_mc *coll_mc,
-			    struct util_coll_comp_item *comp)
+void util_coll_collective_comp(struct util_coll_mc *coll_mc,
+			       struct util_coll_comp_item *comp)
 {
-/* TODO: We should write a completion to the CQ, not the EQ
-	struct fi_eq_err_entry entry;
 	struct util_ep *ep;
-	ssize_t bytes;
 
-	memset(&entry, 0, sizeof(entry));
-	entry.fid = &coll_mc->mc_fid.fid;
-	entry.context = coll_mc->mc_fid.fid.context;
-	bytes = sizeof(struct fi_eq_entry);
 	free(comp->data);
 
-	ep  = container_of(coll_mc->ep, struct util_ep, ep_fid);
-	if (ofi_eq_write(&ep->eq->eq_fid, FI_COLL,
-			 &entry, (size_t) bytes, FI_COLLECTIVE) < 0)
-		FI_WARN(ep->domain->fabric->prov, FI_LOG_DOMAIN,
-			"barrier collective - eq write failed\n");
-*/
-}
+	ep = container_of(coll_mc->ep, struct util_ep, ep_fid);
+	if (!ep->tx_cq)
+		return;
 
-/* TODO: We can probably use the atomic defines for these, rather than
- * duplicate the definitions here
- */
-#define UTIL_COLL_REDUCE_FUNC(src,dst,cnt,OP,TYPE)	\
-		do { \
-			int i; \
-			TYPE *d = (dst); \
-			TYPE *s = (src); \
-			for (i=0; i<(cnt); i++) {\
-				OP(d[i],s[i]); \
-			} \
-		} while (0)
-
-#define SWITCH_REDUCE(type,FUNC,src,dst,cnt,OP)		\
-switch (type) {							 \
-		case FI_INT8:	FUNC(src,dst,cnt,OP,int8_t); break; \
-		case FI_UINT8:	FUNC(src,dst,cnt,OP,uint8_t); break; \
-		case FI_INT16:	FUNC(src,dst,cnt,OP,int16_t); break; \
-		case FI_UINT16: FUNC(src,dst,cnt,OP,uint16_t); break; \
-		case FI_INT32:	FUNC(src,dst,cnt,OP,int32_t); break; \
-		case FI_UINT32: FUNC(src,dst,cnt,OP,uint32_t); break; \
-		case FI_INT64:	FUNC(src,dst,cnt,OP,int64_t); break; \
-		case FI_UINT64: FUNC(src,dst,cnt,OP,uint64_t); break; \
-		default: return -FI_EOPNOTSUPP; \
-		}
-
-#define UTIL_COLL_MIN(dst,src)	if ((dst) > (src)) (dst) = (src)
-#define UTIL_COLL_MAX(dst,src)	if ((dst) < (src)) (dst) = (src)
-#define UTIL_COLL_SUM(dst,src)	(dst) += (src)
-#define UTIL_COLL_PROD(dst,src)	(dst) *= (src)
-#define UTIL_COLL_LOR(dst,src)	(dst) = (dst) || (src)
-#define UTIL_COLL_LAND(dst,src)	(dst) = (dst) && (src)
-#define UTIL_COLL_BOR(dst,src)	(dst) |= (src)
-#define UTIL_COLL_BAND(dst,src)	(dst) &= (src)
-#define UTIL_COLL_LXOR(dst,src)	(dst) = ((dst) && !(src)) || (!(dst) && (src))
-#define UTIL_COLL_BXOR(dst,src)	(dst) ^= (src)
+	if (ofi_cq_write(ep->tx_cq, comp->context, FI_COLLECTIVE, 0,
+			 NULL, 0, 0))
+		FI_WARN(ep->domain->fabric->prov, FI_LOG_CQ,
+			"collective - cq write failed\n");
+}
 
 static int util_coll_proc_reduce_item(struct util_coll_mc *coll_mc,
 				      struct util_coll_reduce_item *reduce_item)
 {
-	switch (reduce_item->op) {
-	case FI_MIN:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_MIN);
-		break;
-	case FI_MAX:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_MAX);
-		break;
-	case FI_SUM:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_SUM);
-		break;
-	case FI_PROD:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_PROD);
-		break;
-	case FI_LOR:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_LOR);
-		break;
-	case FI_LAND:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_LAND);
-		break;
-	case FI_BOR:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_BOR);
-		break;
-	case FI_BAND:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_BAND);
-		break;
-	case FI_LXOR:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_LXOR);
-		break;
-	case FI_BXOR:
-		SWITCH_REDUCE(reduce_item->datatype, UTIL_COLL_REDUCE_FUNC,
-			      reduce_item->in_buf, reduce_item->inout_buf,
-			      reduce_item->count, UTIL_COLL_BXOR);
-		break;
-	case FI_ATOMIC_READ:
-	case FI_ATOMIC_WRITE:
-	case FI_CSWAP:
-	case FI_CSWAP_NE:
-	case FI_CSWAP_LE:
-	case FI_CSWAP_LT:
-	case FI_CSWAP_GE:
-	case FI_CSWAP_GT:
-	case FI_MSWAP:
-	case FI_ATOMIC_OP_LAST:
-	case FI_BARRIER:
-	case FI_BROADCAST:
-	case FI_ALLTOALL:
-	case FI_ALLGATHER:
-	default:
-		return -FI_ENOSYS;
-	};
+	if (reduce_item->op > FI_BXOR ||
+	    !ofi_atomic_reduce_handlers[reduce_item->op][reduce_item->datatype])
+		return -FI_EOPNOTSUPP;
+
+	ofi_atomic_reduce_handlers[reduce_item->op][reduce_item->datatype]
+		(reduce_item->inout_buf, reduce_item->in_buf,
+		 reduce_item->count);
 	return FI_SUCCESS;
 }
 
+static int util_coll_match_entry(struct slist_entry *entry, const void *arg)
+{
+	return entry == arg;
+}
+
+/* Should only be called while holding the EP's lock */
+static void util_coll_set_ready(struct util_coll_mc *coll_mc)
+{
+	struct util_ep *ep = container_of(coll_mc->ep, struct util_ep, ep_fid);
+
+	if (dlist_empty(&coll_mc->ready_entry))
+		dlist_insert_tail(&coll_mc->ready_entry, &ep->coll_ready_queue);
+}
+
+static ssize_t util_coll_post_xfer(struct util_coll_mc *coll_mc,
+				   struct util_coll_xfer_item *xfer_item)
+{
+	struct fi_msg_tagged msg = {0};
+	struct iovec iov;
+
+	iov.iov_base = xfer_item->buf;
+	iov.iov_len = (xfer_item->count *
+		       ofi_datatype_size(xfer_item->datatype));
+	msg.msg_iov = &iov;
+	msg.iov_count = 1;
+	msg.tag = xfer_item->hdr.tag;
+	msg.context = (void *) xfer_item;
+
+	if (xfer_item->hdr.type == UTIL_COLL_SEND) {
+		msg.addr = coll_mc->av_set->fi_addr_array[xfer_item->dest_rank];
+		return fi_tsendmsg(coll_mc->ep, &msg, FI_COLLECTIVE);
+	}
+
+	msg.addr = coll_mc->av_set->fi_addr_array[xfer_item->src_rank];
+	return fi_trecvmsg(coll_mc->ep, &msg, FI_COLLECTIVE);
+}
+
+/* Should only be called while holding the EP's lock.  The lock is dropped
+ * while transfers are posted.
+ */
 static int util_coll_process_work_items(struct util_coll_mc *coll_mc)
 {
+	struct util_ep *ep = container_of(coll_mc->ep, struct util_ep, ep_fid);
 	struct util_coll_hdr *hdr;
-	struct util_coll_xfer_item *xfer_item;
 	struct util_coll_reduce_item *reduce_item;
 	struct util_coll_copy_item *copy_item;
 	struct util_coll_comp_item *comp_item;
 	struct slist_entry *entry;
-	struct fi_msg_tagged msg = {0};
-	struct iovec iov;
-	int ret;
+	int is_barrier;
+	ssize_t ret;
 
 	while (!slist_empty(&coll_mc->deferred_list)) {
 		entry = slist_remove_head(&coll_mc->deferred_list);
 		hdr = container_of(entry, struct util_coll_hdr, entry);
+		is_barrier = hdr->is_barrier;
 		switch (hdr->type) {
 		case UTIL_COLL_SEND:
-			xfer_item = (struct util_coll_xfer_item *) hdr;
-			iov.iov_base = xfer_item->buf;
-			iov.iov_len = (xfer_item->count *
-				       ofi_datatype_size(xfer_item->datatype));
-			msg.msg_iov = &iov;
-			msg.iov_count = 1;
-			msg.addr = coll_mc->av_set->fi_addr_array[xfer_item->dest_rank];
-			msg.tag = hdr->tag;
-			msg.context = (void *) coll_mc;
-			do {
-				ret = fi_tsendmsg(coll_mc->ep, &msg, FI_COLLECTIVE);
-				if (ret && ret != -EAGAIN) {
-					slist_insert_head(&xfer_item->hdr.entry,
-							  &coll_mc->deferred_list);
-					return ret;
-				}
-			} while (ret == -EAGAIN);
-
-			slist_insert_tail(entry, &coll_mc->barrier_list);
-			break;
 		case UTIL_COLL_RECV:
-			xfer_item = (struct util_coll_xfer_item *) hdr;
-			iov.iov_base = xfer_item->buf;
-			iov.iov_len = (xfer_item->count *
-				       ofi_datatype_size(xfer_item->datatype));
-			msg.msg_iov = &iov;
-			msg.iov_count = 1;
-			msg.addr = coll_mc->av_set->fi_addr_array[xfer_item->src_rank];
-			msg.tag = hdr->tag;
-			msg.context = (void *) coll_mc;
-
-			ret = fi_trecvmsg(coll_mc->ep, &msg, FI_COLLECTIVE);
+			/* the transfer may complete, and the item be freed,
+			 * before the call returns */
+			slist_insert_tail(entry, &coll_mc->barrier_list);
+			ofi_ep_lock_release(ep);
+			ret = util_coll_post_xfer(coll_mc,
+					(struct util_coll_xfer_item *) hdr);
+			ofi_ep_lock_acquire(ep);
 			if (ret) {
-				return ret;
+				slist_remove_first_match(&coll_mc->barrier_list,
+							 util_coll_match_entry,
+							 entry);
+				slist_insert_head(entry, &coll_mc->deferred_list);
+				if (ret != -FI_EAGAIN)
+					return (int) ret;
+
+				/* retried from EP progress */
+				util_coll_set_ready(coll_mc);
+				return FI_SUCCESS;
 			}
-
-			slist_insert_tail(entry, &coll_mc->barrier_list);
 			break;
 		case UTIL_COLL_REDUCE:
 			reduce_item = (struct util_coll_reduce_item *) hdr;
 			ret = util_coll_proc_reduce_item(coll_mc, reduce_item);
 			free(reduce_item);
 			if (ret)
-				return ret;
+				return (int) ret;
 			break;
 		case UTIL_COLL_COPY:
 			copy_item = (struct util_coll_copy_item *) hdr;
@@ -731,6 +1378,13 @@ static int util_coll_process_work_items(struct util_coll_mc *coll_mc)
 			free(copy_item);
 			break;
 		case UTIL_COLL_COMP:
+			/* buffers may not be released to the user while any
+			 * transfer of the operation is still outstanding */
+			if (!slist_empty(&coll_mc->barrier_list)) {
+				slist_insert_head(entry, &coll_mc->deferred_list);
+				coll_mc->barrier_wait = 1;
+				return FI_SUCCESS;
+			}
 			comp_item = (struct util_coll_comp_item *) hdr;
 			if (comp_item->comp_fn)
 				comp_item->comp_fn(coll_mc, comp_item);
@@ -740,24 +1394,35 @@ static int util_coll_process_work_items(struct util_coll_mc *coll_mc)
 			break;
 		}
 
-		if (hdr->is_barrier &&
-		    !slist_empty(&coll_mc->barrier_list)) {
+		if (is_barrier && !slist_empty(&coll_mc->barrier_list)) {
+			coll_mc->barrier_wait = 1;
 			break;
 		}
 	}
 	return FI_SUCCESS;
 }
 
-static int util_coll_schedule(struct util_coll_mc *coll_mc)
+/* Queues the work built for an operation behind that of earlier ones, and
+ * runs as much of it as it can.
+ */
+static int util_coll_sched_commit(struct util_coll_mc *coll_mc)
 {
-	int ret;
+	struct util_ep *ep = container_of(coll_mc->ep, struct util_ep, ep_fid);
+	int ret = FI_SUCCESS;
+
+	ofi_ep_lock_acquire(ep);
+	if (slist_empty(&coll_mc->deferred_list)) {
+		slist_swap(&coll_mc->deferred_list, &coll_mc->build_list);
+	} else if (!slist_empty(&coll_mc->build_list)) {
+		coll_mc->deferred_list.tail->next = coll_mc->build_list.head;
+		coll_mc->deferred_list.tail = coll_mc->build_list.tail;
+		slist_init(&coll_mc->build_list);
+	}
 
-	if (slist_empty(&coll_mc->barrier_list)) {
+	if (!coll_mc->barrier_wait)
 		ret = util_coll_process_work_items(coll_mc);
-		if (ret)
-			return ret;
-	}
-	return FI_SUCCESS;
+	ofi_ep_lock_release(ep);
+	return ret;
 }
 
 int ofi_join_collective(struct fid_ep *ep, fi_addr_t coll_addr,
@@ -768,8 +1433,14 @@ int ofi_join_collective(struct fid_ep *ep, fi_addr_t coll_addr,
 	struct util_av_set *av_set;
 	struct util_coll_mc *coll_mc;
 	struct util_coll_join_comp_data *comp_data;
+	struct util_ep *util_ep;
 	int ret;
 
+	/* the join completes through the EP's event queue */
+	util_ep = container_of(ep, struct util_ep, ep_fid);
+	if (!util_ep->eq)
+		return -FI_ENOEQ;
+
 	av_set = container_of(set, struct util_av_set, av_set_fid);
 
 	if (coll_addr == FI_ADDR_NOTAVAIL) {
@@ -821,28 +1492,95 @@ int ofi_join_collective(struct fid_ep *ep, fi_addr_t coll_addr,
 	if (ret)
 		goto err2;
 
-	ret = util_coll_sched_comp(coll_mc, UTIL_COLL_JOIN_OP,
-			     comp_data, util_coll_join_comp);
+	ret = util_coll_sched_comp(coll_mc, UTIL_COLL_JOIN_OP, comp_data,
+				   NULL, util_coll_join_comp);
 	if (ret)
 		goto err2;
 
 	*mc = &new_coll_mc->mc_fid;
-	util_coll_schedule(coll_mc);
+	util_coll_sched_commit(coll_mc);
 	return FI_SUCCESS;
 
 err2:
+	util_coll_sched_abort(coll_mc);
 	free(comp_data);
 err1:
 	free(new_coll_mc);
 	return ret;
 }
 
+void ofi_coll_init(void)
+{
+	fi_param_define(NULL, "coll_segment_size", FI_PARAM_SIZE_T,
+			"Size in bytes of the segments that large collective"
+			" buffers are split into.  The reduction or forwarding"
+			" of one segment is overlapped with the transfer of the"
+			" next.  Setting this to 0 disables segmentation."
+			" (default: 32768)");
+	fi_param_get_size_t(NULL, "coll_segment_size", &util_coll_seg_size);
+}
+
+/* Scatter is queried as FI_BROADCAST with FI_SCATTER set, the way
+ * reduce-scatter is queried as its reduction op with FI_SCATTER set.
+ */
+int ofi_query_collective(struct fid_domain *domain, enum fi_datatype datatype,
+			 enum fi_op op, struct fi_atomic_attr *attr,
+			 uint64_t flags)
+{
+	switch (op) {
+	case FI_BARRIER:
+		if (datatype != FI_VOID)
+			return -FI_EOPNOTSUPP;
+		break;
+	case FI_BROADCAST:
+	case FI_ALLTOALL:
+	case FI_ALLGATHER:
+	case FI_GATHER:
+		if (datatype >= FI_DATATYPE_LAST)
+			return -FI_EOPNOTSUPP;
+		break;
+	default:
+		if (op > FI_BXOR || datatype >= FI_DATATYPE_LAST ||
+		    !ofi_atomic_reduce_handlers[op][datatype])
+			return -FI_EOPNOTSUPP;
+		break;
+	}
+
+	if (attr) {
+		attr->size = (datatype == FI_VOID) ?
+			     0 : ofi_datatype_size(datatype);
+		/* element counts are handled as int */
+		attr->count = INT_MAX;
+	}
+	return FI_SUCCESS;
+}
+
 static struct fi_ops_av_set util_av_set_ops= {
 	.set_union	= 	ofi_av_set_union,
 	.intersect	=	ofi_av_set_intersect,
 	.diff		=	ofi_av_set_diff,
 	.insert		=	ofi_av_set_insert,
 	.remove		=	ofi_av_set_remove,
+	.addr		=	ofi_av_set_addr,
+};
+
+static int util_av_set_close(struct fid *fid)
+{
+	struct util_av_set *av_set;
+
+	av_set = container_of(fid, struct util_av_set, av_set_fid.fid);
+	fastlock_destroy(&av_set->lock);
+	free(av_set->fi_addr_array);
+	free(av_set);
+	return FI_SUCCESS;
+}
+
+static struct fi_ops util_av_set_fi_ops = {
+	.size = sizeof(struct fi_ops),
+	.close = util_av_set_close,
+	.bind = fi_no_bind,
+	.control = fi_no_control,
+	.ops_open = fi_no_ops_open,
 };
 
 static int util_coll_copy_from_av(struct util_av *av, void *addr,
@@ -937,8 +1675,10 @@ int ofi_av_set(struct fid_av *av, struct fi_av_set_attr *attr,
 
 	av_set->fi_addr_array =
 		calloc(util_av->count, sizeof(*av_set->fi_addr_array));
-	if (!av_set->fi_addr_array)
+	if (!av_set->fi_addr_array) {
+		ret = -FI_ENOMEM;
 		goto err2;
+	}
 
 	for (iter = 0; iter < attr->count; iter++) {
 
@@ -950,6 +1690,7 @@ int ofi_av_set(struct fid_av *av, struct fi_av_set_attr *attr,
 	av_set->av = util_av;
 	av_set->av_set_fid.ops = &util_av_set_ops;
 	av_set->av_set_fid.fid.fclass = FI_CLASS_AV_SET;
+	av_set->av_set_fid.fid.ops = &util_av_set_fi_ops;
 	av_set->av_set_fid.fid.context = context;
 	(*av_set_fid) = &av_set->av_set_fid;
 	return FI_SUCCESS;
@@ -963,66 +1704,190 @@ err1:
 ssize_t ofi_ep_barrier(struct fid_ep *ep, fi_addr_t coll_addr, void *context)
 {
 	struct util_coll_mc *coll_mc = (struct util_coll_mc *) coll_addr;
-	struct util_coll_comp_item *comp_item;
+	uint32_t *data;
 	int ret;
 
-	comp_item = calloc(1, sizeof(*comp_item));
-	if (!comp_item)
+	data = calloc(2, sizeof(*data));
+	if (!data)
 		return -FI_ENOMEM;
 
-	comp_item->data = (void *) calloc(1, sizeof(uint32_t));
-	if (!comp_item->data) {
-		ret = -FI_ENOMEM;
-		goto err1;
-	}
-
-	ret = util_coll_allreduce(coll_mc, comp_item->data,
-				  comp_item->data, 1, FI_UINT32,
+	ret = util_coll_allreduce(coll_mc, &data[0], &data[1], 1, FI_UINT32,
 				  FI_BAND);
 	if (ret)
-		goto err2;
+		goto err;
 
-	util_coll_sched_comp(coll_mc, UTIL_COLL_BARRIER_OP,
-			     NULL, util_coll_barrier_comp);
+	ret = util_coll_sched_comp(coll_mc, UTIL_COLL_BARRIER_OP, data,
+				   context, util_coll_collective_comp);
+	if (ret)
+		goto err;
 
-	util_coll_schedule(coll_mc);
+	util_coll_sched_commit(coll_mc);
 	return FI_SUCCESS;
-err2:
-	free(comp_item->data);
-err1:
-	free(comp_item);
+err:
+	util_coll_sched_abort(coll_mc);
+	free(data);
 	return ret;
 }
 
-static int util_coll_match_tag(struct slist_entry *entry, const void *arg)
+void ofi_coll_handle_comp(void *ctx)
 {
-	struct util_coll_xfer_item *item;
-	uint64_t *tag_ptr = (uint64_t *) arg;
+	struct util_coll_xfer_item *item = ctx;
+	struct util_coll_mc *coll_mc = item->coll_mc;
+	struct slist_entry *entry;
+
+	entry = slist_remove_first_match(&coll_mc->barrier_list,
+					 util_coll_match_entry,
+					 &item->hdr.entry);
+	if (!entry)
+		return;
+
+	free(item);
 
-	item = container_of(entry, struct util_coll_xfer_item, hdr.entry);
-	if (item->hdr.tag == *tag_ptr)
-		return 1;
+	if (!slist_empty(&coll_mc->barrier_list))
+		return;
 
-	return 0;
+	coll_mc->barrier_wait = 0;
+	if (!slist_empty(&coll_mc->deferred_list))
+		util_coll_set_ready(coll_mc);
 }
 
-void util_coll_handle_comp(uint64_t tag, void *ctx)
+void ofi_coll_ep_progress(struct fid_ep *ep)
 {
-	struct util_coll_mc *coll_mc = (struct util_coll_mc *) ctx;
-	struct util_coll_xfer_item *item;
-	struct slist_entry *entry;
-	uint64_t *tag_ptr = &tag;
+	struct util_ep *util_ep = container_of(ep, struct util_ep, ep_fid);
+	struct util_coll_mc *coll_mc;
+	struct dlist_entry ready;
+
+	dlist_init(&ready);
+	ofi_ep_lock_acquire(util_ep);
+	dlist_splice_tail(&ready, &util_ep->coll_ready_queue);
+	while (!dlist_empty(&ready)) {
+		dlist_pop_front(&ready, struct util_coll_mc, coll_mc,
+				ready_entry);
+		dlist_init(&coll_mc->ready_entry);
+		if (!coll_mc->barrier_wait)
+			(void) util_coll_process_work_items(coll_mc);
+	}
+	ofi_ep_lock_release(util_ep);
+}
 
-	entry = slist_remove_first_match(&coll_mc->barrier_list,
-					 util_coll_match_tag,
-					 (void *) tag_ptr);
-	if (!entry) {
-		item = container_of(entry, struct util_coll_xfer_item,
-				    hdr.entry);
-		free(item);
+static ssize_t util_coll_ep_reduce(struct util_coll_mc *coll_mc,
+				   const void *buf, int count, void *result,
+				   enum fi_datatype datatype, enum fi_op op,
+				   uint64_t flags, void *context)
+{
+	enum util_coll_op_type op_type;
+	size_t dtsize;
+	char *tmp;
+	int offset, len, ret;
+
+	if (op > FI_BXOR || datatype >= FI_DATATYPE_LAST ||
+	    !ofi_atomic_reduce_handlers[op][datatype])
+		return -FI_EOPNOTSUPP;
+
+	dtsize = ofi_datatype_size(datatype);
+
+	/* the reduction accumulates in place, so work on a copy of buf */
+	tmp = malloc(count * dtsize * 2);
+	if (!tmp)
+		return -FI_ENOMEM;
+
+	ret = util_coll_sched_copy(coll_mc, (void *) buf, tmp, count, datatype,
+				   NO_BARRIER);
+	if (ret)
+		goto err;
+
+	if (flags & FI_SCATTER) {
+		op_type = UTIL_COLL_REDUCE_SCATTER_OP;
+		ret = util_coll_reduce_scatter_ring(coll_mc, tmp,
+						    tmp + count * dtsize,
+						    count, datatype, op);
+		if (ret)
+			goto err;
+
+		util_coll_get_block(count, coll_mc->av_set->fi_addr_count,
+				    coll_mc->my_rank, &offset, &len);
+		ret = util_coll_sched_copy(coll_mc, tmp + offset * dtsize,
+					   result, len, datatype, NO_BARRIER);
+	} else {
+		op_type = UTIL_COLL_ALLREDUCE_OP;
+		ret = util_coll_allreduce(coll_mc, tmp, tmp + count * dtsize,
+					  count, datatype, op);
+		if (ret)
+			goto err;
+
+		ret = util_coll_sched_copy(coll_mc, tmp, result, count,
+					   datatype, NO_BARRIER);
 	}
+	if (ret)
+		goto err;
 
-	util_coll_schedule(coll_mc);
+	ret = util_coll_sched_comp(coll_mc, op_type, tmp, context,
+				   util_coll_collective_comp);
+	if (ret)
+		goto err;
+
+	return FI_SUCCESS;
+err:
+	util_coll_sched_abort(coll_mc);
+	free(tmp);
+	return ret;
+}
+
+static ssize_t util_coll_ep_allgather(struct util_coll_mc *coll_mc,
+				      const void *buf, int count, void *result,
+				      enum fi_datatype datatype, void *context)
+{
+	size_t bytes;
+	void *tmp = NULL;
+	int size, ret;
+
+	size = coll_mc->av_set->fi_addr_count;
+	bytes = count * ofi_datatype_size(datatype);
+
+	if (bytes * size < UTIL_COLL_ALLGATHER_RING_THRESHOLD) {
+		tmp = malloc(bytes * size);
+		if (!tmp)
+			return -FI_ENOMEM;
+
+		ret = util_coll_allgather_bruck(coll_mc, (void *) buf, result,
+						count, datatype, tmp);
+	} else {
+		ret = util_coll_allgather_ring(coll_mc, (void *) buf, result,
+					       count, datatype);
+	}
+	if (ret)
+		goto err;
+
+	ret = util_coll_sched_comp(coll_mc, UTIL_COLL_ALLGATHER_OP, tmp,
+				   context, util_coll_collective_comp);
+	if (ret)
+		goto err;
+
+	return FI_SUCCESS;
+err:
+	util_coll_sched_abort(coll_mc);
+	free(tmp);
+	return ret;
+}
+
+static ssize_t util_coll_ep_alltoall(struct util_coll_mc *coll_mc,
+				     const void *buf, int count, void *result,
+				     enum fi_datatype datatype, void *context)
+{
+	int size, ret;
+
+	size = coll_mc->av_set->fi_addr_count;
+	if (count % size)
+		return -FI_EINVAL;
+
+	ret = util_coll_alltoall(coll_mc, (void *) buf, result, count / size,
+				 datatype);
+	if (!ret)
+		ret = util_coll_sched_comp(coll_mc, UTIL_COLL_ALLTOALL_OP, NULL,
+					   context, util_coll_collective_comp);
+	if (ret)
+		util_coll_sched_abort(coll_mc);
+	return ret;
 }
 
 ssize_t ofi_ep_writeread(struct fid_ep *ep, const void *buf, size_t count,
@@ -1030,7 +1895,126 @@ ssize_t ofi_ep_writeread(struct fid_ep *ep, const void *buf, size_t count,
 		     fi_addr_t coll_addr, enum fi_datatype datatype,
 		     enum fi_op op, uint64_t flags, void *context)
 {
-	return -FI_ENOSYS;
+	struct util_coll_mc *coll_mc = (struct util_coll_mc *) coll_addr;
+	ssize_t ret;
+
+	if (op == FI_BARRIER)
+		return ofi_ep_barrier(ep, coll_addr, context);
+
+	if (datatype >= FI_DATATYPE_LAST || count > INT_MAX)
+		return -FI_EINVAL;
+
+	switch (op) {
+	case FI_ALLGATHER:
+		ret = util_coll_ep_allgather(coll_mc, buf, count, result,
+					     datatype, context);
+		break;
+	case FI_ALLTOALL:
+		ret = util_coll_ep_alltoall(coll_mc, buf, count, result,
+					    datatype, context);
+		break;
+	case FI_BROADCAST:
+		/* broadcast requires a root, see ofi_ep_broadcast */
+		return -FI_EINVAL;
+	default:
+		ret = util_coll_ep_reduce(coll_mc, buf, count, result,
+					  datatype, op, flags, context);
+		break;
+	}
+	if (ret)
+		return ret;
+
+	util_coll_sched_commit(coll_mc);
+	return FI_SUCCESS;
+}
+
+ssize_t ofi_ep_broadcast(struct fid_ep *ep, void *buf, size_t count, void *desc,
+			 fi_addr_t coll_addr, fi_addr_t root_addr,
+			 enum fi_datatype datatype, uint64_t flags,
+			 void *context)
+{
+	struct util_coll_mc *coll_mc = (struct util_coll_mc *) coll_addr;
+	int root, ret;
+
+	root = util_coll_get_rank(coll_mc->av_set, root_addr);
+	if (root < 0 || datatype >= FI_DATATYPE_LAST || count > INT_MAX)
+		return -FI_EINVAL;
+
+	ret = util_coll_bcast(coll_mc, buf, count, datatype, root);
+	if (!ret)
+		ret = util_coll_sched_comp(coll_mc, UTIL_COLL_BROADCAST_OP, NULL,
+					   context, util_coll_collective_comp);
+	if (ret) {
+		util_coll_sched_abort(coll_mc);
+		return ret;
+	}
+
+	util_coll_sched_commit(coll_mc);
+	return FI_SUCCESS;
+}
+
+ssize_t ofi_ep_scatter(struct fid_ep *ep, const void *buf, size_t count,
+		       void *desc, void *result, void *result_desc,
+		       fi_addr_t coll_addr, fi_addr_t root_addr,
+		       enum fi_datatype datatype, uint64_t flags,
+		       void *context)
+{
+	struct util_coll_mc *coll_mc = (struct util_coll_mc *) coll_addr;
+	void *tmp = NULL;
+	int root, ret;
+
+	root = util_coll_get_rank(coll_mc->av_set, root_addr);
+	if (root < 0 || datatype >= FI_DATATYPE_LAST || count > INT_MAX)
+		return -FI_EINVAL;
+
+	ret = util_coll_scatter(coll_mc, (void *) buf, result, count,
+				datatype, root, &tmp);
+	if (ret)
+		goto err;
+
+	ret = util_coll_sched_comp(coll_mc, UTIL_COLL_SCATTER_OP, tmp,
+				   context, util_coll_collective_comp);
+	if (ret)
+		goto err;
+
+	util_coll_sched_commit(coll_mc);
+	return FI_SUCCESS;
+err:
+	util_coll_sched_abort(coll_mc);
+	free(tmp);
+	return ret;
+}
+
+ssize_t ofi_ep_gather(struct fid_ep *ep, const void *buf, size_t count,
+		      void *desc, void *result, void *result_desc,
+		      fi_addr_t coll_addr, fi_addr_t root_addr,
+		      enum fi_datatype datatype, uint64_t flags,
+		      void *context)
+{
+	struct util_coll_mc *coll_mc = (struct util_coll_mc *) coll_addr;
+	void *tmp = NULL;
+	int root, ret;
+
+	root = util_coll_get_rank(coll_mc->av_set, root_addr);
+	if (root < 0 || datatype >= FI_DATATYPE_LAST || count > INT_MAX)
+		return -FI_EINVAL;
+
+	ret = util_coll_gather(coll_mc, (void *) buf, result, count,
+			       datatype, root, &tmp);
+	if (ret)
+		goto err;
+
+	ret = util_coll_sched_comp(coll_mc, UTIL_COLL_GATHER_OP, tmp,
+				   context, util_coll_collective_comp);
+	if (ret)
+		goto err;
+
+	util_coll_sched_commit(coll_mc);
+	return FI_SUCCESS;
+err:
+	util_coll_sched_abort(coll_mc);
+	free(tmp);
+	return ret;
 }
 
 
@@ -1038,5 +2022,13 @@ ssize_t ofi_ep_writereadmsg(struct fid_ep *ep, const struct fi_msg_collective *m
 			struct fi_ioc *resultv, void **result_desc,
 			size_t result_count, uint64_t flags)
 {
-	return -FI_ENOSYS;
+	if (msg->iov_count != 1 || result_count != 1)
+		return -FI_EINVAL;
+
+	return ofi_ep_writeread(ep, msg->msg_iov[0].addr, msg->msg_iov[0].count,
+				msg->desc ? msg->desc[0] : NULL,
+				resultv[0].addr,
+				result_desc ? result_desc[0] : NULL,
+				msg->coll_addr, msg->datatype, msg->op,
+				flags, msg->context);
 }
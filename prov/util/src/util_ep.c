@@ -232,6 +232,7 @@ int ofi_endpoint_init(struct fid_domain *domain, const struct util_prov *util_pr
 	ofi_atomic_inc32(&util_domain->ref);
 	if (util_domain->eq)
 		ofi_ep_bind_eq(ep, util_domain->eq);
+	dlist_init(&ep->coll_ready_queue);
 	fastlock_init(&ep->lock);
 	if (ep->domain->threading != FI_THREAD_SAFE) {
 		ep->lock_acquire = ofi_fastlock_acquire_noop;
@@ -46,6 +46,7 @@
 #include "shared/ofi_str.h"
 #include "ofi_prov.h"
 #include "ofi_perf.h"
+#include "ofi_coll.h"
 
 #ifdef HAVE_LIBDL
 #include <dlfcn.h>
@@ -556,6 +557,7 @@ void fi_ini(void)
 	ofi_perf_init();
 	ofi_hook_init();
 	ofi_monitor_init();
+	ofi_coll_init();
 
 	fi_param_define(NULL, "provider", FI_PARAM_STRING,
 			"Only use specified provider (default: all available)");
@@ -618,6 +618,7 @@ static void ofi_tostr_atomic_op(char *buf, enum fi_op op)
 	CASEENUMSTR(FI_BROADCAST);
 	CASEENUMSTR(FI_ALLTOALL);
 	CASEENUMSTR(FI_ALLGATHER);
+	CASEENUMSTR(FI_GATHER);
 	default:
 		ofi_strcatf(buf, "Unknown");
 		break;
@@ -640,6 +641,7 @@ static void ofi_tostr_eq_event(char *buf, int type)
 	CASEENUMSTR(FI_MR_COMPLETE);
 	CASEENUMSTR(FI_AV_COMPLETE);
 	CASEENUMSTR(FI_JOIN_COMPLETE);
+	CASEENUMSTR(FI_CONNECT_COMPLETE);
 	default:
 		ofi_strcatf(buf, "Unknown");
 		break;